@@ -10,6 +10,8 @@
 #include <stdio.h>
 #include "EL_ramp.h"
 #include "sink_buttons.h"
+#include "sink_fuel_gauge.h"
+#include "sink_energy.h"
 
 #define WM8987L_Transfer(a) I2cTransfer ((SLAVE_ADDRESS_MAX14521E_WR), (a), sizeof (a), NULL, 0)
 #define WM8987L_TransferOK(a) (WM8987L_Transfer (a) == 1 + sizeof (a))
@@ -154,6 +156,9 @@ void EL_Ramp_On(void)
 	result = (uint16)write_register2(ADDR_MAX14521E_EL_SEND,  0x00);
 	DEBUG_MAX14521E(("********** ADDR_MAX14521E_EL_SEND  [%d]\n", result)) ;
 	
+	fuelGaugeSetAccessory(fuel_gauge_accessory_el_panel, TRUE);
+	energyConsumerSet(energy_consumer_el_panel, 1);
+	
 	/*
 	result = (uint16)I2cTransfer ((SLAVE_ADDRESS_MAX14521E_WR), ADDR_MAX14521E_EL_SEND, 1, NULL, 0);
 	DEBUG_MAX14521E(("********** ADDR_MAX14521E_EL_SEND  [%d]\n", result)) ;
@@ -167,6 +172,9 @@ void EL_Ramp_Off(void)
 	DEBUG_MAX14521E(("********** ADDR_MAX14521E_POWER_MODE  [%d]\n", result)) ;
 	result = (uint16)write_register2(ADDR_MAX14521E_EL_SEND,  0x00);
 	DEBUG_MAX14521E(("********** ADDR_MAX14521E_EL_SEND  [%d]\n", result)) ;
+	
+	fuelGaugeSetAccessory(fuel_gauge_accessory_el_panel, FALSE);
+	energyConsumerSet(energy_consumer_el_panel, 0);
 }
 #endif
 
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include "accelerator_system.h"
 #include "sink_buttons.h"
+#include "sink_energy.h"
 
 #define WM8987L_Write(a) I2cTransfer ((SLAVE_ADDRESS_MMA8452Q_WR), (a), sizeof(a), NULL, 0)
 #define WM8987L_WriteOK(a) (WM8987L_Write (a) == 1 + sizeof(a))
@@ -160,6 +161,7 @@ void MMA845x_Init(void)
 void MMA845x_Active(void)
 {
 	IIC_RegWrite(CTRL_REG1, (IIC_RegRead(CTRL_REG1) | ACTIVE_MASK));
+	energyConsumerSet(energy_consumer_accelerometer, 1);
 }
 
 void MMA845x_Standby(void)
@@ -172,6 +174,7 @@ void MMA845x_Standby(void)
 	*/
 	n = IIC_RegRead(CTRL_REG1);
 	IIC_RegWrite(CTRL_REG1, n & ~ACTIVE_MASK);
+	energyConsumerSet(energy_consumer_accelerometer, 0);
 }
 
 /*********************************************************\
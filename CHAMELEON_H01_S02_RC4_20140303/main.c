@@ -68,6 +68,7 @@ NOTES
 #endif
 #ifdef ENABLE_PBAP
 #include "sink_pbap.h"
+#include "sink_callerid.h"
 #endif
 #ifdef ENABLE_MAPC
 #include "sink_mapc.h"
@@ -91,6 +92,7 @@ NOTES
 
 #include "sink_audio.h"
 #include "sink_at_commands.h"
+#include "sink_energy.h"
 #include "vm.h"
 
 #ifdef TEST_HARNESS
@@ -641,6 +643,7 @@ static void handleUEMessage  ( Task task, MessageId id, Message message )
 		#endif
 
 		MessageCancelAll (&theSink.task, EventXYZSamplingMode);
+		energyConsumerSet(energy_consumer_pedometer, 0);
 		MMA845x_Standby();
 		
             /* don't indicate event if already in limbo state */
@@ -651,6 +654,9 @@ static void handleUEMessage  ( Task task, MessageId id, Message message )
                 stateManagerEnterLimboState();
                 AuthResetConfirmationFlags();
                 
+                /* write back cached device attributes before the links are dropped */
+                deviceManagerFlushAttributes();
+                
                 VolumeSetMicrophoneGain(hfp_invalid_link, VOLUME_MUTE_OFF);
                 sinkClearQueueudEvent();                
     
@@ -2522,7 +2528,8 @@ static void handleUEMessage  ( Task task, MessageId id, Message message )
        /* check whether the current routed audio is still the correct one and
           change sources if appropriate */
        case EventCheckAudioRouting:
-            /* check audio routing */
+            /* check audio routing, even if none of the routing inputs have changed */
+            audioRoutingInvalidate();
             audioHandleRouting(audio_source_none);    
             /* don't indicate event as may be generated by USB prior to configuration
                being loaded */
@@ -2809,6 +2816,7 @@ static void handleUEMessage  ( Task task, MessageId id, Message message )
 
 			
 			MessageCancelAll (&theSink.task, EventXYZSamplingMode);
+			energyConsumerSet(energy_consumer_pedometer, 0);
 			MMA845x_Standby();
 		}
 		else
@@ -2820,6 +2828,7 @@ static void handleUEMessage  ( Task task, MessageId id, Message message )
 			MMA845x_Active();
 			full_scale= FULL_SCALE_2G;
 			MessageSendLater( &theSink.task , EventXYZSamplingMode , 0 , DEFAULT_XYZ_SAMPLING_INTERVAL) ;
+			energyConsumerSet(energy_consumer_pedometer, 1);
 			#ifdef PEDOMETER_SUPPORTED
 			 pedometer_init();
 			#endif
@@ -3145,20 +3154,35 @@ static void handleHFPMessage  ( Task task, MessageId id, Message message )
     case HFP_CALLER_ID_IND:
         {
             HFP_CALLER_ID_IND_T *ind = (HFP_CALLER_ID_IND_T *) message;
+            uint16 size_name = ind->size_name;
+            const uint8 *name = ind->caller_info + ind->offset_name;
  
             /* ensure this is not a HSP profile */
             DEBUG(("HFP_CALLER_ID_IND number %s", ind->caller_info + ind->offset_number));
             DEBUG((" name %s\n", ind->caller_info + ind->offset_name));
             
+#ifdef ENABLE_PBAP
+            /* AG did not send a name, look the number up in the phonebook pulled earlier */
+            if (!size_name)
+            {
+                name = callerIdLookup(ind->size_number, ind->caller_info + ind->offset_number, &size_name);
+                if (!name)
+                    size_name = 0;
+            }
+#endif
+            
             /* Show name or number on display */
             if (ind->size_name)
                 displayShowSimpleText((char *) ind->caller_info + ind->offset_name, 1);
             
+            else if (size_name)
+                displayShowText((char *) name, size_name, 1, DISPLAY_TEXT_SCROLL_SCROLL, 1000, 2000, FALSE, 0);
+            
             else
                 displayShowSimpleText((char *) ind->caller_info + ind->offset_number, 1);
                 
             /* Attempt to play caller name */
-            if(!TTSPlayCallerName (ind->size_name, ind->caller_info + ind->offset_name))
+            if(!TTSPlayCallerName (size_name, name))
             {
                 /* Caller name not present or not supported, try to play number */
                 TTSPlayCallerNumber(ind->size_number, ind->caller_info + ind->offset_number) ;
@@ -80,6 +80,18 @@ INPUTS=\
       accelerator_sensor.c\
       accelerator_output.c\
       pedo.c\
+      sink_config_cache.c\
+      sink_vcard.c\
+      sink_callerid.c\
+      sink_reconnect.c\
+      sink_inquiry_rank.c\
+      sink_prompt_scheduler.c\
+      sink_tone_codec.c\
+      sink_fuel_gauge.c\
+      sink_energy.c\
+      sink_clock_drift.c\
+      sink_rc_params.c\
+      sink_avrcp_metadata.c\
       sink_private.h\
       sink_init.h\
       sink_auth.h\
@@ -134,7 +146,19 @@ INPUTS=\
       accelerator_system.h\
       accelerator_output.h\
       pedo_variables.h\
-      pedo.h
+      pedo.h\
+      sink_config_cache.h\
+      sink_vcard.h\
+      sink_callerid.h\
+      sink_reconnect.h\
+      sink_inquiry_rank.h\
+      sink_prompt_scheduler.h\
+      sink_tone_codec.h\
+      sink_fuel_gauge.h\
+      sink_energy.h\
+      sink_clock_drift.h\
+      sink_rc_params.h\
+      sink_avrcp_metadata.h
 # Project-specific options
 characters=1
 messages=1
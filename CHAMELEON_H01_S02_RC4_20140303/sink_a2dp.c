@@ -22,6 +22,8 @@ Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
 #include "sink_audio_routing.h"
 #include "sink_slc.h"
 #include "sink_device_id.h"
+#include "sink_reconnect.h"
+#include "sink_inquiry_rank.h"
 
 
 #ifdef ENABLE_AVRCP
@@ -281,37 +283,13 @@ RETURNS
 **************************************************************************/
 bool getA2dpIndexFromSink(Sink sink, uint16 * Index)
 {
-    uint8 i;
-    
     if (!sink || !theSink.a2dp_link_data)
     {
         return FALSE;
     }
     
-    /* go through A2dp connection looking for sink match */
-    for_all_a2dp(i)
-    {
-        /* if the a2dp link is connected check its device id */
-        if(theSink.a2dp_link_data->connected[i])
-        {
-            /* if a device_id match is found return its value and a
-               status of successfull match found */
-            if(A2dpSignallingGetSink(theSink.a2dp_link_data->device_id[i]) == sink)
-            {
-                *Index = i;
-                return TRUE;
-            }
-            
-            if(A2dpMediaGetSink(theSink.a2dp_link_data->device_id[i], theSink.a2dp_link_data->stream_id[i]) == sink)
-            {
-                *Index = i;
-                return TRUE;
-            }
-        }
-    }
-    
-    /* no matches found so return not successful */    
-    return FALSE;
+    /* sinks of the connected links are held in the connection table */
+    return deviceManagerGetA2dpIndexFromSink(sink, Index);
 }
 
 /*************************************************************************
@@ -628,6 +606,7 @@ void handleA2DPSignallingConnectInd(uint16 DeviceId, bdaddr SrcAddr)
         theSink.a2dp_link_data->connected[priority] = FALSE;
         theSink.a2dp_link_data->device_id[priority] = DeviceId;
         theSink.a2dp_link_data->bd_addr[priority] = SrcAddr;            
+        deviceManagerUpdateConnections();
         theSink.a2dp_link_data->list_id[priority] = deviceManagerSetPriority(&SrcAddr);
         
 #ifdef ENABLE_PEER
@@ -673,6 +652,9 @@ RETURNS
 **************************************************************************/
 void handleA2DPSignallingConnected(a2dp_status_code status, uint16 DeviceId, bdaddr SrcAddr)
 {
+    /* record the outcome if this was a reconnection attempt to an A2DP only device */
+    reconnectPageResult(&SrcAddr, (status == a2dp_success));
+    
     /* Continue connection procedure */
     if(!theSink.a2dp_link_data->remote_connection)    
     {
@@ -702,6 +684,7 @@ void handleA2DPSignallingConnected(a2dp_status_code status, uint16 DeviceId, bda
             theSink.a2dp_link_data->device_id[priority] = INVALID_DEVICE_ID;
             BdaddrSetZero(&theSink.a2dp_link_data->bd_addr[priority]);
             theSink.a2dp_link_data->list_id[priority] = 0;
+            deviceManagerUpdateConnections();
         }
         
 #ifdef ENABLE_AVRCP
@@ -744,6 +727,7 @@ void handleA2DPSignallingConnected(a2dp_status_code status, uint16 DeviceId, bda
                 theSink.a2dp_link_data->connected[a2dp_primary] = TRUE;
                 theSink.a2dp_link_data->device_id[a2dp_primary] = DeviceId;
                 theSink.a2dp_link_data->bd_addr[a2dp_primary] = SrcAddr;            
+                deviceManagerUpdateConnections();
                 theSink.a2dp_link_data->list_id[a2dp_primary] = deviceManagerSetPriority(&SrcAddr);
                 theSink.a2dp_link_data->media_reconnect[a2dp_primary] = FALSE;
             }
@@ -755,6 +739,7 @@ void handleA2DPSignallingConnected(a2dp_status_code status, uint16 DeviceId, bda
                 theSink.a2dp_link_data->connected[a2dp_secondary] = TRUE;
                 theSink.a2dp_link_data->device_id[a2dp_secondary] = DeviceId;
                 theSink.a2dp_link_data->bd_addr[a2dp_secondary] = SrcAddr;            
+                deviceManagerUpdateConnections();
                 theSink.a2dp_link_data->list_id[a2dp_secondary] = deviceManagerSetPriority(&SrcAddr);
                 theSink.a2dp_link_data->media_reconnect[a2dp_secondary] = FALSE;
             }
@@ -795,6 +780,9 @@ void handleA2DPSignallingConnected(a2dp_status_code status, uint16 DeviceId, bda
                 
                 theSink.a2dp_link_data->gAvVolumeLevel[priority] = attributes.a2dp.volume;
                 theSink.a2dp_link_data->clockMismatchRate[priority] = attributes.a2dp.clock_mismatch;
+                theSink.a2dp_link_data->clockDrift[priority] = attributes.a2dp_drift;
+                theSink.a2dp_link_data->low_latency[priority] = attributes.low_latency;
+                theSink.a2dp_link_data->report_delay[priority] = attributes.report_delay;
                 
 #ifdef ENABLE_PEER
                 if (attributes.peer_device != remote_device_unknown)
@@ -802,9 +790,9 @@ void handleA2DPSignallingConnected(a2dp_status_code status, uint16 DeviceId, bda
                     theSink.a2dp_link_data->peer_device[priority] = attributes.peer_device;
                 }
                 
-                if ((slcDetermineConnectAction() & AR_Rssi) && theSink.inquiry.results)
+                if ((slcDetermineConnectAction() & AR_Rssi) && theSink.inquiry.results && inquiryRankGet(theSink.inquiry.results, theSink.inquiry.attempting))
                 {
-                    theSink.a2dp_link_data->peer_device[priority] = (theSink.inquiry.results[theSink.inquiry.attempting].peer_device) ? remote_device_peer : remote_device_nonpeer;
+                    theSink.a2dp_link_data->peer_device[priority] = (inquiryRankGet(theSink.inquiry.results, theSink.inquiry.attempting)->peer_device) ? remote_device_peer : remote_device_nonpeer;
                     attributes.peer_device = theSink.a2dp_link_data->peer_device[priority];
                 }
                 
@@ -1018,8 +1006,10 @@ void handleA2DPOpenInd(uint16 DeviceId, uint8 seid)
            
         /* find structure index of deviceId */
         if(getA2dpIndex(DeviceId, &Id))
+        {
             theSink.a2dp_link_data->device_id[Id] = DeviceId;
-
+            deviceManagerUpdateConnections();
+        }
     }
 #endif
 }
@@ -1054,6 +1044,7 @@ void handleA2DPOpenCfm(uint16 DeviceId, uint16 StreamId, uint8 seid, a2dp_status
             theSink.a2dp_link_data->device_id[Id] = DeviceId;
             theSink.a2dp_link_data->stream_id[Id] = StreamId;
             theSink.a2dp_link_data->seid[Id] = seid;
+            deviceManagerUpdateConnections();
             theSink.a2dp_link_data->media_reconnect[Id] = FALSE;
        
 #ifdef ENABLE_PEER
@@ -1161,6 +1152,9 @@ static void handleA2DPClose(uint16 DeviceId, uint16 StreamId, a2dp_status_code s
         
        	A2DP_DEBUG(("A2dp: Close DevId = %d, StreamId = %d\n",DeviceId,StreamId)); 
 
+        /* media sink has gone */
+        deviceManagerUpdateConnections();
+
         /* route the audio using the appropriate codec/plugin */
  	    audioHandleRouting(audio_source_none);
 #ifdef ENABLE_SOUNDBAR
@@ -1302,6 +1296,7 @@ void handleA2DPSignallingDisconnected(uint16 DeviceId, a2dp_status_code status,
 #endif        
 
         /* update number of connected devices */
+        deviceManagerUpdateConnections();
 	    theSink.no_of_profiles_connected = deviceManagerNumConnectedDevs();
       
         /*if the device is off then this is disconnect as part of the power off cycle, otherwise check
@@ -1371,6 +1366,11 @@ void handleA2DPSignallingLinkloss(uint16 DeviceId)
         
         audioHandleRouting(audio_source_none);
         
+        /* note the link loss against the device for reconnection ordering,
+           a device with HFP connected has it noted by the HFP link loss */
+        if(!(deviceManagerProfilesConnected(&theSink.a2dp_link_data->bd_addr[Id]) & conn_hfp))
+            reconnectLinkLoss(&theSink.a2dp_link_data->bd_addr[Id]);
+        
         if(theSink.features.GoConnectableDuringLinkLoss || (theSink.a2dp_link_data->peer_device[Id] == remote_device_peer))
         {   /* Go connectable if feature enabled or remote is a peer device */
             sinkEnableConnectable(); 
@@ -1526,6 +1526,7 @@ void handleA2DPStartStreaming(uint16 DeviceId, uint16 StreamId, a2dp_status_code
             linkPolicyUseA2dpSettings(DeviceId, StreamId, sink);
             /* set the current seid */         
             theSink.a2dp_link_data->stream_id[Id] = StreamId;
+            deviceManagerUpdateConnections();
 
 #ifdef ENABLE_PEER
             if (theSink.a2dp_link_data->peer_device[Id] == remote_device_peer)
@@ -1996,7 +1997,8 @@ NAME
     handleA2DPStoreClockMismatchRate
     
 DESCRIPTION
-    handle storing the clock mismatch rate for the active stream
+    handle a clock mismatch rate reported for the active stream, filed with
+    the clock drift tracker for the device
 RETURNS
     
 **************************************************************************/
@@ -2017,12 +2019,12 @@ void handleA2DPStoreClockMismatchRate(uint16 clockMismatchRate)
     if((a2dpStatePri == a2dp_stream_streaming) && (a2dpSinkPri == theSink.routed_audio))  
     {
         A2DP_DEBUG(("A2dp: store pri. clk mismatch = %x\n", clockMismatchRate));
-        theSink.a2dp_link_data->clockMismatchRate[a2dp_primary] = clockMismatchRate;
+        clockDriftSample(a2dp_primary, clockMismatchRate);
     }
     else if((a2dpStateSec == a2dp_stream_streaming) && (a2dpSinkSec == theSink.routed_audio))  
     {
         A2DP_DEBUG(("A2dp: store sec. clk mismatch = %x\n", clockMismatchRate));
-        theSink.a2dp_link_data->clockMismatchRate[a2dp_secondary] = clockMismatchRate;
+        clockDriftSample(a2dp_secondary, clockMismatchRate);
     }
     else
     {
@@ -2082,6 +2084,44 @@ void handleA2DPStoreEnhancements(uint16 enhancements)
     }
 }
 
+/*************************************************************************
+NAME    
+    sinkA2dpSetLowLatency
+    
+DESCRIPTION
+    Select the low latency mode and delay reporting for a connected a2dp
+    device and store them in its attributes. The poll interval is applied
+    straight away, the codec levels and delay report take effect when the
+    stream is next configured.
+
+RETURNS
+    TRUE if the device is connected
+**************************************************************************/
+bool sinkA2dpSetLowLatency(uint16 Index, bool low_latency, bool report_delay)
+{
+    sink_attributes attributes;
+    uint16 DeviceId;
+
+    if(!theSink.a2dp_link_data || (Index >= MAX_A2DP_CONNECTIONS) || !theSink.a2dp_link_data->connected[Index])
+        return FALSE;
+
+    A2DP_DEBUG(("A2dp: low latency %d report delay %d for %d\n", low_latency, report_delay, Index));
+
+    theSink.a2dp_link_data->low_latency[Index] = low_latency;
+    theSink.a2dp_link_data->report_delay[Index] = report_delay;
+
+    deviceManagerGetDefaultAttributes(&attributes, FALSE);
+    deviceManagerGetAttributes(&attributes, &theSink.a2dp_link_data->bd_addr[Index]);
+    attributes.low_latency = low_latency;
+    attributes.report_delay = report_delay;
+    deviceManagerStoreAttributes(&attributes, &theSink.a2dp_link_data->bd_addr[Index]);
+
+    DeviceId = theSink.a2dp_link_data->device_id[Index];
+    linkPolicyUseA2dpSettings(DeviceId, theSink.a2dp_link_data->stream_id[Index], A2dpSignallingGetSink(DeviceId));
+
+    return TRUE;
+}
+
 /*************************************************************************
 NAME    
     disconnectAllA2dpAVRCP
@@ -2252,6 +2292,27 @@ bool controlA2DPPeer (uint16 event)
 }
 #endif
 
+/*************************************************************************
+NAME    
+    a2dpGetSyncDelay
+    
+DESCRIPTION
+    Get the AV sync delay to report for a device, 0 unless delay reporting
+    is enabled for it and the delays have been measured
+
+RETURNS
+    the delay in 1/10 ms
+**************************************************************************/
+static uint16 a2dpGetSyncDelay(uint16 DeviceId)
+{
+    uint16 Index;
+
+    if(!getA2dpIndex(DeviceId, &Index) || !theSink.a2dp_link_data->report_delay[Index])
+        return 0;
+
+    return theSink.a2dp_link_data->low_latency[Index] ? A2DP_SYNC_DELAY_LOW_LATENCY : A2DP_SYNC_DELAY_DEFAULT;
+}
+
 /*************************************************************************
 NAME    
     handleA2DPMessage
@@ -2385,11 +2446,11 @@ void handleA2DPMessage( Task task, MessageId id, Message message )
 
         case A2DP_MEDIA_AV_SYNC_DELAY_IND:
             A2DP_DEBUG(("A2DP_MEDIA_AV_SYNC_DELAY_IND : seid=0x%X\n",((A2DP_MEDIA_AV_SYNC_DELAY_IND_T*)message)->seid));
-            /* Currently supplying a zero AV Sync delay value, which will cause device to operate with the same latency 
-               as pre A2DP v1.3 devices */
+            /* Supply a zero AV Sync delay value unless reporting is enabled for the device, a zero value
+               causes the device to operate with the same latency as pre A2DP v1.3 devices */
             A2dpMediaAvSyncDelayResponse(((A2DP_MEDIA_AV_SYNC_DELAY_IND_T*)message)->device_id,
                                          ((A2DP_MEDIA_AV_SYNC_DELAY_IND_T*)message)->seid,
-                                         0);
+                                         a2dpGetSyncDelay(((A2DP_MEDIA_AV_SYNC_DELAY_IND_T*)message)->device_id));
         break;
         
         case A2DP_MEDIA_AV_SYNC_DELAY_CFM:
@@ -14,6 +14,7 @@ Copyright (C) Cambridge Silicon Radio Ltd. 2005-2013
 #include <csr_a2dp_decoder_common_plugin.h>
 #include "sink_private.h"
 #include <a2dp.h>
+#include "sink_clock_drift.h"
 
 /* Local stream end point codec IDs */
 #define SOURCE_SEID_MASK        0x20        /*!< @brief Combined with a SEP codec id to produce an id for source codecs */
@@ -41,6 +42,22 @@ Copyright (C) Cambridge Silicon Radio Ltd. 2005-2013
 
 #define MAX_A2DP_CONNECTIONS    2
 
+/* AV sync delay reported to a source in 1/10 ms when delay reporting is
+   enabled for it. They are 0 until measured on the hardware the
+   application is built for. A source treats 0 as a device with no delay
+   report and uses its own default.
+
+   To measure them, stream silence with one full scale click a second from
+   a source, with a protocol analyser capturing the air interface and
+   giving a trigger on each media packet. Put the analyser trigger and the
+   DAC output on two channels of an oscilloscope. The delay is the time
+   from the packet carrying a click to the click at the output. Average it
+   over at least 20 clicks once the stream has settled. Measure again with
+   low latency mode on for the second figure, and take the longest over
+   the codecs enabled. */
+#define A2DP_SYNC_DELAY_DEFAULT         (0)
+#define A2DP_SYNC_DELAY_LOW_LATENCY     (0)
+
 /* Bits used to select which DAC channel is used to render audio, as read from PSKEY_FEATURE_BLOCK */
 
 
@@ -117,6 +134,9 @@ typedef struct
     uint8 gAvVolumeLevel[MAX_A2DP_CONNECTIONS];
     bdaddr bd_addr[MAX_A2DP_CONNECTIONS];
     uint16 clockMismatchRate[MAX_A2DP_CONNECTIONS];
+    clock_drift_model clockDrift[MAX_A2DP_CONNECTIONS];
+    bool low_latency[MAX_A2DP_CONNECTIONS];
+    bool report_delay[MAX_A2DP_CONNECTIONS];
 #ifdef ENABLE_AVRCP
     avrcpSupport avrcp_support[MAX_A2DP_CONNECTIONS];
 #endif
@@ -357,7 +377,8 @@ NAME
     handleA2DPStoreClockMismatchRate
     
 DESCRIPTION
-    handle storing the clock mismatch rate for the active stream
+    handle a clock mismatch rate reported for the active stream, filed with
+    the clock drift tracker for the device
 RETURNS
     
 **************************************************************************/
@@ -473,6 +494,19 @@ RETURNS
 **************************************************************************/
 void handleA2DPStoreEnhancements(uint16 enhancements);
 
+/*************************************************************************
+NAME    
+    sinkA2dpSetLowLatency
+    
+DESCRIPTION
+    Select the low latency mode and delay reporting for a connected a2dp
+    device, stored in its attributes
+    
+RETURNS
+    TRUE if the device is connected
+**************************************************************************/
+bool sinkA2dpSetLowLatency(uint16 Index, bool low_latency, bool report_delay);
+
 /*************************************************************************
 NAME    
     controlA2DPPeer
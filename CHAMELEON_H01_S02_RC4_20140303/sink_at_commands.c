@@ -32,6 +32,7 @@ NOTES
 #include "sink_private.h"
 #include "sink_config.h"
 #include "sink_audio.h"
+#include "sink_config_cache.h"
 #include <string.h>
 
 
@@ -61,7 +62,8 @@ DESCRIPTION
 void sinkHandleUnrecognisedATCmd(HFP_UNRECOGNISED_AT_CMD_IND_T *ind)         
 {
     char* pData;
-    char* pSearchString = NULL;
+    const config_block3_t * config;
+    const char* pSearchString = NULL;
     uint16 i = 0 ;
     char *pDataEnd = (char*)(ind->data + ind->size_data);
     
@@ -91,19 +93,20 @@ void sinkHandleUnrecognisedATCmd(HFP_UNRECOGNISED_AT_CMD_IND_T *ind)
     }    
     
     /* check if there's any more configured AT commands to check */
-    if(!theSink.conf3)
+    config = configCacheGet(config_cache_at_commands);
+    if(!config)
     {
         AT_DEBUG(("AT: Unrecognised AT Cmd -  no config\n" )) ;
         return;
     }
     
-    pSearchString = theSink.conf3->at_commands;
+    pSearchString = config->at_commands;
     
     /* Try and match the AT command */
     while(*pSearchString != '\0')
     {
         /* Command followed by response string */
-        char* res_string = pSearchString + strlen(pSearchString) + 1;
+        const char* res_string = pSearchString + strlen(pSearchString) + 1;
         AT_DEBUG(("Matching %s\n", pSearchString));
         
         /* If the incoming command matches; handle & respond */
@@ -135,15 +138,16 @@ DESCRIPTION
 void sinkSendATCmd( uint16 at_id ) 
 {
     uint8 count = 0;
-    char* search_string = NULL;
+    const config_block3_t * config = configCacheGet(config_cache_at_commands);
+    const char* search_string = NULL;
     
-    if(!theSink.conf3)
+    if(!config)
     {
         AT_DEBUG(("AT: Send Cmd -  no config\n" )) ;
         return;
     }
     
-    search_string = theSink.conf3->at_commands;
+    search_string = config->at_commands;
         
     AT_DEBUG(("AT: Send Cmd\n" )) ;
 
@@ -233,8 +237,9 @@ DESCRIPTION
 void ATCommandPlayEvent ( sinkEvents_t id ) 
 {
     uint16 i = 0 ;
+    const config_block3_t * config = configCacheGet(config_cache_at_commands);
     
-    if(!theSink.conf3)
+    if(!config)
     {
         AT_DEBUG(("AT: Play Cmd -  no config\n" )) ;
         return;
@@ -242,28 +247,28 @@ void ATCommandPlayEvent ( sinkEvents_t id )
     
     for (i =0 ; i < MAX_AT_COMMANDS_TO_SEND ; i++ )
     {
-        if ( (id-EVENTS_MESSAGE_BASE) == theSink.conf3->gEventATCommands[i].event )     
+        if ( (id-EVENTS_MESSAGE_BASE) == config->gEventATCommands[i].event )     
         {
-            AT_DEBUG(("AT: Ev [%x] AT CMD [%d]" , id , theSink.conf3->gEventATCommands[i].at_cmd )) ;
+            AT_DEBUG(("AT: Ev [%x] AT CMD [%d]" , id , config->gEventATCommands[i].at_cmd )) ;
             
-            sinkSendATCmd ( theSink.conf3->gEventATCommands[i].at_cmd ) ;    
+            sinkSendATCmd ( config->gEventATCommands[i].at_cmd ) ;    
         }
         
             /*special handling for gas gauge events */
-        switch ( theSink.conf3->gEventATCommands[i].event + EVENTS_MESSAGE_BASE )
+        switch ( config->gEventATCommands[i].event + EVENTS_MESSAGE_BASE )
         {
             case EventGasGauge0:
                 if ( ( id >= EventGasGauge0 ) && (id <= EventGasGauge3)) 
                 {
-                    AT_DEBUG(("AT: Ev Gas Gauge n [%x] AT CMD [%d]" , id , theSink.conf3->gEventATCommands[i].at_cmd )) ;
-                    sinkSendATCmd ( theSink.conf3->gEventATCommands[i].at_cmd ) ;    
+                    AT_DEBUG(("AT: Ev Gas Gauge n [%x] AT CMD [%d]" , id , config->gEventATCommands[i].at_cmd )) ;
+                    sinkSendATCmd ( config->gEventATCommands[i].at_cmd ) ;    
                 }
             break ;
             case EventChargerGasGauge0:
                 if ( ( id >= EventChargerGasGauge0 ) && ( id <= EventChargerGasGauge3)) 
                 {
-                    AT_DEBUG(("AT: Ev Charger Gas Gauge n [%x] AT CMD [%d]" , id , theSink.conf3->gEventATCommands[i].at_cmd )) ;
-                    sinkSendATCmd ( theSink.conf3->gEventATCommands[i].at_cmd ) ;    
+                    AT_DEBUG(("AT: Ev Charger Gas Gauge n [%x] AT CMD [%d]" , id , config->gEventATCommands[i].at_cmd )) ;
+                    sinkSendATCmd ( config->gEventATCommands[i].at_cmd ) ;    
                 }
             break ;
             default:
@@ -682,7 +682,7 @@ void A2dpRouteAudio(uint8 Index, Sink sink)
                 /* initialise the AudioConnect extra parameters required to pass in additional codec information */
                 theSink.a2dp_link_data->a2dp_audio_connect_params.packet_size = codec_settings->codecData.packet_size; /* Packet size retrieved from a2dp library */            
                 theSink.a2dp_link_data->a2dp_audio_connect_params.content_protection = codec_settings->codecData.content_protection; /* content protection retrieved from a2dp library */            
-                theSink.a2dp_link_data->a2dp_audio_connect_params.clock_mismatch = theSink.a2dp_link_data->clockMismatchRate[Index]; /* clock mismatch rate for this device */      
+                theSink.a2dp_link_data->a2dp_audio_connect_params.clock_mismatch = clockDriftStreamStart(Index); /* learned clock mismatch rate for this device */      
                 theSink.a2dp_link_data->a2dp_audio_connect_params.mode_params = &theSink.a2dp_link_data->a2dp_audio_mode_params; /* EQ mode and Audio enhancements */
 #ifdef INCLUDE_A2DP_EXTRA_CODECS                
 #ifdef INCLUDE_FASTSTREAM                
@@ -695,6 +695,11 @@ void A2dpRouteAudio(uint8 Index, Sink sink)
 #endif
 #ifdef INCLUDE_APTX_ACL_SPRINT
                 theSink.a2dp_link_data->a2dp_audio_connect_params.aptx_sprint_params  = codec_settings->codecData.aptx_sprint_params; /* aptX LL params */ 
+                if (theSink.a2dp_link_data->low_latency[Index])
+                {   /* halve the buffer the decoder aims to hold for a device streaming in low latency mode */
+                    theSink.a2dp_link_data->a2dp_audio_connect_params.aptx_sprint_params.target_codec_level >>= 1;
+                    theSink.a2dp_link_data->a2dp_audio_connect_params.aptx_sprint_params.initial_codec_level >>= 1;
+                }
 #endif
 #endif  
 #ifdef ENABLE_SOUNDBAR
@@ -28,6 +28,8 @@ NOTES
 #include "sink_audio_routing.h"
 #include "sink_devicemanager.h"
 #include "sink_debug.h"
+#include "sink_fuel_gauge.h"
+#include "sink_energy.h"
 
 #ifdef ENABLE_FM
 #include "sink_fm.h"
@@ -37,10 +39,15 @@ NOTES
 #include "sink_swat.h"
 #endif
 
+#ifdef ENABLE_REMOTE
+#include "sink_rc_params.h"
+#endif
+
 #include <connection.h>
 #include <a2dp.h>
 #include <hfp.h>
 #include <stdlib.h>
+#include <string.h>
 #include <audio.h>
 #include <audio_plugin_if.h>
 #include <sink.h>
@@ -53,6 +60,278 @@ NOTES
 #define AUD_DEBUG(x) 
 #endif     
 
+/* everything the headset routing policy reads, compared between triggers so
+   the policy is only evaluated again when one of them has changed */
+typedef struct
+{
+    audio_source_status status;
+    Sink                usb_sink;
+    uint16              available;              /* AUDIO_AVAILABLE_ bits */
+    audio_priority      sco_priority[2];        /* sco priority of AG1, AG2 */
+    unsigned            codec_selected:2;       /* sco codec negotiated for AG1, AG2 */
+    unsigned            voice_dial:1;
+    unsigned            suspended_pri:2;        /* a2dp_suspend_state */
+    unsigned            suspended_sec:2;
+    unsigned            unused:9;
+#if (defined ENABLE_AVRCP) && (MAX_AVRCP_CONNECTIONS >=2) && (MAX_A2DP_CONNECTIONS >=2)
+    uint16              avrcp_connected[2];
+    uint16              play_status[2];
+#endif
+}audio_routing_inputs;
+
+typedef struct
+{
+    audio_routing_inputs    inputs;             /* inputs as routing left them after the last evaluation */
+    audio_routing_decision  log[AUDIO_ROUTING_LOG_SIZE];
+    uint16                  skipped;            /* triggers skipped since the last evaluation */
+    unsigned                valid:1;            /* inputs are from an evaluation */
+    unsigned                next:3;             /* log entry written next */
+    unsigned                logged:4;           /* log entries in use */
+    unsigned                unused:8;
+}audio_routing_t;
+
+static audio_routing_t gAudioRouting;
+
+
+/****************************************************************************
+NAME    
+    audioFillStatus
+    
+DESCRIPTION
+    get status of sco/calls and a2dp links into the structure passed in
+
+RETURNS
+    none
+*/
+static void audioFillStatus(Sink routed_audio, audio_source_status * lAudioStatus)
+{
+    /* store currently routed audio */
+    lAudioStatus->audio_routed = routed_audio;
+    
+    /* get AG1 and AG2 call current states if connected */
+    HfpLinkGetCallState(hfp_primary_link, &lAudioStatus->stateAG1);
+    HfpLinkGetCallState(hfp_secondary_link, &lAudioStatus->stateAG2);
+    
+    /* get audio sink for AGs if available */
+    HfpLinkGetAudioSink(hfp_primary_link, &lAudioStatus->sinkAG1);
+    HfpLinkGetAudioSink(hfp_secondary_link, &lAudioStatus->sinkAG2);  
+    
+    /* get status of current a2dp links */
+    getA2dpStreamData(a2dp_primary,   &lAudioStatus->a2dpSinkPri, &lAudioStatus->a2dpStatePri);
+    getA2dpStreamData(a2dp_secondary, &lAudioStatus->a2dpSinkSec, &lAudioStatus->a2dpStateSec);
+    
+    getA2dpStreamRole(a2dp_primary, &lAudioStatus->a2dpRolePri);
+    getA2dpStreamRole(a2dp_secondary, &lAudioStatus->a2dpRoleSec);
+}
+
+#ifndef ENABLE_SOUNDBAR
+
+/****************************************************************************
+NAME    
+    audioLogRoutingDecision
+    
+DESCRIPTION
+    add a routing decision to the log, overwriting the oldest when full
+
+RETURNS
+    none
+*/
+static void audioLogRoutingDecision(uint16 available, uint16 routed)
+{
+    audio_routing_decision * decision = &gAudioRouting.log[gAudioRouting.next];
+
+    decision->available = available;
+    decision->routed    = routed;
+    decision->time      = (uint16)(VmGetClock() / 1000);
+    decision->skipped   = gAudioRouting.skipped;
+
+    gAudioRouting.skipped = 0;
+    gAudioRouting.next = (gAudioRouting.next + 1) % AUDIO_ROUTING_LOG_SIZE;
+    if(gAudioRouting.logged < AUDIO_ROUTING_LOG_SIZE)
+        gAudioRouting.logged++;
+
+    AUD_DEBUG(("AUD: routing decision available %x routed %x at %ds, %d skipped\n", available, routed, decision->time, decision->skipped));
+}
+
+
+/* routes a source if it is able to */
+typedef bool (*audio_source_probe)(audio_source_status * lAudioStatus);
+
+/* an entry of the headset routing policy */
+typedef struct
+{
+    uint16              source;                 /* AUDIO_AVAILABLE_ bit */
+    audio_source_probe  probe;
+}audio_routing_policy;
+
+/****************************************************************************
+NAME    
+    audioProbeCallSco
+    
+DESCRIPTION
+    route sco with an active call on either AG
+
+RETURNS
+    true if sco routed, false if no sco routable
+*/
+static bool audioProbeCallSco(audio_source_status * lAudioStatus)
+{
+    return audioActiveCallScoAvailable(lAudioStatus, hfp_invalid_link);
+}
+
+/****************************************************************************
+NAME    
+    audioProbeA2dp
+    
+DESCRIPTION
+    route a2dp from either the primary or secondary link
+
+RETURNS
+    true if a2dp routed, false if no a2dp routable
+*/
+static bool audioProbeA2dp(audio_source_status * lAudioStatus)
+{
+    return audioA2dpStreamAvailable(lAudioStatus, a2dp_pri_sec);
+}
+
+/* headset routing policy, highest priority first, the first available source
+   whose probe routes it wins. Speech recognition is above all of these. */
+static const audio_routing_policy gAudioRoutingPolicy[] =
+{
+    {AUDIO_AVAILABLE_CALL_SCO,  audioProbeCallSco},
+    {AUDIO_AVAILABLE_A2DP,      audioProbeA2dp},
+#ifdef ENABLE_USB
+    {AUDIO_AVAILABLE_USB,       audioUsbAvailable},
+#endif
+#ifdef ENABLE_WIRED
+    {AUDIO_AVAILABLE_WIRED,     audioWiredAvailable},
+#endif
+#ifdef ENABLE_FM
+    {AUDIO_AVAILABLE_FM,        audioFMAvailable},
+#endif
+    {AUDIO_AVAILABLE_SCO,       audioScoAvailable}
+};
+
+#define AUDIO_ROUTING_POLICY_SIZE   (sizeof(gAudioRoutingPolicy) / sizeof(gAudioRoutingPolicy[0]))
+
+/****************************************************************************
+NAME    
+    audioGetRoutingInputs
+    
+DESCRIPTION
+    collect the inputs of the headset routing policy and work out which
+    sources are available, a source is only available if its probe could
+    do something with it
+
+RETURNS
+    none
+*/
+static void audioGetRoutingInputs(const audio_source_status * lAudioStatus, audio_routing_inputs * inputs)
+{
+    uint16 available = 0;
+
+    memset(inputs, 0, sizeof(audio_routing_inputs));
+
+    inputs->status          = *lAudioStatus;
+    inputs->usb_sink        = usbGetAudioSink();
+    inputs->sco_priority[0] = theSink.profile_data[PROFILE_INDEX(hfp_primary_link)].audio.sco_priority;
+    inputs->sco_priority[1] = theSink.profile_data[PROFILE_INDEX(hfp_secondary_link)].audio.sco_priority;
+    inputs->codec_selected  = (theSink.profile_data[PROFILE_INDEX(hfp_primary_link)].audio.codec_selected ? 1 : 0) |
+                              (theSink.profile_data[PROFILE_INDEX(hfp_secondary_link)].audio.codec_selected ? 2 : 0);
+    inputs->voice_dial      = theSink.VoiceRecognitionIsActive;
+    inputs->suspended_pri   = a2dpSuspended(a2dp_primary);
+    inputs->suspended_sec   = a2dpSuspended(a2dp_secondary);
+
+#if (defined ENABLE_AVRCP) && (MAX_AVRCP_CONNECTIONS >=2) && (MAX_A2DP_CONNECTIONS >=2)
+    if(theSink.avrcp_link_data)
+    {
+        inputs->avrcp_connected[0] = theSink.avrcp_link_data->connected[0];
+        inputs->avrcp_connected[1] = theSink.avrcp_link_data->connected[1];
+        inputs->play_status[0]     = theSink.avrcp_link_data->play_status[0];
+        inputs->play_status[1]     = theSink.avrcp_link_data->play_status[1];
+    }
+#endif
+
+#ifdef ENABLE_SPEECH_RECOGNITION
+    if(speechRecognitionIsActive())
+        available |= AUDIO_AVAILABLE_ASR;
+#endif
+
+    /* sco with a call or voice dial, or an out of band ring needing other audio to be removed */
+    if((lAudioStatus->sinkAG1 && ((lAudioStatus->stateAG1 > hfp_call_state_idle) || theSink.VoiceRecognitionIsActive)) ||
+       (lAudioStatus->sinkAG2 && ((lAudioStatus->stateAG2 > hfp_call_state_idle) || theSink.VoiceRecognitionIsActive)) ||
+       (lAudioStatus->stateAG1 == hfp_call_state_incoming) || (lAudioStatus->stateAG2 == hfp_call_state_incoming))
+        available |= AUDIO_AVAILABLE_CALL_SCO;
+
+    /* any open media channel, a2dp routing also looks after relayed streams */
+    if((lAudioStatus->a2dpRolePri != a2dp_role_undefined) || (lAudioStatus->a2dpRoleSec != a2dp_role_undefined))
+        available |= AUDIO_AVAILABLE_A2DP;
+
+    if(inputs->usb_sink)
+        available |= AUDIO_AVAILABLE_USB;
+
+    if(wiredAudioConnected())
+        available |= AUDIO_AVAILABLE_WIRED;
+
+#ifdef ENABLE_FM
+    if(theSink.conf2->sink_fm_data.fmRxOn)
+        available |= AUDIO_AVAILABLE_FM;
+#endif
+
+    if(lAudioStatus->sinkAG1 || lAudioStatus->sinkAG2)
+        available |= AUDIO_AVAILABLE_SCO;
+
+    inputs->available = available;
+}
+
+/****************************************************************************
+NAME    
+    audioApplyRoutingPolicy
+    
+DESCRIPTION
+    route the highest priority available source, disconnecting any routed
+    audio if there is nothing to route
+
+RETURNS
+    AUDIO_AVAILABLE_ bit of the source routed, 0 if none
+*/
+static uint16 audioApplyRoutingPolicy(audio_source_status * lAudioStatus, uint16 available)
+{
+    uint16 i;
+
+    /* speech recognition takes priority over all other audio sources, if
+       another audio source is already connected, disconnect or suspend it
+       to use the audio hardware for speech recognition */
+    if(available & AUDIO_AVAILABLE_ASR)
+    {
+        if(lAudioStatus->audio_routed)
+        {
+            AUD_DEBUG(("AUD: routing, ASR active, suspend/disconnect current source\n"));
+
+            /* suspend or disconnect the current audio source */
+            audioSuspendDisconnectSource(lAudioStatus);
+        }
+        return AUDIO_AVAILABLE_ASR;
+    }
+
+    for(i = 0; i < AUDIO_ROUTING_POLICY_SIZE; i++)
+    {
+        if((available & gAudioRoutingPolicy[i].source) && gAudioRoutingPolicy[i].probe(lAudioStatus))
+            return gAudioRoutingPolicy[i].source;
+    }
+
+    /* if no audio sources and audio still routed, disconnect it */                            
+    if(lAudioStatus->audio_routed)
+    {
+        AUD_DEBUG(("AUD: sink with no source, disconnect\n"));
+        /* disconnect the active audio */
+        audioDisconnectActiveSink();   
+    }
+    return 0;
+}
+
+#endif /* ENABLE_SOUNDBAR */
+
 #ifdef ENABLE_SOUNDBAR
 /****************************************************************************
 NAME    
@@ -235,6 +514,8 @@ bool audioHandleRouting (audio_sources requested_source)
            as device is still allowed to operate in DUT mode */
         AUD_DEBUG(("AUD: disconnect DUT audio\n"));
         AudioDisconnect();
+        /* routed_audio is left as it was, make sure routing is evaluated */
+        audioRoutingInvalidate();
     }
 
 /* non soundbar (headset) operation results in an automatic switching of audio sources based upon the 
@@ -253,72 +534,37 @@ bool audioHandleRouting (audio_sources requested_source)
     /* determine which audio sources are available and what should be routed, if
        already routed then no changes are made, otherwise disconnect and reconnect
        the next highest priority available audio source */
-
-#ifdef ENABLE_SPEECH_RECOGNITION
-    /* speech recognition takes priority over all other audio sources */    
-    if (!speechRecognitionIsActive() )
-#endif
-    {
-        AUD_DEBUG(("AUD: ASR not active\n"));
-        /* SCO with active call has the highest routing priority, if present then route sco */
-        if(!audioActiveCallScoAvailable(lAudioStatus, hfp_invalid_link))
-        {
-            AUD_DEBUG(("AUD: no sco\n"));
-            /* there are no sco's available with active call so check for a2dp sources */
-            if(!audioA2dpStreamAvailable(lAudioStatus, a2dp_pri_sec))
-            {
-                AUD_DEBUG(("AUD: no a2dp\n"));
-#ifdef ENABLE_USB
-                /* there are no a2dp streams available, check for usb audio sources */        
-                if(!audioUsbAvailable(lAudioStatus))    
-#endif
-                {
-                    AUD_DEBUG(("AUD: no usb\n"));
-#ifdef ENABLE_WIRED  
-                    /* no usb sources, is wired available? */
-                    if(!audioWiredAvailable(lAudioStatus))
-#endif
-                    {
-                        AUD_DEBUG(("AUD: no wired\n"));
-#ifdef ENABLE_FM
-                        /* no wired available, is fm available? */
-                        if(!audioFMAvailable(lAudioStatus))
-#endif
-                        {
-                            AUD_DEBUG(("AUD: no fm\n"));
-                            
-                            /* check for any SCO without call sources */
-                            if(!audioScoAvailable(lAudioStatus))
-                            {                           
-                                /* if no audio sources and audio still routed, disconnect it */                            
-                                if(lAudioStatus->audio_routed)
-                                {
-                                    AUD_DEBUG(("AUD: sink with no source, disconnect\n"));
-                                    /* disconnect the active audio */
-                                    audioDisconnectActiveSink();   
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-#ifdef ENABLE_SPEECH_RECOGNITION
-    /* speech recognition is active */
-    else
     {
-        /* if another audio source is already connected, disconnect or suspend it
-           to use the audio hardware for speech recognition */
-        if(lAudioStatus->audio_routed)
+        audio_routing_inputs * inputs = mallocPanic(sizeof(audio_routing_inputs));
+        uint16 routed;
+
+        audioGetRoutingInputs(lAudioStatus, inputs);
+
+        /* nothing the policy depends on has changed since it was last evaluated
+           so it would make the same decision again */
+        if(gAudioRouting.valid && !memcmp(inputs, &gAudioRouting.inputs, sizeof(audio_routing_inputs)))
         {
-            AUD_DEBUG(("AUD: routing, ASR active, suspend/disconnect current source\n"));
+            AUD_DEBUG(("AUD: routing inputs unchanged\n"));
+            if(gAudioRouting.skipped < 0xFFFF)
+                gAudioRouting.skipped++;
 
-            /* suspend or disconnect the current audio source */
-            audioSuspendDisconnectSource(lAudioStatus);
+            freePanic(inputs);
+            freePanic(lAudioStatus);
+            return TRUE;
         }
+
+        routed = audioApplyRoutingPolicy(lAudioStatus, inputs->available);
+
+        /* keep the inputs as routing has left them, the display and amp are
+           also updated from these */
+        audioFillStatus(theSink.routed_audio, lAudioStatus);
+        audioGetRoutingInputs(lAudioStatus, &gAudioRouting.inputs);
+        gAudioRouting.valid = TRUE;
+
+        audioLogRoutingDecision(inputs->available, routed);
+
+        freePanic(inputs);
     }
-#endif
            
 /* for soundbar operation the audio sources are switched manually, sources can be specified
    directly or a switch to next source function is available. If the audio source that is requested
@@ -1349,6 +1595,38 @@ RETURNS
 */
 void audioUpdateDisplayAmp(Sink audio_routed, audio_source_status * lAudioStatus)
 {
+    /* let the fuel gauge and energy accounting know the load on the battery */
+    if(!audio_routed)
+    {
+        fuelGaugeSetLoad(fuel_gauge_load_idle);
+        energyConsumerSet(energy_consumer_voice, 0);
+        energyConsumerSet(energy_consumer_media, 0);
+    }
+    else if((audio_routed == lAudioStatus->sinkAG1) || (audio_routed == lAudioStatus->sinkAG2))
+    {
+        fuelGaugeSetLoad(fuel_gauge_load_sco);
+        energyConsumerSet(energy_consumer_media, 0);
+        energyConsumerSet(energy_consumer_voice, 1);
+    }
+    else
+    {
+        fuelGaugeSetLoad(fuel_gauge_load_media);
+        energyConsumerSet(energy_consumer_voice, 0);
+        energyConsumerSet(energy_consumer_media, 1);
+    }
+
+#ifdef ENABLE_REMOTE
+    /* keep the remote control connection events in step with any audio on the radio */
+    if(!audio_routed)
+        rcParamsSetTraffic(rc_traffic_none);
+    else if((audio_routed == lAudioStatus->sinkAG1) || (audio_routed == lAudioStatus->sinkAG2))
+        rcParamsSetTraffic(rc_traffic_sco);
+    else if((audio_routed == lAudioStatus->a2dpSinkPri) || (audio_routed == lAudioStatus->a2dpSinkSec))
+        rcParamsSetTraffic(rc_traffic_a2dp);
+    else
+        rcParamsSetTraffic(rc_traffic_none);
+#endif
+
     /* if any audio present display volume level and turn on audio amp - Update SWAT volume */
     if(audio_routed)
     {           
@@ -1488,27 +1766,32 @@ audio_source_status * audioGetStatus(Sink routed_audio)
     /* use temporary memory slot for storing current audio sources */
     audio_source_status * lAudioStatus = mallocPanic(sizeof(audio_source_status));        
 
-    /* store currently routed audio */
-    lAudioStatus->audio_routed = routed_audio;
-    
-    /* get AG1 and AG2 call current states if connected */
-    HfpLinkGetCallState(hfp_primary_link, &lAudioStatus->stateAG1);
-    HfpLinkGetCallState(hfp_secondary_link, &lAudioStatus->stateAG2);
-    
-    /* get audio sink for AGs if available */
-    HfpLinkGetAudioSink(hfp_primary_link, &lAudioStatus->sinkAG1);
-    HfpLinkGetAudioSink(hfp_secondary_link, &lAudioStatus->sinkAG2);  
-    
-    /* get status of current a2dp links */
-    getA2dpStreamData(a2dp_primary,   &lAudioStatus->a2dpSinkPri, &lAudioStatus->a2dpStatePri);
-    getA2dpStreamData(a2dp_secondary, &lAudioStatus->a2dpSinkSec, &lAudioStatus->a2dpStateSec);
-    
-    getA2dpStreamRole(a2dp_primary, &lAudioStatus->a2dpRolePri);
-    getA2dpStreamRole(a2dp_secondary, &lAudioStatus->a2dpRoleSec);
+    audioFillStatus(routed_audio, lAudioStatus);
     
     return lAudioStatus;
 }
 
+/****************************************************************************
+NAME    
+    audioRoutingInvalidate
+*/
+void audioRoutingInvalidate(void)
+{
+    gAudioRouting.valid = FALSE;
+}
+
+/****************************************************************************
+NAME    
+    audioRoutingGetDecision
+*/
+const audio_routing_decision * audioRoutingGetDecision(uint16 age)
+{
+    if(age >= gAudioRouting.logged)
+        return NULL;
+
+    return &gAudioRouting.log[(gAudioRouting.next + AUDIO_ROUTING_LOG_SIZE - 1 - age) % AUDIO_ROUTING_LOG_SIZE];
+}
+
 #ifdef ENABLE_SOUNDBAR
 #ifdef ENABLE_SUBWOOFER
 
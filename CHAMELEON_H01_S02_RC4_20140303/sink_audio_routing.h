@@ -42,6 +42,28 @@ typedef enum
     audio_source_end_of_list
 }audio_sources;
 
+/* sources the headset routing policy sees as available, in priority order,
+   a set bit means the probe for that source may route it */
+#define AUDIO_AVAILABLE_ASR         (1<<0)  /* speech recognition running */
+#define AUDIO_AVAILABLE_CALL_SCO    (1<<1)  /* sco with a call or voice dial, or an incoming call */
+#define AUDIO_AVAILABLE_A2DP        (1<<2)  /* an a2dp media channel is open */
+#define AUDIO_AVAILABLE_USB         (1<<3)
+#define AUDIO_AVAILABLE_WIRED       (1<<4)
+#define AUDIO_AVAILABLE_FM          (1<<5)
+#define AUDIO_AVAILABLE_SCO         (1<<6)  /* sco without a call */
+
+/* number of routing decisions kept */
+#define AUDIO_ROUTING_LOG_SIZE      (8)
+
+/* a routing decision made by the headset routing policy */
+typedef struct
+{
+    uint16      available;          /* AUDIO_AVAILABLE_ bits the decision was made on */
+    uint16      routed;             /* AUDIO_AVAILABLE_ bit of the source routed, 0 if none */
+    uint16      time;               /* seconds since boot the decision was made at */
+    uint16      skipped;            /* triggers since the previous decision where nothing had changed */
+}audio_routing_decision;
+
 #ifdef ENABLE_SOUNDBAR
 /****************************************************************************
 NAME    
@@ -255,6 +277,31 @@ RETURNS
 */
 audio_source_status * audioGetStatus(Sink routed_audio);
 
+/****************************************************************************
+NAME
+    audioRoutingInvalidate
+
+DESCRIPTION
+    force the next call to audioHandleRouting to evaluate the routing policy
+    even if none of the routing inputs have changed since the last evaluation
+
+RETURNS
+    none
+*/
+void audioRoutingInvalidate(void);
+
+/****************************************************************************
+NAME
+    audioRoutingGetDecision
+
+DESCRIPTION
+    get one of the routing decisions kept, 0 is the most recent
+
+RETURNS
+    the decision, NULL if no decision that old is kept
+*/
+const audio_routing_decision * audioRoutingGetDecision(uint16 age);
+
 #ifdef ENABLE_SOUNDBAR
 #ifdef ENABLE_SUBWOOFER
 
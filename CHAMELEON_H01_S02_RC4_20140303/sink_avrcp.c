@@ -104,6 +104,7 @@ static void sendAvrcpPassthroughCmd(avc_operation_id op_id, uint8 state, uint16
         theSink.avrcp_link_data->cmd_queue_size[Index]--;  
     /* Send a key press */
     AvrcpPassthroughRequest(theSink.avrcp_link_data->avrcp[Index], subunit_panel, 0, state, op_id, 0, 0);   
+    linkPolicyNoteActivity();
 }
 
 /*************************************************************************
@@ -273,6 +274,13 @@ static void avrcpControlHandler(Task task, MessageId id, Message message)
         }
         sinkAvrcpConnect(&addr, DEFAULT_AVRCP_NO_CONNECTION_DELAY);
     }
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+    else if (id == AVRCP_METADATA_TIMEOUT)
+    {
+        AVRCP_DEBUG(("AVRCP_METADATA_TIMEOUT :\n"));
+        sinkAvrcpMetadataAbort(*(uint16 *)message);
+    }
+#endif
     else if (id == AVRCP_CONTROL_SEND)
     {
         uint16 Index = ((AVRCP_CONTROL_SEND_T *)message)->index;
@@ -378,6 +386,10 @@ static void avrcpControlHandler(Task task, MessageId id, Message message)
             case AVRCP_CTRL_ABORT_CONTINUING_RESPONSE:
                 AVRCP_DEBUG(("  Sending Abort Continuing Response\n"));
                 sendAvrcpAbortContinuingCmd(Index, ((AVRCP_CTRL_ABORT_CONTINUING_RESPONSE_T *)message)->pdu_id);
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+                if (((AVRCP_CTRL_ABORT_CONTINUING_RESPONSE_T *)message)->pdu_id == AVRCP_GET_ELEMENT_ATTRIBUTES_PDU_ID)
+                    sinkAvrcpMetadataAbort(Index);
+#endif
                 break;
             default:
                 break;
@@ -620,6 +632,9 @@ static void resetAvrcpConnection(uint16 Index)
     theSink.avrcp_link_data->registered_events[Index] = 0;
     theSink.avrcp_link_data->features[Index] = 0;
     theSink.avrcp_link_data->event_capabilities[Index] = 0;  
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+    memset(&theSink.avrcp_link_data->metadata[Index], 0, sizeof(sinkAvrcpMetadata));
+#endif
 }
 
 
@@ -693,6 +708,8 @@ static void handleAvrcpPassthroughInd(AVRCP_PASSTHROUGH_IND_T *msg)
     uint16 avrcpIndex;
     uint16 a2dpIndex;
     
+    linkPolicyNoteActivity();
+    
     /* Acknowledge the request */    
     if ((msg->opid == opid_volume_up) || (msg->opid == opid_volume_down))
     {        
@@ -1060,13 +1077,11 @@ static void handleAvrcpGetElementAttributesCfm(AVRCP_GET_ELEMENT_ATTRIBUTES_CFM_
 {
     uint16 Index;
     
-    if ((msg->status == avrcp_success) && (sinkAvrcpGetIndexFromInstance(msg->avrcp, &Index)))
+    if (!sinkAvrcpGetIndexFromInstance(msg->avrcp, &Index))
+        return;
+    
+    if (msg->status == avrcp_success)
     {
-        uint16 i = 0;
-        uint32 attribute_id = 0;
-        uint16 charset_id = 0;
-        uint16 attribute_length = 0;
-        uint16 header_end = 0;
         const uint8 *lSource = SourceMap(msg->attributes);
         uint16 source_size = SourceSize(msg->attributes);
         uint16 size_attributes = (source_size < msg->size_attributes) ? source_size : msg->size_attributes;              
@@ -1075,40 +1090,9 @@ static void handleAvrcpGetElementAttributesCfm(AVRCP_GET_ELEMENT_ATTRIBUTES_CFM_
         {
             AVRCP_DEBUG(("   success; packet[%d] num_attr[%d] size_att[%d] size_source[%d]\n", msg->metadata_packet_type, msg->number_of_attributes, msg->size_attributes, source_size));                
             
-            header_end = i + AVRCP_GET_ELEMENT_ATTRIBUTES_CFM_HEADER_SIZE;
-            while (size_attributes >= header_end) /* check there is room left for data to exist */
-            {         
-                attribute_id = ((uint32)lSource[i] << 24) | ((uint32)lSource[i + 1] << 16) | ((uint32)lSource[i + 2] << 8) | lSource[i + 3];
-                charset_id = (lSource[i + 4] << 8) | lSource[i + 5];
-                attribute_length = (lSource[i + 6] << 8) | lSource[i + 7];
-                
-                AVRCP_DEBUG(("        attribute = 0x%lx\n", attribute_id));
-                AVRCP_DEBUG(("        charset_id = 0x%x\n", charset_id));
-                AVRCP_DEBUG(("        attribute_length = 0x%x\n", attribute_length));
-                        
-                if ((attribute_length + header_end) > size_attributes)
-                    attribute_length = size_attributes - header_end;
-                
-#ifdef DEBUG_AVRCP    
-                {
-                    uint16 j;
-                    AVRCP_DEBUG(("        attribute text : "));
-                    for (j = i; j < (i + attribute_length); j++)
-                    {                    
-                        AVRCP_DEBUG(("%c", lSource[j + 8]));                    
-                    }
-                        AVRCP_DEBUG(("\n"));
-                }
-#endif                               
-                
-                AVRCP_DEBUG(("AVRCP NOW PLAYING:\n"));
-                
-                if (attribute_length)
-                    sinkAvrcpDisplayMediaAttributes(attribute_id, attribute_length, &lSource[i + 8]);
-
-                i = header_end + attribute_length;
-                header_end = i + AVRCP_GET_ELEMENT_ATTRIBUTES_CFM_HEADER_SIZE;
-            }
+            /* values go straight into the cache, an attribute split across
+               fragments is completed by the next fragment */
+            sinkAvrcpMetadataParse(Index, lSource, size_attributes);
                     
             /* finished processing the source */
             AvrcpSourceProcessed(msg->avrcp);  
@@ -1125,16 +1109,23 @@ static void handleAvrcpGetElementAttributesCfm(AVRCP_GET_ELEMENT_ATTRIBUTES_CFM_
                 message->pdu_id = AVRCP_GET_ELEMENT_ATTRIBUTES_PDU_ID;
                 AvrcpRequestContinuingResponseRequest(msg->avrcp, AVRCP_GET_ELEMENT_ATTRIBUTES_PDU_ID);
                 MessageSendLater(&theSink.avrcp_link_data->avrcp_ctrl_handler[Index], AVRCP_CTRL_ABORT_CONTINUING_RESPONSE, message, AVRCP_ABORT_CONTINUING_TIMEOUT);
-            }            
+            }
+            else
+            {
+                /* whole response received */
+                sinkAvrcpMetadataComplete(Index);
+            }
         }
         else
         {
             AVRCP_DEBUG(("   fail; no source; num attributes zero\n"));
+            sinkAvrcpMetadataAbort(Index);
         }
     }
     else
     {
         AVRCP_DEBUG(("   fail; status %d\n", msg->status));
+        sinkAvrcpMetadataAbort(Index);
     }
 }
 
@@ -1162,6 +1153,10 @@ static void handleAvrcpNowPlayingContentChangedInd(AVRCP_EVENT_NOW_PLAYING_CONTE
             {
                 /* re-register to receive notifications */
                 AvrcpRegisterNotificationRequest(msg->avrcp, avrcp_event_now_playing_content_changed, 0);   
+                
+#ifdef ENABLE_AVRCP_BROWSING
+                sinkAvrcpBrowsingInvalidateScope(Index, avrcp_now_playing_scope);
+#endif
                               
                 if (sinkAvrcpGetActiveConnection() == Index)
                 {
@@ -1200,6 +1195,9 @@ static void handleAvrcpTrackChangedInd(AVRCP_EVENT_TRACK_CHANGED_IND_T *msg)
             /* store that this command is supported by remote device */
             theSink.avrcp_link_data->registered_events[Index] |= (1 << avrcp_event_track_changed);
         
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+            sinkAvrcpMetadataTrackChanged(Index, msg->track_index_high, msg->track_index_low);
+#endif
 
             if (msg->response == avctp_response_changed)
             {
@@ -2786,6 +2784,215 @@ void sinkAvrcpDisplayMediaAttributes(uint32 attribute_id, uint16 attribute_lengt
 
 
 #ifdef ENABLE_AVRCP_NOW_PLAYING
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataDisplay
+    
+DESCRIPTION
+    Displays the cached Now Playing attributes of a connection.
+
+**************************************************************************/
+static void sinkAvrcpMetadataDisplay(uint16 Index)
+{
+    sinkAvrcpMetadata *metadata = &theSink.avrcp_link_data->metadata[Index];
+    const uint8 *value;
+    uint16 length;
+    uint16 i;
+    
+    AVRCP_DEBUG(("AVRCP NOW PLAYING:\n"));
+    
+    for (i = 1; i <= AVRCP_METADATA_NUM_ATTRIBUTES; i++)
+    {
+        if ((value = avrcpMetadataGetValue(metadata, i, &length)) != NULL)
+            sinkAvrcpDisplayMediaAttributes(i, length, value);
+    }
+}
+
+
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataTrackChanged
+    
+DESCRIPTION
+    Track Changed notification received, the cache is kept if the UID is
+    the one already cached. A UID of zero does not identify the track and
+    all ones means no track is selected, so neither is treated as unchanged.
+
+**************************************************************************/
+void sinkAvrcpMetadataTrackChanged(uint16 Index, uint32 track_index_high, uint32 track_index_low)
+{
+    sinkAvrcpMetadata *metadata = &theSink.avrcp_link_data->metadata[Index];
+    bool known = ((track_index_high != 0) || (track_index_low != 0)) &&
+                 ((track_index_high != 0xffffffff) || (track_index_low != 0xffffffff));
+    
+    if (known && (track_index_high == metadata->uid_high) && (track_index_low == metadata->uid_low))
+    {
+        AVRCP_DEBUG(("AVRCP: Metadata track unchanged\n"));
+        return;
+    }
+    
+    metadata->uid_high = track_index_high;
+    metadata->uid_low = track_index_low;
+    metadata->valid = FALSE;
+    metadata->pending = FALSE;
+    metadata->track_seq++;
+}
+
+
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataIsCurrent
+    
+DESCRIPTION
+    Checks whether the cache holds the current track. The cached attributes
+    are displayed again if it does.
+
+RETURNS
+    TRUE if the cache holds the current track, FALSE otherwise.
+
+**************************************************************************/
+bool sinkAvrcpMetadataIsCurrent(uint16 Index, bool full_attributes)
+{
+    sinkAvrcpMetadata *metadata = &theSink.avrcp_link_data->metadata[Index];
+    
+    if (full_attributes && !metadata->full)
+        return FALSE;
+    
+    if (metadata->valid)
+    {
+        AVRCP_DEBUG(("AVRCP: Metadata from cache\n"));
+        sinkAvrcpMetadataDisplay(Index);
+        return TRUE;
+    }
+    
+    return FALSE;
+}
+
+
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataIsPending
+    
+DESCRIPTION
+    Checks whether a Now Playing request for the current track is outstanding.
+    A request is only outstanding until its response arrives, fails or times out.
+
+RETURNS
+    TRUE if the attributes are being fetched, FALSE if a request should be made.
+
+**************************************************************************/
+bool sinkAvrcpMetadataIsPending(uint16 Index, bool full_attributes)
+{
+    sinkAvrcpMetadata *metadata = &theSink.avrcp_link_data->metadata[Index];
+    
+    if (full_attributes && !metadata->full)
+        return FALSE;
+    
+    return metadata->pending;
+}
+
+
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataStartTimeout
+    
+DESCRIPTION
+    (Re)starts the wait for the rest of a Now Playing response.
+
+**************************************************************************/
+static void sinkAvrcpMetadataStartTimeout(uint16 Index)
+{
+    uint16 *message = PanicUnlessNew(uint16);
+    
+    *message = Index;
+    MessageCancelAll(&theSink.avrcp_link_data->avrcp_ctrl_handler[Index], AVRCP_METADATA_TIMEOUT);
+    MessageSendLater(&theSink.avrcp_link_data->avrcp_ctrl_handler[Index], AVRCP_METADATA_TIMEOUT, message, AVRCP_METADATA_RESPONSE_TIMEOUT);
+}
+
+
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataStart
+    
+DESCRIPTION
+    Empties the cache of a connection ready for the response to a Now Playing request.
+    The request is abandoned if the response has not arrived in time.
+
+**************************************************************************/
+void sinkAvrcpMetadataStart(uint16 Index, bool full_attributes)
+{
+    sinkAvrcpMetadata *metadata = &theSink.avrcp_link_data->metadata[Index];
+    
+    avrcpMetadataReset(metadata);
+    metadata->full = full_attributes;
+    metadata->valid = FALSE;
+    metadata->pending = TRUE;
+    metadata->fetch_seq = metadata->track_seq;
+    
+    sinkAvrcpMetadataStartTimeout(Index);
+}
+
+
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataParse
+    
+DESCRIPTION
+    Parses a fragment of a Now Playing response into the cache, see
+    avrcpMetadataParse.
+
+**************************************************************************/
+void sinkAvrcpMetadataParse(uint16 Index, const uint8 *data, uint16 length)
+{
+    /* more of the response has arrived, wait for the rest */
+    if (theSink.avrcp_link_data->metadata[Index].pending)
+        sinkAvrcpMetadataStartTimeout(Index);
+    
+    avrcpMetadataParse(&theSink.avrcp_link_data->metadata[Index], data, length);
+}
+
+
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataComplete
+    
+DESCRIPTION
+    The whole response has been received, display it. The cache is only
+    marked valid if the track has not changed since the request was made.
+
+**************************************************************************/
+void sinkAvrcpMetadataComplete(uint16 Index)
+{
+    sinkAvrcpMetadata *metadata = &theSink.avrcp_link_data->metadata[Index];
+    
+    MessageCancelAll(&theSink.avrcp_link_data->avrcp_ctrl_handler[Index], AVRCP_METADATA_TIMEOUT);
+    
+    metadata->pending = FALSE;
+    metadata->valid = (metadata->fetch_seq == metadata->track_seq);
+    
+    AVRCP_DEBUG(("AVRCP: Metadata complete truncated[%d] valid[%d]\n", metadata->truncated, metadata->valid));
+    
+    sinkAvrcpMetadataDisplay(Index);
+}
+
+
+/*************************************************************************
+NAME    
+    sinkAvrcpMetadataAbort
+    
+DESCRIPTION
+    The Now Playing request failed or timed out, allow it to be retried.
+
+**************************************************************************/
+void sinkAvrcpMetadataAbort(uint16 Index)
+{
+    MessageCancelAll(&theSink.avrcp_link_data->avrcp_ctrl_handler[Index], AVRCP_METADATA_TIMEOUT);
+    
+    theSink.avrcp_link_data->metadata[Index].pending = FALSE;
+    theSink.avrcp_link_data->metadata[Index].valid = FALSE;
+}
+
+
 /*************************************************************************
 NAME    
     sinkAvrcpRetrieveNowPlayingRequest
@@ -2806,6 +3013,11 @@ void sinkAvrcpRetrieveNowPlayingRequest(uint32 track_index_high, uint32 track_in
   
     if (theSink.avrcp_link_data->connected[Index])
     {               
+        /* nothing to fetch if the track has not changed since it was last retrieved,
+           or if it is already being fetched */
+        if (sinkAvrcpMetadataIsCurrent(Index, full_attributes) || sinkAvrcpMetadataIsPending(Index, full_attributes))
+            return;
+        
 #ifdef ENABLE_AVRCP_BROWSING        
         if (sinkAvrcpBrowsingIsSupported(Index) && ((track_index_high != 0x0) || (track_index_low != 0x0)))
         {
@@ -2838,6 +3050,13 @@ void sinkAvrcpRetrieveNowPlayingNoBrowsingRequest(uint16 Index, bool full_attrib
     uint16 size_media_attributes;
     Source src_media_attributes;    
     
+    /* nothing to fetch if the track has not changed since it was last retrieved,
+       or if it is already being fetched */
+    if (sinkAvrcpMetadataIsCurrent(Index, full_attributes) || sinkAvrcpMetadataIsPending(Index, full_attributes))
+        return;
+    
+    sinkAvrcpMetadataStart(Index, full_attributes);
+    
     if (full_attributes)
     {
         size_media_attributes = sizeof(avrcp_retrieve_media_attributes_full);
@@ -19,6 +19,8 @@ Copyright (C) Cambridge Silicon Radio Ltd. 2005-2013
 
 #include <avrcp.h>
 
+#include "sink_avrcp_browsing.h"
+
 
 /* Define to allow display of Now Playing information */
 #define ENABLE_AVRCP_NOW_PLAYINGx
@@ -47,6 +49,8 @@ Copyright (C) Cambridge Silicon Radio Ltd. 2005-2013
 
 #define AVRCP_ABORT_CONTINUING_TIMEOUT 5000 /* amount of time to wait to receive fragment of Metadata packet before aborting */
 
+#define AVRCP_METADATA_RESPONSE_TIMEOUT 5000 /* amount of time to wait for a Now Playing response before it can be requested again */
+
 #define AVRCP_GET_ELEMENT_ATTRIBUTES_CFM_HEADER_SIZE 8 /* amount of fixed data in Source of AVRCP_GET_ELEMENT_ATTRIBUTES_CFM_T message before variable length data */
 #define AVRCP_GET_APP_ATTRIBUTES_TEXT_CFM_HEADER_SIZE 4 /* amount of fixed data in Source of AVRCP_GET_APP_ATTRIBUTE_TEXT_CFM_T message before variable length data */
 #define AVRCP_GET_APP_VALUE_CFM_DATA_SIZE 2 /* amount of fixed data in Source of AVRCP_GET_APP_VALUE_CFM_T message before variable length data */
@@ -85,7 +89,8 @@ typedef enum
 typedef enum
 {
   AVRCP_CONTROL_SEND,
-  AVRCP_CREATE_CONNECTION
+  AVRCP_CREATE_CONNECTION,
+  AVRCP_METADATA_TIMEOUT
 } avrcp_ctrl_message;
 
 typedef enum
@@ -125,6 +130,10 @@ typedef struct
     uint8               *data;
 } SinkAvrcpCleanUpTask;
 
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+#include "sink_avrcp_metadata.h"
+#endif /* ENABLE_AVRCP_NOW_PLAYING */
+
 
 typedef struct
 {
@@ -146,6 +155,9 @@ typedef struct
     uint16 absolute_volume[MAX_AVRCP_CONNECTIONS];
     bdaddr avrcp_play_addr;
     bool   link_active[MAX_AVRCP_CONNECTIONS];
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+    sinkAvrcpMetadata metadata[MAX_AVRCP_CONNECTIONS];
+#endif
 #ifdef ENABLE_AVRCP_BROWSING
     TaskData avrcp_browsing_handler[MAX_AVRCP_CONNECTIONS];
     uint16 browsing_channel[MAX_AVRCP_CONNECTIONS];   
@@ -153,6 +165,7 @@ typedef struct
     uint16 media_player_features[MAX_AVRCP_CONNECTIONS];
     uint16 media_player_id[MAX_AVRCP_CONNECTIONS];
     uint16 browsing_scope[MAX_AVRCP_CONNECTIONS];
+    avrcp_browsing_cache *browsing_cache;
 #endif
 } avrcp_data;
 
@@ -229,6 +242,14 @@ void sinkAvrcpDisplayMediaAttributes(uint32 attribute_id, uint16 attribute_lengt
 void sinkAvrcpRetrieveNowPlayingRequest(uint32 track_index_high, uint32 track_index_low, bool full_attributes);
 
 void sinkAvrcpRetrieveNowPlayingNoBrowsingRequest(uint16 Index, bool full_attributes);
+/* Now Playing metadata cache */
+void sinkAvrcpMetadataTrackChanged(uint16 Index, uint32 track_index_high, uint32 track_index_low);
+bool sinkAvrcpMetadataIsCurrent(uint16 Index, bool full_attributes);
+bool sinkAvrcpMetadataIsPending(uint16 Index, bool full_attributes);
+void sinkAvrcpMetadataStart(uint16 Index, bool full_attributes);
+void sinkAvrcpMetadataParse(uint16 Index, const uint8 *data, uint16 length);
+void sinkAvrcpMetadataComplete(uint16 Index);
+void sinkAvrcpMetadataAbort(uint16 Index);
 #endif /* ENABLE_AVRCP_NOW_PLAYING */
 
 #ifdef ENABLE_AVRCP_PLAYER_APP_SETTINGS
@@ -2,6 +2,8 @@
 
 #include "sink_avrcp_browsing.h"
 #include "sink_private.h"
+#include "sink_display.h"
+#include "display_plugin_if.h"
 
 /****************************************************************************
 Copyright (C) Cambridge Silicon Radio Ltd. 2005-2013
@@ -21,7 +23,8 @@ DESCRIPTION
     if no commands are sent within the AVRCP_BROWSING_DISCONNECT_ON_IDLE_TIMER timeout.
     
     The application should use the Request functions in this file to send Browsing commands and the Cfm and Ind functions will handle the
-    responses. Code will need to be added for display capable devices in order to display the information returned over the AVRCP browsing channel. 
+    responses. Items retrieved through the page cache are shown on the display, the first AVRCP_BROWSING_DISPLAY_LINES items of each request
+    one per line. 
     Most of the code for registering for notication of changes in TG device has already be added, although some functionality like registering for
     changes in battery status and system status has not been added.
 
@@ -67,6 +70,28 @@ bool sinkAvrcpBrowsingIsSupported(uint16 Index)
 #ifdef ENABLE_AVRCP_BROWSING
 
 #include <source.h>
+#include <string.h>
+
+
+/*************************************************************************
+NAME    
+    avrcpBrowseStoreItem
+    
+DESCRIPTION
+    Stores a GetFolderItems item in the page being retrieved, the displayable name is truncated to AVRCP_BROWSING_ITEM_NAME_MAX.
+
+**************************************************************************/
+static void avrcpBrowseStoreItem(avrcp_browsing_item *cached, uint8 type, avrcp_browse_uid uid, uint8 is_playable, uint16 name_length, const uint8 *name)
+{
+    if (name_length > AVRCP_BROWSING_ITEM_NAME_MAX)
+        name_length = AVRCP_BROWSING_ITEM_NAME_MAX;
+    
+    cached->uid = uid;
+    cached->type = type;
+    cached->is_playable = is_playable ? AVRCP_BROWSING_MEDIA_PLAYABLE : AVRCP_BROWSING_MEDIA_NOT_PLAYABLE;
+    cached->name_length = name_length;
+    memmove(cached->name, name, name_length);
+}
 
 
 /*************************************************************************
@@ -74,10 +99,12 @@ NAME
     avrcpBrowseMediaPlayerItem
     
 DESCRIPTION
-    Handles the GetFolderItems media player item data.
+    Handles the GetFolderItems media player item data, storing the item in cached if it is not NULL.
 
+RETURNS
+    Returns TRUE if the item was valid, FALSE otherwise.
 **************************************************************************/
-static void avrcpBrowseMediaPlayerItem(uint16 Index, uint16 max_length, uint16 item_length, const uint8 *item)
+static bool avrcpBrowseMediaPlayerItem(uint16 Index, uint16 max_length, uint16 item_length, const uint8 *item, avrcp_browsing_item *cached)
 {
     uint16 player_id = 0;
     uint8 major_player_type = 0;
@@ -88,7 +115,7 @@ static void avrcpBrowseMediaPlayerItem(uint16 Index, uint16 max_length, uint16 i
     
     /* check that the item array elements are accessible */
     if (max_length < AVRCP_BROWSE_MEDIA_PLAYER_ITEM_HEADER_SIZE)
-        return;
+        return FALSE;
         
     player_id = (item[0] << 8) | item[1];
     major_player_type = item[2];
@@ -125,7 +152,15 @@ static void avrcpBrowseMediaPlayerItem(uint16 Index, uint16 max_length, uint16 i
      }
 #endif
     
-    /* TODO display player with ID of player_id and displayable name starting at item[28] with name length of displayable_name_length */    
+    if (cached)
+    {
+        avrcp_browse_uid uid;
+        uid.msb = 0;
+        uid.lsb = player_id;
+        avrcpBrowseStoreItem(cached, AVRCP_BROWSABLE_ITEM_TYPE_MEDIA_PLAYER, uid, AVRCP_BROWSING_MEDIA_NOT_PLAYABLE, displayable_name_length, &item[28]);
+    }
+    
+    return TRUE;
 }
 
 /*************************************************************************
@@ -133,10 +168,12 @@ NAME
     avrcpBrowseMediaElementItem
     
 DESCRIPTION
-    Handles the GetFolderItems media element item data.
+    Handles the GetFolderItems media element item data, storing the item in cached if it is not NULL.
 
+RETURNS
+    Returns TRUE if the item was valid, FALSE otherwise.
 **************************************************************************/
-static void avrcpBrowseMediaElementItem(uint16 max_length, uint16 item_length, const uint8 *item)
+static bool avrcpBrowseMediaElementItem(uint16 max_length, uint16 item_length, const uint8 *item, avrcp_browsing_item *cached)
 {
     avrcp_browse_uid uid;    
     uint8 media_type;
@@ -150,7 +187,7 @@ static void avrcpBrowseMediaElementItem(uint16 max_length, uint16 item_length, c
     
     /* check that the item array elements are accessible */
     if (max_length < AVRCP_BROWSE_MEDIA_ELEMENT_ITEM_HEADER_SIZE)
-        return;
+        return FALSE;
     
     uid.msb = ((uint32)item[0] << 24) | ((uint32)item[1] << 16) | ((uint32)item[2] << 8) | item[3];
     uid.lsb = ((uint32)item[4] << 24) | ((uint32)item[5] << 16) | ((uint32)item[6] << 8) | item[7];
@@ -162,7 +199,7 @@ static void avrcpBrowseMediaElementItem(uint16 max_length, uint16 item_length, c
     
     /* if displayable name length is too long then discard this data as corrupt */
     if (displayable_name_length > (max_length - AVRCP_BROWSE_MEDIA_ELEMENT_ITEM_HEADER_SIZE))
-        return;
+        return FALSE;
     
     /* item[13] to item[13+displayable_name_length-1] is displayable name */
 #ifdef DEBUG_AVRCP_BROWSING    
@@ -209,18 +246,11 @@ static void avrcpBrowseMediaElementItem(uint16 max_length, uint16 item_length, c
         index = index + AVRCP_BROWSE_GET_ITEM_ATTRIBUTES_CFM_HEADER_SIZE + attribute_value_length;
     }         
     
-    {
-        uint16 Index = sinkAvrcpGetActiveConnection();
-        /* just display displayable name for menu */
-        if (theSink.avrcp_link_data->browsing_scope[Index] == SCOPE_NON_ZERO(avrcp_virtual_filesystem_scope))
-        {
-            /* TODO display track in virtual filesystem with displayable name starting at item[13] and of length displayable_name_length */            
-        }
-        else if (theSink.avrcp_link_data->browsing_scope[Index] == SCOPE_NON_ZERO(avrcp_now_playing_scope))
-        {
-            /* TODO display Now Playing track with displayable name starting at item[13] and of length displayable_name_length */            
-        }
-    }
+    /* just the displayable name is kept for the menu */
+    if (cached)
+        avrcpBrowseStoreItem(cached, AVRCP_BROWSABLE_ITEM_TYPE_MEDIA_ELEMENT, uid, AVRCP_BROWSING_MEDIA_PLAYABLE, displayable_name_length, &item[13]);
+    
+    return TRUE;
 }
 
 /*************************************************************************
@@ -228,10 +258,12 @@ NAME
     avrcpBrowseFolderItem
     
 DESCRIPTION
-    Handles the GetFolderItems folder item data.
+    Handles the GetFolderItems folder item data, storing the item in cached if it is not NULL.
 
+RETURNS
+    Returns TRUE if the item was valid, FALSE otherwise.
 **************************************************************************/
-static void avrcpBrowseFolderItem(uint16 Index, uint16 max_length, uint16 item_length, const uint8 *item)
+static bool avrcpBrowseFolderItem(uint16 Index, uint16 max_length, uint16 item_length, const uint8 *item, avrcp_browsing_item *cached)
 {
     avrcp_browse_uid uid;
     uint8 folder_type;
@@ -241,7 +273,7 @@ static void avrcpBrowseFolderItem(uint16 Index, uint16 max_length, uint16 item_l
     
     /* check that the item array elements are accessible */
     if (max_length < AVRCP_BROWSE_FOLDER_ITEM_HEADER_SIZE)
-        return;
+        return FALSE;
         
     uid.msb = ((uint32)item[0] << 24) | ((uint32)item[1] << 16) | ((uint32)item[2] << 8) | item[3];
     uid.lsb = ((uint32)item[4] << 24) | ((uint32)item[5] << 16) | ((uint32)item[6] << 8) | item[7];
@@ -268,9 +300,320 @@ static void avrcpBrowseFolderItem(uint16 Index, uint16 max_length, uint16 item_l
      }
 #endif
     
-    /* TODO display folder with displayable name starting at item[14] and of length displayable_name_length - is_playable states if this folder is playable */
+    if (cached)
+        avrcpBrowseStoreItem(cached, AVRCP_BROWSABLE_ITEM_TYPE_FOLDER, uid, is_playable, displayable_name_length, &item[14]);
+    
+    return TRUE;
+}
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheGet
+    
+DESCRIPTION
+    Returns the browsing cache for the connection, allocating it if needed. Only pages from one connection are cached, 
+    so the pages held are discarded if they were retrieved from another connection.
+
+**************************************************************************/
+static avrcp_browsing_cache *avrcpBrowsingCacheGet(uint16 Index)
+{
+    avrcp_browsing_cache *cache = theSink.avrcp_link_data->browsing_cache;
+    
+    if (!cache)
+    {
+        cache = (avrcp_browsing_cache *)mallocPanic(sizeof(avrcp_browsing_cache));
+        memset(cache, 0, sizeof(avrcp_browsing_cache));
+        cache->link = Index;
+        theSink.avrcp_link_data->browsing_cache = cache;
+    }
+    else if (cache->link != Index)
+    {
+        AVRCP_BROWSING_DEBUG(("AVRCP: browsing cache moved to link [%d]\n", Index));
+        memset(cache, 0, sizeof(avrcp_browsing_cache));
+        cache->link = Index;
+    }
+    
+    return cache;
+}
+
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheFlush
+    
+DESCRIPTION
+    Discards all pages cached for the connection.
+
+**************************************************************************/
+static void avrcpBrowsingCacheFlush(uint16 Index)
+{
+    avrcp_browsing_cache *cache = theSink.avrcp_link_data->browsing_cache;
+    uint16 i;
+    
+    if (cache && (cache->link == Index))
+    {
+        AVRCP_BROWSING_DEBUG(("AVRCP: browsing cache flush\n"));
+        for (i = 0; i < AVRCP_BROWSING_CACHE_PAGES; i++)
+            cache->page[i].valid = FALSE;
+    }
+}
+
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheFindPage
+    
+DESCRIPTION
+    Finds the cached page of the scope starting at start_index, only pages retrieved with the current UID counter match.
+
+RETURNS
+    Returns the page, or NULL if the page is not cached.
+**************************************************************************/
+static avrcp_browsing_page *avrcpBrowsingCacheFindPage(avrcp_browsing_cache *cache, avrcp_browse_scope scope, uint16 start_index)
+{
+    avrcp_browsing_page *page = cache->page;
+    uint16 i;
+    
+    for (i = 0; i < AVRCP_BROWSING_CACHE_PAGES; i++, page++)
+    {
+        if (page->valid && (page->scope == scope) && (page->start_index == start_index) && 
+            (page->uid_counter == theSink.avrcp_link_data->uid_counter[cache->link]))
+        {
+            page->last_used = ++cache->use_count;
+            return page;
+        }
+    }
+    return NULL;
+}
+
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheNewPage
+    
+DESCRIPTION
+    Gets a page to store newly retrieved items in, replacing an invalid page if there is one or else the least recently used page.
+
+RETURNS
+    Returns the page, which is left invalid until it has been filled.
+**************************************************************************/
+static avrcp_browsing_page *avrcpBrowsingCacheNewPage(avrcp_browsing_cache *cache)
+{
+    avrcp_browsing_page *page = &cache->page[0];
+    uint16 i;
+    
+    for (i = 0; i < AVRCP_BROWSING_CACHE_PAGES; i++)
+    {
+        if (!cache->page[i].valid)
+        {
+            page = &cache->page[i];
+            break;
+        }
+        /* ages are compared as differences so the count wrapping does not matter */
+        if ((uint16)(cache->use_count - cache->page[i].last_used) > (uint16)(cache->use_count - page->last_used))
+            page = &cache->page[i];
+    }
+    
+    memset(page, 0, sizeof(avrcp_browsing_page));
+    page->last_used = ++cache->use_count;
+    return page;
+}
+
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheFetchPage
+    
+DESCRIPTION
+    Sends the Get Folder Items command to retrieve the page of the scope starting at start_index.
+    The page is stored when sinkAvrcpBrowsingGetFolderItemsCfm is called.
+
+**************************************************************************/
+static void avrcpBrowsingCacheFetchPage(uint16 Index, avrcp_browse_scope scope, uint16 start_index)
+{
+    avrcp_browsing_cache *cache = theSink.avrcp_link_data->browsing_cache;
+    uint16 end_index = start_index + AVRCP_BROWSING_PAGE_ITEMS - 1;
+    
+    AVRCP_BROWSING_DEBUG(("AVRCP: browsing cache fetch scope[%d] start[0x%x]\n", scope, start_index));
+    
+    cache->fetching = TRUE;
+    cache->fetch_scope = scope;
+    cache->fetch_index = start_index;
+    
+    /* as the confirmation messages don't return the scope, can only send one scope message at a time */
+    theSink.avrcp_link_data->browsing_scope[Index] = SCOPE_NON_ZERO(scope);
+    
+    if (scope == avrcp_media_player_scope)
+    {
+        /* get notification of changes in media players */
+        AvrcpRegisterNotificationRequest(theSink.avrcp_link_data->avrcp[Index], avrcp_event_available_players_changed, 0);
+        
+        AvrcpBrowseGetFolderItemsRequest(theSink.avrcp_link_data->avrcp[Index],   
+                                            avrcp_media_player_scope,   
+                                            start_index,   
+                                            end_index,      
+                                            0, 
+                                            0);
+    }
+    else
+    {
+        uint16 size_media_attributes = sizeof(avrcp_retrieve_media_attributes_basic);
+        Source src_media_attributes = StreamRegionSource(avrcp_retrieve_media_attributes_basic, size_media_attributes);
+        
+        if (scope == avrcp_now_playing_scope)
+        {
+            /* register to receive notifications of now playing content changes */
+            AvrcpRegisterNotificationRequest(theSink.avrcp_link_data->avrcp[Index], avrcp_event_now_playing_content_changed, 0);
+        }
+        
+        AvrcpBrowseGetFolderItemsRequest(theSink.avrcp_link_data->avrcp[Index],   
+                                            scope,   
+                                            start_index,   
+                                            end_index,      
+                                            AVRCP_NUMBER_MEDIA_ATTRIBUTES_BASIC, 
+                                            src_media_attributes);
+    }
 }
 
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheShowItems
+    
+DESCRIPTION
+    Displays the items of a cached page from first_index to last_index. The displayable name of a media player,
+    folder or media element is shown on the line given by its position in the request being served, items past
+    the last line are not shown.
+
+**************************************************************************/
+static void avrcpBrowsingCacheShowItems(const avrcp_browsing_cache *cache, const avrcp_browsing_page *page, uint16 first_index, uint16 last_index)
+{
+    const avrcp_browsing_item *item;
+    uint16 line;
+    uint16 i;
+    
+    for (i = first_index; i <= last_index; i++)
+    {
+        item = &page->item[i - page->start_index];
+        line = i - cache->start_index + 1;
+        
+        AVRCP_BROWSING_DEBUG(("   item[0x%x] type[%d] uid[0x%lx 0x%lx] name_length[%d] line[%d]\n", i, item->type, item->uid.msb, item->uid.lsb, item->name_length, line));
+        
+        if (line <= AVRCP_BROWSING_DISPLAY_LINES)
+        {
+#ifdef ENABLE_DISPLAY
+            displayShowText((char*)item->name, item->name_length, line, DISPLAY_TEXT_SCROLL_SCROLL, 500, 2000, FALSE, 0);
+#endif
+        }
+    }
+}
+
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheServe
+    
+DESCRIPTION
+    Displays the items of the request being served from the cache, retrieving the first page that is not cached.
+    Serving continues from sinkAvrcpBrowsingGetFolderItemsCfm once the page has been retrieved.
+    When the request has been served the page following it is retrieved, so that scrolling on finds it already cached.
+
+**************************************************************************/
+static void avrcpBrowsingCacheServe(uint16 Index)
+{
+    avrcp_browsing_cache *cache = theSink.avrcp_link_data->browsing_cache;
+    avrcp_browsing_page *page = NULL;
+    uint16 start_index;
+    uint16 last_index;
+    uint16 next_start;
+    
+    while (cache->serving)
+    {
+        start_index = cache->next_index - (cache->next_index % AVRCP_BROWSING_PAGE_ITEMS);
+        page = avrcpBrowsingCacheFindPage(cache, cache->scope, start_index);
+        
+        if (!page)
+        {
+            /* wait for the page, it may already be being retrieved by a prefetch */
+            if (!cache->fetching)
+                avrcpBrowsingCacheFetchPage(Index, cache->scope, start_index);
+            return;
+        }
+        
+        last_index = start_index + page->num_items - 1;
+        if (last_index > cache->end_index)
+            last_index = cache->end_index;
+        
+        if (page->num_items && (cache->next_index <= last_index))
+            avrcpBrowsingCacheShowItems(cache, page, cache->next_index, last_index);
+        
+        if (page->last || (last_index >= cache->end_index))
+            cache->serving = FALSE;
+        else
+            cache->next_index = last_index + 1;
+    }
+    
+    AVRCP_BROWSING_DEBUG(("AVRCP: browsing cache served scope[%d]\n", cache->scope));
+    
+    /* prefetch the page following the last page served */
+    next_start = page ? (page->start_index + AVRCP_BROWSING_PAGE_ITEMS) : 0;
+    if (page && !page->last && !cache->fetching && (next_start > page->start_index) && 
+        !avrcpBrowsingCacheFindPage(cache, cache->scope, next_start))
+    {
+        avrcpBrowsingCacheFetchPage(Index, cache->scope, next_start);
+    }
+}
+
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheRetrieve
+    
+DESCRIPTION
+    Starts serving the items of the scope from start_index to end_index, the display is cleared ready for them.
+
+**************************************************************************/
+static void avrcpBrowsingCacheRetrieve(uint16 Index, avrcp_browse_scope scope, uint16 start_index, uint16 end_index)
+{
+    avrcp_browsing_cache *cache = avrcpBrowsingCacheGet(Index);
+    
+    if (end_index < start_index)
+        return;
+    
+#ifdef ENABLE_DISPLAY
+    displayShowSimpleText(DISPLAYSTR_CLEAR, 1);
+    displayShowSimpleText(DISPLAYSTR_CLEAR, 2);
+#endif
+    
+    cache->scope = scope;
+    cache->start_index = start_index;
+    cache->next_index = start_index;
+    cache->end_index = end_index;
+    cache->serving = TRUE;
+    
+    avrcpBrowsingCacheServe(Index);
+}
+
+
+/*************************************************************************
+NAME    
+    avrcpBrowsingCacheIsPrefetching
+    
+DESCRIPTION
+    Checks if the outstanding Get Folder Items command is a prefetch, in which case a new request need not wait for it 
+    before being served from the cache.
+
+RETURNS
+    Returns TRUE if a page is being prefetched, FALSE otherwise.
+**************************************************************************/
+static bool avrcpBrowsingCacheIsPrefetching(uint16 Index)
+{
+    avrcp_browsing_cache *cache = theSink.avrcp_link_data->browsing_cache;
+    
+    return (cache && (cache->link == Index) && cache->fetching && !cache->serving);
+}
+
+
 /*************************************************************************
 NAME    
     sinkAvrcpBrowsingPlayItem
@@ -460,6 +803,12 @@ void sinkAvrcpBrowsingInit(bool all_links, uint16 link_index)
         theSink.avrcp_link_data->media_player_features[i] = AVRCP_BROWSING_PLAYER_FEATURES_INVALID;
         theSink.avrcp_link_data->media_player_id[i] = 0;
         theSink.avrcp_link_data->browsing_scope[i] = 0;
+        if (theSink.avrcp_link_data->browsing_cache && (theSink.avrcp_link_data->browsing_cache->link == i))
+        {
+            /* release the cache with the link it was filled from */
+            freePanic(theSink.avrcp_link_data->browsing_cache);
+            theSink.avrcp_link_data->browsing_cache = NULL;
+        }
         theSink.avrcp_link_data->avrcp_browsing_handler[i].handler = avrcpBrowsingHandler; /* initialise browsing message handler */
         MessageFlushTask(&theSink.avrcp_link_data->avrcp_browsing_handler[i]);
     }              
@@ -734,6 +1083,10 @@ void sinkAvrcpBrowsingRetrieveNowPlayingTrackRequest(uint16 Index, uint32 track_
         uid.lsb = track_index_low;
         
         MessageCancelAll(&theSink.avrcp_link_data->avrcp_browsing_handler[Index], AVRCP_BROWSING_DISCONNECT_IDLE);
+        
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+        sinkAvrcpMetadataStart(Index, full_attributes);
+#endif
             
         AvrcpBrowseGetItemAttributesRequest(theSink.avrcp_link_data->avrcp[Index],
                                             avrcp_now_playing_scope,  
@@ -781,7 +1134,7 @@ bool sinkAvrcpBrowsingRetrieveNowPlayingListRequest(uint16 start_index, uint16 e
             {
                 MessageCancelAll(&theSink.avrcp_link_data->avrcp_browsing_handler[Index], AVRCP_BROWSING_DISCONNECT_IDLE);
                 
-                if (theSink.avrcp_link_data->browsing_scope[Index])
+                if (theSink.avrcp_link_data->browsing_scope[Index] && !avrcpBrowsingCacheIsPrefetching(Index))
                 {
                     MAKE_AVRCP_MESSAGE(AVRCP_BROWSING_RETRIEVE_NOW_PLAYING_LIST);                    
                     message->start_index = start_index;
@@ -790,20 +1143,8 @@ bool sinkAvrcpBrowsingRetrieveNowPlayingListRequest(uint16 start_index, uint16 e
                 }
                 else
                 {
-                    uint16 size_media_attributes = sizeof(avrcp_retrieve_media_attributes_basic);
-                    Source src_media_attributes = StreamRegionSource(avrcp_retrieve_media_attributes_basic, size_media_attributes);
-                    theSink.avrcp_link_data->browsing_scope[Index] = SCOPE_NON_ZERO(avrcp_now_playing_scope);
-                    
-                    /* register to receive notifications of now playing content changes */
-                    AvrcpRegisterNotificationRequest(theSink.avrcp_link_data->avrcp[Index], avrcp_event_now_playing_content_changed, 0);
-                            
-                    /* retrieve now playing list */
-                    AvrcpBrowseGetFolderItemsRequest(theSink.avrcp_link_data->avrcp[Index],   
-                                                        avrcp_now_playing_scope,   
-                                                        start_index,   
-                                                        end_index,      
-                                                        AVRCP_NUMBER_MEDIA_ATTRIBUTES_BASIC, 
-                                                        src_media_attributes);
+                    /* retrieve now playing list, pages not cached are retrieved one at a time */
+                    avrcpBrowsingCacheRetrieve(Index, avrcp_now_playing_scope, start_index, end_index);
                 }
             }
             else
@@ -846,13 +1187,13 @@ DESCRIPTION
 **************************************************************************/
 void sinkAvrcpBrowsingGetItemAttributesCfm(AVRCP_BROWSE_GET_ITEM_ATTRIBUTES_CFM_T *msg)
 {
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+    uint16 Index;
+    bool known = sinkAvrcpGetIndexFromInstance(msg->avrcp, &Index);
+#endif
+    
     if (msg->status == avrcp_success)
     {
-        uint16 i = 0;
-        uint32 attribute_id = 0;
-        uint16 charset_id = 0;
-        uint16 attribute_length = 0;
-        uint16 header_end = 0;
         const uint8 *lSource = SourceMap(msg->attr_value_list);
         uint16 source_size = SourceSize(msg->attr_value_list);
         uint16 size_attr_list = (source_size < msg->size_attr_list) ? source_size : msg->size_attr_list;
@@ -861,51 +1202,32 @@ void sinkAvrcpBrowsingGetItemAttributesCfm(AVRCP_BROWSE_GET_ITEM_ATTRIBUTES_CFM_
         {
             AVRCP_BROWSING_DEBUG(("   success; num_attr[%d] size_att[%d] size_source[%d]\n", msg->num_attributes, msg->size_attr_list, source_size));                
             
-            header_end = i + AVRCP_BROWSE_GET_ITEM_ATTRIBUTES_CFM_HEADER_SIZE;
-            while (size_attr_list >= header_end) /* check there is room left for data to exist */
-            {         
-                attribute_id = ((uint32)lSource[i] << 24) | ((uint32)lSource[i + 1] << 16) | ((uint32)lSource[i + 2] << 8) | lSource[i + 3];
-                charset_id = (lSource[i + 4] << 8) | lSource[i + 5];
-                attribute_length = (lSource[i + 6] << 8) | lSource[i + 7];
-                
-                AVRCP_BROWSING_DEBUG(("        attribute = 0x%lx\n", attribute_id));
-                AVRCP_BROWSING_DEBUG(("        charset_id = 0x%x\n", charset_id));
-                AVRCP_BROWSING_DEBUG(("        attribute_length = 0x%x\n", attribute_length));
-                        
-                if ((attribute_length + header_end) > size_attr_list)
-                    attribute_length = size_attr_list - header_end;
-                
-#ifdef DEBUG_AVRCP    
-                {
-                    uint16 j;
-                    AVRCP_BROWSING_DEBUG(("        attribute text : "));
-                    for (j = i; j < (i + attribute_length); j++)
-                    {                    
-                        AVRCP_BROWSING_DEBUG(("%c", lSource[j + 8]));                    
-                    }
-                        AVRCP_BROWSING_DEBUG(("\n"));
-                }
-#endif                               
-                
-                AVRCP_BROWSING_DEBUG(("AVRCP NOW PLAYING:\n"));
-                
 #ifdef ENABLE_AVRCP_NOW_PLAYING            
-                if (attribute_length)
-                    sinkAvrcpDisplayMediaAttributes(attribute_id, attribute_length, &lSource[i + 8]);
+            /* the attribute list has the same layout as GetElementAttributes, 
+               cache and display it */
+            if (known)
+            {
+                sinkAvrcpMetadataParse(Index, lSource, size_attr_list);
+                sinkAvrcpMetadataComplete(Index);
+            }
 #endif
-
-                i = header_end + attribute_length;
-                header_end = i + AVRCP_BROWSE_GET_ITEM_ATTRIBUTES_CFM_HEADER_SIZE;
-            }                    
         }
         else
         {
             AVRCP_BROWSING_DEBUG(("   fail; no source\n"));
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+            if (known)
+                sinkAvrcpMetadataAbort(Index);
+#endif
         }
     }
     else
     {
         AVRCP_BROWSING_DEBUG(("   fail; status %d\n", msg->status));
+#ifdef ENABLE_AVRCP_NOW_PLAYING
+        if (known)
+            sinkAvrcpMetadataAbort(Index);
+#endif
     }
     
     /* Send Idle Disconnect of Browsing Channel request, as browsing channel may not be used again for some time */
@@ -959,7 +1281,7 @@ bool sinkAvrcpBrowsingRetrieveMediaPlayersRequest(uint16 start_index, uint16 end
             {
                 MessageCancelAll(&theSink.avrcp_link_data->avrcp_browsing_handler[Index], AVRCP_BROWSING_DISCONNECT_IDLE);
                 
-                if (theSink.avrcp_link_data->browsing_scope[Index])
+                if (theSink.avrcp_link_data->browsing_scope[Index] && !avrcpBrowsingCacheIsPrefetching(Index))
                 {
                     /* as the confirmation messages don't return the scope, can only send one scope message at a time */
                     MAKE_AVRCP_MESSAGE(AVRCP_BROWSING_RETRIEVE_MEDIA_PLAYERS);                    
@@ -969,19 +1291,8 @@ bool sinkAvrcpBrowsingRetrieveMediaPlayersRequest(uint16 start_index, uint16 end
                 }
                 else
                 {
-                    /* send library command now */
-                    theSink.avrcp_link_data->browsing_scope[Index] = SCOPE_NON_ZERO(avrcp_media_player_scope);
-                    
-                    /* get notification of changes in media players */
-                    AvrcpRegisterNotificationRequest(theSink.avrcp_link_data->avrcp[Index], avrcp_event_available_players_changed, 0);
-                    
-                    /* retrieve all media players */
-                    AvrcpBrowseGetFolderItemsRequest(theSink.avrcp_link_data->avrcp[Index],   
-                                                        avrcp_media_player_scope,   
-                                                        start_index,   
-                                                        end_index,      
-                                                        0, 
-                                                        0);
+                    /* retrieve media players, from the cache if possible */
+                    avrcpBrowsingCacheRetrieve(Index, avrcp_media_player_scope, start_index, end_index);
                 }
             }
             else
@@ -1011,6 +1322,19 @@ void sinkAvrcpBrowsingGetFolderItemsCfm(AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_T *msg
 {
     uint16 Index;
     avrcp_status_code avrcp_status = msg->status;
+    avrcp_browsing_cache *cache = theSink.avrcp_link_data->browsing_cache;
+    bool cached = FALSE;
+    
+    if (sinkAvrcpGetIndexFromInstance(msg->avrcp, &Index))
+    {
+        /* see if this is the response to a page retrieved for the cache */
+        if (cache && (cache->link == Index) && cache->fetching &&
+            (theSink.avrcp_link_data->browsing_scope[Index] == SCOPE_NON_ZERO(cache->fetch_scope)))
+        {
+            cache->fetching = FALSE;
+            cached = TRUE;
+        }
+    }
     
     if ((msg->status == avrcp_success) && sinkAvrcpGetIndexFromInstance(msg->avrcp, &Index))
     {   
@@ -1021,9 +1345,22 @@ void sinkAvrcpBrowsingGetFolderItemsCfm(AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_T *msg
         const uint8 *lSource = SourceMap(msg->item_list);
         uint16 source_size = SourceSize(msg->item_list);
         uint16 item_list_size = (source_size < msg->item_list_size) ? source_size : msg->item_list_size;
+        avrcp_browsing_page *page = NULL;
+        avrcp_browsing_item *item = NULL;
+        bool item_valid = FALSE;
         
         if (lSource)
         {
+            if (cached)
+            {
+                page = avrcpBrowsingCacheNewPage(cache);
+                page->start_index = cache->fetch_index;
+                page->uid_counter = msg->uid_counter;
+                page->scope = cache->fetch_scope;
+                /* store the UID counter the items are valid for */
+                theSink.avrcp_link_data->uid_counter[Index] = msg->uid_counter;
+            }
+            
             AVRCP_BROWSING_DEBUG(("   success; uid_counter[%d] num_items[%d] item_list_size[%d] source_size[%d]\n", msg->uid_counter, msg->num_items, msg->item_list_size, SourceSize(msg->item_list)));
         
             switch (theSink.avrcp_link_data->browsing_scope[Index])
@@ -1031,19 +1368,16 @@ void sinkAvrcpBrowsingGetFolderItemsCfm(AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_T *msg
                 case SCOPE_NON_ZERO(avrcp_media_player_scope):
                 {
                     AVRCP_BROWSING_DEBUG(("Scope: Media Player start\n"));
-                    /* TODO start of media player display - msg->num_items returned */
                     break;
                 }
                 case SCOPE_NON_ZERO(avrcp_now_playing_scope):
                 {
                     AVRCP_BROWSING_DEBUG(("Scope: Now Playing start\n"));
-                    /* TODO start of now playing display - msg->num_items returned */
                     break;
                 }
                 case SCOPE_NON_ZERO(avrcp_virtual_filesystem_scope):
                 {
                     AVRCP_BROWSING_DEBUG(("Scope: Filesystem start\n"));
-                    /* TODO start of file system display - msg->num_items returned */                    
                     break;
                 }
                 case SCOPE_NON_ZERO(avrcp_search_scope):
@@ -1064,24 +1398,27 @@ void sinkAvrcpBrowsingGetFolderItemsCfm(AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_T *msg
             { 
                 item_type = lSource[i];
                 item_length = (lSource[i + 1] << 8) | lSource[i + 2];
+                /* only the items of the requested page are stored */
+                item = (page && (page->num_items < AVRCP_BROWSING_PAGE_ITEMS)) ? &page->item[page->num_items] : NULL;
+                item_valid = FALSE;
                 switch (item_type)
                 {
                     case AVRCP_BROWSABLE_ITEM_TYPE_MEDIA_ELEMENT:
                     {
                         AVRCP_BROWSING_DEBUG(("   Media Element\n"));
-                        avrcpBrowseMediaElementItem(item_list_size - header_end, item_length, &lSource[i + 3]);
+                        item_valid = avrcpBrowseMediaElementItem(item_list_size - header_end, item_length, &lSource[i + 3], item);
                         break;
                     }
                     case AVRCP_BROWSABLE_ITEM_TYPE_MEDIA_PLAYER:
                     {
                         AVRCP_BROWSING_DEBUG(("   Media Player\n"));
-                        avrcpBrowseMediaPlayerItem(Index, item_list_size - header_end, item_length, &lSource[i + 3]);
+                        item_valid = avrcpBrowseMediaPlayerItem(Index, item_list_size - header_end, item_length, &lSource[i + 3], item);
                         break;
                     }
                     case AVRCP_BROWSABLE_ITEM_TYPE_FOLDER:                
                     {
                         AVRCP_BROWSING_DEBUG(("   Folder\n"));
-                        avrcpBrowseFolderItem(Index, item_list_size - header_end, item_length, &lSource[i + 3]);
+                        item_valid = avrcpBrowseFolderItem(Index, item_list_size - header_end, item_length, &lSource[i + 3], item);
                         break;
                     }
                     default:
@@ -1089,10 +1426,19 @@ void sinkAvrcpBrowsingGetFolderItemsCfm(AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_T *msg
                         break;
                     }
                 }
+                if (item && item_valid)
+                    page->num_items++;
                    
                 i = header_end + item_length;            
                 header_end = i + AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_HEADER_SIZE;
             } 
+            
+            if (page)
+            {
+                /* a short page is the end of the folder */
+                page->last = (page->num_items < AVRCP_BROWSING_PAGE_ITEMS);
+                page->valid = TRUE;
+            }
         }
         else
         {
@@ -1105,6 +1451,24 @@ void sinkAvrcpBrowsingGetFolderItemsCfm(AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_T *msg
         AVRCP_BROWSING_DEBUG(("   fail; status %d\n", msg->status));
     }    
     
+    if (cached && (avrcp_status != avrcp_success))
+    {
+        /* the page could not be retrieved, normally as it was beyond the end of the folder */
+        avrcp_browsing_page *page = NULL;
+        
+        if (cache->fetch_index >= AVRCP_BROWSING_PAGE_ITEMS)
+            page = avrcpBrowsingCacheFindPage(cache, cache->fetch_scope, cache->fetch_index - AVRCP_BROWSING_PAGE_ITEMS);
+        if (page)
+            page->last = TRUE;
+        
+        /* give up on the request if it was waiting for this page */
+        if (cache->serving && (cache->scope == cache->fetch_scope) &&
+            (cache->fetch_index == (cache->next_index - (cache->next_index % AVRCP_BROWSING_PAGE_ITEMS))))
+        {
+            cache->serving = FALSE;
+        }
+    }
+    
     if (sinkAvrcpGetIndexFromInstance(msg->avrcp, &Index))
     {
         switch (theSink.avrcp_link_data->browsing_scope[Index])
@@ -1112,19 +1476,16 @@ void sinkAvrcpBrowsingGetFolderItemsCfm(AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_T *msg
             case SCOPE_NON_ZERO(avrcp_media_player_scope):
             {
                 AVRCP_BROWSING_DEBUG(("Scope: Media Player end\n"));
-                /* TODO end of media player display */
                 break;
             }
             case SCOPE_NON_ZERO(avrcp_now_playing_scope):
             {
                 AVRCP_BROWSING_DEBUG(("Scope: Now Playing end\n"));
-                /* TODO end of now playing display */
                 break;
             }
             case SCOPE_NON_ZERO(avrcp_virtual_filesystem_scope):
             {
                 AVRCP_BROWSING_DEBUG(("Scope: Filesystem end \n"));
-                /* TODO end of filesystem display */
                 break;
             }
             case SCOPE_NON_ZERO(avrcp_search_scope):
@@ -1141,6 +1502,10 @@ void sinkAvrcpBrowsingGetFolderItemsCfm(AVRCP_BROWSE_GET_FOLDER_ITEMS_CFM_T *msg
         }                
 
         theSink.avrcp_link_data->browsing_scope[Index] = 0;
+        
+        /* carry on with the request waiting for this page */
+        if (cached && cache->serving)
+            avrcpBrowsingCacheServe(Index);
     }
 }
 
@@ -1225,6 +1590,7 @@ void sinkAvrcpBrowsingSetBrowsedPlayerCfm(AVRCP_BROWSE_SET_PLAYER_CFM_T *msg)
 {
     if (msg->status == avrcp_success)
     {        
+        uint16 Index;
         uint16 offset = 0;
         uint16 folder_items = 0;
         uint16 folder_name_length = 0;
@@ -1239,6 +1605,11 @@ void sinkAvrcpBrowsingSetBrowsedPlayerCfm(AVRCP_BROWSE_SET_PLAYER_CFM_T *msg)
                                                                                 msg->folder_depth,
                                                                                 msg->size_path,
                                                                                 SourceSize(msg->folder_path)));
+        
+        /* the browsed folder is now the root of the new player */
+        if (sinkAvrcpGetIndexFromInstance(msg->avrcp, &Index))
+            sinkAvrcpBrowsingInvalidateScope(Index, avrcp_virtual_filesystem_scope);
+        
         if (lSource)
         {
             AVRCP_BROWSING_DEBUG(("   current folder: "));        
@@ -1297,6 +1668,8 @@ void sinkAvrcpBrowsingAddressedPlayerChangedInd(AVRCP_EVENT_ADDRESSED_PLAYER_CHA
             {
                 /* re-register to receive notifications */
                 AvrcpRegisterNotificationRequest(msg->avrcp, avrcp_event_addressed_player_changed, 0);   
+                /* items cached were from the previous player */
+                avrcpBrowsingCacheFlush(Index);
                 /* retrieve the information for these media players */
                 sinkAvrcpBrowsingRetrieveMediaPlayersRequest(0, AVRCP_MAX_MEDIA_PLAYERS - 1);
             }
@@ -1339,7 +1712,7 @@ bool sinkAvrcpBrowsingRetrieveFileSystemRequest(uint16 start_index, uint16 end_i
             {
                 MessageCancelAll(&theSink.avrcp_link_data->avrcp_browsing_handler[Index], AVRCP_BROWSING_DISCONNECT_IDLE);
                 
-                if (theSink.avrcp_link_data->browsing_scope[Index])
+                if (theSink.avrcp_link_data->browsing_scope[Index] && !avrcpBrowsingCacheIsPrefetching(Index))
                 {
                     MAKE_AVRCP_MESSAGE(AVRCP_BROWSING_RETRIEVE_FILESYSTEM);                    
                     message->start_index = start_index;
@@ -1348,15 +1721,8 @@ bool sinkAvrcpBrowsingRetrieveFileSystemRequest(uint16 start_index, uint16 end_i
                 }
                 else
                 {
-                    uint16 size_media_attributes = sizeof(avrcp_retrieve_media_attributes_basic);
-                    Source src_media_attributes = StreamRegionSource(avrcp_retrieve_media_attributes_basic, size_media_attributes);
-                    theSink.avrcp_link_data->browsing_scope[Index] = SCOPE_NON_ZERO(avrcp_virtual_filesystem_scope);
-                    AvrcpBrowseGetFolderItemsRequest(theSink.avrcp_link_data->avrcp[Index],   
-                                                        avrcp_virtual_filesystem_scope,   
-                                                        start_index,   
-                                                        end_index,      
-                                                        AVRCP_NUMBER_MEDIA_ATTRIBUTES_BASIC, 
-                                                        src_media_attributes);
+                    /* retrieve the current folder, from the cache if possible */
+                    avrcpBrowsingCacheRetrieve(Index, avrcp_virtual_filesystem_scope, start_index, end_index);
                 }
             }
             else
@@ -1460,8 +1826,14 @@ DESCRIPTION
 **************************************************************************/
 void sinkAvrcpBrowsingChangePathCfm(AVRCP_BROWSE_CHANGE_PATH_CFM_T *msg)
 {
+    uint16 Index;
+    
     if (msg->status == avrcp_success)
     {
+        /* the cached pages of the filesystem are of the previous folder */
+        if (sinkAvrcpGetIndexFromInstance(msg->avrcp, &Index))
+            sinkAvrcpBrowsingInvalidateScope(Index, avrcp_virtual_filesystem_scope);
+        
         /* TODO filesystem path has changed, may need to update display of virtual filesystem */
     }
 }
@@ -1492,6 +1864,9 @@ void sinkAvrcpBrowsingUIDsChangedInd(AVRCP_EVENT_UIDS_CHANGED_IND_T *msg)
             {
                 /* re-register to receive notifications */
                 AvrcpRegisterNotificationRequest(msg->avrcp, avrcp_event_uids_changed, 0);   
+                
+                /* UIDs of all cached items are now invalid, even if the UID counter is unchanged as TG is not database aware */
+                avrcpBrowsingCacheFlush(Index);
 
                 if (sinkAvrcpGetActiveConnection() == Index) /* update display if this is the active connection */
                 {
@@ -1530,6 +1905,8 @@ void sinkAvrcpBrowsingAvailablePlayersChangedInd(AVRCP_EVENT_AVAILABLE_PLAYERS_C
             {
                 /* re-register to receive notifications */
                 AvrcpRegisterNotificationRequest(msg->avrcp, avrcp_event_available_players_changed, 0);   
+                
+                sinkAvrcpBrowsingInvalidateScope(Index, avrcp_media_player_scope);
 
                 if (sinkAvrcpGetActiveConnection() == Index) /* update display if this is the active connection */
                 {
@@ -1546,6 +1923,31 @@ void sinkAvrcpBrowsingAvailablePlayersChangedInd(AVRCP_EVENT_AVAILABLE_PLAYERS_C
 }
 
 
+/*************************************************************************
+NAME    
+    sinkAvrcpBrowsingInvalidateScope
+    
+DESCRIPTION
+    Discards the pages of a scope cached for the connection, used when the contents of the scope have changed.
+
+**************************************************************************/
+void sinkAvrcpBrowsingInvalidateScope(uint16 Index, avrcp_browse_scope scope)
+{
+    avrcp_browsing_cache *cache = theSink.avrcp_link_data->browsing_cache;
+    uint16 i;
+    
+    if (cache && (cache->link == Index))
+    {
+        AVRCP_BROWSING_DEBUG(("AVRCP: browsing cache invalidate scope[%d]\n", scope));
+        for (i = 0; i < AVRCP_BROWSING_CACHE_PAGES; i++)
+        {
+            if (cache->page[i].scope == scope)
+                cache->page[i].valid = FALSE;
+        }
+    }
+}
+
+
 /*************************************************************************
 NAME    
     sinkAvrcpSearchIsSupported
@@ -62,6 +62,11 @@ extern const uint8 avrcp_retrieve_media_attributes_full[AVRCP_NUMBER_MEDIA_ATTRI
 
 #define SCOPE_NON_ZERO(scope) (scope + 1)                    /* scope starts at zero index, convert it to start at index of one */ 
 
+#define AVRCP_BROWSING_PAGE_ITEMS 4                         /* number of items retrieved with each Get Folder Items command */
+#define AVRCP_BROWSING_CACHE_PAGES 3                        /* number of pages cached before the least recently used page is replaced */
+#define AVRCP_BROWSING_ITEM_NAME_MAX 16                     /* displayable names longer than this are truncated in the cache */
+#define AVRCP_BROWSING_DISPLAY_LINES 2                      /* items of a request shown on the display, one per line */
+
 /* browsing channel connection states */
 typedef enum
 {
@@ -71,6 +76,48 @@ typedef enum
     browsing_channel_disconnecting    
 } browsing_channel_state;
 
+/* cached media player, folder or media element item */
+typedef struct
+{
+    avrcp_browse_uid uid;                   /* UID of folder or media element, player ID for media players */
+    unsigned type:2;                        /* AVRCP_BROWSABLE_ITEM_TYPE_ */
+    unsigned is_playable:1;                 /* folder can be played */
+    unsigned name_length:5;
+    unsigned unused:8;
+    uint8 name[AVRCP_BROWSING_ITEM_NAME_MAX];
+} avrcp_browsing_item;
+
+/* page of consecutive items from one scope */
+typedef struct
+{
+    uint16 start_index;                     /* index of the first item, a multiple of AVRCP_BROWSING_PAGE_ITEMS */
+    uint16 uid_counter;                     /* UID counter of the TG when the page was retrieved */
+    uint16 last_used;                       /* value of use_count when the page was last accessed */
+    unsigned valid:1;
+    unsigned scope:2;                       /* avrcp_browse_scope */
+    unsigned last:1;                        /* no items follow this page */
+    unsigned num_items:3;
+    unsigned unused:9;
+    avrcp_browsing_item item[AVRCP_BROWSING_PAGE_ITEMS];
+} avrcp_browsing_page;
+
+/* cache of the pages retrieved from the active connection */
+typedef struct
+{
+    uint16 link;                            /* index of the connection the pages were retrieved from */
+    uint16 use_count;                       /* incremented on each page access to find the least recently used page */
+    uint16 start_index;                     /* first item of the request being served */
+    uint16 next_index;                      /* next item of the request being served */
+    uint16 end_index;                       /* last item of the request being served */
+    uint16 fetch_index;                     /* start index of the page being retrieved */
+    unsigned scope:2;                       /* avrcp_browse_scope of the request being served */
+    unsigned fetch_scope:2;                 /* avrcp_browse_scope of the page being retrieved */
+    unsigned serving:1;                     /* request is waiting for a page to be retrieved */
+    unsigned fetching:1;                    /* Get Folder Items command is outstanding for a page */
+    unsigned unused:10;
+    avrcp_browsing_page page[AVRCP_BROWSING_CACHE_PAGES];
+} avrcp_browsing_cache;
+
 /* queued application browsing commands */
 typedef enum
 {
@@ -214,6 +261,9 @@ void sinkAvrcpBrowsingUIDsChangedInd(AVRCP_EVENT_UIDS_CHANGED_IND_T *msg);
 
 void sinkAvrcpBrowsingAvailablePlayersChangedInd(AVRCP_EVENT_AVAILABLE_PLAYERS_CHANGED_IND_T *msg);
 
+/* browsing cache */
+void sinkAvrcpBrowsingInvalidateScope(uint16 Index, avrcp_browse_scope scope);
+
 /* search */
 bool sinkAvrcpSearchIsSupported(uint16 Index);
         
@@ -0,0 +1,133 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_avrcp_metadata.c
+
+DESCRIPTION
+    Now Playing metadata cache. Each attribute has a fixed part of the pool
+    sized by its AVRCP_METADATA_MAX_ value, values are copied straight from
+    the source into it and whatever does not fit is counted and dropped.
+
+*/
+
+#include "sink_avrcp_metadata.h"
+#include "sink_debug.h"
+
+#include <string.h>
+
+
+#ifdef DEBUG_AVRCP
+#define METADATA_DEBUG(x) DEBUG(x)
+#else
+#define METADATA_DEBUG(x)
+#endif
+
+/* longest value and start in the pool of each attribute */
+static const uint8 metadata_max[AVRCP_METADATA_NUM_ATTRIBUTES] =
+{
+    AVRCP_METADATA_MAX_TITLE,
+    AVRCP_METADATA_MAX_ARTIST,
+    AVRCP_METADATA_MAX_ALBUM,
+    AVRCP_METADATA_MAX_NUMBER,
+    AVRCP_METADATA_MAX_TOTAL,
+    AVRCP_METADATA_MAX_GENRE,
+    AVRCP_METADATA_MAX_TIME
+};
+
+static const uint8 metadata_offset[AVRCP_METADATA_NUM_ATTRIBUTES] =
+{
+    0,
+    AVRCP_METADATA_MAX_TITLE,
+    AVRCP_METADATA_MAX_TITLE + AVRCP_METADATA_MAX_ARTIST,
+    AVRCP_METADATA_MAX_TITLE + AVRCP_METADATA_MAX_ARTIST + AVRCP_METADATA_MAX_ALBUM,
+    AVRCP_METADATA_MAX_TITLE + AVRCP_METADATA_MAX_ARTIST + AVRCP_METADATA_MAX_ALBUM + AVRCP_METADATA_MAX_NUMBER,
+    AVRCP_METADATA_MAX_TITLE + AVRCP_METADATA_MAX_ARTIST + AVRCP_METADATA_MAX_ALBUM + AVRCP_METADATA_MAX_NUMBER +
+        AVRCP_METADATA_MAX_TOTAL,
+    AVRCP_METADATA_MAX_TITLE + AVRCP_METADATA_MAX_ARTIST + AVRCP_METADATA_MAX_ALBUM + AVRCP_METADATA_MAX_NUMBER +
+        AVRCP_METADATA_MAX_TOTAL + AVRCP_METADATA_MAX_GENRE
+};
+
+
+/****************************************************************************
+NAME
+    avrcpMetadataReset
+*/
+void avrcpMetadataReset(sinkAvrcpMetadata *metadata)
+{
+    memset(metadata->length, 0, sizeof(metadata->length));
+    metadata->header_len = 0;
+    metadata->value_remaining = 0;
+    metadata->attribute = 0;
+    metadata->truncated = 0;
+}
+
+/****************************************************************************
+NAME
+    avrcpMetadataParse
+*/
+void avrcpMetadataParse(sinkAvrcpMetadata *metadata, const uint8 *data, uint16 length)
+{
+    while (length)
+    {
+        if (metadata->value_remaining)
+        {
+            uint16 size = (length < metadata->value_remaining) ? length : metadata->value_remaining;
+            
+            if (metadata->attribute)
+            {
+                uint16 index = metadata->attribute - 1;
+                uint16 room = metadata_max[index] - metadata->length[index];
+                uint16 copy = (size < room) ? size : room;
+                
+                memmove(&metadata->pool[metadata_offset[index] + metadata->length[index]], data, copy);
+                metadata->length[index] += copy;
+                metadata->truncated += size - copy;
+            }
+            
+            data += size;
+            length -= size;
+            metadata->value_remaining -= size;
+        }
+        else
+        {
+            metadata->header[metadata->header_len++] = *data++;
+            length--;
+            
+            if (metadata->header_len == AVRCP_METADATA_HEADER_SIZE)
+            {
+                const uint8 *header = metadata->header;
+                uint32 attribute_id = ((uint32)header[0] << 24) | ((uint32)header[1] << 16) | ((uint32)header[2] << 8) | header[3];
+                
+                metadata->value_remaining = (header[6] << 8) | header[7];
+                metadata->header_len = 0;
+                
+                METADATA_DEBUG(("        attribute = 0x%lx charset_id = 0x%x length = 0x%x\n", attribute_id, (header[4] << 8) | header[5], metadata->value_remaining));
+                
+                /* a value sent again replaces the first */
+                if ((attribute_id >= 1) && (attribute_id <= AVRCP_METADATA_NUM_ATTRIBUTES))
+                {
+                    metadata->attribute = attribute_id;
+                    metadata->length[attribute_id - 1] = 0;
+                }
+                else
+                {
+                    metadata->attribute = 0;
+                }
+            }
+        }
+    }
+}
+
+/****************************************************************************
+NAME
+    avrcpMetadataGetValue
+*/
+const uint8 *avrcpMetadataGetValue(const sinkAvrcpMetadata *metadata, uint32 attribute_id, uint16 *length)
+{
+    if ((attribute_id < 1) || (attribute_id > AVRCP_METADATA_NUM_ATTRIBUTES) || !metadata->length[attribute_id - 1])
+        return NULL;
+    
+    *length = metadata->length[attribute_id - 1];
+    return &metadata->pool[metadata_offset[attribute_id - 1]];
+}
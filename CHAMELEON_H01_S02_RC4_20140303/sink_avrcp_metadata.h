@@ -0,0 +1,99 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_avrcp_metadata.h
+
+DESCRIPTION
+    Now Playing metadata cache of an AVRCP connection. The attributes of a
+    Get Element Attributes response are parsed as they arrive, with headers
+    and values split across fragments, and each value is copied into its
+    own part of a fixed pool. A value longer than its part is truncated, so
+    a long title cannot leave the attributes after it empty.
+
+*/
+#ifndef SINK_AVRCP_METADATA_H
+#define SINK_AVRCP_METADATA_H
+
+#include <csrtypes.h>
+
+
+/* attribute IDs cached, title (1) to playing time (7) */
+#define AVRCP_METADATA_NUM_ATTRIBUTES   (7)
+
+/* attribute ID (4 octets), character set (2) and value length (2) before each value */
+#define AVRCP_METADATA_HEADER_SIZE      (8)
+
+/* longest value cached for each attribute, in the order of their IDs */
+#define AVRCP_METADATA_MAX_TITLE        (32)
+#define AVRCP_METADATA_MAX_ARTIST       (24)
+#define AVRCP_METADATA_MAX_ALBUM        (24)
+#define AVRCP_METADATA_MAX_NUMBER       (4)     /* track number, as text */
+#define AVRCP_METADATA_MAX_TOTAL        (4)     /* number of tracks, as text */
+#define AVRCP_METADATA_MAX_GENRE        (16)
+#define AVRCP_METADATA_MAX_TIME         (10)    /* playing time in ms, as text */
+
+#define AVRCP_METADATA_POOL_SIZE        (AVRCP_METADATA_MAX_TITLE + AVRCP_METADATA_MAX_ARTIST + AVRCP_METADATA_MAX_ALBUM + \
+                                         AVRCP_METADATA_MAX_NUMBER + AVRCP_METADATA_MAX_TOTAL + AVRCP_METADATA_MAX_GENRE + \
+                                         AVRCP_METADATA_MAX_TIME)
+
+/* Now Playing attributes of a connection */
+typedef struct
+{
+    uint32 uid_high;                                        /* UID of the current track */
+    uint32 uid_low;
+    uint8 pool[AVRCP_METADATA_POOL_SIZE];                   /* values, each attribute in its own part */
+    uint8 length[AVRCP_METADATA_NUM_ATTRIBUTES];            /* length of each value, 0 if not present */
+    uint8 header[AVRCP_METADATA_HEADER_SIZE];               /* attribute header, which may be split across fragments */
+    uint16 value_remaining;                                 /* bytes of the current value still to arrive */
+    uint16 truncated;                                       /* bytes of values dropped as too long for the cache */
+    unsigned header_len:4;
+    unsigned attribute:3;                                   /* ID of the value being received, 0 if not cached */
+    unsigned full:1;                                        /* all attributes were requested */
+    unsigned valid:1;                                       /* cache holds the current track */
+    unsigned pending:1;                                     /* a request is outstanding */
+    unsigned track_seq:2;                                   /* advanced on each track change */
+    unsigned fetch_seq:2;                                   /* track_seq when the request was made */
+    unsigned unused:2;
+} sinkAvrcpMetadata;
+
+
+/****************************************************************************
+NAME
+    avrcpMetadataReset
+
+DESCRIPTION
+    Empty the cached values ready for a new response
+
+RETURNS
+    void
+*/
+void avrcpMetadataReset(sinkAvrcpMetadata *metadata);
+
+/****************************************************************************
+NAME
+    avrcpMetadataParse
+
+DESCRIPTION
+    Parse a fragment of the attributes of a Get Element Attributes response.
+    A header or value split across fragments is completed by the next one.
+
+RETURNS
+    void
+*/
+void avrcpMetadataParse(sinkAvrcpMetadata *metadata, const uint8 *data, uint16 length);
+
+/****************************************************************************
+NAME
+    avrcpMetadataGetValue
+
+DESCRIPTION
+    Get the cached value of an attribute
+
+RETURNS
+    pointer to the value, which is not NUL terminated, or NULL if the
+    attribute is not cached
+*/
+const uint8 *avrcpMetadataGetValue(const sinkAvrcpMetadata *metadata, uint32 attribute_id, uint16 *length);
+
+#endif /* SINK_AVRCP_METADATA_H */
@@ -63,7 +63,7 @@ VARIABLES
 */
 
 #define BM_NUM_BLOCKS (2)
-#define BM_NUM_CONFIGURABLE_EVENTS (BM_EVENTS_PER_BLOCK * BM_NUM_BLOCKS)
+#define BM_NUM_CONFIGURABLE_EVENTS (BM_EVENTS_PER_CONF_BLOCK * BM_NUM_BLOCKS)
 
 #define BUTTON_PIO_DEBOUNCE_NUM_CHECKS  (4)
 #define BUTTON_PIO_DEBOUNCE_TIME_MS     (15)
@@ -72,6 +72,88 @@ VARIABLES
   FUNCTIONS
 */
 
+/****************************************************************************
+NAME 
+ 	bmGetEvent
+*/  
+static ButtonEvents_t * bmGetEvent ( uint16 pIndex )
+{
+    return &theSink.theButtonsTask->gButtonEvents[pIndex / BM_EVENTS_PER_CONF_BLOCK][pIndex % BM_EVENTS_PER_CONF_BLOCK] ;
+}
+
+/****************************************************************************
+NAME 
+ 	bmGetEventMask
+
+DESCRIPTION
+ 	the translated input mask of an event, PIO bits with VREG and CHG on top
+*/  
+static uint32 bmGetEventMask ( const ButtonEvents_t * pButtonEvent )
+{
+    return (uint32)(pButtonEvent->ButtonMaskLS | (uint32)(pButtonEvent->ButtonMaskVC) << VREG_PIN) ;
+}
+
+/****************************************************************************
+NAME 
+ 	bmIndexBucket
+
+DESCRIPTION
+ 	hash an input mask and duration to a bucket of the event index
+*/  
+static uint16 bmIndexBucket ( uint32 pButtonMask , ButtonsTime_t pDuration )
+{
+    uint16 lKey = (uint16)pButtonMask ^ (uint16)(pButtonMask >> 16) ^ ((uint16)pDuration << 12) ;
+    
+    /* multiplicative hash, the top bits depend on all of the key */
+    return (uint16)(lKey * 0x9E37u) >> 12 ;
+}
+
+/****************************************************************************
+NAME 
+ 	bmIndexRemove
+
+DESCRIPTION
+ 	remove an event from the event index if it is present
+*/  
+static void bmIndexRemove ( uint16 pIndex )
+{
+    ButtonsTaskData * lButtonsTask = theSink.theButtonsTask ;
+    ButtonEvents_t * lButtonEvent = bmGetEvent ( pIndex ) ;
+    uint8 * lLink = &lButtonsTask->gButtonIndexHead[bmIndexBucket(bmGetEventMask(lButtonEvent), lButtonEvent->Duration)] ;
+    
+    while ( *lLink != BM_INDEX_NONE )
+    {
+        if ( *lLink == pIndex )
+        {
+            *lLink = lButtonsTask->gButtonIndexNext[pIndex] ;
+            break ;
+        }
+        lLink = &lButtonsTask->gButtonIndexNext[*lLink] ;
+    }
+    lButtonsTask->gButtonIndexNext[pIndex] = BM_INDEX_NONE ;
+}
+
+/****************************************************************************
+NAME 
+ 	bmIndexAdd
+
+DESCRIPTION
+ 	add an event to the tail of its bucket so that events sharing an input and
+    duration are still sent in configuration order
+*/  
+static void bmIndexAdd ( uint16 pIndex )
+{
+    ButtonsTaskData * lButtonsTask = theSink.theButtonsTask ;
+    ButtonEvents_t * lButtonEvent = bmGetEvent ( pIndex ) ;
+    uint8 * lLink = &lButtonsTask->gButtonIndexHead[bmIndexBucket(bmGetEventMask(lButtonEvent), lButtonEvent->Duration)] ;
+    
+    while ( *lLink != BM_INDEX_NONE )
+        lLink = &lButtonsTask->gButtonIndexNext[*lLink] ;
+    
+    *lLink = pIndex ;
+    lButtonsTask->gButtonIndexNext[pIndex] = BM_INDEX_NONE ;
+}
+
 /****************************************************************************
 NAME 
  	buttonManagerInit
@@ -93,6 +175,12 @@ void buttonManagerInit ( void )
     BM_DEBUG(("BM: ButtonEvents block size [%u]\n" ,  sizeof( ButtonEvents_t ) * BM_EVENTS_PER_CONF_BLOCK ));
     theSink.theButtonsTask->gButtonEvents[0] = (ButtonEvents_t * ) ( mallocPanic( sizeof( ButtonEvents_t ) * BM_EVENTS_PER_CONF_BLOCK ) ) ;
     theSink.theButtonsTask->gButtonEvents[1]= (ButtonEvents_t * ) ( mallocPanic( sizeof( ButtonEvents_t ) * BM_EVENTS_PER_CONF_BLOCK ) ) ;
+    memset(theSink.theButtonsTask->gButtonEvents[0], 0, sizeof( ButtonEvents_t ) * BM_EVENTS_PER_CONF_BLOCK);
+    memset(theSink.theButtonsTask->gButtonEvents[1], 0, sizeof( ButtonEvents_t ) * BM_EVENTS_PER_CONF_BLOCK);
+    
+    /* the event index starts empty */
+    memset(theSink.theButtonsTask->gButtonIndexHead, BM_INDEX_NONE, sizeof(theSink.theButtonsTask->gButtonIndexHead));
+    memset(theSink.theButtonsTask->gButtonIndexNext, BM_INDEX_NONE, sizeof(theSink.theButtonsTask->gButtonIndexNext));
     
       /*init the PIO button routines with the Button manager Task data */ 
     ButtonsInit( theSink.theButtonsTask ) ; 
@@ -152,6 +240,9 @@ void buttonManagerAddMapping ( event_config_type * event_config, uint8 index )
     /* if input has been assigned, process and add to input checking masks */
     if ( lInputEvent )
     {
+        /* the entry may be being reconfigured */
+        bmIndexRemove ( index ) ;
+        
         /* store button mask */
         lInputEvent->ButtonMaskLS = event_config->pio_mask;   
         lInputEvent->ButtonMaskVC = (uint32)((uint32)((uint32)event_config->state_mask & 0xC000 ) >>14);     
@@ -173,6 +264,12 @@ void buttonManagerAddMapping ( event_config_type * event_config, uint8 index )
             lButtonsTask->gPerformInputLevelCheck |= (uint32)((lInputEvent->ButtonMaskLS | (uint32)(lInputEvent->ButtonMaskVC) << VREG_PIN));
         }               
         
+        /* index the event by input and duration for BMCheckForButtonMatch */
+        if(lInputEvent->Duration > B_INVALID)
+        {
+            bmIndexAdd ( index ) ;
+        }
+        
         BM_DEBUG(("BM: Add Mapping: Event[%x] Duration[%x] Input Mask[0x%lx] Level Check[0x%lx]\n", lInputEvent->Event
                                                                                                   , lInputEvent->Duration
                                                                                                   , (uint32)((lInputEvent->ButtonMaskLS | (uint32)(lInputEvent->ButtonMaskVC) << VREG_PIN))
@@ -317,57 +414,40 @@ RETURNS
 */   
 static void BMCheckForButtonMatch ( uint32 pButtonMask , ButtonsTime_t  pDuration ) 
 {
-    uint16 lBlockIndex = 0 ; 
-    uint16 lEvIndex = 0 ;        
-    uint32 lMask = 0;
+    uint16 lEvIndex = theSink.theButtonsTask->gButtonIndexHead[bmIndexBucket(pButtonMask, pDuration)] ;
     
-        /*each block*/
-    for (lBlockIndex = 0 ; lBlockIndex < BM_NUM_BLOCKS ; lBlockIndex++)
-    {       /*Each Entry*/        
-        for (lEvIndex = 0 ; lEvIndex < BM_EVENTS_PER_CONF_BLOCK ; lEvIndex ++)
-        { 
-            ButtonEvents_t * lButtonEvent = &theSink.theButtonsTask->gButtonEvents [lBlockIndex] [ lEvIndex ] ;
-            /*if the event is valid*/
-            if ( lButtonEvent != NULL)
-            {     
-                /* work out input mask for this event configuration */
-               lMask = (uint32)(lButtonEvent->ButtonMaskLS | (uint32)(lButtonEvent->ButtonMaskVC) << VREG_PIN);  
-
-               /* if the input mask of the configuration item being checked matches the current inputs being set
-                  progress to checking the current state and stte configuration of that input to see if an event should
-                  be generated */
-               if (lMask == pButtonMask )
-               {                          
-                    /*we have a button match*/
-                    if ( lButtonEvent->Duration == pDuration )
-                    {           
-                        if ( (lButtonEvent->StateMask) & ( ( 1 << stateManagerGetState () )) )
-                        {                                
-                            BM_DEBUG(("BM : State Match [%lx][%x][%x]\n" , pButtonMask ,  lButtonEvent->Event, lButtonEvent->StateMask)) ;
-                            
-                            /* if the led's are disabled and the feature bit to ignore a button press when the
-                               led's are enabled is true then ignore this button press and just re-enable the leds */
-							if(theSink.theLEDTask->gLEDSStateTimeout && theSink.features.IgnoreButtonPressAfterLedEnable)
-                            {
-								LEDManagerCheckTimeoutState();
-                            }
-                            /* all other cases the button generated event is processed as normal */
-                            else
-							{
-                                /* Only indicate the event if the buttons are unlocked or this is actually the user 
-                                   trying to unlock them */                                
-                                if(!BMCheckButtonLock(lButtonEvent->Event + EVENTS_MESSAGE_BASE))
-                                {
-                                    /*we have fully matched an event....so tell the main task about it*/
-                                    MessageSend( theSink.theButtonsTask->client, (lButtonEvent->Event + EVENTS_MESSAGE_BASE) , 0 ) ;								
-                                }
-                                else
-                                {
-                                    /* Button has been blocked because the buttons are locked, event is sent so the block event can be indicated */
-                                    MessageSend( theSink.theButtonsTask->client, EventButtonBlockedByLock , 0 ) ;		
-                                }
-                            }
-                        }
+        /*only the events configured for this input and duration can match*/
+    for ( ; lEvIndex != BM_INDEX_NONE ; lEvIndex = theSink.theButtonsTask->gButtonIndexNext[lEvIndex] )
+    { 
+        ButtonEvents_t * lButtonEvent = bmGetEvent ( lEvIndex ) ;
+        
+        /* the bucket may be shared with other inputs and durations */
+        if ( ( bmGetEventMask ( lButtonEvent ) == pButtonMask ) && ( lButtonEvent->Duration == pDuration ) )
+        {                          
+            if ( (lButtonEvent->StateMask) & ( ( 1 << stateManagerGetState () )) )
+            {                                
+                BM_DEBUG(("BM : State Match [%lx][%x][%x]\n" , pButtonMask ,  lButtonEvent->Event, lButtonEvent->StateMask)) ;
+                
+                /* if the led's are disabled and the feature bit to ignore a button press when the
+                   led's are enabled is true then ignore this button press and just re-enable the leds */
+                if(theSink.theLEDTask->gLEDSStateTimeout && theSink.features.IgnoreButtonPressAfterLedEnable)
+                {
+                    LEDManagerCheckTimeoutState();
+                }
+                /* all other cases the button generated event is processed as normal */
+                else
+                {
+                    /* Only indicate the event if the buttons are unlocked or this is actually the user 
+                       trying to unlock them */                                
+                    if(!BMCheckButtonLock(lButtonEvent->Event + EVENTS_MESSAGE_BASE))
+                    {
+                        /*we have fully matched an event....so tell the main task about it*/
+                        MessageSend( theSink.theButtonsTask->client, (lButtonEvent->Event + EVENTS_MESSAGE_BASE) , 0 ) ;								
+                    }
+                    else
+                    {
+                        /* Button has been blocked because the buttons are locked, event is sent so the block event can be indicated */
+                        MessageSend( theSink.theButtonsTask->client, EventButtonBlockedByLock , 0 ) ;		
                     }
                 }
             }
@@ -65,6 +65,9 @@ typedef struct ButtonEventsTag
 #define BM_EVENTS_PER_CONF_BLOCK (33)   /* Number of events stored per block in memory */
 #define BM_EVENTS_PER_PS_BLOCK (22)     /* Number of events stored per block in PS */
 
+#define BM_INDEX_BUCKETS (16)           /* Buckets in the (mask, duration) event index, power of 2 */
+#define BM_INDEX_NONE (0xff)            /* End of an event index bucket */
+
 #define BM_NUM_BUTTON_TRANSLATIONS 18
 
 #define BM_CAP_SENSORS 6
@@ -116,15 +119,27 @@ typedef struct
     
     unsigned    gBTapCount:8;                   /* multiple press counter */
 	unsigned 	gBTime:8 ;                      /* *ButtonsTime_t   */
+    
+    uint32      gBPressTime;                    /* VM clock when the held input was pressed */
+    uint32      gBRepeatAt;                     /* hold time of the next repeat, 0 if repeats are off */
+    unsigned    gBHolding:1;                    /* the hold timer is running for a pressed input */
+    unsigned    gBUnused:15;
    
     ButtonEvents_t * gButtonEvents [2] ;        /*pointer to the array of button event maps*/
+    
+    uint8       gButtonIndexHead[BM_INDEX_BUCKETS] ;                /* first event in each bucket of the event index */
+    uint8       gButtonIndexNext[BM_EVENTS_PER_CONF_BLOCK * 2] ;    /* next event in the same bucket, in configuration order */
              
     ButtonMatchPattern_t gButtonPatterns [BM_NUM_BUTTON_MATCH_PATTERNS]; /*the button match patterns*/
 			
     uint16      gButtonMatchProgress[BM_NUM_BUTTON_MATCH_PATTERNS] ;  /*the progress achieved*/
     
 #ifdef ENABLE_CAPSENSE    
-    uint16      gOldCapState;                   /* last stored state of the capsense switches */
+    uint16      gOldCapState;                   /* last stored state of the capsense switches, debounced */
+    uint16      gCapRawState;                   /* capsense switch state as last reported by the firmware */
+    uint8       gCapCount[BM_CAP_SENSORS];      /* samples each switch has been seen away from its debounced state */
+    unsigned    gCapSampling:1;                 /* the capsense sample timer is running */
+    unsigned    gCapUnused:15;
 #endif
     
     /* array of input vs button translations */
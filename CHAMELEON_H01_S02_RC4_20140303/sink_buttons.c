@@ -32,6 +32,7 @@ NOTES
 #include <pio.h>
 #include <psu.h>
 #include <stddef.h>
+#include <vm.h>
 
 #ifdef ENABLE_CAPSENSE
 #include <capsense.h>
@@ -54,8 +55,8 @@ typedef enum ButtonsIntMsgTag
 {
     B_MESSAGE_CAPSENSE_ENABLE,
     B_MULTIPLE_TIMER , 
-    B_INTERNAL_TIMER , 
-    B_REPEAT_TIMER  
+    B_HOLD_TIMER , 
+    B_CAP_SAMPLE_TIMER
 }ButtonsIntMsg_t;
 
 
@@ -69,6 +70,11 @@ static void ButtonsButtonDetected (  ButtonsTaskData * pButtonsTask ,uint32 pBut
 static void ButtonsEdgeDetect ( const uint32 pState , ButtonsTaskData * pButtonsTask ) ;  
 static void ButtonsLevelDetect ( const uint32 pState , ButtonsTaskData * pButtonsTask )  ;
 static void ButtonsCheckDetection(uint16 CapSenseState, uint32 PioState);
+static void ButtonsHoldStart ( ButtonsTaskData * pButtonsTask ) ;
+static void ButtonsHoldSchedule ( ButtonsTaskData * pButtonsTask ) ;
+#ifdef ENABLE_CAPSENSE
+static void ButtonsCapSample ( ButtonsTaskData * pButtonsTask ) ;
+#endif
 
 /****************************************************************************
 DESCRIPTION
@@ -184,7 +190,7 @@ static void ButtonsMessageHandler ( Task pTask, MessageId pId, Message pMessage
         {
             uint8 i;
             const MessageCapsenseChanged * lMessage = ( const MessageCapsenseChanged * ) (pMessage ) ;
-            uint16 CurrentCapState = lBTask->gOldCapState;
+            uint16 CurrentCapState = lBTask->gCapRawState;
                       
             B_DEBUG(("B:Cap - Events = %x pad = %x dir = %x\n",lMessage->num_events,lMessage->event[0].pad,lMessage->event[0].direction)) ;
 
@@ -225,11 +231,21 @@ static void ButtonsMessageHandler ( Task pTask, MessageId pId, Message pMessage
             
             B_DEBUG(("B:Cap - state = %x\n",CurrentCapState)) ;
 
-            /* check whether the sensor status change requires an event to be generated */
-            ButtonsCheckDetection(CurrentCapState, lBTask->gOldPIOState);
+            /* the sensors are debounced on the sample timer, which only runs while
+               the reported state differs from the debounced one */
+            lBTask->gCapRawState = CurrentCapState;
             
-            /* update the last state value */
-            lBTask->gOldCapState = CurrentCapState;
+            if(!lBTask->gCapSampling && (lBTask->gCapRawState != lBTask->gOldCapState))
+            {
+                lBTask->gCapSampling = TRUE;
+                MessageSendLater(&lBTask->task, B_CAP_SAMPLE_TIMER, 0, lBTask->button_config->debounce_period_ms);
+            }
+        }
+        break;
+        
+        case B_CAP_SAMPLE_TIMER :
+        {
+            ButtonsCapSample(lBTask);
         }
         break;
 #endif  
@@ -289,57 +305,70 @@ static void ButtonsMessageHandler ( Task pTask, MessageId pId, Message pMessage
         } 
         break ;
         
-        case B_INTERNAL_TIMER:
+        case B_HOLD_TIMER:
         {
-            /*if we have reached here, then the buttons have been held longer than one of the timed messages*/
-            B_DEBUG(("B:Timer\n")) ;
-
-            /* since a long/vlong or vvlong has been triggered, cancel any pending double press checks */
-            lBTask->gBMultipleState = 0x0000 ;
-            lBTask->gBTapCount = 0 ;
-            MessageCancelAll ( &lBTask->task , B_MULTIPLE_TIMER ) ;           
+            uint32 lHeld = VmGetClock() - lBTask->gBPressTime ;
+            
+            /*if we have reached here, then the buttons have been held longer than the next long 
+              press threshold or the repeat time, or both*/
+            B_DEBUG(("B:Hold[%ld]\n", lHeld)) ;
 
-            /* an internal timer has triggered which was initiated from the level detect function call */
-            if ( lBTask->gBTime == B_VERY_LONG )
+            if ( ( lBTask->gBTime == B_SHORT ) || ( lBTask->gBTime == B_LONG ) || ( lBTask->gBTime == B_VERY_LONG ) )
             {
-                /* update timer state flag */
-                lBTask->gBTime = B_VERY_VERY_LONG ;                
+                uint16 lThreshold = lBTask->button_config->long_press_time ;
+                
+                if ( lBTask->gBTime == B_LONG )
+                    lThreshold = lBTask->button_config->very_long_press_time ;
+                else if ( lBTask->gBTime == B_VERY_LONG )
+                    lThreshold = lBTask->button_config->very_very_long_press_time ;
+                
+                if ( lHeld >= lThreshold )
+                {
+                    /* since a long/vlong or vvlong has been triggered, cancel any pending double press checks */
+                    lBTask->gBMultipleState = 0x0000 ;
+                    lBTask->gBTapCount = 0 ;
+                    MessageCancelAll ( &lBTask->task , B_MULTIPLE_TIMER ) ;           
+
+                    if ( lBTask->gBTime == B_VERY_LONG )
+                    {
+                        /* update timer state flag */
+                        lBTask->gBTime = B_VERY_VERY_LONG ;                
+                    }
+                    /* a long press threshold has been passed */
+                    else if ( lBTask->gBTime == B_LONG )
+                    {
+                        /* update timer state flag */
+                        lBTask->gBTime = B_VERY_LONG ;
+                        /*notify the app that the timer has expired*/
+                        MessageSend( &theSink.task , EventVLongTimer , 0 ) ;    
+                    }
+                    /* the first threshold since the press */
+                    else
+                    {
+                        /*notify the app that the timer has expired*/
+                        MessageSend( &theSink.task , EventLongTimer , 0 ) ;    
+                        lBTask->gBTime = B_LONG ;
+                    }    
+                    /*indicate that we have received a message */
+                    ButtonsButtonDetected ( lBTask, (lBTask->gBOldInputState & lBTask->gPerformInputLevelCheck) , lBTask->gBTime ); 
+                }
             }
-            /* a long press timer event has triggered */
-            else if ( lBTask->gBTime == B_LONG )
+            
+            if ( lBTask->gBRepeatAt && ( lHeld >= lBTask->gBRepeatAt ) )
             {
-                /* don't send very very long timer message until needed, i.e. very_long timer expired */
-                MessageSendLater ( &lBTask->task , B_INTERNAL_TIMER , 0 ,  (lBTask->button_config->very_very_long_press_time - lBTask->button_config->very_long_press_time ) ) ;                   
-                /* update tiemr state flag */
-                lBTask->gBTime = B_VERY_LONG ;
-                /*notify the app that the timer has expired*/
-                MessageSend( &theSink.task , EventVLongTimer , 0 ) ;    
+                /*the repeat time has been reached so send a new message*/
+                B_DEBUG(("B:Repeat[%lx][%x]\n", lBTask->gBOldInputState , B_REPEAT  )) ;
+                
+                lBTask->gBRepeatAt += lBTask->button_config->repeat_time ;
+                
+                ButtonsButtonDetected ( lBTask, (lBTask->gBOldInputState & lBTask->gPerformInputLevelCheck) , B_REPEAT ); 
             }
-            /* the first timer event triggered from the level detect call */
-            else
-            {
-                /* only send very long message when long timer expired to save messaging.                 */
-                MessageSendLater ( &lBTask->task , B_INTERNAL_TIMER , 0 , (lBTask->button_config->very_long_press_time - lBTask->button_config->long_press_time)) ;
-                /*notify the app that the timer has expired*/
-                MessageSend( &theSink.task , EventLongTimer , 0 ) ;    
-                lBTask->gBTime = B_LONG ;
-            }    
-            /*indicate that we have received a message */
-            ButtonsButtonDetected ( lBTask, (lBTask->gBOldInputState & lBTask->gPerformInputLevelCheck) , lBTask->gBTime ); 
+            
+            if ( lBTask->gBHolding )
+                ButtonsHoldSchedule ( lBTask ) ;
         }         
         break ;
         
-        case B_REPEAT_TIMER:
-        {
-            /*if we have reached here, the repeat time has been reached so send a new message*/
-            B_DEBUG(("B:Repeat[%lx][%x]\n", lBTask->gBOldInputState , B_REPEAT  )) ;
-            
-            /*send another repeat message*/
-            MessageSendLater ( &lBTask->task , B_REPEAT_TIMER , 0 ,  lBTask->button_config->repeat_time ) ; 
-
-            ButtonsButtonDetected ( lBTask, (lBTask->gBOldInputState & lBTask->gPerformInputLevelCheck) , B_REPEAT ); 
-        }
-        break;
         default :
            B_DEBUG(("B:?[%x]\n",pId)) ; 
         break ;
@@ -391,7 +420,10 @@ static void ButtonsButtonDetected (  ButtonsTaskData * pButtonsTask, uint32 pBut
     
     if( pButtonMask == 0 )
     {
-        MessageCancelAll ( &pButtonsTask->task , B_REPEAT_TIMER ) ;
+        /* no more repeats for this press */
+        pButtonsTask->gBRepeatAt = 0 ;
+        if ( pButtonsTask->gBHolding )
+            ButtonsHoldSchedule ( pButtonsTask ) ;
     }
     else
     {
@@ -423,16 +455,9 @@ static void ButtonsLevelDetect ( const uint32 pInput , ButtonsTaskData * pButton
         if(theSink.features.GoConnectableButtonPress)
             sinkEnableMultipointConnectable();
 
-        /*cancel all previously timed messages*/   
-        MessageCancelAll ( &pButtonsTask->task , B_INTERNAL_TIMER ) ;
-        MessageCancelAll ( &pButtonsTask->task , B_REPEAT_TIMER ) ;
-        
-        /* send new timed messages*/
-        MessageSendLater ( &pButtonsTask->task , B_INTERNAL_TIMER , 0 ,  pButtonsTask->button_config->long_press_time ) ; 
-        MessageSendLater ( &pButtonsTask->task , B_REPEAT_TIMER   , 0 ,  pButtonsTask->button_config->repeat_time ) ;   
-        
-        /*having restrted the timers, reset the time*/
+        /*having restarted the hold timer, reset the time*/
         pButtonsTask->gBTime = B_SHORT ;      
+        ButtonsHoldStart ( pButtonsTask ) ;
         
         if (stateManagerGetState() == deviceTestMode)
         {
@@ -501,8 +526,8 @@ static void ButtonsLevelDetect ( const uint32 pInput , ButtonsTaskData * pButton
              
              if (pButtonsTask->gBTime != B_INVALID)
              {
-                MessageCancelAll ( &pButtonsTask->task , B_INTERNAL_TIMER) ;
-                MessageCancelAll ( &pButtonsTask->task , B_REPEAT_TIMER ) ; 
+                MessageCancelAll ( &pButtonsTask->task , B_HOLD_TIMER) ;
+                pButtonsTask->gBHolding = FALSE ;
              }    
              
              /*removing this allows all releases to generate combination presses is this right?*/
@@ -518,6 +543,102 @@ static void ButtonsLevelDetect ( const uint32 pInput , ButtonsTaskData * pButton
   
 
 
+/****************************************************************************
+DESCRIPTION
+    start timing a press, the long, very long and very very long thresholds
+    and the repeats are all driven from the one hold timer
+*/ 
+static void ButtonsHoldStart ( ButtonsTaskData * pButtonsTask )
+{
+    pButtonsTask->gBPressTime = VmGetClock() ;
+    pButtonsTask->gBRepeatAt  = pButtonsTask->button_config->repeat_time ;
+    pButtonsTask->gBHolding   = TRUE ;
+    
+    ButtonsHoldSchedule ( pButtonsTask ) ;
+}
+
+/****************************************************************************
+DESCRIPTION
+    set the hold timer for whichever of the next threshold and the next 
+    repeat comes first
+*/ 
+static void ButtonsHoldSchedule ( ButtonsTaskData * pButtonsTask )
+{
+    uint32 lNext = 0 ;
+    
+    MessageCancelAll ( &pButtonsTask->task , B_HOLD_TIMER ) ;
+    
+    if ( pButtonsTask->gBTime == B_SHORT )
+        lNext = pButtonsTask->button_config->long_press_time ;
+    else if ( pButtonsTask->gBTime == B_LONG )
+        lNext = pButtonsTask->button_config->very_long_press_time ;
+    else if ( pButtonsTask->gBTime == B_VERY_LONG )
+        lNext = pButtonsTask->button_config->very_very_long_press_time ;
+    
+    if ( pButtonsTask->gBRepeatAt && ( !lNext || ( pButtonsTask->gBRepeatAt < lNext ) ) )
+        lNext = pButtonsTask->gBRepeatAt ;
+    
+    if ( lNext )
+    {
+        uint32 lHeld = VmGetClock() - pButtonsTask->gBPressTime ;
+        
+        MessageSendLater ( &pButtonsTask->task , B_HOLD_TIMER , 0 , ( lNext > lHeld ) ? ( lNext - lHeld ) : 0 ) ;
+    }
+}
+
+#ifdef ENABLE_CAPSENSE
+/****************************************************************************
+DESCRIPTION
+    capsense sample timer, debounces each of the sensors with its own count
+    of samples. A sensor only changes state once it has been seen in the new
+    state for debounce_number samples in a row, as a PIO does, so noise on
+    the sensors produces no button events. The timer stops once the sensors
+    settle.
+*/ 
+static void ButtonsCapSample ( ButtonsTaskData * pButtonsTask )
+{
+    uint16 lDelta  = pButtonsTask->gCapRawState ^ pButtonsTask->gOldCapState ;
+    uint16 lToggle = 0 ;
+    uint16 i ;
+    
+    for ( i = 0 ; i < BM_CAP_SENSORS ; i++ )
+    {
+        /* counters of sensors back at the debounced state reset to zero */
+        if ( !( lDelta & ( 1 << i ) ) )
+        {
+            pButtonsTask->gCapCount[i] = 0 ;
+        }
+        else if ( ++pButtonsTask->gCapCount[i] >= pButtonsTask->button_config->debounce_number )
+        {
+            pButtonsTask->gCapCount[i] = 0 ;
+            lToggle |= ( 1 << i ) ;
+        }
+    }
+    
+    if ( lToggle )
+    {
+        uint16 lCapState = pButtonsTask->gOldCapState ^ lToggle ;
+        
+        B_DEBUG(("B:Cap - debounced = %x\n",lCapState)) ;
+        
+        /* check whether the sensor status change requires an event to be generated */
+        ButtonsCheckDetection(lCapState, pButtonsTask->gOldPIOState);
+        
+        /* update the last state value */
+        pButtonsTask->gOldCapState = lCapState;
+    }
+    
+    if ( pButtonsTask->gCapRawState != pButtonsTask->gOldCapState )
+    {
+        MessageSendLater(&pButtonsTask->task, B_CAP_SAMPLE_TIMER, 0, pButtonsTask->button_config->debounce_period_ms);
+    }
+    else
+    {
+        pButtonsTask->gCapSampling = FALSE ;
+    }
+}
+#endif
+
 /****************************************************************************
 
 DESCRIPTION
@@ -0,0 +1,418 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_callerid.c
+
+DESCRIPTION
+    Local caller ID store. The store is rebuilt from each pull of the main
+    phonebook: every entry's first number is normalised to a key made from its
+    trailing digits and the name is packed into a pool. The rebuild goes into
+    a second store so lookups keep using the previous one until the pull has
+    completed. A checksum of the rebuilt store is compared with the saved one
+    so PS is only written, and the change counter only advanced, when the
+    phonebook has changed.
+
+*/
+
+#ifdef ENABLE_PBAP
+
+#include "sink_callerid.h"
+#include "sink_private.h"
+
+#include <ps.h>
+#include <string.h>
+
+
+#ifdef DEBUG_PBAP
+#define CALLERID_DEBUG(x) DEBUG(x)
+#else
+#define CALLERID_DEBUG(x)
+#endif
+
+/* A number and where its name is in the pool */
+typedef struct
+{
+    uint32      key;                /* digit count and trailing digits, 0 if the slot is free */
+    unsigned    name_offset:11;     /* characters into the pool */
+    unsigned    name_len:5;
+} caller_id_slot;
+
+/* The store, saved to PS as is but only as far as the pool is used */
+typedef struct
+{
+    uint16          change_count;
+    uint16          checksum;
+    uint16          entries;
+    uint16          pool_used;
+    caller_id_slot  slot[CALLER_ID_SLOTS];
+    uint16          pool[CALLER_ID_POOL_WORDS];     /* two characters to a word, the first in the high octet */
+} caller_id_store;
+
+#define CALLER_ID_HEADER_WORDS  (sizeof(caller_id_store) - CALLER_ID_POOL_WORDS)
+
+/* words of the pool holding a number of characters */
+#define CALLER_ID_POOL_USED_WORDS(chars)    (((chars) + 1) / 2)
+
+typedef struct
+{
+    caller_id_store *   store;      /* NULL until a store is loaded or built */
+    caller_id_store *   rebuild;    /* store being built, NULL if no pull in progress */
+    caller_id_stats     stats;
+    uint8               name[CALLER_ID_MAX_NAME];   /* name of the last lookup */
+} caller_id_t;
+
+static caller_id_t gCallerId;
+
+
+/****************************************************************************
+NAME
+  	callerIdNormalise
+
+DESCRIPTION
+  	Reduce a dial string to a key made from its digit count (saturating at
+    CALLER_ID_SUFFIX_DIGITS) and the value of its trailing digits. Formatting
+    characters are ignored and anything after a pause or wait is DTMF, not
+    part of the number.
+
+RETURNS
+  	the key, 0 if the number is too short to match on
+*/
+static uint32 callerIdNormalise( uint16 size_number, const uint8 * number )
+{
+    uint32 value = 0;
+    uint32 modulus = 1;
+    uint16 digits = 0;
+    uint16 i;
+
+    for(i = 0; i < CALLER_ID_SUFFIX_DIGITS; i++)
+        modulus *= 10;
+
+    for(i = 0; (i < size_number) && number[i]; i++)
+    {
+        uint8 c = number[i];
+
+        if((c >= '0') && (c <= '9'))
+        {
+            value = ((value * 10) + (c - '0')) % modulus;
+            if(digits < CALLER_ID_SUFFIX_DIGITS)
+                digits++;
+        }
+        else if((c == 'p') || (c == 'P') || (c == 'w') || (c == 'W') || (c == ',') || (c == ';'))
+        {
+            break;
+        }
+    }
+
+    if(digits < CALLER_ID_MIN_DIGITS)
+        return 0;
+
+    return ((uint32)digits << 24) | value;
+}
+
+/****************************************************************************
+NAME
+  	callerIdHash
+
+DESCRIPTION
+  	Multiplicative hash of a key to its home slot
+
+RETURNS
+  	the slot index
+*/
+static uint16 callerIdHash( uint32 key )
+{
+    uint16 h = (uint16)key ^ (uint16)(key >> 16);
+    return (uint16)(h * 40503u) >> (16 - CALLER_ID_SLOTS_BITS);
+}
+
+/****************************************************************************
+NAME
+  	callerIdFind
+
+DESCRIPTION
+  	Probe for a key, stopping at the first free slot
+
+RETURNS
+  	the slot holding the key or the free slot it would go in
+*/
+static uint16 callerIdFind( const caller_id_store * store, uint32 key )
+{
+    uint16 i = callerIdHash(key);
+
+    /* the table is never full so a free slot is always found */
+    while(store->slot[i].key && (store->slot[i].key != key))
+        i = (i + 1) & (CALLER_ID_SLOTS - 1);
+
+    return i;
+}
+
+/****************************************************************************
+NAME
+  	callerIdChecksum
+
+DESCRIPTION
+  	Checksum of the entries and the used part of the pool
+
+RETURNS
+  	the checksum
+*/
+static uint16 callerIdChecksum( const caller_id_store * store )
+{
+    const uint16 * data = &store->entries;
+    uint16 words = CALLER_ID_HEADER_WORDS - 2 + CALLER_ID_POOL_USED_WORDS(store->pool_used);
+    uint16 sum = 0;
+
+    while(words--)
+        sum = ((sum << 1) | (sum >> 15)) ^ *data++;
+
+    return sum;
+}
+
+/****************************************************************************
+NAME
+  	callerIdPoolPut
+
+DESCRIPTION
+  	Write a character into the pool, which starts zeroed
+
+RETURNS
+  	void
+*/
+static void callerIdPoolPut( caller_id_store * store, uint16 offset, uint8 c )
+{
+    if(offset & 1)
+        store->pool[offset / 2] |= (c & 0xFF);
+    else
+        store->pool[offset / 2] = (uint16)(c & 0xFF) << 8;
+}
+
+/****************************************************************************
+NAME
+  	callerIdPoolGet
+
+DESCRIPTION
+  	Read a character from the pool
+
+RETURNS
+  	the character
+*/
+static uint8 callerIdPoolGet( const caller_id_store * store, uint16 offset )
+{
+    uint16 word = store->pool[offset / 2];
+
+    return (offset & 1) ? (word & 0xFF) : (word >> 8);
+}
+
+/****************************************************************************
+NAME
+  	callerIdLoad
+
+DESCRIPTION
+  	Read the store from PS, releasing the memory if nothing valid is saved
+
+RETURNS
+  	void
+*/
+static void callerIdLoad( void )
+{
+    uint16 words;
+
+    if(!gCallerId.store)
+        gCallerId.store = (caller_id_store *)mallocPanic(sizeof(caller_id_store));
+
+    memset(gCallerId.store, 0, sizeof(caller_id_store));
+    words = PsRetrieve(PSKEY_CALLER_ID_CACHE, gCallerId.store, sizeof(caller_id_store));
+
+    if((words < CALLER_ID_HEADER_WORDS) ||
+       (gCallerId.store->entries > CALLER_ID_MAX_ENTRIES) ||
+       (gCallerId.store->pool_used > CALLER_ID_POOL_SIZE) ||
+       (callerIdChecksum(gCallerId.store) != gCallerId.store->checksum))
+    {
+        CALLERID_DEBUG(("CALLERID: nothing saved\n"));
+        freePanic(gCallerId.store);
+        gCallerId.store = NULL;
+        return;
+    }
+
+    CALLERID_DEBUG(("CALLERID: loaded [%d] entries, change [%d]\n", gCallerId.store->entries, gCallerId.store->change_count));
+}
+
+
+/****************************************************************************
+NAME
+  	callerIdInit
+*/
+void callerIdInit( void )
+{
+    memset(&gCallerId, 0, sizeof(caller_id_t));
+    callerIdLoad();
+}
+
+/****************************************************************************
+NAME
+  	callerIdBuildStart
+*/
+void callerIdBuildStart( void )
+{
+    caller_id_store * store = gCallerId.rebuild;
+
+    if(!store)
+        store = gCallerId.rebuild = (caller_id_store *)mallocPanic(sizeof(caller_id_store));
+
+    memset(store, 0, sizeof(caller_id_store));
+
+    /* the change counter and checksum of the saved store are carried over
+       so the rebuilt store can be compared with it */
+    if(gCallerId.store)
+    {
+        store->change_count = gCallerId.store->change_count;
+        store->checksum     = gCallerId.store->checksum;
+    }
+
+    gCallerId.stats.dropped = 0;
+
+    CALLERID_DEBUG(("CALLERID: rebuild\n"));
+}
+
+/****************************************************************************
+NAME
+  	callerIdBuildAdd
+*/
+void callerIdBuildAdd( const vcard_entry * entry )
+{
+    caller_id_store * store = gCallerId.rebuild;
+    const uint8 * name = entry->name;
+    uint32 key;
+    uint16 len;
+    uint16 i;
+
+    if(!store || !entry->name_len)
+        return;
+
+    key = callerIdNormalise(entry->tel_len, entry->tel);
+    if(!key)
+        return;
+
+    len = (entry->name_len > CALLER_ID_MAX_NAME) ? CALLER_ID_MAX_NAME : entry->name_len;
+
+    i = callerIdFind(store, key);
+
+    /* the first entry for a number wins */
+    if(store->slot[i].key)
+        return;
+
+    if((store->entries >= CALLER_ID_MAX_ENTRIES) || ((store->pool_used + len) > CALLER_ID_POOL_SIZE))
+    {
+        gCallerId.stats.dropped++;
+        return;
+    }
+
+    store->slot[i].key         = key;
+    store->slot[i].name_offset = store->pool_used;
+    store->slot[i].name_len    = len;
+
+    while(len--)
+        callerIdPoolPut(store, store->pool_used++, *name++);
+
+    store->entries++;
+}
+
+/****************************************************************************
+NAME
+  	callerIdBuildEnd
+*/
+void callerIdBuildEnd( bool complete )
+{
+    caller_id_store * store = gCallerId.rebuild;
+    uint16 sum;
+
+    if(!store)
+        return;
+
+    gCallerId.rebuild = NULL;
+
+    if(!complete)
+    {
+        /* partial phonebook, keep the store already in use */
+        CALLERID_DEBUG(("CALLERID: rebuild abandoned\n"));
+        freePanic(store);
+        return;
+    }
+
+    sum = callerIdChecksum(store);
+
+    CALLERID_DEBUG(("CALLERID: rebuilt [%d] entries, pool [%d], dropped [%d]\n", store->entries, store->pool_used, gCallerId.stats.dropped));
+
+    if(gCallerId.store && (sum == store->checksum))
+    {
+        /* unchanged, the store in use is the same */
+        freePanic(store);
+        return;
+    }
+
+    store->checksum = sum;
+    store->change_count++;
+    (void)PsStore(PSKEY_CALLER_ID_CACHE, store, CALLER_ID_HEADER_WORDS + CALLER_ID_POOL_USED_WORDS(store->pool_used));
+
+    CALLERID_DEBUG(("CALLERID: saved, change [%d]\n", store->change_count));
+
+    if(gCallerId.store)
+        freePanic(gCallerId.store);
+    gCallerId.store = store;
+}
+
+/****************************************************************************
+NAME
+  	callerIdLookup
+*/
+const uint8 * callerIdLookup( uint16 size_number, const uint8 * number, uint16 * size_name )
+{
+    caller_id_store * store = gCallerId.store;
+    uint32 key;
+    uint16 i;
+    uint16 n;
+
+    gCallerId.stats.lookups++;
+
+    if(!store || !store->entries)
+        return NULL;
+
+    key = callerIdNormalise(size_number, number);
+    if(!key)
+        return NULL;
+
+    i = callerIdFind(store, key);
+    if(!store->slot[i].key)
+        return NULL;
+
+    gCallerId.stats.hits++;
+
+    for(n = 0; n < store->slot[i].name_len; n++)
+        gCallerId.name[n] = callerIdPoolGet(store, store->slot[i].name_offset + n);
+
+    *size_name = store->slot[i].name_len;
+    return gCallerId.name;
+}
+
+/****************************************************************************
+NAME
+  	callerIdGetStats
+*/
+void callerIdGetStats( caller_id_stats * stats )
+{
+    *stats = gCallerId.stats;
+
+    if(gCallerId.rebuild)
+        stats->store_words = sizeof(caller_id_store);
+
+    if(gCallerId.store)
+    {
+        stats->store_words += sizeof(caller_id_store);
+        stats->entries      = gCallerId.store->entries;
+        stats->pool_used    = gCallerId.store->pool_used;
+        stats->change_count = gCallerId.store->change_count;
+    }
+}
+
+#endif /* ENABLE_PBAP */
@@ -0,0 +1,146 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_callerid.h
+
+DESCRIPTION
+    Local caller ID store built from the phonebook pulled over PBAP. Numbers
+    are reduced to their last CALLER_ID_SUFFIX_DIGITS digits and held in a
+    small open addressed hash table, names are held in a string pool. The
+    store is sized from a budget of CALLER_ID_BUDGET_WORDS so its memory use
+    is capped, and it is written to PS only when a rebuild changes its
+    contents.
+
+*/
+#ifndef SINK_CALLERID_H
+#define SINK_CALLERID_H
+
+#ifdef ENABLE_PBAP
+
+#include <csrtypes.h>
+
+#include "sink_vcard.h"
+
+
+/* PS key the store is kept in, not contiguous with the configuration keys */
+#define PSKEY_CALLER_ID_CACHE       (37)
+
+/* RAM for one store in words. A rebuild is made in a second store that
+   replaces the first once the pull completes, so twice this is held while
+   the main phonebook is being pulled. */
+#define CALLER_ID_BUDGET_WORDS      (1024)
+
+/* number of hash slots, must be a power of two, and the words in each */
+#define CALLER_ID_SLOTS_BITS        (7)
+#define CALLER_ID_SLOTS             (1 << CALLER_ID_SLOTS_BITS)
+#define CALLER_ID_SLOT_WORDS        (3)
+
+/* entries are refused once the table is this full to keep probe chains short */
+#define CALLER_ID_MAX_ENTRIES       ((CALLER_ID_SLOTS * 3) / 4)
+
+/* the rest of the budget after the 4 word header and the slots holds the
+   names packed two characters to a word, 1272 characters or 13 for each
+   of the 96 entries, and the longest name kept */
+#define CALLER_ID_POOL_WORDS        (CALLER_ID_BUDGET_WORDS - 4 - (CALLER_ID_SLOTS * CALLER_ID_SLOT_WORDS))
+#define CALLER_ID_POOL_SIZE         (CALLER_ID_POOL_WORDS * 2)
+#define CALLER_ID_MAX_NAME          (24)
+
+/* numbers are matched on their trailing digits so the same number dialled
+   with or without a country or trunk prefix still matches */
+#define CALLER_ID_SUFFIX_DIGITS     (7)
+#define CALLER_ID_MIN_DIGITS        (3)
+
+/* Usage counters */
+typedef struct
+{
+    uint16  store_words;        /* RAM held by the store and any rebuild, 0 if not allocated */
+    uint16  entries;            /* numbers held */
+    uint16  pool_used;          /* characters of the name pool used */
+    uint16  dropped;            /* entries refused by the last rebuild as the store was full */
+    uint16  change_count;       /* number of rebuilds that changed the store */
+    uint16  lookups;
+    uint16  hits;
+} caller_id_stats;
+
+
+/****************************************************************************
+NAME
+  	callerIdInit
+
+DESCRIPTION
+  	Load the store from PS if one has been saved
+
+RETURNS
+  	void
+*/
+void callerIdInit( void );
+
+/****************************************************************************
+NAME
+  	callerIdBuildStart
+
+DESCRIPTION
+  	Start a rebuild from a phonebook pull into a second store. Lookups keep
+    using the current store until the rebuild ends.
+
+RETURNS
+  	void
+*/
+void callerIdBuildStart( void );
+
+/****************************************************************************
+NAME
+  	callerIdBuildAdd
+
+DESCRIPTION
+  	Add a phonebook entry to a store being rebuilt, ignored if no rebuild
+    is in progress or the entry has no name or number
+
+RETURNS
+  	void
+*/
+void callerIdBuildAdd( const vcard_entry * entry );
+
+/****************************************************************************
+NAME
+  	callerIdBuildEnd
+
+DESCRIPTION
+  	Finish a rebuild. If the pull completed the rebuilt store replaces the
+    current one and is written to PS when its contents have changed,
+    otherwise it is discarded and the current store is kept.
+
+RETURNS
+  	void
+*/
+void callerIdBuildEnd( bool complete );
+
+/****************************************************************************
+NAME
+  	callerIdLookup
+
+DESCRIPTION
+  	Find the name for a number as sent in a caller ID indication
+
+RETURNS
+  	pointer to the name, which is not NUL terminated, or NULL if the number
+    is not known. The name is valid until the next lookup.
+*/
+const uint8 * callerIdLookup( uint16 size_number, const uint8 * number, uint16 * size_name );
+
+/****************************************************************************
+NAME
+  	callerIdGetStats
+
+DESCRIPTION
+  	Copy the current usage counters
+
+RETURNS
+  	void
+*/
+void callerIdGetStats( caller_id_stats * stats );
+
+#endif /* ENABLE_PBAP */
+
+#endif /* SINK_CALLERID_H */
@@ -0,0 +1,148 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_clock_drift.c
+
+DESCRIPTION
+    Clock drift tracking per a2dp source. Each streaming session gives one
+    observation, the first rate the DSP reports once it has settled, which
+    is filtered into the learned rate with a gain falling as confidence
+    builds. A session that never settles is filed with its last rate when
+    the next stream starts, and counts against the confidence.
+
+*/
+
+#include "sink_clock_drift.h"
+#include "sink_private.h"
+#include "sink_a2dp.h"
+
+#include <bdaddr.h>
+#include <vm.h>
+#include <string.h>
+
+
+#ifdef DEBUG_CLOCK_DRIFT
+#define CLOCK_DRIFT_DEBUG(x) DEBUG(x)
+#else
+#define CLOCK_DRIFT_DEBUG(x)
+#endif
+
+/* Limits in the units the DSP reports the rate in. A session has settled
+   once a rate is within CLOCK_DRIFT_SETTLED of the one before, a session
+   agrees with the learned rate if within CLOCK_DRIFT_AGREE of it. */
+#define CLOCK_DRIFT_SETTLED         (4)
+#define CLOCK_DRIFT_AGREE           (8)
+
+#define CLOCK_DRIFT_MAX_CONFIDENCE  (15)
+
+typedef struct
+{
+    bdaddr      addr;               /* device the session was with */
+    uint32      start;              /* clock the stream started */
+    uint16      last;               /* last rate reported */
+    unsigned    sampled:1;
+    unsigned    settled:1;
+    unsigned    unused:14;
+} clock_drift_session;
+
+static clock_drift_session gSession[MAX_A2DP_CONNECTIONS];
+
+
+/****************************************************************************
+NAME
+  	clockDriftWithin
+
+DESCRIPTION
+  	Check two rates are no more than limit apart
+
+RETURNS
+  	TRUE if they are
+*/
+static bool clockDriftWithin( uint16 a, uint16 b, int16 limit )
+{
+    int32 diff = (int32)(int16)a - (int16)b;
+
+    return (diff <= limit) && (diff >= -limit);
+}
+
+/****************************************************************************
+NAME
+  	clockDriftFile
+
+DESCRIPTION
+  	Filter the rate a session ended up at into the learned rate for the
+    device on an a2dp link
+
+RETURNS
+  	void
+*/
+static void clockDriftFile( uint16 index, uint16 rate )
+{
+    clock_drift_model * model = &theSink.a2dp_link_data->clockDrift[index];
+    int16 learned = (int16)theSink.a2dp_link_data->clockMismatchRate[index];
+    bool agreed = clockDriftWithin(rate, learned, CLOCK_DRIFT_AGREE);
+
+    /* the gain is 1/(n+1) so the first few sessions are averaged evenly */
+    if(model->confidence)
+        learned += (int16)(((int32)(int16)rate - learned) / (model->confidence + 1));
+    else
+        learned = (int16)rate;
+
+    if(!agreed)
+        model->confidence >>= 1;
+    else if(model->confidence < CLOCK_DRIFT_MAX_CONFIDENCE)
+        model->confidence++;
+
+    theSink.a2dp_link_data->clockMismatchRate[index] = (uint16)learned;
+
+    CLOCK_DRIFT_DEBUG(("DRIFT: [%d] rate %d learned %d confidence %d converged %d00ms\n", index, (int16)rate,
+                        learned, model->confidence, model->convergence));
+}
+
+
+/****************************************************************************
+NAME
+  	clockDriftStreamStart
+*/
+uint16 clockDriftStreamStart( uint16 index )
+{
+    clock_drift_session * session = &gSession[index];
+    const bdaddr * addr = &theSink.a2dp_link_data->bd_addr[index];
+
+    if(session->sampled && !session->settled && BdaddrIsSame(&session->addr, addr))
+    {
+        theSink.a2dp_link_data->clockDrift[index].convergence = CLOCK_DRIFT_NOT_SETTLED;
+        clockDriftFile(index, session->last);
+    }
+
+    memset(session, 0, sizeof(clock_drift_session));
+    session->addr = *addr;
+    session->start = VmGetClock();
+
+    return theSink.a2dp_link_data->clockMismatchRate[index];
+}
+
+/****************************************************************************
+NAME
+  	clockDriftSample
+*/
+void clockDriftSample( uint16 index, uint16 rate )
+{
+    clock_drift_session * session = &gSession[index];
+    clock_drift_model * model = &theSink.a2dp_link_data->clockDrift[index];
+    uint32 elapsed;
+
+    if(!session->settled &&
+       ((session->sampled && clockDriftWithin(rate, session->last, CLOCK_DRIFT_SETTLED)) ||
+        (model->confidence && clockDriftWithin(rate, theSink.a2dp_link_data->clockMismatchRate[index], CLOCK_DRIFT_AGREE))))
+    {
+        elapsed = (VmGetClock() - session->start) / 100;
+        model->convergence = (elapsed < CLOCK_DRIFT_NOT_SETTLED) ? elapsed : (CLOCK_DRIFT_NOT_SETTLED - 1);
+        session->settled = TRUE;
+        clockDriftFile(index, rate);
+    }
+
+    session->last = rate;
+    session->sampled = TRUE;
+}
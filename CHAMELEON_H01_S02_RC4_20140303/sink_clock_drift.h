@@ -0,0 +1,61 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_clock_drift.h
+
+DESCRIPTION
+    Clock drift tracking per a2dp source. The clock mismatch rate reported
+    by the DSP in each streaming session is filtered into a learned rate
+    for the device, kept in its attributes with a confidence in that rate
+    and the time the last session took to settle. The learned rate is
+    given to the decoder when a stream starts so it has less to correct.
+
+*/
+#ifndef _SINK_CLOCK_DRIFT_H_
+#define _SINK_CLOCK_DRIFT_H_
+
+#include <csrtypes.h>
+
+
+/* The learned rate is the clock mismatch rate of the device attributes,
+   this holds how far it can be trusted */
+typedef struct
+{
+    unsigned    confidence:4;       /* sessions the rate has agreed with, saturating */
+    unsigned    convergence:12;     /* time the last session took to settle in 100ms */
+} clock_drift_model;
+
+/* convergence of a session that has not settled */
+#define CLOCK_DRIFT_NOT_SETTLED     (0xFFF)
+
+
+/****************************************************************************
+NAME
+    clockDriftStreamStart
+
+DESCRIPTION
+    Note a stream starting on an a2dp link, an earlier session on the link
+    that never settled is filed first
+
+RETURNS
+    the clock mismatch rate to start the decoder with
+*/
+uint16 clockDriftStreamStart( uint16 index );
+
+/****************************************************************************
+NAME
+    clockDriftSample
+
+DESCRIPTION
+    File a clock mismatch rate reported by the DSP for the stream on an
+    a2dp link. The first rate of a session to agree with the one before it,
+    or with a learned rate that has some confidence, settles the session
+    and is filtered into the learned rate.
+
+RETURNS
+    void
+*/
+void clockDriftSample( uint16 index, uint16 rate );
+
+#endif /* _SINK_CLOCK_DRIFT_H_ */
@@ -0,0 +1,382 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_config_cache.c
+
+DESCRIPTION
+    Lazily loaded cache for the rarely used configuration blocks. Rather than
+    allocating the AT command, TTS phrase and user tone blocks at boot they are
+    read from PS the first time a subsystem asks for them. Blocks are released
+    least recently used first when the cache exceeds its budget or when the
+    pool is unable to satisfy an allocation.
+
+*/
+
+#include "sink_config_cache.h"
+#include "sink_configmanager.h"
+#include "sink_config.h"
+#include "sink_private.h"
+#include "sink_tts.h"
+#include "sink_tone_codec.h"
+
+#include <audio.h>
+#include <string.h>
+
+
+#ifdef DEBUG_CONFIG
+#define CACHE_DEBUG(x) DEBUG(x)
+#else
+#define CACHE_DEBUG(x)
+#endif
+
+typedef struct
+{
+    void   *data;           /* block data, NULL if not loaded */
+    uint16  size;           /* size of data in words */
+    uint16  last_used;      /* LRU stamp */
+    unsigned stale:1;       /* PS has changed but the block was still in use */
+    unsigned unused:15;
+} config_cache_entry;
+
+typedef struct
+{
+    config_cache_entry  entry[config_cache_num_blocks];
+    config_cache_stats  stats;
+    uint16              clock;
+    uint16              no_tts;
+    uint16              user_tones_length;
+    uint16              size_at_commands;
+    unsigned            lengths_valid:1;
+    unsigned            unused:15;
+} config_cache_t;
+
+static config_cache_t gConfigCache;
+
+
+/****************************************************************************
+NAME
+  	configCacheReadLengths
+
+DESCRIPTION
+ 	Read the block lengths from PSKEY_LENGTHS if not already known
+
+RETURNS
+  	void
+*/
+static void configCacheReadLengths( void )
+{
+    if(!gConfigCache.lengths_valid)
+    {
+        /* use a memory allocation for the lengths data to reduce stack usage */
+        lengths_config_type * lengths = mallocPanic(sizeof(lengths_config_type));
+
+        memset(lengths, 0, sizeof(lengths_config_type));
+        ConfigRetrieve(theSink.config_id, PSKEY_LENGTHS, lengths, sizeof(lengths_config_type));
+
+        gConfigCache.no_tts            = lengths->no_tts;
+        gConfigCache.user_tones_length = lengths->userTonesLength;
+        gConfigCache.size_at_commands  = lengths->size_at_commands;
+        gConfigCache.lengths_valid     = TRUE;
+
+        freePanic(lengths);
+    }
+}
+
+/****************************************************************************
+NAME
+  	configCacheBlockSize
+
+DESCRIPTION
+ 	Work out the RAM needed to hold a block
+
+RETURNS
+  	size in words, 0 if the block is not configured
+*/
+static uint16 configCacheBlockSize( config_cache_block block )
+{
+    switch(block)
+    {
+        case config_cache_at_commands:
+            /* one extra word ensures a string terminator is present should the
+               data read from ps be incorrect */
+            return gConfigCache.size_at_commands ? (sizeof(config_block3_t) + gConfigCache.size_at_commands + 1) : 0;
+
+        case config_cache_tts_phrases:
+#ifdef TEXT_TO_SPEECH_PHRASES
+            /* always one extra entry for the terminator */
+            return gConfigCache.no_tts ? ((gConfigCache.no_tts + 1) * sizeof(tts_config_type)) : 0;
+#else
+            return 0;
+#endif
+
+        case config_cache_user_tones:
+            /* tones stored packed need more room once decoded */
+            return toneCodecUserTonesSize(gConfigCache.user_tones_length);
+
+        default:
+            return 0;
+    }
+}
+
+/****************************************************************************
+NAME
+  	configCacheBlockLoad
+
+DESCRIPTION
+ 	Read a block from PS into data, which is size words long
+
+RETURNS
+  	TRUE if the block contained valid data
+*/
+static bool configCacheBlockLoad( config_cache_block block, void * data, uint16 size )
+{
+    memset(data, 0, size);
+
+    switch(block)
+    {
+        case config_cache_at_commands:
+            ConfigRetrieve(theSink.config_id, PSKEY_AT_COMMANDS, data, gConfigCache.size_at_commands + sizeof(config_block3_t) - 1);
+            return TRUE;
+
+        case config_cache_tts_phrases:
+        {
+            tts_config_type * phrases = (tts_config_type *)data;
+
+            if(!ConfigRetrieve(theSink.config_id, PSKEY_TTS, phrases, gConfigCache.no_tts * sizeof(tts_config_type)))
+                return FALSE;
+
+            /* Terminate the list */
+            phrases[gConfigCache.no_tts].tts_id = TTS_NOT_DEFINED;
+            return TRUE;
+        }
+
+        case config_cache_user_tones:
+            /* the data is in the form of 8 x uint16 audio note start offsets followed by
+               up to 8 lots of tone data, decoded here if the key holds packed tones */
+            return toneCodecUserTonesLoad(gConfigCache.user_tones_length, (ringtone_note *)data, size);
+
+        default:
+            return FALSE;
+    }
+}
+
+/****************************************************************************
+NAME
+  	configCacheIsPinned
+
+DESCRIPTION
+ 	Check whether a block may still be referenced outside of the cache. User
+    tones are handed to the audio plugin by reference so must stay put while
+    audio is busy.
+
+RETURNS
+  	TRUE if the block must not be released
+*/
+static bool configCacheIsPinned( config_cache_block block )
+{
+    return ((block == config_cache_user_tones) && IsAudioBusy());
+}
+
+/****************************************************************************
+NAME
+  	configCacheRelease
+
+DESCRIPTION
+ 	Free the memory held for a block
+
+RETURNS
+  	void
+*/
+static void configCacheRelease( config_cache_block block )
+{
+    config_cache_entry * entry = &gConfigCache.entry[block];
+
+    if(entry->data)
+    {
+        freePanic(entry->data);
+        gConfigCache.stats.pool_words -= entry->size;
+        entry->data = NULL;
+        entry->size = 0;
+    }
+    entry->stale = FALSE;
+}
+
+/****************************************************************************
+NAME
+  	configCacheEvictOne
+
+DESCRIPTION
+ 	Release the least recently used block other than the one being loaded
+
+RETURNS
+  	TRUE if a block was released
+*/
+static bool configCacheEvictOne( config_cache_block keep )
+{
+    config_cache_block block;
+    config_cache_block victim = config_cache_num_blocks;
+    uint16 oldest = 0;
+
+    for(block = 0; block < config_cache_num_blocks; block++)
+    {
+        config_cache_entry * entry = &gConfigCache.entry[block];
+
+        if(entry->data && (block != keep) && !configCacheIsPinned(block))
+        {
+            /* age relative to the clock copes with the stamp wrapping */
+            uint16 age = gConfigCache.clock - entry->last_used;
+
+            if((victim == config_cache_num_blocks) || (age > oldest))
+            {
+                victim = block;
+                oldest = age;
+            }
+        }
+    }
+
+    if(victim == config_cache_num_blocks)
+        return FALSE;
+
+    CACHE_DEBUG(("CACHE: Evict [%d] size [%d]\n", victim, gConfigCache.entry[victim].size));
+    configCacheRelease(victim);
+    gConfigCache.stats.evictions++;
+    return TRUE;
+}
+
+
+/****************************************************************************
+NAME
+  	configCacheInit
+*/
+void configCacheInit( void )
+{
+    config_cache_block block;
+
+    for(block = 0; block < config_cache_num_blocks; block++)
+        configCacheRelease(block);
+
+    memset(&gConfigCache, 0, sizeof(config_cache_t));
+}
+
+/****************************************************************************
+NAME
+  	configCacheGet
+*/
+const void * configCacheGet( config_cache_block block )
+{
+    config_cache_entry * entry;
+    uint16 size;
+
+    if(block >= config_cache_num_blocks)
+        return NULL;
+
+    entry = &gConfigCache.entry[block];
+    entry->last_used = ++gConfigCache.clock;
+
+    /* a block rewritten whilst in use is replaced once it is free, until then
+       the old data remains valid */
+    if(entry->stale && !configCacheIsPinned(block))
+        configCacheRelease(block);
+
+    if(entry->data)
+    {
+        gConfigCache.stats.hits++;
+        return entry->data;
+    }
+
+    configCacheReadLengths();
+
+    /* nothing configured, no need to touch PS */
+    size = configCacheBlockSize(block);
+    if(!size)
+        return NULL;
+
+    gConfigCache.stats.misses++;
+
+    /* make room within the budget */
+    while(((gConfigCache.stats.pool_words + size) > CONFIG_CACHE_MAX_POOL_WORDS) && configCacheEvictOne(block))
+        ;
+
+    /* if the pool is exhausted give up other blocks before failing */
+    entry->data = malloc(size);
+    while(!entry->data && configCacheEvictOne(block))
+        entry->data = malloc(size);
+
+    if(!entry->data)
+    {
+        CACHE_DEBUG(("CACHE: No memory for [%d] size [%d]\n", block, size));
+        return NULL;
+    }
+
+    if(!configCacheBlockLoad(block, entry->data, size))
+    {
+        /* no valid data in PS, no need to waste memory */
+        freePanic(entry->data);
+        entry->data = NULL;
+        return NULL;
+    }
+
+    entry->size = size;
+    gConfigCache.stats.pool_words += size;
+    if(gConfigCache.stats.pool_words > gConfigCache.stats.pool_peak_words)
+        gConfigCache.stats.pool_peak_words = gConfigCache.stats.pool_words;
+
+    CACHE_DEBUG(("CACHE: Load [%d] size [%d] pool [%d] hit [%d] miss [%d]\n", block, size,
+                 gConfigCache.stats.pool_words, gConfigCache.stats.hits, gConfigCache.stats.misses));
+
+    return entry->data;
+}
+
+/****************************************************************************
+NAME
+  	configCacheInvalidate
+*/
+void configCacheInvalidate( config_cache_block block )
+{
+    if(block < config_cache_num_blocks)
+    {
+        CACHE_DEBUG(("CACHE: Invalidate [%d]\n", block));
+        if(configCacheIsPinned(block))
+            gConfigCache.entry[block].stale = TRUE;
+        else
+            configCacheRelease(block);
+        /* the block may have changed size */
+        gConfigCache.lengths_valid = FALSE;
+    }
+}
+
+/****************************************************************************
+NAME
+  	configCacheInvalidateAll
+*/
+void configCacheInvalidateAll( void )
+{
+    config_cache_block block;
+
+    for(block = 0; block < config_cache_num_blocks; block++)
+        configCacheInvalidate(block);
+}
+
+/****************************************************************************
+NAME
+  	configCacheTrim
+*/
+uint16 configCacheTrim( uint16 max_words )
+{
+    uint16 before = gConfigCache.stats.pool_words;
+
+    while((gConfigCache.stats.pool_words > max_words) && configCacheEvictOne(config_cache_num_blocks))
+        ;
+
+    return before - gConfigCache.stats.pool_words;
+}
+
+/****************************************************************************
+NAME
+  	configCacheGetStats
+*/
+void configCacheGetStats( config_cache_stats * stats )
+{
+    *stats = gConfigCache.stats;
+}
@@ -0,0 +1,123 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_config_cache.h
+
+DESCRIPTION
+    Lazily loaded cache for the rarely used configuration blocks (AT commands,
+    TTS phrase table and user defined tones). Blocks are read from PS the first
+    time they are needed and may be evicted least recently used first when the
+    memory pool is under pressure.
+
+*/
+#ifndef SINK_CONFIG_CACHE_H
+#define SINK_CONFIG_CACHE_H
+
+#include <csrtypes.h>
+
+
+/* maximum number of words the cache may hold before older blocks are evicted */
+#define CONFIG_CACHE_MAX_POOL_WORDS     (512)
+
+/* Configuration blocks managed by the cache */
+typedef enum
+{
+    config_cache_at_commands,       /* PSKEY_AT_COMMANDS, as config_block3_t */
+    config_cache_tts_phrases,       /* PSKEY_TTS, as a TTS_NOT_DEFINED terminated tts_config_type array */
+    config_cache_user_tones,        /* PSKEY_CONFIG_TONES, offsets followed by ringtone_note data */
+    config_cache_num_blocks
+} config_cache_block;
+
+/* Cache usage counters */
+typedef struct
+{
+    uint16  hits;               /* requests served from RAM */
+    uint16  misses;             /* requests that required a PS read */
+    uint16  evictions;          /* blocks released to make room */
+    uint16  pool_words;         /* words currently held by the cache */
+    uint16  pool_peak_words;    /* high water mark of pool_words */
+} config_cache_stats;
+
+
+/****************************************************************************
+NAME
+  	configCacheInit
+
+DESCRIPTION
+  	Reset the cache, releasing any blocks that are currently held
+
+RETURNS
+  	void
+*/
+void configCacheInit( void );
+
+/****************************************************************************
+NAME
+  	configCacheGet
+
+DESCRIPTION
+  	Get a configuration block, reading it from PS if it is not already
+    held in RAM. A hit never evicts, but the returned pointer is only valid
+    until another block is loaded or the block is invalidated so callers
+    must not keep it.
+
+RETURNS
+  	pointer to the block data or NULL if the block is not configured
+*/
+const void * configCacheGet( config_cache_block block );
+
+/****************************************************************************
+NAME
+  	configCacheInvalidate
+
+DESCRIPTION
+  	Release a block so the next configCacheGet re-reads it from PS, used
+    when the underlying PS key has been rewritten (e.g. by GAIA). A block
+    that may still be in use by the audio plugin is replaced once audio is
+    no longer busy.
+
+RETURNS
+  	void
+*/
+void configCacheInvalidate( config_cache_block block );
+
+/****************************************************************************
+NAME
+  	configCacheInvalidateAll
+
+DESCRIPTION
+  	Release all blocks and the cached key lengths
+
+RETURNS
+  	void
+*/
+void configCacheInvalidateAll( void );
+
+/****************************************************************************
+NAME
+  	configCacheTrim
+
+DESCRIPTION
+  	Evict least recently used blocks until the cache holds no more than
+    max_words, blocks that may still be referenced by the audio plugin are
+    left in place
+
+RETURNS
+  	the number of words released
+*/
+uint16 configCacheTrim( uint16 max_words );
+
+/****************************************************************************
+NAME
+  	configCacheGetStats
+
+DESCRIPTION
+  	Copy the current cache counters
+
+RETURNS
+  	void
+*/
+void configCacheGetStats( config_cache_stats * stats );
+
+#endif /* SINK_CONFIG_CACHE_H */
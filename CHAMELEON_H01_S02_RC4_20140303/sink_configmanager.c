@@ -23,6 +23,7 @@ DESCRIPTION
 #include "sink_tones.h"
 #include "sink_tts.h"
 #include "sink_audio.h"
+#include "sink_config_cache.h"
 
 #include "sink_pio.h"
 
@@ -259,66 +260,6 @@ static void configManagerFeatureBlock( void )
 }
 
 
-/****************************************************************************
-NAME 
-  	configManagerUserDefinedTones
-
-DESCRIPTION
-  	Attempt to read the user configured tones, if data exists it will be in the following format:
-    
-    uint16 offset in array to user tone 1,
-    uint16 offset in array to user tone ....,
-    uint16 offset in array to user tone 8,
-    uint16[] user tone data
-    
-    To play a particular tone it can be access via gVariableTones, e.g. to access tone 1
-    
-    theSink.audioData.gConfigTones->gVariableTones[0] + (uint16)*theSink.audioData.gConfigTones->gVariableTones[0]
-    
-    or to access tone 2
-
-    theSink.audioData.gConfigTones->gVariableTones[0] + (uint16)*theSink.audioData.gConfigTones->gVariableTones[1]
-    
-    and so on
- 
-RETURNS
-  	void
-*/
-static void configManagerUserDefinedTones( uint16 KeyLength ) 
-{
-    /* if the keyLength is zero there are no user tones so don't malloc any memory */
-    if(KeyLength)
-    {
-        /* malloc only enough memory to hold the configured tone data */
-        uint16 * configTone = mallocPanic(KeyLength * sizeof(uint16));
-    
-        /* retrieve pskey data up to predetermined max size */
-        uint16 size_ps_key = ConfigRetrieve( theSink.config_id, PSKEY_CONFIG_TONES , configTone , KeyLength );
-      
-        CONF_DEBUG(("Co : Configurable Tones Malloc size [%x]\n", KeyLength )) ;
-        
-        /* is there any configurable tone data, if present update pointer to tone data */
-        if (size_ps_key)
-        {
-            /* the data is in the form of 8 x uint16 audio note start offsets followed by the 
-               up to 8 lots of tone data */
-            theSink.conf1->gConfigTones.gVariableTones = (ringtone_note*)&configTone[0];
-        
-        }
-        /* no user configured tone data is available, so free previous malloc as not in use */
-        else
-        {
-            /* no need to waste memory */
-        	freePanic(configTone);      
-        }
-    }
-    /* no tone data available, ensure data pointer is null */
-    else
-    {
-            theSink.conf1->gConfigTones.gVariableTones = NULL;
-    }
-}
-
 /****************************************************************************
 NAME 
   configManagerConfiguration
@@ -464,31 +405,6 @@ static void configManagerEventTones( uint16 no_tones )
 
 
 
-/****************************************************************************
-NAME 
-  	configManagerEventTTSPhrases
-
-DESCRIPTION
-  	Configure an event tts phrase only if one is defined
- 
-RETURNS
-  	void
-*/ 
-static void configManagerEventTTSPhrases( uint16 no_tts )
-{
-#ifdef TEXT_TO_SPEECH_PHRASES    
-  	/* check the number of events configured */
-	if(no_tts)
-  	{
-    	/* Now read in TTS configuration */
-        ConfigRetrieve(theSink.config_id , PSKEY_TTS, &theSink.conf4->gEventTTSPhrases, no_tts * sizeof(tts_config_type));
-        
-        /* Terminate the list */
-        theSink.conf4->gEventTTSPhrases[no_tts].tts_id = TTS_NOT_DEFINED;
-    }
-#endif
-}
-
 #ifdef ENABLE_SQIFVP
 void configManagerSqifPartitionsInit( void )
 {
@@ -556,28 +472,6 @@ static void configManagerVoicePromptsInit( uint16 no_vp , uint16 no_tts_language
 
 
 
-/****************************************************************************
-NAME 
- 	InitConfigMemoryAtCommands
-
-DESCRIPTION
-    Dynamically allocate memory slot for AT commands (conf3)
- 
-RETURNS
- 	void
-*/ 
-static void InitConfigMemoryAtCommands(uint16 atCmdsKeyLength)
-{    
-	/* Allocate memory for supported custom AT commands, malloc one extra word to ensure 
-       a string terminator is present should the data read from ps be incorrect */
-    theSink.conf3 = mallocPanic( sizeof(config_block3_t) + atCmdsKeyLength + 1);
-    /* ensure that all data is set as string terminator in case of incorrect pskey 
-       data being read */
-    memset(theSink.conf3, 0, (sizeof(config_block3_t) + atCmdsKeyLength + 1));
-	CONF_DEBUG(("INIT: Malloc size %d:\n", sizeof(config_block3_t) + atCmdsKeyLength ));
-}
-
-
 /****************************************************************************
 NAME 
  	InitConfigMemory
@@ -599,13 +493,12 @@ static void InitConfigMemory(lengths_config_type * keyLengths)
     /* initialise the memory block to 0 */    
     memset(theSink.conf2,0,sizeof(config_block2_t) + (keyLengths->no_tones * sizeof(tone_config_type)));
     
-    theSink.conf3 = NULL;
-    
-    /* Allocate memory for voice prompts config if required*/
-    if(keyLengths->no_tts || keyLengths->no_vp)
+    /* Allocate memory for voice prompts config if required, the TTS phrase table
+       is loaded on demand by the config cache */
+    if(keyLengths->no_vp)
     {
-        theSink.conf4 = mallocPanic( sizeof(config_block4_t) + (keyLengths->no_tts * sizeof(tts_config_type)));
-        CONF_DEBUG(("INIT: Malloc size %d:\n", sizeof(config_block4_t) + (keyLengths->no_tts * sizeof(tts_config_type))));
+        theSink.conf4 = mallocPanic( sizeof(config_block4_t) );
+        CONF_DEBUG(("INIT: Malloc size %d:\n", sizeof(config_block4_t)));
     }
     else
     {
@@ -614,22 +507,6 @@ static void InitConfigMemory(lengths_config_type * keyLengths)
 }
 
 
-/****************************************************************************
-NAME 
- 	configManagerAtCommands
-
-DESCRIPTION
-    Retrieve configurable AT command data from PS
- 
-RETURNS
- 	void
-*/ 
-static void configManagerAtCommands(uint16 length)
-{
-    ConfigRetrieve(theSink.config_id, PSKEY_AT_COMMANDS, theSink.conf3, length);
-}
-
-
 /****************************************************************************
 NAME 
  	configManagerPioMap
@@ -1083,6 +960,9 @@ void configManagerInit( void )
 
         /* Allocate the memory required for the configuration data */
     InitConfigMemory(keyLengths);
+
+        /* AT commands, TTS phrases and user tones are read from PS on first use */
+    configCacheInit();
     
   	    /* Read and configure the button translations */
   	configManagerButtonTranslations( );
@@ -1098,6 +978,7 @@ void configManagerInit( void )
 
         /*Read and configure the event tones*/
     configManagerEventTones( keyLengths->no_tones ) ;
+    TonesCacheInit( ) ;
         /* Read and configure the system features */
   	configManagerFeatureBlock( );	
                                                         
@@ -1107,9 +988,6 @@ void configManagerInit( void )
     /* Must happen between features and session data... */
     InitA2dp();  
  
-    /* Read and configure the user defined tones */    
-  	configManagerUserDefinedTones( keyLengths->userTonesLength );	
-
   	    /* Read and configure the LEDs */
     configManagerLEDS();
    
@@ -1130,8 +1008,6 @@ void configManagerInit( void )
         /* Read and configure the sniff sub-rate parameters */
 	configManagerSetupSsr ( ) ; 
 	
-    configManagerEventTTSPhrases( keyLengths->no_tts ) ;
-
     configManagerVoicePromptsInit( keyLengths->no_vp , keyLengths->no_tts_languages );
  
 #if defined (ENABLE_REMOTE) && defined (ENABLE_SOUNDBAR)
@@ -1139,13 +1015,6 @@ void configManagerInit( void )
     configManagerHidkeyMap();
  #endif
 
-    /* don't allocate memory for AT commands if they're not required */
-    if (keyLengths->size_at_commands)
-    {        
-        InitConfigMemoryAtCommands(keyLengths->size_at_commands);
-        configManagerAtCommands(keyLengths->size_at_commands + sizeof(config_block3_t) - 1);
-    }
-    
 #ifdef ENABLE_FM
     /* read the fm configuration data */
     configManagerReadFmData();
@@ -45,18 +45,16 @@ void csr2csrHandleAgBatteryRequestInd ( void )
 	MessageSend (&theSink.task , EventBatteryLevelRequest , 0 );
 }
 
-void csr2csrHandleAgBatteryRequestRes(uint8 idx)
+void csr2csrHandleAgBatteryRequestRes(uint8 percent)
 {
-    const unsigned char csr2csr_battery_level_indications[4] = {2,4,7,9};
+    /* the AG is sent a level from 0 to 9 */
+    uint16 batt_level = ((uint16)percent * 9 + 50) / 100;
     
-    CSR2CSR_DEBUG(("CSR2CSR BATTERY REQUEST RES %d", idx)) ;
-    if(idx < sizeof(csr2csr_battery_level_indications))
-    {
-        uint16 batt_level = csr2csr_battery_level_indications[idx];
-        CSR2CSR_DEBUG((" [%d]", batt_level)) ;
-        /* Attempt to send indication to both AGs (HFP will block if unsupported) */
-        HfpCsrFeaturesBatteryLevelRequest(hfp_primary_link, batt_level);
-        HfpCsrFeaturesBatteryLevelRequest(hfp_secondary_link, batt_level);
-    }
-    CSR2CSR_DEBUG(("\n")) ;
+    CSR2CSR_DEBUG(("CSR2CSR BATTERY REQUEST RES %d%% [%d]\n", percent, batt_level)) ;
+    if(batt_level > 9)
+        batt_level = 9;
+    
+    /* Attempt to send indication to both AGs (HFP will block if unsupported) */
+    HfpCsrFeaturesBatteryLevelRequest(hfp_primary_link, batt_level);
+    HfpCsrFeaturesBatteryLevelRequest(hfp_secondary_link, batt_level);
 }
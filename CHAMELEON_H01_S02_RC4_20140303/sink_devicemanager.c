@@ -37,6 +37,164 @@ NOTES
 #define PDI_ENTRY(pdi, x) (((x >= 4) ? (pdi[1] >> ((x-4) * 4)) : (pdi[0] >> (x*4))) & 0xf)
 #define PDI_ENTRY_UNUSED  (0xf)
 
+/* Message sent to the cache task once the cached attributes stop changing */
+#define ATTRIBUTE_CACHE_WRITE_BACK  (0)
+
+/* Attributes of a connected device held in RAM */
+typedef struct
+{
+    bdaddr          bd_addr;
+    sink_attributes attributes;
+    unsigned        valid:1;
+    unsigned        dirty:1;        /* attributes have changed since they were written to PS */
+    unsigned        unused:14;
+} attribute_cache_entry;
+
+static void deviceManagerAttributeCacheHandler(Task task, MessageId id, Message message);
+
+static attribute_cache_entry gAttributeCache[ATTRIBUTE_CACHE_SIZE];
+static TaskData gAttributeCacheTask = { deviceManagerAttributeCacheHandler };
+
+/* Connected devices and links, rebuilt by deviceManagerUpdateConnections so
+   the connection queries don't go to the profile libraries */
+typedef struct
+{
+    bdaddr      bd_addr[CONN_TABLE_SLOTS];          /* device in each slot */
+    conn_mask   profiles[CONN_TABLE_SLOTS];         /* links the device in each slot has */
+    uint8       link_slot[CONN_TABLE_LINKS];        /* slot + 1 of the device on each link, 0 if not connected */
+    Sink        a2dp_sink[MAX_A2DP_CONNECTIONS][2]; /* signalling and media sink of each A2DP link */
+    uint8       devices;                            /* number of slots in use */
+} conn_table_t;
+
+static conn_table_t gConnTable;
+
+
+/****************************************************************************
+NAME    
+    deviceManagerCacheFind
+    
+DESCRIPTION
+    Find the cached attributes of a device
+
+RETURNS
+    the cache entry, NULL if the device is not cached
+*/
+static attribute_cache_entry* deviceManagerCacheFind(const bdaddr* dev_addr)
+{
+    uint8 i;
+    
+    for(i = 0; i < ATTRIBUTE_CACHE_SIZE; i++)
+    {
+        if(gAttributeCache[i].valid && BdaddrIsSame(&gAttributeCache[i].bd_addr, dev_addr))
+            return &gAttributeCache[i];
+    }
+    return NULL;
+}
+
+
+/****************************************************************************
+NAME    
+    deviceManagerWriteAttributes
+    
+DESCRIPTION
+    Write attributes to PS
+
+RETURNS
+    void
+*/
+static void deviceManagerWriteAttributes(sink_attributes* attributes, const bdaddr* dev_addr)
+{
+#ifdef ENABLE_SHAREME
+    DEV_DEBUG(("DEV: StoreAttribs   - profiles %d, peer %d, hfp_vol %d, a2dp_vol %d\n", attributes->profiles, attributes->peer_device, attributes->hfp.volume,attributes->a2dp.volume));
+#else
+    DEV_DEBUG(("DEV: StoreAttribs   - profiles %d, hfp_vol %d, a2dp_vol %d\n", attributes->profiles, attributes->hfp.volume,attributes->a2dp.volume));
+#endif
+    ConnectionSmPutAttribute(PSKEY_ATTRIBUTE_BASE, dev_addr, sizeof(sink_attributes), (uint8*)attributes); 
+}
+
+
+/****************************************************************************
+NAME    
+    deviceManagerCacheWriteBack
+    
+DESCRIPTION
+    Write a cache entry to PS if it has changed
+
+RETURNS
+    void
+*/
+static void deviceManagerCacheWriteBack(attribute_cache_entry* entry)
+{
+    if(entry && entry->valid && entry->dirty)
+    {
+        DEV_DEBUG(("DEV: Cache write back %04x,%02x,%06lx\n", entry->bd_addr.nap, entry->bd_addr.uap, entry->bd_addr.lap));
+        deviceManagerWriteAttributes(&entry->attributes, &entry->bd_addr);
+        entry->dirty = FALSE;
+    }
+}
+
+
+/****************************************************************************
+NAME    
+    deviceManagerCacheAdd
+    
+DESCRIPTION
+    Cache the attributes of a device, writing back the attributes of a
+    device that is no longer connected (or failing that the first entry)
+    to make room
+
+RETURNS
+    the cache entry
+*/
+static attribute_cache_entry* deviceManagerCacheAdd(const bdaddr* dev_addr, const sink_attributes* attributes)
+{
+    attribute_cache_entry* entry = NULL;
+    uint8 i;
+    
+    for(i = 0; (i < ATTRIBUTE_CACHE_SIZE) && !entry; i++)
+    {
+        if(!gAttributeCache[i].valid)
+            entry = &gAttributeCache[i];
+    }
+    for(i = 0; (i < ATTRIBUTE_CACHE_SIZE) && !entry; i++)
+    {
+        if(!deviceManagerProfilesConnected(&gAttributeCache[i].bd_addr))
+            entry = &gAttributeCache[i];
+    }
+    if(!entry)
+        entry = &gAttributeCache[0];
+    
+    deviceManagerCacheWriteBack(entry);
+    
+    entry->bd_addr    = *dev_addr;
+    entry->attributes = *attributes;
+    entry->valid      = TRUE;
+    entry->dirty      = TRUE;
+    
+    return entry;
+}
+
+
+/****************************************************************************
+NAME    
+    deviceManagerAttributeCacheHandler
+    
+DESCRIPTION
+    Message handler for the attribute cache
+
+RETURNS
+    void
+*/
+static void deviceManagerAttributeCacheHandler(Task task, MessageId id, Message message)
+{
+    if(id == ATTRIBUTE_CACHE_WRITE_BACK)
+    {
+        DEV_DEBUG(("DEV: Cache idle\n"));
+        deviceManagerFlushAttributes();
+    }
+}
+
+
 /****************************************************************************
 NAME    
     deviceManagerGetDefaultAttributes
@@ -89,6 +247,15 @@ bool deviceManagerGetAttributes(sink_attributes* attributes, const bdaddr* dev_a
 {
     /* NULL is valid if we just want to check dev is in PDL */
     uint8 size = (attributes ? sizeof(sink_attributes) : 0);
+    attribute_cache_entry* entry = deviceManagerCacheFind(dev_addr);
+    
+    /* Cached attributes are newer than those in PS */
+    if(entry)
+    {
+        if(attributes)
+            *attributes = entry->attributes;
+        return TRUE;
+    }
     /* Attempt to retrieve attributes from PS */
     return ConnectionSmGetAttributeNow(PSKEY_ATTRIBUTE_BASE, dev_addr, size, (uint8*)attributes);
 }
@@ -106,7 +273,17 @@ RETURNS
 */
 bool deviceManagerGetIndexedAttributes(uint8 index, sink_attributes* attributes, typed_bdaddr* dev_addr)
 {
-    return ConnectionSmGetIndexedAttributeNowReq(PSKEY_ATTRIBUTE_BASE, index, sizeof(sink_attributes), (uint8*)attributes, dev_addr);
+    attribute_cache_entry* entry;
+    
+    if(!ConnectionSmGetIndexedAttributeNowReq(PSKEY_ATTRIBUTE_BASE, index, sizeof(sink_attributes), (uint8*)attributes, dev_addr))
+        return FALSE;
+    
+    /* Cached attributes are newer than those in PS */
+    entry = deviceManagerCacheFind(&dev_addr->addr);
+    if(entry && attributes)
+        *attributes = entry->attributes;
+    
+    return TRUE;
 }
 
 /****************************************************************************
@@ -114,19 +291,82 @@ NAME
     deviceManagerStoreAttributes
     
 DESCRIPTION
-    Stores given attribute values against a given device in PS.
+    Stores given attribute values against a given device. The attributes of
+    a connected device are cached and written back to PS later, those of
+    any other device are written to PS straight away.
 
 RETURNS
     void
 */
 void deviceManagerStoreAttributes(sink_attributes* attributes, const bdaddr* dev_addr)
 {
-#ifdef ENABLE_SHAREME
-    DEV_DEBUG(("DEV: StoreAttribs   - profiles %d, peer %d, hfp_vol %d, a2dp_vol %d\n", attributes->profiles, attributes->peer_device, attributes->hfp.volume,attributes->a2dp.volume));
-#else
-    DEV_DEBUG(("DEV: StoreAttribs   - profiles %d, hfp_vol %d, a2dp_vol %d\n", attributes->profiles, attributes->hfp.volume,attributes->a2dp.volume));
-#endif
-    ConnectionSmPutAttribute(PSKEY_ATTRIBUTE_BASE, dev_addr, sizeof(sink_attributes), (uint8*)attributes); 
+    attribute_cache_entry* entry = deviceManagerCacheFind(dev_addr);
+    
+    if(entry)
+    {
+        if(memcmp(&entry->attributes, attributes, sizeof(sink_attributes)) == 0)
+            return;
+        entry->attributes = *attributes;
+        entry->dirty = TRUE;
+    }
+    else if(deviceManagerProfilesConnected(dev_addr))
+    {
+        deviceManagerCacheAdd(dev_addr, attributes);
+    }
+    else
+    {
+        deviceManagerWriteAttributes(attributes, dev_addr);
+        return;
+    }
+    
+    DEV_DEBUG(("DEV: Cached attributes changed\n"));
+    
+    /* Write back once the attributes stop changing */
+    MessageCancelAll(&gAttributeCacheTask, ATTRIBUTE_CACHE_WRITE_BACK);
+    MessageSendLater(&gAttributeCacheTask, ATTRIBUTE_CACHE_WRITE_BACK, 0, ATTRIBUTE_WRITE_BACK_DELAY);
+}
+
+
+/****************************************************************************
+NAME
+    deviceManagerFlushAttributes
+*/
+void deviceManagerFlushAttributes(void)
+{
+    uint8 i;
+    
+    MessageCancelAll(&gAttributeCacheTask, ATTRIBUTE_CACHE_WRITE_BACK);
+    
+    for(i = 0; i < ATTRIBUTE_CACHE_SIZE; i++)
+        deviceManagerCacheWriteBack(&gAttributeCache[i]);
+}
+
+
+/****************************************************************************
+NAME
+    deviceManagerRemoveDevice
+*/
+void deviceManagerRemoveDevice(const bdaddr* dev_addr)
+{
+    attribute_cache_entry* entry = deviceManagerCacheFind(dev_addr);
+    
+    if(entry)
+        entry->valid = FALSE;
+    
+    ConnectionSmDeleteAuthDevice(dev_addr);
+}
+
+
+/****************************************************************************
+NAME
+    deviceManagerRemoveAllDevices
+*/
+void deviceManagerRemoveAllDevices(void)
+{
+    MessageCancelAll(&gAttributeCacheTask, ATTRIBUTE_CACHE_WRITE_BACK);
+    memset(gAttributeCache, 0, sizeof(gAttributeCache));
+    
+    ConnectionSmDeleteAllAuthDevices(PSKEY_ATTRIBUTE_BASE);
 }
 
 
@@ -223,6 +463,7 @@ void deviceManagerUpdateAttributes(const bdaddr* bd_addr, sink_link_type link_ty
         update->attributes.profiles = sink_a2dp;
         update->attributes.a2dp.volume = theSink.a2dp_link_data->gAvVolumeLevel[a2dp_priority];
         update->attributes.a2dp.clock_mismatch = theSink.a2dp_link_data->clockMismatchRate[a2dp_priority];
+        update->attributes.a2dp_drift = theSink.a2dp_link_data->clockDrift[a2dp_priority];
     }
 #ifdef ENABLE_SUBWOOFER
     else if(link_type == sink_swat)
@@ -273,6 +514,7 @@ void deviceManagerDelayedUpdateAttributes(EVENT_UPDATE_ATTRIBUTES_T* update)
         new_attributes.profiles |= sink_a2dp;
         new_attributes.a2dp.volume = update->attributes.a2dp.volume;
         new_attributes.a2dp.clock_mismatch = update->attributes.a2dp.clock_mismatch;
+        new_attributes.a2dp_drift = update->attributes.a2dp_drift;
     }
 #ifdef ENABLE_SUBWOOFER
     else if(update->attributes.profiles == sink_swat)
@@ -289,6 +531,10 @@ void deviceManagerDelayedUpdateAttributes(EVENT_UPDATE_ATTRIBUTES_T* update)
     /* Write updated attributes to PS */
     if(!deviceManagerCompareAttributes(&attributes, &new_attributes))
         deviceManagerStoreAttributes(&new_attributes, &update->bd_addr);
+    
+    /* Attributes are updated as a device disconnects, don't keep them cached once it has gone */
+    if(!deviceManagerProfilesConnected(&update->bd_addr))
+        deviceManagerCacheWriteBack(deviceManagerCacheFind(&update->bd_addr));
 }
 
 
@@ -373,15 +619,15 @@ uint8 deviceManagerSetPriority(const bdaddr* dev_addr)
 
 /****************************************************************************
 NAME    
-    deviceManagerGetProfileAddr
+    deviceManagerReadProfileAddr
     
 DESCRIPTION
-    Get bluetooth address from connection mask
+    Get bluetooth address from connection mask, from the profile link data
 
 RETURNS
     TRUE if connection is valid, otherwise FALSE
 */
-static bool deviceManagerGetProfileAddr(conn_mask mask, bdaddr* dev_addr)
+static bool deviceManagerReadProfileAddr(conn_mask mask, bdaddr* dev_addr)
 {
     if(mask & conn_hfp)
     {
@@ -391,7 +637,7 @@ static bool deviceManagerGetProfileAddr(conn_mask mask, bdaddr* dev_addr)
         if(theSink.profile_data[PROFILE_INDEX(hfp)].status.connected)        
             return HfpLinkGetBdaddr(hfp, dev_addr);
     }
-    else if(mask & conn_a2dp)
+    else if((mask & conn_a2dp) && theSink.a2dp_link_data)
     {
         /* Get bluetooth address for this profile if connected */
         a2dp_link_priority a2dp = ((mask & conn_a2dp_pri) ? a2dp_primary : a2dp_secondary);
@@ -408,6 +654,160 @@ static bool deviceManagerGetProfileAddr(conn_mask mask, bdaddr* dev_addr)
 }
 
 
+/****************************************************************************
+NAME    
+    deviceManagerBuildConnTable
+    
+DESCRIPTION
+    Fill in a connection table from the profile link data
+
+RETURNS
+    void
+*/
+static void deviceManagerBuildConnTable(conn_table_t* table)
+{
+    bdaddr dev_addr;
+    uint8 link;
+    uint8 slot;
+    
+    memset(table, 0, sizeof(conn_table_t));
+    
+    for(link = 0; link < CONN_TABLE_LINKS; link++)
+    {
+        conn_mask mask = (conn_mask)(1 << link);
+        
+        if(deviceManagerReadProfileAddr(mask, &dev_addr))
+        {
+            /* A device with more than one link has one slot */
+            for(slot = 0; slot < table->devices; slot++)
+            {
+                if(BdaddrIsSame(&table->bd_addr[slot], &dev_addr))
+                    break;
+            }
+            if(slot == table->devices)
+            {
+                table->bd_addr[slot] = dev_addr;
+                table->devices++;
+            }
+            table->profiles[slot] |= mask;
+            table->link_slot[link] = slot + 1;
+        }
+    }
+    
+    if(theSink.a2dp_link_data)
+    {
+        uint16 a2dp;
+        
+        for_all_a2dp(a2dp)
+        {
+            if(theSink.a2dp_link_data->connected[a2dp])
+            {
+                uint16 device_id = theSink.a2dp_link_data->device_id[a2dp];
+                table->a2dp_sink[a2dp][0] = A2dpSignallingGetSink(device_id);
+                table->a2dp_sink[a2dp][1] = A2dpMediaGetSink(device_id, theSink.a2dp_link_data->stream_id[a2dp]);
+            }
+        }
+    }
+}
+
+
+#ifdef DEBUG_DEV
+/****************************************************************************
+NAME    
+    deviceManagerCheckConnTable
+    
+DESCRIPTION
+    Compare the connection table with the profile link data and report a
+    missing deviceManagerUpdateConnections call
+
+RETURNS
+    void
+*/
+static void deviceManagerCheckConnTable(const char* caller)
+{
+    conn_table_t current;
+    
+    deviceManagerBuildConnTable(&current);
+    
+    if(memcmp(&current, &gConnTable, sizeof(conn_table_t)) != 0)
+    {
+        DEV_DEBUG(("DEV: Connection table out of date in %s, devices %d (expected %d)\n", caller, gConnTable.devices, current.devices));
+    }
+}
+#define CHECK_CONN_TABLE(caller) deviceManagerCheckConnTable(caller)
+#else
+#define CHECK_CONN_TABLE(caller)
+#endif
+
+
+/****************************************************************************
+NAME    
+    deviceManagerUpdateConnections
+*/
+void deviceManagerUpdateConnections(void)
+{
+    deviceManagerBuildConnTable(&gConnTable);
+    DEV_DEBUG(("DEV: Connection table devices %d links %x %x\n", gConnTable.devices, gConnTable.profiles[0], gConnTable.profiles[1]));
+}
+
+
+/****************************************************************************
+NAME    
+    deviceManagerGetProfileAddr
+    
+DESCRIPTION
+    Get bluetooth address from connection mask
+
+RETURNS
+    TRUE if connection is valid, otherwise FALSE
+*/
+static bool deviceManagerGetProfileAddr(conn_mask mask, bdaddr* dev_addr)
+{
+    uint8 link;
+    
+    CHECK_CONN_TABLE("GetProfileAddr");
+    
+    /* As for the link data, HFP is used if the mask has both */
+    if(mask & conn_hfp)
+        link = ((mask & conn_hfp_pri) ? 0 : 1);
+    else if(mask & conn_a2dp)
+        link = ((mask & conn_a2dp_pri) ? 2 : 3);
+    else
+        return FALSE;
+    
+    if(!gConnTable.link_slot[link])
+        return FALSE;
+    
+    *dev_addr = gConnTable.bd_addr[gConnTable.link_slot[link] - 1];
+    return TRUE;
+}
+
+
+/****************************************************************************
+NAME    
+    deviceManagerGetA2dpIndexFromSink
+*/
+bool deviceManagerGetA2dpIndexFromSink(Sink sink, uint16 * index)
+{
+    uint16 a2dp;
+    
+    CHECK_CONN_TABLE("GetA2dpIndexFromSink");
+    
+    if(!sink)
+        return FALSE;
+    
+    for_all_a2dp(a2dp)
+    {
+        if((gConnTable.a2dp_sink[a2dp][0] == sink) || (gConnTable.a2dp_sink[a2dp][1] == sink))
+        {
+            *index = a2dp;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
 /****************************************************************************
 NAME    
     deviceManagerProfilesConnected
@@ -420,18 +820,17 @@ RETURNS
 */
 conn_mask deviceManagerProfilesConnected(const bdaddr * bd_addr)
 {
-    bdaddr dev_addr;
-    conn_mask mask, result = 0;
+    conn_mask result = 0;
+    uint8 slot;
     
-    /* Go through all profiles */
-    for(mask = conn_hfp_pri; mask <= conn_a2dp_sec; mask <<=1)
+    CHECK_CONN_TABLE("ProfilesConnected");
+    
+    for(slot = 0; slot < gConnTable.devices; slot++)
     {
-        /* Get bluetooth address for profile if connected */
-        if(deviceManagerGetProfileAddr(mask, &dev_addr))
+        if(BdaddrIsSame(bd_addr, &gConnTable.bd_addr[slot]))
         {
-            /* If address matches device passed in... */
-            if(BdaddrIsSame(bd_addr, &dev_addr))
-                result |= mask;
+            result = gConnTable.profiles[slot];
+            break;
         }
     }
     DEV_DEBUG(("DEV: profiles connected bdaddr %x %x %x Conn Mask %X\n", (uint16)bd_addr->nap,(uint16)bd_addr->uap,(uint16)bd_addr->lap,result));
@@ -450,22 +849,10 @@ RETURNS
 */
 uint8 deviceManagerNumConnectedDevs(void)
 {
-    conn_mask mask;
-    bdaddr dev_addr;
-    uint8 no_devices = 0;
-    /* Go through all profiles */
-    for(mask = conn_hfp_pri; mask <= conn_a2dp_sec; mask <<=1)
-    {
-        /* Get bluetooth address for profile if connected */
-        if(deviceManagerGetProfileAddr(mask, &dev_addr))
-        {
-            /* If HFP connection, or A2DP connection on device with no HFP... */
-            if( (mask & conn_hfp) || (!(conn_hfp & deviceManagerProfilesConnected(&dev_addr))) )
-                no_devices++;
-        }
-    }
-    DEV_DEBUG(("DEV: Conn Count %d\n", no_devices));
-    return no_devices;
+    CHECK_CONN_TABLE("NumConnectedDevs");
+    
+    DEV_DEBUG(("DEV: Conn Count %d\n", gConnTable.devices));
+    return gConnTable.devices;
 }
 
 
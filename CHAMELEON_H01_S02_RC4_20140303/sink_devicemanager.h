@@ -12,9 +12,16 @@ DESCRIPTION
 #define _SINK_DEVICEMANAGER_H_
 
 #include <connection.h>
+#include "sink_clock_drift.h"
 
 #define PSKEY_ATTRIBUTE_BASE        (42)
 
+/* Attributes of connected devices are held in RAM and written to PS once
+   they have not changed for ATTRIBUTE_WRITE_BACK_DELAY, when the device
+   disconnects or at power off */
+#define ATTRIBUTE_CACHE_SIZE        (2)
+#define ATTRIBUTE_WRITE_BACK_DELAY  (10000)   /* ms */
+
 /* Link types the sink device supports */
 typedef enum
 {
@@ -35,7 +42,7 @@ typedef struct
 typedef struct
 {
     uint8  volume;
-    uint16 clock_mismatch;
+    uint16 clock_mismatch;              /* learned clock mismatch rate */
     uint16 audio_enhancements;
 } a2dp_attributes;
 
@@ -45,19 +52,33 @@ typedef struct
     uint8 sub_trim;    
 } sub_attributes;
 
-/* All device attributes stored in PS */
+/* Reconnection statistics */
+typedef struct
+{
+    unsigned page_history:8;        /* outcome of recent connection attempts, newest in bit 0, set if connected */
+    unsigned page_attempts:4;       /* number of outcomes held in page_history */
+    unsigned link_loss:4;           /* recent link losses, halved each time the device connects */
+} reconnect_attributes;
+
+/* All device attributes stored in PS. Records are read back at the size
+   of this structure, so new fields are added at the end where a record
+   stored before them leaves the defaults in place. */
 typedef struct
 {
 #ifdef ENABLE_PEER
-    unsigned            :10;
+    unsigned            :8;
     remote_device       peer_device:2;
 #else
-    unsigned            :12;
+    unsigned            :10;
 #endif
+    unsigned            low_latency:1;      /* stream a2dp in low latency mode */
+    unsigned            report_delay:1;     /* report the a2dp delay to the source */
     sink_link_type      profiles:4;
     hfp_attributes      hfp;
     a2dp_attributes     a2dp;
     sub_attributes      sub;
+    reconnect_attributes reconnect;
+    clock_drift_model   a2dp_drift;         /* confidence in a2dp.clock_mismatch */
 } sink_attributes;
 
 
@@ -80,6 +101,10 @@ typedef enum
 #define conn_hfp  (conn_hfp_pri | conn_hfp_sec)
 #define conn_a2dp (conn_a2dp_pri | conn_a2dp_sec)
 
+/* Connection table, one link for each conn_mask bit and at most one device per link */
+#define CONN_TABLE_LINKS    (4)
+#define CONN_TABLE_SLOTS    CONN_TABLE_LINKS
+
 
 /****************************************************************************
 NAME    
@@ -125,7 +150,9 @@ NAME
     deviceManagerStoreAttributes
     
 DESCRIPTION
-    Stores given attribute values against a given device in PS.
+    Stores given attribute values against a given device. The attributes of
+    a connected device are cached and written back to PS later, those of
+    any other device are written to PS straight away.
 
 RETURNS
     void
@@ -133,6 +160,19 @@ RETURNS
 void deviceManagerStoreAttributes(sink_attributes* attributes, const bdaddr* dev_addr);
 
 
+/****************************************************************************
+NAME
+    deviceManagerFlushAttributes
+    
+DESCRIPTION
+    Write any cached attributes that have changed to PS
+
+RETURNS
+    void
+*/
+void deviceManagerFlushAttributes(void);
+
+
 /****************************************************************************
 NAME
     deviceManagerStoreDefaultAttributes
@@ -202,12 +242,12 @@ NAME
     deviceManagerRemoveDevice
     
 DESCRIPTION
-    Remove given device from the PDL
+    Remove given device from the PDL, discarding any cached attributes
 
 RETURNS
     void
 */
-#define deviceManagerRemoveDevice(dev_addr) ConnectionSmDeleteAuthDevice(dev_addr)
+void deviceManagerRemoveDevice(const bdaddr* dev_addr);
 
 
 /****************************************************************************
@@ -215,12 +255,41 @@ NAME
     deviceManagerRemoveAllDevices
     
 DESCRIPTION
-    Remove all devices from the PDL
+    Remove all devices from the PDL, discarding any cached attributes
 
 RETURNS
     void
 */
-#define deviceManagerRemoveAllDevices() ConnectionSmDeleteAllAuthDevices(PSKEY_ATTRIBUTE_BASE)
+void deviceManagerRemoveAllDevices(void);
+
+
+/****************************************************************************
+NAME    
+    deviceManagerUpdateConnections
+    
+DESCRIPTION
+    Rebuild the connection table from the HFP and A2DP link data. Must be
+    called whenever an HFP or A2DP link, or an A2DP media channel, is
+    connected, released or moves to another link priority, before any of
+    the connection queries below are made.
+
+RETURNS
+    void
+*/
+void deviceManagerUpdateConnections(void);
+
+
+/****************************************************************************
+NAME    
+    deviceManagerGetA2dpIndexFromSink
+    
+DESCRIPTION
+    Find the A2DP link using a signalling or media sink
+
+RETURNS
+    TRUE and the link in index if found, otherwise FALSE
+*/
+bool deviceManagerGetA2dpIndexFromSink(Sink sink, uint16 * index);
 
 
 /****************************************************************************
@@ -0,0 +1,233 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_energy.c
+
+DESCRIPTION
+    Energy accounting per consumer. The charge drawn by a consumer is
+    counted up to the clock each time any consumer changes state and when
+    the hour rolls over, so a total only ever covers time at one current.
+    Charge short of a whole 10uAh is carried over to the next count.
+
+*/
+
+#include "sink_energy.h"
+#include "sink_fuel_gauge.h"
+#include "sink_private.h"
+
+#include <ps.h>
+#include <vm.h>
+#include <string.h>
+
+
+#ifdef DEBUG_ENERGY
+#define ENERGY_DEBUG(x) DEBUG(x)
+#else
+#define ENERGY_DEBUG(x)
+#endif
+
+#define ENERGY_HOUR_MSG                 (0)
+
+#define ENERGY_HOUR_MS                  (3600000UL)
+
+/* 10uA for a second, and for a millisecond, in 10uAh */
+#define ENERGY_SECONDS_PER_UNIT         (3600UL)
+#define ENERGY_MS_PER_UNIT              (3600000UL)
+
+/* Current for one unit of each consumer in 10uA, used until set over GAIA */
+static const uint16 gDefaultCurrents[energy_num_consumers] =
+{
+    50,                                                         /* pedometer */
+    17,                                                         /* accelerometer */
+    FUEL_GAUGE_EL_PANEL_MA * 100,                               /* el panel */
+    FUEL_GAUGE_VIBRATOR_MA * 100,                               /* vibrator */
+    200,                                                        /* leds */
+    (FUEL_GAUGE_SCO_MA - FUEL_GAUGE_IDLE_MA) * 100,             /* voice */
+    (FUEL_GAUGE_MEDIA_MA - FUEL_GAUGE_IDLE_MA) * 100,           /* media */
+    1000,                                                       /* inquiry */
+    1                                                           /* remote */
+};
+
+typedef struct
+{
+    uint16      current[energy_num_consumers];  /* 10uA per unit */
+    uint16      units[energy_num_consumers];    /* units on */
+    uint32      residue[energy_num_consumers];  /* 10uA ms not yet a whole 10uAh */
+    uint16      hour[ENERGY_HOURS][energy_num_consumers];   /* 10uAh */
+    uint32      last_count;                     /* clock counted up to */
+    uint32      hour_start;                     /* clock the hour in progress began */
+    unsigned    current_hour:8;                 /* entry of hour in progress */
+    unsigned    hours_held:7;
+    unsigned    started:1;
+} energy_t;
+
+static void energyHandler(Task task, MessageId id, Message message);
+
+static TaskData gEnergyTask = { energyHandler };
+static energy_t gEnergy;
+
+
+/****************************************************************************
+NAME
+  	energyStart
+
+DESCRIPTION
+  	Load the current figures and start the hour timer the first time a
+    consumer is seen
+
+RETURNS
+  	void
+*/
+static void energyStart( void )
+{
+    if(gEnergy.started)
+        return;
+
+    if(PsRetrieve(PSKEY_ENERGY_CURRENTS, gEnergy.current, sizeof(gEnergy.current)) != sizeof(gEnergy.current))
+        memmove(gEnergy.current, gDefaultCurrents, sizeof(gEnergy.current));
+
+    gEnergy.started     = TRUE;
+    gEnergy.hours_held  = 1;
+    gEnergy.last_count  = VmGetClock();
+    gEnergy.hour_start  = gEnergy.last_count;
+
+    MessageSendLater(&gEnergyTask, ENERGY_HOUR_MSG, 0, ENERGY_HOUR_MS);
+}
+
+/****************************************************************************
+NAME
+  	energyCount
+
+DESCRIPTION
+  	Add the charge drawn since the last count by each consumer on to the
+    hour in progress
+
+RETURNS
+  	void
+*/
+static void energyCount( void )
+{
+    uint32 now = VmGetClock();
+    uint32 elapsed = now - gEnergy.last_count;
+    uint32 seconds = elapsed / 1000;
+    uint32 ms = elapsed % 1000;
+    uint16 * totals = gEnergy.hour[gEnergy.current_hour];
+    uint32 draw;
+    uint32 charge;
+    uint16 i;
+
+    gEnergy.last_count = now;
+
+    for(i = 0; i < energy_num_consumers; i++)
+    {
+        if(!gEnergy.units[i])
+            continue;
+
+        draw = (uint32)gEnergy.current[i] * gEnergy.units[i];
+
+        /* whole seconds first so a long stretch can not overflow */
+        charge = seconds * draw;
+        gEnergy.residue[i] += (charge % ENERGY_SECONDS_PER_UNIT) * 1000 + ms * draw;
+        charge = (charge / ENERGY_SECONDS_PER_UNIT) + (gEnergy.residue[i] / ENERGY_MS_PER_UNIT);
+        gEnergy.residue[i] %= ENERGY_MS_PER_UNIT;
+
+        totals[i] = ((0xFFFF - totals[i]) > charge) ? (uint16)(totals[i] + charge) : 0xFFFF;
+    }
+}
+
+/****************************************************************************
+NAME
+  	energyHandler
+
+DESCRIPTION
+  	Close the hour in progress and start the next
+
+RETURNS
+  	void
+*/
+static void energyHandler(Task task, MessageId id, Message message)
+{
+    if(id != ENERGY_HOUR_MSG)
+        return;
+
+    energyCount();
+
+    gEnergy.current_hour = (gEnergy.current_hour + 1) % ENERGY_HOURS;
+    memset(gEnergy.hour[gEnergy.current_hour], 0, sizeof(gEnergy.hour[0]));
+    gEnergy.hour_start = gEnergy.last_count;
+    if(gEnergy.hours_held < ENERGY_HOURS)
+        gEnergy.hours_held++;
+
+    ENERGY_DEBUG(("ENERGY: %lu hour %d\n", gEnergy.last_count, gEnergy.current_hour));
+
+    MessageSendLater(&gEnergyTask, ENERGY_HOUR_MSG, 0, ENERGY_HOUR_MS);
+}
+
+
+/****************************************************************************
+NAME
+  	energyConsumerSet
+*/
+void energyConsumerSet( energy_consumer consumer, uint16 units )
+{
+    energyStart();
+
+    if(units != gEnergy.units[consumer])
+    {
+        energyCount();
+        gEnergy.units[consumer] = units;
+
+        /* clock, consumer and units, enough to replay the log offline */
+        ENERGY_DEBUG(("ENERGY: %lu %d %d\n", gEnergy.last_count, consumer, units));
+    }
+}
+
+/****************************************************************************
+NAME
+  	energyGetHourTotals
+*/
+uint16 energyGetHourTotals( uint16 hours_ago, uint16 * totals )
+{
+    uint16 minutes;
+
+    if(!gEnergy.started || (hours_ago >= gEnergy.hours_held))
+        return 0;
+
+    energyCount();
+
+    if(hours_ago)
+        minutes = 60;
+    else
+        minutes = (uint16)((gEnergy.last_count - gEnergy.hour_start) / 60000) + 1;
+
+    memmove(totals, gEnergy.hour[(gEnergy.current_hour + ENERGY_HOURS - hours_ago) % ENERGY_HOURS],
+            sizeof(gEnergy.hour[0]));
+
+    return minutes;
+}
+
+/****************************************************************************
+NAME
+  	energyGetCurrent
+*/
+uint16 energyGetCurrent( energy_consumer consumer )
+{
+    energyStart();
+    return gEnergy.current[consumer];
+}
+
+/****************************************************************************
+NAME
+  	energySetCurrent
+*/
+bool energySetCurrent( energy_consumer consumer, uint16 current )
+{
+    energyStart();
+
+    /* count what was drawn at the old figure first */
+    energyCount();
+    gEnergy.current[consumer] = current;
+
+    return PsStore(PSKEY_ENERGY_CURRENTS, gEnergy.current, sizeof(gEnergy.current)) == sizeof(gEnergy.current);
+}
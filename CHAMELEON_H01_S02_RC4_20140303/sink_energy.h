@@ -0,0 +1,97 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_energy.h
+
+DESCRIPTION
+    Energy accounting per consumer. Each consumer reports when it is
+    switched on and off, and the charge it draws is worked out from the
+    time it was on and a current figure held for it. Totals are kept for
+    each of the last ENERGY_HOURS hours so the features draining the
+    battery can be read back over GAIA. The current figures can be changed
+    over GAIA and are kept in PS.
+
+*/
+#ifndef _SINK_ENERGY_H_
+#define _SINK_ENERGY_H_
+
+#include <csrtypes.h>
+
+
+/* PS key the current figures are kept in, not contiguous with the
+   configuration keys */
+#define PSKEY_ENERGY_CURRENTS           (36)
+
+/* hours of totals kept, including the one in progress */
+#define ENERGY_HOURS                    (8)
+
+/* The consumers accounted for */
+typedef enum
+{
+    energy_consumer_pedometer,          /* accelerometer sampling loop */
+    energy_consumer_accelerometer,      /* MMA845x active */
+    energy_consumer_el_panel,
+    energy_consumer_vibrator,
+    energy_consumer_leds,               /* per LED lit */
+    energy_consumer_voice,              /* SCO audio routed */
+    energy_consumer_media,              /* a2dp, usb, wired or fm audio routed */
+    energy_consumer_inquiry,
+    energy_consumer_remote,             /* per BLE remote connection event each second */
+    energy_num_consumers
+} energy_consumer;
+
+
+/****************************************************************************
+NAME
+    energyConsumerSet
+
+DESCRIPTION
+    Note a consumer changing state, units is the number of the consumer
+    on, 0 when it is off
+
+RETURNS
+    void
+*/
+void energyConsumerSet( energy_consumer consumer, uint16 units );
+
+/****************************************************************************
+NAME
+    energyGetHourTotals
+
+DESCRIPTION
+    Get the charge drawn by each consumer in an hour, hours_ago 0 being the
+    hour in progress. totals must hold energy_num_consumers entries, each
+    in units of 10uAh.
+
+RETURNS
+    minutes of the hour accounted, 0 if the hour is not held
+*/
+uint16 energyGetHourTotals( uint16 hours_ago, uint16 * totals );
+
+/****************************************************************************
+NAME
+    energyGetCurrent
+
+DESCRIPTION
+    Get the current figure for one unit of a consumer
+
+RETURNS
+    the current in units of 10uA
+*/
+uint16 energyGetCurrent( energy_consumer consumer );
+
+/****************************************************************************
+NAME
+    energySetCurrent
+
+DESCRIPTION
+    Change the current figure for one unit of a consumer, in units of 10uA,
+    and store the figures in PS
+
+RETURNS
+    TRUE if the figures were stored
+*/
+bool energySetCurrent( energy_consumer consumer, uint16 current );
+
+#endif /* _SINK_ENERGY_H_ */
@@ -0,0 +1,487 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_fuel_gauge.c
+
+DESCRIPTION
+    Battery fuel gauge. Charge is held in hundredths of a percent and
+    counted down at the current of the load in place since the last update,
+    with the part of a hundredth not yet used carried to the next update.
+    Each reading moves it part of the way towards the charge read from the
+    discharge curve, a quarter of the way with nothing loading the battery
+    and a sixteenth otherwise. The percentage reported never rises while the
+    battery is discharging.
+
+*/
+
+#include "sink_fuel_gauge.h"
+#include "sink_private.h"
+
+#include <vm.h>
+
+
+#ifdef DEBUG_POWER
+#define GAUGE_DEBUG(x) DEBUG(x)
+#else
+#define GAUGE_DEBUG(x)
+#endif
+
+#define FUEL_GAUGE_FULL                 (10000)
+
+/* longest time counted in one step, avoids overflow after long gaps */
+#define FUEL_GAUGE_MAX_STEP_MS          (3600000UL)
+
+/* a hundredth of a percent of the capacity in mA ms */
+#define FUEL_GAUGE_UNIT_MA_MS           ((uint32)FUEL_GAUGE_CAPACITY_MAH * 360)
+
+/* the average current is held in 1/256 mA */
+#define FUEL_GAUGE_AVERAGE_SCALE        (256)
+
+/* Point on the discharge curve, voltage in thousandths of the way from
+   the critical voltage to the termination voltage */
+typedef struct
+{
+    uint16      voltage;
+    uint16      percent;
+} fuel_gauge_point;
+
+static const fuel_gauge_point gDischargeCurve[] =
+{
+    {   0,   0},
+    { 250,   2},
+    { 500,  10},
+    { 583,  40},
+    { 667,  60},
+    { 750,  75},
+    { 833,  85},
+    { 917,  95},
+    {1000, 100}
+};
+
+typedef struct
+{
+    uint32      last_update;        /* clock the charge was last counted to */
+    uint32      residue;            /* mA ms counted but not yet a whole 1/100 percent */
+    uint32      period_charge;      /* mA ms drawn in the averaging period in progress */
+    uint32      period_ms;          /* time into the averaging period */
+    uint16      charge;             /* in 1/100 percent */
+    uint16      voltage;            /* filtered, load corrected, in mV */
+    uint16      average;            /* average discharge current in 1/256 mA */
+    uint8       percent;            /* reported charge */
+    unsigned    valid:1;            /* a reading has been taken */
+    unsigned    charging:1;
+    unsigned    load:2;             /* fuel_gauge_load */
+    unsigned    accessories:2;      /* bit per fuel_gauge_accessory on */
+    unsigned    level:4;            /* region reported */
+    unsigned    candidate:4;        /* region read but not yet reported */
+    unsigned    candidate_count:4;
+} fuel_gauge_t;
+
+#define FUEL_GAUGE_ACCESSORY(a)         (1 << (a))
+
+/* nothing but the radio and processor drawing current */
+#define fuelGaugeIsIdle()               ((gFuelGauge.load == fuel_gauge_load_idle) && !gFuelGauge.accessories)
+
+static fuel_gauge_t gFuelGauge;
+
+
+/****************************************************************************
+NAME
+  	fuelGaugeLoadCurrent
+
+DESCRIPTION
+  	Get the current drawn by the load and accessories in place
+
+RETURNS
+  	current in mA
+*/
+static uint16 fuelGaugeLoadCurrent( void )
+{
+    uint16 current;
+
+    switch(gFuelGauge.load)
+    {
+        case fuel_gauge_load_media:
+            current = FUEL_GAUGE_MEDIA_MA;
+            break;
+        case fuel_gauge_load_sco:
+            current = FUEL_GAUGE_SCO_MA;
+            break;
+        default:
+            current = FUEL_GAUGE_IDLE_MA;
+            break;
+    }
+
+    if(gFuelGauge.accessories & FUEL_GAUGE_ACCESSORY(fuel_gauge_accessory_el_panel))
+        current += FUEL_GAUGE_EL_PANEL_MA;
+    if(gFuelGauge.accessories & FUEL_GAUGE_ACCESSORY(fuel_gauge_accessory_vibrator))
+        current += FUEL_GAUGE_VIBRATOR_MA;
+
+    return current;
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeLoadSag
+
+DESCRIPTION
+  	Get the drop in battery voltage caused by the load and accessories in
+    place
+
+RETURNS
+  	voltage in mV
+*/
+static uint16 fuelGaugeLoadSag( void )
+{
+    uint16 sag;
+
+    switch(gFuelGauge.load)
+    {
+        case fuel_gauge_load_media:
+            sag = FUEL_GAUGE_MEDIA_SAG_MV;
+            break;
+        case fuel_gauge_load_sco:
+            sag = FUEL_GAUGE_SCO_SAG_MV;
+            break;
+        default:
+            sag = 0;
+            break;
+    }
+
+    if(gFuelGauge.accessories & FUEL_GAUGE_ACCESSORY(fuel_gauge_accessory_el_panel))
+        sag += FUEL_GAUGE_EL_PANEL_SAG_MV;
+    if(gFuelGauge.accessories & FUEL_GAUGE_ACCESSORY(fuel_gauge_accessory_vibrator))
+        sag += FUEL_GAUGE_VIBRATOR_SAG_MV;
+
+    return sag;
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeVoltageCharge
+
+DESCRIPTION
+  	Look up the charge for a resting battery voltage on the discharge curve
+
+RETURNS
+  	TRUE and the charge in 1/100 percent, FALSE if the battery limits are
+    not known
+*/
+static bool fuelGaugeVoltageCharge( uint16 voltage, uint16 * charge )
+{
+    uint16 min = theSink.rundata->battery_limits.min_battery_v;
+    uint16 max = theSink.rundata->battery_limits.max_battery_v;
+    uint16 position;
+    uint16 i;
+
+    if(max <= min)
+        return FALSE;
+
+    if(voltage <= min)
+        position = 0;
+    else if(voltage >= max)
+        position = 1000;
+    else
+        position = (uint16)(((uint32)(voltage - min) * 1000) / (max - min));
+
+    for(i = 1; (i + 1) < (sizeof(gDischargeCurve) / sizeof(gDischargeCurve[0])) && (position > gDischargeCurve[i].voltage); i++)
+        ;
+
+    /* interpolate between the points either side */
+    *charge = (gDischargeCurve[i - 1].percent * 100) +
+              (uint16)(((uint32)(position - gDischargeCurve[i - 1].voltage) * (gDischargeCurve[i].percent - gDischargeCurve[i - 1].percent) * 100) /
+                       (gDischargeCurve[i].voltage - gDischargeCurve[i - 1].voltage));
+    return TRUE;
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeAverage
+
+DESCRIPTION
+  	Add a stretch of discharge at a current to the averaging period in
+    progress, folding the current over each period completed into the
+    average
+
+RETURNS
+  	void
+*/
+static void fuelGaugeAverage( uint16 current, uint32 elapsed )
+{
+    uint32 step;
+    int32 sample;
+
+    while(elapsed)
+    {
+        step = FUEL_GAUGE_AVERAGE_PERIOD_MS - gFuelGauge.period_ms;
+        if(step > elapsed)
+            step = elapsed;
+
+        gFuelGauge.period_charge += (uint32)current * step;
+        gFuelGauge.period_ms     += step;
+        elapsed                  -= step;
+
+        if(gFuelGauge.period_ms == FUEL_GAUGE_AVERAGE_PERIOD_MS)
+        {
+            sample = (int32)((gFuelGauge.period_charge * FUEL_GAUGE_AVERAGE_SCALE) / FUEL_GAUGE_AVERAGE_PERIOD_MS);
+            gFuelGauge.average += (int16)((sample - (int32)gFuelGauge.average) /
+                                          (FUEL_GAUGE_AVERAGE_WINDOW_MS / FUEL_GAUGE_AVERAGE_PERIOD_MS));
+
+            gFuelGauge.period_charge = 0;
+            gFuelGauge.period_ms     = 0;
+        }
+    }
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeCount
+
+DESCRIPTION
+  	Count the charge used or gained since the last update at the load in
+    place over that time, and add the discharge to the average
+
+RETURNS
+  	void
+*/
+static void fuelGaugeCount( void )
+{
+    uint32 now = VmGetClock();
+    uint32 elapsed = now - gFuelGauge.last_update;
+    uint16 current = fuelGaugeLoadCurrent();
+    uint16 delta;
+
+    gFuelGauge.last_update = now;
+
+    if(!gFuelGauge.valid)
+        return;
+
+    if(elapsed > FUEL_GAUGE_MAX_STEP_MS)
+        elapsed = FUEL_GAUGE_MAX_STEP_MS;
+
+    gFuelGauge.residue += (uint32)(gFuelGauge.charging ? FUEL_GAUGE_CHARGE_MA : current) * elapsed;
+    delta = (uint16)(gFuelGauge.residue / FUEL_GAUGE_UNIT_MA_MS);
+    gFuelGauge.residue %= FUEL_GAUGE_UNIT_MA_MS;
+
+    if(gFuelGauge.charging)
+    {
+        gFuelGauge.charge = ((FUEL_GAUGE_FULL - gFuelGauge.charge) > delta) ? (gFuelGauge.charge + delta) : FUEL_GAUGE_FULL;
+    }
+    else
+    {
+        gFuelGauge.charge = (gFuelGauge.charge > delta) ? (gFuelGauge.charge - delta) : 0;
+        fuelGaugeAverage(current, elapsed);
+    }
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeUpdatePercent
+
+DESCRIPTION
+  	Work out the percentage to report from the charge
+
+RETURNS
+  	void
+*/
+static void fuelGaugeUpdatePercent( void )
+{
+    uint8 percent = (uint8)((gFuelGauge.charge + 50) / 100);
+
+    if(gFuelGauge.charging || (percent < gFuelGauge.percent))
+        gFuelGauge.percent = percent;
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeFilterLevel
+
+DESCRIPTION
+  	Decide whether a region read should replace the one reported
+
+RETURNS
+  	void
+*/
+static void fuelGaugeFilterLevel( uint16 level, bool urgent )
+{
+    uint16 needed;
+
+    /* while charging the regions follow the charger, report them as read */
+    if(gFuelGauge.charging || (level == gFuelGauge.level))
+    {
+        gFuelGauge.level = level;
+        gFuelGauge.candidate_count = 0;
+        return;
+    }
+
+    if((level != gFuelGauge.candidate) || !gFuelGauge.candidate_count)
+    {
+        gFuelGauge.candidate = level;
+        gFuelGauge.candidate_count = 0;
+    }
+    if(gFuelGauge.candidate_count < 15)
+        gFuelGauge.candidate_count++;
+
+    if(level > gFuelGauge.level)
+        needed = FUEL_GAUGE_CONFIRM_RISE;
+    else if(urgent)
+        needed = fuelGaugeIsIdle() ? 1 : 2;
+    else
+        needed = fuelGaugeIsIdle() ? FUEL_GAUGE_CONFIRM_IDLE : FUEL_GAUGE_CONFIRM_LOAD;
+
+    if(gFuelGauge.candidate_count >= needed)
+    {
+        GAUGE_DEBUG(("GAUGE: region %d -> %d\n", gFuelGauge.level, level));
+        gFuelGauge.level = level;
+        gFuelGauge.candidate_count = 0;
+    }
+}
+
+
+/****************************************************************************
+NAME
+  	fuelGaugeHandleReading
+*/
+uint16 fuelGaugeHandleReading( const voltage_reading * vbat, bool urgent )
+{
+    uint16 voltage = vbat->voltage + fuelGaugeLoadSag();
+    uint16 charge;
+
+    fuelGaugeCount();
+
+    if(!gFuelGauge.valid)
+    {
+        /* no history, take the reading as it is */
+        if(!fuelGaugeVoltageCharge(voltage, &charge))
+            charge = (uint16)(((uint32)(vbat->level + 1) * FUEL_GAUGE_FULL) / POWER_MAX_VBAT_REGIONS);
+
+        gFuelGauge.valid   = TRUE;
+        gFuelGauge.voltage = voltage;
+        gFuelGauge.charge  = charge;
+        gFuelGauge.average = fuelGaugeLoadCurrent() * FUEL_GAUGE_AVERAGE_SCALE;
+        gFuelGauge.level   = vbat->level;
+        gFuelGauge.percent = (uint8)((charge + 50) / 100);
+        return gFuelGauge.level;
+    }
+
+    gFuelGauge.voltage += (int16)(voltage - gFuelGauge.voltage) / 4;
+
+    /* the charger holds the voltage up, only count while charging */
+    if(!gFuelGauge.charging && fuelGaugeVoltageCharge(gFuelGauge.voltage, &charge))
+    {
+        int16 shift = fuelGaugeIsIdle() ? 2 : 4;
+        gFuelGauge.charge += (int16)(((int32)charge - (int32)gFuelGauge.charge) >> shift);
+    }
+
+    fuelGaugeUpdatePercent();
+    fuelGaugeFilterLevel(vbat->level, urgent);
+
+    GAUGE_DEBUG(("GAUGE: %dmV [%dmV] charge %d%% region %d [%d] %dmA\n", vbat->voltage, gFuelGauge.voltage,
+                 gFuelGauge.percent, gFuelGauge.level, vbat->level, gFuelGauge.average / FUEL_GAUGE_AVERAGE_SCALE));
+
+    return gFuelGauge.level;
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeSetLoad
+*/
+void fuelGaugeSetLoad( fuel_gauge_load load )
+{
+    if(load != gFuelGauge.load)
+    {
+        fuelGaugeCount();
+        gFuelGauge.load = load;
+    }
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeSetAccessory
+*/
+void fuelGaugeSetAccessory( fuel_gauge_accessory accessory, bool on )
+{
+    uint16 accessories = gFuelGauge.accessories & ~FUEL_GAUGE_ACCESSORY(accessory);
+
+    if(on)
+        accessories |= FUEL_GAUGE_ACCESSORY(accessory);
+
+    if(accessories != gFuelGauge.accessories)
+    {
+        fuelGaugeCount();
+        gFuelGauge.accessories = accessories;
+    }
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeSetCharging
+*/
+void fuelGaugeSetCharging( bool charging )
+{
+    if(charging != gFuelGauge.charging)
+    {
+        fuelGaugeCount();
+        gFuelGauge.charging = charging;
+        /* what is left over was counted the other way */
+        gFuelGauge.residue = 0;
+        fuelGaugeUpdatePercent();
+    }
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeChargeComplete
+*/
+void fuelGaugeChargeComplete( void )
+{
+    fuelGaugeCount();
+    gFuelGauge.charge  = FUEL_GAUGE_FULL;
+    gFuelGauge.residue = 0;
+    gFuelGauge.percent = 100;
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeGetPercent
+*/
+uint8 fuelGaugeGetPercent( void )
+{
+    voltage_reading reading;
+
+    if(!gFuelGauge.valid && PowerBatteryGetVoltage(&reading))
+        (void)fuelGaugeHandleReading(&reading, FALSE);
+
+    if(!gFuelGauge.valid)
+        return 0;
+
+    fuelGaugeCount();
+    fuelGaugeUpdatePercent();
+    return gFuelGauge.percent;
+}
+
+/****************************************************************************
+NAME
+  	fuelGaugeGetMinutes
+*/
+uint16 fuelGaugeGetMinutes( void )
+{
+    uint32 minutes;
+    uint16 average;
+
+    if(!gFuelGauge.valid || gFuelGauge.charging)
+        return FUEL_GAUGE_MINUTES_UNKNOWN;
+
+    fuelGaugeCount();
+
+    average = gFuelGauge.average;
+    if(!average)
+        average = 1;
+
+    /* charge is 1/100 percent of capacity, 1/10000 of capacity mAh */
+    minutes = ((uint32)gFuelGauge.charge * FUEL_GAUGE_CAPACITY_MAH * 60) / FUEL_GAUGE_FULL;
+    minutes = (minutes * FUEL_GAUGE_AVERAGE_SCALE) / average;
+
+    return (minutes < FUEL_GAUGE_MINUTES_UNKNOWN) ? (uint16)minutes : (FUEL_GAUGE_MINUTES_UNKNOWN - 1);
+}
@@ -0,0 +1,160 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_fuel_gauge.h
+
+DESCRIPTION
+    Battery fuel gauge. The charge left is estimated by counting the charge
+    drawn at the current expected for what the device is doing, and the
+    estimate is pulled towards the charge implied by the battery voltage.
+    Voltages read while audio is routed or the EL panel or vibrator is
+    driven are corrected for the drop caused by the load and trusted less. The battery region the power manager acts
+    on only changes once a new region has been read several times in a row,
+    so indications do not flicker while audio load comes and goes.
+
+*/
+#ifndef _SINK_FUEL_GAUGE_H_
+#define _SINK_FUEL_GAUGE_H_
+
+#include <csrtypes.h>
+#include <power.h>
+
+
+/* capacity of the battery */
+#define FUEL_GAUGE_CAPACITY_MAH         (140)
+
+/* current expected to be drawn for each load */
+#define FUEL_GAUGE_IDLE_MA              (3)
+#define FUEL_GAUGE_MEDIA_MA             (14)
+#define FUEL_GAUGE_SCO_MA               (18)
+
+/* current drawn by each accessory on top of the load */
+#define FUEL_GAUGE_EL_PANEL_MA          (12)
+#define FUEL_GAUGE_VIBRATOR_MA          (60)
+
+/* current expected to flow into the battery while charging */
+#define FUEL_GAUGE_CHARGE_MA            (70)
+
+/* drop in battery voltage caused by each load */
+#define FUEL_GAUGE_MEDIA_SAG_MV         (30)
+#define FUEL_GAUGE_SCO_SAG_MV           (45)
+#define FUEL_GAUGE_EL_PANEL_SAG_MV      (25)
+#define FUEL_GAUGE_VIBRATOR_SAG_MV      (110)
+
+/* readings in a row needed before the reported region changes */
+#define FUEL_GAUGE_CONFIRM_IDLE         (2)     /* lower region with no audio */
+#define FUEL_GAUGE_CONFIRM_LOAD         (4)     /* lower region under load */
+#define FUEL_GAUGE_CONFIRM_RISE         (3)     /* higher region */
+
+/* time over which the average current is taken, the current drawn over
+   each period is folded into the average as the period ends */
+#define FUEL_GAUGE_AVERAGE_WINDOW_MS    (600000)
+#define FUEL_GAUGE_AVERAGE_PERIOD_MS    (60000)
+
+/* time to empty when the battery is not discharging */
+#define FUEL_GAUGE_MINUTES_UNKNOWN      (0xFFFF)
+
+/* What the device is doing, sets the current drawn */
+typedef enum
+{
+    fuel_gauge_load_idle,
+    fuel_gauge_load_media,      /* a2dp, usb, wired or fm audio routed */
+    fuel_gauge_load_sco
+} fuel_gauge_load;
+
+/* Accessories driven alongside the load */
+typedef enum
+{
+    fuel_gauge_accessory_el_panel,
+    fuel_gauge_accessory_vibrator
+} fuel_gauge_accessory;
+
+
+/****************************************************************************
+NAME
+    fuelGaugeHandleReading
+
+DESCRIPTION
+    Update the gauge with a battery reading. An urgent reading, one in the
+    critical region, is acted on straight away with no load and after a
+    second reading otherwise.
+
+RETURNS
+    the battery region to act on
+*/
+uint16 fuelGaugeHandleReading( const voltage_reading * vbat, bool urgent );
+
+/****************************************************************************
+NAME
+    fuelGaugeSetLoad
+
+DESCRIPTION
+    Note a change in what the device is doing
+
+RETURNS
+    void
+*/
+void fuelGaugeSetLoad( fuel_gauge_load load );
+
+/****************************************************************************
+NAME
+    fuelGaugeSetAccessory
+
+DESCRIPTION
+    Note an accessory being switched on or off
+
+RETURNS
+    void
+*/
+void fuelGaugeSetAccessory( fuel_gauge_accessory accessory, bool on );
+
+/****************************************************************************
+NAME
+    fuelGaugeSetCharging
+
+DESCRIPTION
+    Note the charger being connected or disconnected
+
+RETURNS
+    void
+*/
+void fuelGaugeSetCharging( bool charging );
+
+/****************************************************************************
+NAME
+    fuelGaugeChargeComplete
+
+DESCRIPTION
+    Note the charger reporting the battery full
+
+RETURNS
+    void
+*/
+void fuelGaugeChargeComplete( void );
+
+/****************************************************************************
+NAME
+    fuelGaugeGetPercent
+
+DESCRIPTION
+    Get the charge left, taking a reading if the gauge has none yet
+
+RETURNS
+    the charge left in percent
+*/
+uint8 fuelGaugeGetPercent( void );
+
+/****************************************************************************
+NAME
+    fuelGaugeGetMinutes
+
+DESCRIPTION
+    Predict the time to empty from the charge left and the average current
+
+RETURNS
+    minutes, FUEL_GAUGE_MINUTES_UNKNOWN while charging or before a reading
+*/
+uint16 fuelGaugeGetMinutes( void );
+
+#endif /* _SINK_FUEL_GAUGE_H_ */
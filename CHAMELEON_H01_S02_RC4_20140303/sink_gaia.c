@@ -23,14 +23,28 @@ NOTES
 #include <boot.h>
 #include "sink_config.h"
 #include "sink_configmanager.h"
+#include "sink_config_cache.h"
 #include "sink_leds.h"
 #include "sink_led_manager.h"
 #include "sink_tones.h"
+#include "sink_tone_codec.h"
 #include "sink_tts.h"
 #include "sink_buttons.h"
 #include "sink_volume.h"
 #include "sink_speech_recognition.h"
 #include "sink_device_id.h"
+#include "sink_link_policy.h"
+#include "sink_fuel_gauge.h"
+#include "sink_energy.h"
+#ifdef ENABLE_REMOTE
+#include "sink_rc_params.h"
+#endif
+#ifdef ENABLE_PBAP
+#include "sink_callerid.h"
+#endif
+#include "sink_powermanager.h"
+#include "sink_audio_routing.h"
+#include "sink_prompt_scheduler.h"
 
 
 /*  Gaia-global data stored in app-allocated structure */
@@ -1710,6 +1724,10 @@ static void gaia_factory_reset_config(uint16 config_id)
     
     /* update the config id */
     set_config_id ( PSKEY_CONFIGURATION_ID ) ;
+    
+    /* cached configuration blocks may now come from a different config */
+    configCacheInvalidateAll();
+    TonesCacheInit();
 }
 
 
@@ -1775,6 +1793,13 @@ static void gaia_set_tts_config(uint8 *payload)
             }
         }
         
+        /*  Make the new phrase table visible to TTSPlayEvent  */
+        if (status == GAIA_STATUS_SUCCESS)
+        {
+            configCacheInvalidate(config_cache_tts_phrases);
+            TonesCacheInit();
+        }
+        
         freePanic(config);
     }
 
@@ -2052,18 +2077,18 @@ DESCRIPTION
     Note data consists of tempo, volume, timbre and decay values for
     the whole sequence followed by pitch and length values for each note.
     
-    If the indicated tone number is not in use we add it, otherwise we
-    delete the existing data, compact the free space and add the new tone
-    data at the end of the list.
+    Tones are stored packed, one record per tone, so only the record of
+    the indicated tone is replaced. A key written by the configuration
+    tool is packed the first time a tone is set.
 */
 static void gaia_set_user_tone_config(uint8 payload_len, uint8 *payload)
 {
     lengths_config_type lengths;
     uint16 config_len;
-    uint16 *note_data;
+    uint16 *config_data;
+    ringtone_note *note_data;
     uint16 tone_len;
     uint16 idx;
-    uint16 old;
     uint8 tone_idx;
     
     if ((payload_len < 5) || (payload[0] < 1) || (payload[0] > MAX_NUM_VARIABLE_TONES))
@@ -2072,10 +2097,20 @@ static void gaia_set_user_tone_config(uint8 payload_len, uint8 *payload)
         return;
     }
     
-    note_data = mallocPanic(GAIA_TONE_BUFFER_SIZE);
+    /* up to four control words, the notes and the end marker */
+    tone_len = 4 + (payload_len - 5) / 2 + 1;
     
-    if (note_data == NULL)
+    config_data = mallocPanic(GAIA_TONE_BUFFER_SIZE);
+    note_data = mallocPanic(tone_len);
+    
+    if ((config_data == NULL) || (note_data == NULL))
     {
+        if (config_data)
+            freePanic(config_data);
+        
+        if (note_data)
+            freePanic(note_data);
+        
         gaia_send_insufficient_resources(GAIA_COMMAND_SET_USER_TONE_CONFIGURATION);
         return;
     }
@@ -2083,82 +2118,52 @@ static void gaia_set_user_tone_config(uint8 payload_len, uint8 *payload)
     get_config_lengths(&lengths);
     
     config_len = lengths.userTonesLength;
-    if (config_len == 0)
-    {
-        /* No tones; create empty list  */
-        config_len = MAX_NUM_VARIABLE_TONES;
-        for (idx = 0; idx < config_len; ++idx)
-            note_data[idx] = 0;    
-    }
-    
-    else
-        ConfigRetrieve(theSink.config_id, PSKEY_CONFIG_TONES, note_data, config_len);
+    if (config_len != 0)
+        ConfigRetrieve(theSink.config_id, PSKEY_CONFIG_TONES, config_data, config_len);
     
 #ifdef DEBUG_GAIA
-    dump("before", note_data, config_len);
+    dump("before", config_data, config_len);
 #endif
     
     tone_idx = payload[0] - 1;
-
-    old = note_data[tone_idx];
-    /* If the index in use, purge it  */
-    if (old)
+    tone_len = 0;
+    
+    if (payload[1] != 0)
+        note_data[tone_len++] = (ringtone_note) RINGTONE_TEMPO(payload[1] * 4);
+    
+    if (payload[2] != 0)
+        note_data[tone_len++] = (ringtone_note) RINGTONE_VOLUME(payload[2]);
+    
+    if (payload[3] != 0)
+        note_data[tone_len++] = (ringtone_note) RINGTONE_SEQ_TIMBRE | payload[3];
+    
+    if (payload[4] != 0)
+        note_data[tone_len++] = (ringtone_note) RINGTONE_DECAY(payload[4]);
+    
+    for (idx = 5; (idx + 1) < payload_len; idx += 2)
+        note_data[tone_len++] = pitch_length_tone(payload[idx], payload[idx + 1]);
+    
+    note_data[tone_len] = (ringtone_note) RINGTONE_END;
+    
+    /* Replace the record of this tone, leaving the others as they are  */
+    config_len = toneCodecPack(config_data, config_len, GAIA_TONE_BUFFER_SIZE);
+    if (config_len != 0)
     {
-        /*  Find the end  */
-        idx = old;
-        while (note_data[idx] != (uint16) RINGTONE_END)
-            ++idx;
-        
-        tone_len = idx - old + 1;
-
-        /* Adjust any offsets into purged space  */
-        for (idx = 0; idx < MAX_NUM_VARIABLE_TONES; ++idx)
-            if (note_data[idx] > old)
-                note_data[idx] -= tone_len;
-        
-        /* Close the gap  */
-        config_len -= tone_len;
-        for (idx = old; idx < config_len; ++idx)
-            note_data[idx] = note_data[idx + tone_len];
+        config_len = toneCodecRemove(config_data, config_len, tone_idx);
+        config_len = toneCodecAppend(config_data, config_len, GAIA_TONE_BUFFER_SIZE, tone_idx, note_data);
     }
-        
-#ifdef DEBUG_GAIA
-    dump("during", note_data, config_len);
-#endif
-        
-    tone_len = (payload_len - 4) / 2 + 1;
     
-    if ((config_len + tone_len) > GAIA_TONE_BUFFER_SIZE)  /* TODO: test this sooner! */
+    if (config_len == 0)
         gaia_send_insufficient_resources(GAIA_COMMAND_SET_USER_TONE_CONFIGURATION);
     
     else
     {
-        /* Copy new tone into free space  */
-        note_data[tone_idx] = config_len;
-        
-        if (payload[1] != 0)
-            note_data[config_len++] = (uint16) RINGTONE_TEMPO(payload[1] * 4);
-        
-        if (payload[2] != 0)
-            note_data[config_len++] = (uint16) RINGTONE_VOLUME(payload[2]);
-        
-        if (payload[3] != 0)
-            note_data[config_len++] = (uint16) RINGTONE_SEQ_TIMBRE | payload[3];
-        
-        if (payload[4] != 0)
-            note_data[config_len++] = (uint16) RINGTONE_DECAY(payload[4]);
-        
-        for (idx = 5; idx < payload_len; idx += 2)
-            note_data[config_len++] = (uint16) pitch_length_tone(payload[idx], payload[idx + 1]);
-        
-        note_data[config_len++] = (uint16) RINGTONE_END;
-        
 #ifdef DEBUG_GAIA
-        dump("after ", note_data, config_len);
+        dump("after ", config_data, config_len);
 #endif
 
         /*  Write back to persistent store  */
-        if (PsStore(PSKEY_CONFIG_TONES, note_data, config_len) == 0)
+        if (PsStore(PSKEY_CONFIG_TONES, config_data, config_len) == 0)
             gaia_send_insufficient_resources(GAIA_COMMAND_SET_USER_TONE_CONFIGURATION);
         
         else
@@ -2174,11 +2179,15 @@ static void gaia_set_user_tone_config(uint8 payload_len, uint8 *payload)
                 }
             }
             
+            /*  Make the new tone visible to TonesPlayTone  */
+            configCacheInvalidate(config_cache_user_tones);
+            
             gaia_send_success(GAIA_COMMAND_SET_USER_TONE_CONFIGURATION);
         }
     }
         
     freePanic(note_data);
+    freePanic(config_data);
 }
 
 
@@ -2213,16 +2222,22 @@ static void gaia_send_user_tone_config(uint8 id)
         return;
     }
     
-    config_len = lengths.userTonesLength;
-    note_data = mallocPanic(config_len);
+    /* the key may hold packed tones, work on them decoded */
+    config_len = toneCodecUserTonesSize(lengths.userTonesLength);
+    if (config_len != 0)
+        note_data = mallocPanic(config_len);
+    
+    if ((note_data != NULL) && !toneCodecUserTonesLoad(lengths.userTonesLength, (ringtone_note *) note_data, config_len))
+    {
+        freePanic(note_data);
+        note_data = NULL;
+    }
     
     if (note_data == NULL)
         gaia_send_insufficient_resources(GAIA_COMMAND_GET_USER_TONE_CONFIGURATION);
     
     else
     {
-        ConfigRetrieve(theSink.config_id, PSKEY_CONFIG_TONES, note_data, config_len);
-        
         if (note_data[id - 1] == 0)
             gaia_send_invalid_parameter(GAIA_COMMAND_GET_USER_TONE_CONFIGURATION);
         
@@ -2518,6 +2533,428 @@ static void gaia_send_application_version(void)
 }
   
 
+/*************************************************************************
+NAME
+    gaia_send_battery_gauge
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_BATTERY_GAUGE by sending the charge left in
+    percent, the predicted minutes to empty and whether the charger is
+    connected
+*/
+static void gaia_send_battery_gauge(void)
+{
+    uint8 payload[GAIA_BATTERY_GAUGE_LENGTH];
+    uint16 minutes = fuelGaugeGetMinutes();
+    
+    payload[0] = fuelGaugeGetPercent();
+    payload[1] = minutes >> 8;
+    payload[2] = minutes & 0xFF;
+    payload[3] = powerManagerIsChargerConnected();
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_BATTERY_GAUGE, sizeof payload, payload);
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_send_energy_report
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_ENERGY_REPORT by sending the charge drawn by
+    each consumer in the hour requested, preceded by the hour and the
+    minutes of it accounted
+*/
+static void gaia_send_energy_report(uint8 hours_ago)
+{
+    uint16 totals[energy_num_consumers];
+    uint8 payload[2 + 2 * energy_num_consumers];
+    uint16 minutes = energyGetHourTotals(hours_ago, totals);
+    uint16 i;
+    
+    if (minutes == 0)
+        gaia_send_invalid_parameter(GAIA_COMMAND_GET_ENERGY_REPORT);
+    
+    else
+    {
+        payload[0] = hours_ago;
+        payload[1] = minutes;
+        
+        for (i = 0; i < energy_num_consumers; ++i)
+        {
+            payload[2 + 2 * i] = totals[i] >> 8;
+            payload[3 + 2 * i] = totals[i] & 0xFF;
+        }
+        
+        gaia_send_success_payload(GAIA_COMMAND_GET_ENERGY_REPORT, sizeof payload, payload);
+    }
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_set_energy_current
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_SET_ENERGY_CURRENT
+*/
+static void gaia_set_energy_current(uint8 *payload)
+{
+    if (payload[0] >= energy_num_consumers)
+        gaia_send_invalid_parameter(GAIA_COMMAND_SET_ENERGY_CURRENT);
+    
+    else if (energySetCurrent(payload[0], (payload[1] << 8) | payload[2]))
+        gaia_send_success(GAIA_COMMAND_SET_ENERGY_CURRENT);
+    
+    else
+        gaia_send_insufficient_resources(GAIA_COMMAND_SET_ENERGY_CURRENT);
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_set_a2dp_low_latency
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_SET_A2DP_LOW_LATENCY, payload is the a2dp link,
+    low latency and report delay
+*/
+static void gaia_set_a2dp_low_latency(uint8 *payload)
+{
+    if ((payload[1] > 1) || (payload[2] > 1) || !sinkA2dpSetLowLatency(payload[0], payload[1], payload[2]))
+        gaia_send_invalid_parameter(GAIA_COMMAND_SET_A2DP_LOW_LATENCY);
+    
+    else
+        gaia_send_success(GAIA_COMMAND_SET_A2DP_LOW_LATENCY);
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_send_a2dp_low_latency
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_A2DP_LOW_LATENCY by sending whether each a2dp
+    link is connected, in low latency mode and reporting its delay
+*/
+static void gaia_send_a2dp_low_latency(void)
+{
+    uint8 payload[3 * MAX_A2DP_CONNECTIONS];
+    uint16 i;
+    
+    for (i = 0; i < MAX_A2DP_CONNECTIONS; ++i)
+    {
+        payload[3 * i] = theSink.a2dp_link_data && theSink.a2dp_link_data->connected[i];
+        payload[3 * i + 1] = payload[3 * i] && theSink.a2dp_link_data->low_latency[i];
+        payload[3 * i + 2] = payload[3 * i] && theSink.a2dp_link_data->report_delay[i];
+    }
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_A2DP_LOW_LATENCY, sizeof payload, payload);
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_send_a2dp_clock_drift
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_A2DP_CLOCK_DRIFT by sending the clock drift
+    model of the device on each a2dp link
+*/
+static void gaia_send_a2dp_clock_drift(void)
+{
+    uint8 payload[6 * MAX_A2DP_CONNECTIONS];
+    uint8 *p = payload;
+    uint16 i;
+    
+    memset(payload, 0, sizeof payload);
+    
+    for (i = 0; i < MAX_A2DP_CONNECTIONS; ++i, p += 6)
+    {
+        if (theSink.a2dp_link_data && theSink.a2dp_link_data->connected[i])
+        {
+            p[0] = TRUE;
+            p[1] = theSink.a2dp_link_data->clockMismatchRate[i] >> 8;
+            p[2] = theSink.a2dp_link_data->clockMismatchRate[i] & 0xFF;
+            p[3] = theSink.a2dp_link_data->clockDrift[i].confidence;
+            p[4] = theSink.a2dp_link_data->clockDrift[i].convergence >> 8;
+            p[5] = theSink.a2dp_link_data->clockDrift[i].convergence & 0xFF;
+        }
+    }
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_A2DP_CLOCK_DRIFT, sizeof payload, payload);
+}
+  
+
+#ifdef ENABLE_REMOTE
+/*************************************************************************
+NAME
+    gaia_send_remote_control_stats
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_REMOTE_CONTROL_STATS
+*/
+static void gaia_send_remote_control_stats(void)
+{
+    uint8 payload[GAIA_REMOTE_CONTROL_STATS_LENGTH];
+    rc_params_stats stats;
+    
+    rcParamsGetStats(&stats);
+    
+    payload[0] = stats.presses >> 8;
+    payload[1] = stats.presses & 0xFF;
+    payload[2] = stats.average_latency >> 8;
+    payload[3] = stats.average_latency & 0xFF;
+    payload[4] = stats.worst_latency >> 8;
+    payload[5] = stats.worst_latency & 0xFF;
+    payload[6] = stats.requested_interval >> 8;
+    payload[7] = stats.requested_interval & 0xFF;
+    payload[8] = stats.current >> 8;
+    payload[9] = stats.current & 0xFF;
+    payload[10] = stats.reconnect >> 8;
+    payload[11] = stats.reconnect & 0xFF;
+    payload[12] = stats.worst_reconnect >> 8;
+    payload[13] = stats.worst_reconnect & 0xFF;
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_REMOTE_CONTROL_STATS, sizeof payload, payload);
+}
+#endif
+  
+
+/*************************************************************************
+NAME
+    gaia_send_link_policy_stats
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_LINK_POLICY_STATS
+*/
+static void gaia_send_link_policy_stats(void)
+{
+    uint8 payload[GAIA_LINK_POLICY_STATS_LENGTH + LP_LOG_SIZE * GAIA_LINK_POLICY_TRANSITION_LENGTH];
+    uint8 *p = payload;
+    lp_adaptive_stats stats;
+    const lp_transition *transition;
+    uint16 level;
+    uint16 age;
+    
+    linkPolicyGetAdaptiveStats(&stats);
+    
+    *p++ = stats.transitions >> 8;
+    *p++ = stats.transitions & 0xFF;
+    *p++ = stats.duty >> 8;
+    *p++ = stats.duty & 0xFF;
+    *p++ = stats.average_duty >> 8;
+    *p++ = stats.average_duty & 0xFF;
+    
+    for (level = 0; level < lp_num_levels; ++level)
+    {
+        uint32 seconds = stats.time_in_level[level] / 1000;
+        
+        *p++ = seconds >> 24;
+        *p++ = (seconds >> 16) & 0xFF;
+        *p++ = (seconds >> 8) & 0xFF;
+        *p++ = seconds & 0xFF;
+    }
+    
+    /* number of logged changes, filled in below */
+    p++;
+    
+    for (age = 0; (transition = linkPolicyGetTransition(age)) != NULL; ++age)
+    {
+        *p++ = transition->time >> 8;
+        *p++ = transition->time & 0xFF;
+        *p++ = transition->duty >> 8;
+        *p++ = transition->duty & 0xFF;
+        *p++ = (transition->from << 4) | transition->to;
+        *p++ = (transition->reason << 4) | transition->links;
+    }
+    
+    payload[GAIA_LINK_POLICY_STATS_LENGTH - 1] = age;
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_LINK_POLICY_STATS, p - payload, payload);
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_send_config_cache_stats
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_CONFIG_CACHE_STATS
+*/
+static void gaia_send_config_cache_stats(void)
+{
+    uint8 payload[GAIA_CONFIG_CACHE_STATS_LENGTH];
+    config_cache_stats stats;
+    
+    configCacheGetStats(&stats);
+    
+    payload[0] = stats.hits >> 8;
+    payload[1] = stats.hits & 0xFF;
+    payload[2] = stats.misses >> 8;
+    payload[3] = stats.misses & 0xFF;
+    payload[4] = stats.evictions >> 8;
+    payload[5] = stats.evictions & 0xFF;
+    payload[6] = stats.pool_words >> 8;
+    payload[7] = stats.pool_words & 0xFF;
+    payload[8] = stats.pool_peak_words >> 8;
+    payload[9] = stats.pool_peak_words & 0xFF;
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_CONFIG_CACHE_STATS, sizeof payload, payload);
+}
+  
+
+#ifdef ENABLE_PBAP
+/*************************************************************************
+NAME
+    gaia_send_caller_id_stats
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_CALLER_ID_STATS
+*/
+static void gaia_send_caller_id_stats(void)
+{
+    uint8 payload[GAIA_CALLER_ID_STATS_LENGTH];
+    caller_id_stats stats;
+    
+    callerIdGetStats(&stats);
+    
+    payload[0] = stats.store_words >> 8;
+    payload[1] = stats.store_words & 0xFF;
+    payload[2] = stats.entries >> 8;
+    payload[3] = stats.entries & 0xFF;
+    payload[4] = stats.pool_used >> 8;
+    payload[5] = stats.pool_used & 0xFF;
+    payload[6] = stats.dropped >> 8;
+    payload[7] = stats.dropped & 0xFF;
+    payload[8] = stats.change_count >> 8;
+    payload[9] = stats.change_count & 0xFF;
+    payload[10] = stats.lookups >> 8;
+    payload[11] = stats.lookups & 0xFF;
+    payload[12] = stats.hits >> 8;
+    payload[13] = stats.hits & 0xFF;
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_CALLER_ID_STATS, sizeof payload, payload);
+}
+#endif
+  
+
+/*************************************************************************
+NAME
+    gaia_send_audio_routing_log
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_AUDIO_ROUTING_LOG
+*/
+static void gaia_send_audio_routing_log(void)
+{
+    uint8 payload[GAIA_AUDIO_ROUTING_LOG_LENGTH + AUDIO_ROUTING_LOG_SIZE * GAIA_AUDIO_ROUTING_DECISION_LENGTH];
+    uint8 *p = payload;
+    const audio_routing_decision *decision;
+    uint16 age;
+    
+    /* number of logged decisions, filled in below */
+    p++;
+    
+    for (age = 0; (decision = audioRoutingGetDecision(age)) != NULL; ++age)
+    {
+        *p++ = decision->time >> 8;
+        *p++ = decision->time & 0xFF;
+        *p++ = decision->available;
+        *p++ = decision->routed;
+        *p++ = decision->skipped >> 8;
+        *p++ = decision->skipped & 0xFF;
+    }
+    
+    payload[0] = age;
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_AUDIO_ROUTING_LOG, p - payload, payload);
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_send_tone_cache_stats
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_TONE_CACHE_STATS
+*/
+static void gaia_send_tone_cache_stats(void)
+{
+    uint8 payload[GAIA_TONE_CACHE_STATS_LENGTH];
+    tone_cache_stats stats;
+    
+    TonesCacheGetStats(&stats);
+    
+    payload[0] = stats.hits >> 8;
+    payload[1] = stats.hits & 0xFF;
+    payload[2] = stats.misses >> 8;
+    payload[3] = stats.misses & 0xFF;
+    payload[4] = stats.latency_last >> 8;
+    payload[5] = stats.latency_last & 0xFF;
+    payload[6] = stats.latency_max >> 8;
+    payload[7] = stats.latency_max & 0xFF;
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_TONE_CACHE_STATS, sizeof payload, payload);
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_send_prompt_scheduler_stats
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_PROMPT_SCHEDULER_STATS
+*/
+static void gaia_send_prompt_scheduler_stats(void)
+{
+    uint8 payload[GAIA_PROMPT_SCHEDULER_STATS_LENGTH];
+    prompt_scheduler_stats stats;
+    
+    promptSchedulerGetStats(&stats);
+    
+    payload[0] = stats.depth >> 8;
+    payload[1] = stats.depth & 0xFF;
+    payload[2] = stats.peak_depth >> 8;
+    payload[3] = stats.peak_depth & 0xFF;
+    payload[4] = stats.played >> 8;
+    payload[5] = stats.played & 0xFF;
+    payload[6] = stats.coalesced >> 8;
+    payload[7] = stats.coalesced & 0xFF;
+    payload[8] = stats.dropped >> 8;
+    payload[9] = stats.dropped & 0xFF;
+    payload[10] = stats.preempted >> 8;
+    payload[11] = stats.preempted & 0xFF;
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_PROMPT_SCHEDULER_STATS, sizeof payload, payload);
+}
+  
+
+/*************************************************************************
+NAME
+    gaia_send_energy_currents
+    
+DESCRIPTION
+    Handle GAIA_COMMAND_GET_ENERGY_CURRENT by sending the current figure
+    for each consumer
+*/
+static void gaia_send_energy_currents(void)
+{
+    uint8 payload[2 * energy_num_consumers];
+    uint16 current;
+    uint16 i;
+    
+    for (i = 0; i < energy_num_consumers; ++i)
+    {
+        current = energyGetCurrent(i);
+        payload[2 * i] = current >> 8;
+        payload[2 * i + 1] = current & 0xFF;
+    }
+    
+    gaia_send_success_payload(GAIA_COMMAND_GET_ENERGY_CURRENT, sizeof payload, payload);
+}
+  
+
 /*************************************************************************
 NAME
     gaia_set_feature
@@ -2939,6 +3376,36 @@ static bool gaia_handle_configuration_command(Task task, GAIA_UNHANDLED_COMMAND_
             gaia_send_invalid_parameter(GAIA_COMMAND_GET_USER_TONE_CONFIGURATION);
         
         return TRUE;
+        
+        
+    case GAIA_COMMAND_SET_ENERGY_CURRENT:
+        if (command->size_payload == 3)
+            gaia_set_energy_current(command->payload);
+        
+        else
+            gaia_send_invalid_parameter(GAIA_COMMAND_SET_ENERGY_CURRENT);
+        
+        return TRUE;
+        
+        
+    case GAIA_COMMAND_GET_ENERGY_CURRENT:
+        gaia_send_energy_currents();
+        return TRUE;
+        
+        
+    case GAIA_COMMAND_SET_A2DP_LOW_LATENCY:
+        if (command->size_payload == 3)
+            gaia_set_a2dp_low_latency(command->payload);
+        
+        else
+            gaia_send_invalid_parameter(GAIA_COMMAND_SET_A2DP_LOW_LATENCY);
+        
+        return TRUE;
+        
+        
+    case GAIA_COMMAND_GET_A2DP_LOW_LATENCY:
+        gaia_send_a2dp_low_latency();
+        return TRUE;
 
 #ifdef ENABLE_SQIFVP
     case GAIA_COMMAND_GET_MOUNTED_PARTITIONS:
@@ -3298,6 +3765,56 @@ static bool gaia_handle_status_command(Task task, GAIA_UNHANDLED_COMMAND_IND_T *
     case GAIA_COMMAND_GET_APPLICATION_VERSION:
         gaia_send_application_version();
         return TRUE;
+        
+    case GAIA_COMMAND_GET_BATTERY_GAUGE:
+        gaia_send_battery_gauge();
+        return TRUE;
+        
+    case GAIA_COMMAND_GET_ENERGY_REPORT:
+        if (command->size_payload == 1)
+            gaia_send_energy_report(command->payload[0]);
+        
+        else
+            gaia_send_invalid_parameter(GAIA_COMMAND_GET_ENERGY_REPORT);
+        
+        return TRUE;
+        
+        
+    case GAIA_COMMAND_GET_A2DP_CLOCK_DRIFT:
+        gaia_send_a2dp_clock_drift();
+        return TRUE;
+        
+#ifdef ENABLE_REMOTE
+    case GAIA_COMMAND_GET_REMOTE_CONTROL_STATS:
+        gaia_send_remote_control_stats();
+        return TRUE;
+#endif
+        
+    case GAIA_COMMAND_GET_LINK_POLICY_STATS:
+        gaia_send_link_policy_stats();
+        return TRUE;
+        
+    case GAIA_COMMAND_GET_CONFIG_CACHE_STATS:
+        gaia_send_config_cache_stats();
+        return TRUE;
+        
+#ifdef ENABLE_PBAP
+    case GAIA_COMMAND_GET_CALLER_ID_STATS:
+        gaia_send_caller_id_stats();
+        return TRUE;
+#endif
+        
+    case GAIA_COMMAND_GET_AUDIO_ROUTING_LOG:
+        gaia_send_audio_routing_log();
+        return TRUE;
+        
+    case GAIA_COMMAND_GET_TONE_CACHE_STATS:
+        gaia_send_tone_cache_stats();
+        return TRUE;
+        
+    case GAIA_COMMAND_GET_PROMPT_SCHEDULER_STATS:
+        gaia_send_prompt_scheduler_stats();
+        return TRUE;
                    
     default:
         return FALSE;
@@ -3521,6 +4038,7 @@ void handleGaiaMessage(Task task, MessageId id, Message message)
         
     case GAIA_UNHANDLED_COMMAND_IND:
         GAIA_DEBUG(("G: GAIA_UNHANDLED_COMMAND_IND\n"));
+        linkPolicyNoteActivity();
         gaia_handle_command(task, (GAIA_UNHANDLED_COMMAND_IND_T *) message);
         break;
 
@@ -30,6 +30,79 @@ NOTES
 #define GAIA_CONFIGURATION_LENGTH_HFP (24)
 #define GAIA_CONFIGURATION_LENGTH_RSSI (14)
 
+/* status command answered with the fuel gauge charge in percent, the
+   predicted minutes to empty (0xFFFF if unknown) and whether charging */
+#define GAIA_COMMAND_GET_BATTERY_GAUGE (0x0380)
+#define GAIA_BATTERY_GAUGE_LENGTH (4)
+
+/* energy accounting, current figures are set per consumer in 10uA and the
+   report gives the charge drawn by each consumer in an hour in 10uAh */
+#define GAIA_COMMAND_SET_ENERGY_CURRENT (0x0140)
+#define GAIA_COMMAND_GET_ENERGY_CURRENT (0x01C0)
+#define GAIA_COMMAND_GET_ENERGY_REPORT (0x0381)
+
+/* low latency a2dp mode and delay reporting, set per a2dp link and stored
+   in the attributes of the device on it */
+#define GAIA_COMMAND_SET_A2DP_LOW_LATENCY (0x0141)
+#define GAIA_COMMAND_GET_A2DP_LOW_LATENCY (0x01C1)
+
+/* status command answered for each a2dp link with whether connected, the
+   learned clock mismatch rate, its confidence and the time the last stream
+   took to settle in 100ms */
+#define GAIA_COMMAND_GET_A2DP_CLOCK_DRIFT (0x0382)
+
+/* status command answered with the key presses seen from the BLE remote
+   control, their estimated average and worst latency in ms, the connection
+   interval asked for in 1.25ms, the estimated current in 10uA and the last
+   and worst reconnection time in 100ms, each two octets. The latency and
+   current follow from the interval asked for, not the one the controller
+   set, and are to be verified on target. */
+#define GAIA_COMMAND_GET_REMOTE_CONTROL_STATS (0x0383)
+#define GAIA_REMOTE_CONTROL_STATS_LENGTH (14)
+
+/* status command answered with the idle link policy statistics: the level
+   changes made and the estimated radio duty cycle now and on average in
+   1/1000, two octets each, the seconds spent at the responsive, normal and
+   deep levels, four octets each, and the number of level changes logged.
+   The logged changes follow newest first, each the time in seconds since
+   boot and duty cycle in two octets, the levels from and to in one octet
+   and the reason and idle links in one octet. */
+#define GAIA_COMMAND_GET_LINK_POLICY_STATS (0x0384)
+#define GAIA_LINK_POLICY_STATS_LENGTH (19)
+#define GAIA_LINK_POLICY_TRANSITION_LENGTH (6)
+
+/* status command answered with the configuration cache hits, misses,
+   evictions, words held and most words held, two octets each */
+#define GAIA_COMMAND_GET_CONFIG_CACHE_STATS (0x0385)
+#define GAIA_CONFIG_CACHE_STATS_LENGTH (10)
+
+/* status command answered with the caller ID store words held, numbers
+   held, name characters held, entries dropped by the last rebuild, changes,
+   lookups and lookups found, two octets each */
+#define GAIA_COMMAND_GET_CALLER_ID_STATS (0x0386)
+#define GAIA_CALLER_ID_STATS_LENGTH (14)
+
+/* status command answered with the number of audio routing decisions
+   logged, in one octet. The decisions follow newest first, each the time
+   in seconds since boot in two octets, the sources available and the
+   source routed as AUDIO_AVAILABLE_ bits in one octet each, and the
+   triggers skipped before it in two octets. */
+#define GAIA_COMMAND_GET_AUDIO_ROUTING_LOG (0x0387)
+#define GAIA_AUDIO_ROUTING_LOG_LENGTH (1)
+#define GAIA_AUDIO_ROUTING_DECISION_LENGTH (6)
+
+/* status command answered with the event tone cache hits and misses and
+   the last and longest time in ms a tone or prompt waited to be played,
+   two octets each */
+#define GAIA_COMMAND_GET_TONE_CACHE_STATS (0x0388)
+#define GAIA_TONE_CACHE_STATS_LENGTH (8)
+
+/* status command answered with the prompts waiting now, most prompts
+   waiting, prompts played, coalesced, dropped and preempted, two octets
+   each */
+#define GAIA_COMMAND_GET_PROMPT_SCHEDULER_STATS (0x0389)
+#define GAIA_PROMPT_SCHEDULER_STATS_LENGTH (12)
+
 #define GAIA_TONE_BUFFER_SIZE (94)
 #define GAIA_TONE_MAX_LENGTH ((GAIA_TONE_BUFFER_SIZE - 4) / 2)
 
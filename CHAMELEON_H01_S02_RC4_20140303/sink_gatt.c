@@ -17,6 +17,7 @@ DESCRIPTION
 #include "sink_debug.h"
 #include "sink_devicemanager.h"
 #include "sink_scan.h"
+#include "sink_fuel_gauge.h"
 
 #include <gatt.h>
 #include <batt_rep.h>
@@ -201,29 +202,10 @@ void handleGattBatteryReportMessage(Task task, MessageId id, Message message)
     
         case BATT_REP_LEVEL_REQUEST_IND:
         {
-            /* get current battery voltage */
-            voltage_reading reading;
-            uint8 battery_level = 0; 
+            /* report the charge left estimated by the fuel gauge */
+            uint8 battery_level = fuelGaugeGetPercent(); 
             
             GATT_DEBUG(("GATT: BATT_REP_LEVEL_REQUEST_IND\n"));
-            
-            PowerBatteryGetVoltage(&reading);
-            /* calculate %battery level using: (currentV - minV)/(maxV - minV)*100 */
-            if (theSink.rundata->battery_limits.max_battery_v > theSink.rundata->battery_limits.min_battery_v)
-            {
-                if (reading.voltage < theSink.rundata->battery_limits.min_battery_v)
-                {
-                    battery_level = 0;
-                }
-                else if (reading.voltage > theSink.rundata->battery_limits.max_battery_v)
-                {
-                    battery_level = 100;
-                }
-                else
-                {
-                    battery_level = (uint8)(((uint32)(reading.voltage - theSink.rundata->battery_limits.min_battery_v)  * (uint32)100) / (uint32)(theSink.rundata->battery_limits.max_battery_v - theSink.rundata->battery_limits.min_battery_v));
-                }
-            }
             GATT_DEBUG(("    battery level %d\n", battery_level));
             /* Return current battery level */
             BattRepLevelResponse(battery_level);
@@ -21,6 +21,8 @@ NOTES
 #include "sink_statemanager.h"
 #include "sink_devicemanager.h"
 #include "sink_device_id.h"
+#include "sink_inquiry_rank.h"
+#include "sink_energy.h"
 
 #ifdef ENABLE_SUBWOOFER
 #include "sink_swat.h"
@@ -132,15 +134,13 @@ static sink_link_type getFirstConnectableProfile (supported_profiles remote_prof
 #ifdef ENABLE_PEER
 void handleSdpOpenCfm (CL_SDP_OPEN_SEARCH_CFM_T *cfm)
 {
-    uint8 index = theSink.inquiry.attempting;
-    inquiry_result_t* device = &theSink.inquiry.results[index];
+    inquiry_result_t* device = inquiryRankGet(theSink.inquiry.results, theSink.inquiry.attempting);
     performSdpSearch(&device->bd_addr, theSink.inquiry.profile_search_idx);
 }
 
 void handleSdpCloseCfm (CL_SDP_CLOSE_SEARCH_CFM_T *cfm)
 {
-    uint8 index = theSink.inquiry.attempting;
-    inquiry_result_t* device = &theSink.inquiry.results[index];
+    inquiry_result_t* device = inquiryRankGet(theSink.inquiry.results, theSink.inquiry.attempting);
     sink_link_type first_profile = getFirstConnectableProfile(theSink.inquiry.remote_profiles);
     
     if (first_profile)
@@ -201,22 +201,6 @@ void HandleSdpServiceSearchCfm (CL_SDP_SERVICE_SEARCH_CFM_T *cfm)
 }
 #endif
 
-/****************************************************************************
-NAME    
-    inquiryResetEntry
-    
-DESCRIPTION
-    Reset inquiry data to initial values
-RETURNS
-    void
-*/
-static void inquiryResetEntry(uint8 index)
-{
-    BdaddrSetZero(&theSink.inquiry.results[index].bd_addr);
-    theSink.inquiry.results[index].rssi = RSSI_THRESHOLD;
-}
-
-
 /****************************************************************************
 NAME    
     inquiryReset
@@ -228,11 +212,9 @@ RETURNS
 */
 void inquiryReset(void)
 {
-    uint8 index;
     INQ_DEBUG(("INQ: Reset\n"));
     if(theSink.inquiry.results)
-        for(index=0; index < NUM_INQ_RESULTS; index++)
-            inquiryResetEntry(index);
+        inquiryRankReset(theSink.inquiry.results, (int16)RSSI_THRESHOLD);
 
     theSink.inquiry.attempting = 0;
 }
@@ -318,8 +300,8 @@ void inquiryStart (bool req_disc)
         }
         slcReset();
         
-        /* Allocate space to store inquiry results */
-        theSink.inquiry.results = mallocPanic(NUM_INQ_RESULTS * sizeof(inquiry_result_t));
+        /* Allocate space to store inquiry results, RSSI is averaged over repeated responses */
+        theSink.inquiry.results = inquiryRankCreate(NUM_INQ_RESULTS, (int16)RSSI_THRESHOLD, inquiry_rank_average);
         theSink.inquiry.state = inquiry_idle;
 
         /* Increase page timeout */
@@ -327,6 +309,7 @@ void inquiryStart (bool req_disc)
 
         /* Start a periodic inquiry, this will keep going until we cancel */
         inquiryResume();
+        energyConsumerSet(energy_consumer_inquiry, 1);
 
         /* Send a reminder event */
         MessageSendLater(&theSink.task, EventRssiPairReminder, 0, D_SEC(INQUIRY_REMINDER_TIMEOUT_SECS));
@@ -364,6 +347,7 @@ void inquiryStop(void)
         freePanic(theSink.inquiry.results);
         theSink.inquiry.results = NULL;
         theSink.inquiry.state = inquiry_idle;
+        energyConsumerSet(energy_consumer_inquiry, 0);
 
         /* Restore Page Timeout */
         ConnectionSetPageTimeout(0);
@@ -416,39 +400,6 @@ void inquiryTimeout(void)
 }
 
 
-/****************************************************************************
-NAME    
-    inquiryCheckBdaddr
-    
-DESCRIPTION
-    Helper function to check if an address is in inquiry results
-*/
-static bool inquiryCheckBdaddr(bdaddr *bd_addr, uint8* index)
-{
-    /* Check all devices for a previous entry */
-    for((*index) = 0; (*index) < NUM_INQ_RESULTS; (*index)++)
-        if(BdaddrIsSame(bd_addr, &theSink.inquiry.results[*index].bd_addr))
-            return TRUE;
-    return FALSE;
-}
-
-
-/****************************************************************************
-NAME    
-    inquiryGetIndex
-    
-DESCRIPTION
-    Work out the correct index in inquiry data for a given RSSI value
-*/
-static void inquiryGetIndex(int16 rssi, uint8* index)
-{
-    for((*index) = 0; (*index) < NUM_INQ_RESULTS; (*index)++)
-        if(rssi > theSink.inquiry.results[*index].rssi)
-            return;
-    (*index)++;
-}
-
-
 /****************************************************************************
 NAME    
     inquiryConnectNext
@@ -467,14 +418,14 @@ static void inquiryConnect (uint8 index)
     {
         if(index < NUM_INQ_DEVS || (RSSI_CONF.try_all_discovered && index < NUM_INQ_RESULTS))
         {
-            inquiry_result_t* device = &theSink.inquiry.results[index];
-            INQ_DEBUG(("INQ: Address %04x,%02x,%06lx\n", device->bd_addr.nap, device->bd_addr.uap, device->bd_addr.lap));
+            inquiry_result_t* device = inquiryRankGet(theSink.inquiry.results, index);
 
             /* Check there's a valid result at position idx */
-            if(!BdaddrIsZero(&device->bd_addr))
+            if(device)
             {
                 /* Allow 2 close devices if multipoint enabled, otherwise just one */
-                int16 rssi = theSink.inquiry.results[theSink.MultipointEnable ? 2 : 1].rssi;
+                int16 rssi = inquiryRankGetRssi(theSink.inquiry.results, theSink.MultipointEnable ? 2 : 1);
+                INQ_DEBUG(("INQ: Address %04x,%02x,%06lx\n", device->bd_addr.nap, device->bd_addr.uap, device->bd_addr.lap));
                 INQ_DEBUG(("INQ: RSSI %d Difference %d (%d)\n", device->rssi, (device->rssi - rssi), RSSI_DIFF_THRESHOLD));
 
                 /* Check that difference threshold criteria are met */
@@ -551,8 +502,18 @@ void inquiryConnectNext(void)
     inquiryConnect(++theSink.inquiry.attempting);
 }
 
-#ifdef ENABLE_PEER
-static supported_profiles getEirRemoteProfiles (uint16 size_eir_data, const uint8 *eir_data)
+/****************************************************************************
+NAME    
+    getEirRemoteProfiles
+    
+DESCRIPTION
+    Find the profiles we can use in the first service class UUID list of
+    the EIR data
+RETURNS
+    TRUE if the list found is complete, so a profile not in it is not
+    supported by the device
+*/
+static bool getEirRemoteProfiles (uint16 size_eir_data, const uint8 *eir_data, supported_profiles *remote_profiles)
 {
     uint16 i;
     INQ_DEBUG(("\n"));
@@ -568,7 +529,9 @@ static supported_profiles getEirRemoteProfiles (uint16 size_eir_data, const uint
         INQ_DEBUG(("INQ: EIR Record Size = %u, Tag = 0x%X\n",eir_record_size, eir_data[1]));
         if ((eir_data[1] == 0x02) || (eir_data[1] == 0x03))     /* Partial or complete list of 16-bit service class UUIDs */
         {
-            supported_profiles remote_profiles = profile_none;
+            bool complete = (eir_data[1] == 0x03);
+            
+            *remote_profiles = profile_none;
             
             do
             {
@@ -581,22 +544,22 @@ static supported_profiles getEirRemoteProfiles (uint16 size_eir_data, const uint
                 switch ((eir_data[1]<<8) + eir_data[0])
                 {
                 case 0x110A:    /* A2DP Audio Source */
-                    remote_profiles |= profile_a2dp;
+                    *remote_profiles |= profile_a2dp;
                     break;
                 case 0x110C:    /* AVRCP Target */
-                    remote_profiles |= profile_avrcp;
+                    *remote_profiles |= profile_avrcp;
                     break;
                 case 0x1112:    /* HSP AG */
-                    remote_profiles |= profile_hsp;
+                    *remote_profiles |= profile_hsp;
                     break;
                 case 0x111F:    /* HFP AG */
-                    remote_profiles |= profile_hfp;
+                    *remote_profiles |= profile_hfp;
                     break;
                 }
             }
             while (eir_record_size);
             
-            return remote_profiles;
+            return complete;
         }
         
         if (size_eir_data > eir_record_size)  
@@ -610,9 +573,9 @@ static supported_profiles getEirRemoteProfiles (uint16 size_eir_data, const uint
         }
     }
     
-    return profile_none;
+    *remote_profiles = profile_none;
+    return FALSE;
 }
-#endif
 
 /****************************************************************************
 NAME    
@@ -645,17 +608,19 @@ void inquiryHandleResult( CL_DM_INQUIRE_RESULT_T* result )
                                                                        result->bd_addr.lap, 
                                                                        result->rssi )) ;
 
-        for(debug_idx=0; debug_idx<NUM_INQ_RESULTS; debug_idx++)
-            INQ_DEBUG(("INQ: [Addr %04x,%02x,%06lx RSSI: %d]\n", theSink.inquiry.results[debug_idx].bd_addr.nap,
-                                                                 theSink.inquiry.results[debug_idx].bd_addr.uap,
-                                                                 theSink.inquiry.results[debug_idx].bd_addr.lap, 
-                                                                 theSink.inquiry.results[debug_idx].rssi )) ;
+        for(debug_idx=0; debug_idx<inquiryRankCount(theSink.inquiry.results); debug_idx++)
+            INQ_DEBUG(("INQ: [Addr %04x,%02x,%06lx RSSI: %d]\n", inquiryRankGet(theSink.inquiry.results, debug_idx)->bd_addr.nap,
+                                                                 inquiryRankGet(theSink.inquiry.results, debug_idx)->bd_addr.uap,
+                                                                 inquiryRankGet(theSink.inquiry.results, debug_idx)->bd_addr.lap, 
+                                                                 inquiryRankGet(theSink.inquiry.results, debug_idx)->rssi )) ;
 #endif
         if(result->status == inquiry_status_result)
         {
-#ifdef ENABLE_PEER
             bool peer_device = FALSE;
+            supported_profiles remote_profiles;
+            bool profiles_complete;
             
+#ifdef ENABLE_PEER
             /* Check for a peer device by matching device id records */
             if (CheckEirDeviceIdData(result->size_eir_data, result->eir_data))
             {   /* Mark device as a peer */
@@ -663,55 +628,36 @@ void inquiryHandleResult( CL_DM_INQUIRE_RESULT_T* result )
                 peer_device = TRUE;
                 result->rssi += 0x100; /* Bump rssi value by maxiumum possible range so peer devices will be at top of sorted list */
             }
-#endif
             
-#ifdef ENABLE_PEER
             /* Filter out peer/non-peer devices depending on inquiry session */
             INQ_DEBUG(("INQ:session=%u device=%u\n", theSink.inquiry.session, peer_device));
-            if ((theSink.inquiry.session == inquiry_session_peer && peer_device) || 
-                (theSink.inquiry.session == inquiry_session_normal && !peer_device))
+            if ((theSink.inquiry.session == inquiry_session_peer && !peer_device) || 
+                (theSink.inquiry.session == inquiry_session_normal && peer_device))
+                return;
 #endif
+            
+            /* Drop devices that could not earn a place before looking them up in the PDL */
+            if(!inquiryRankWouldStore(theSink.inquiry.results, &result->bd_addr, result->rssi))
+                return;
+            
+            /* An AG that lists its services in full and has none we can connect to is of no use */
+            profiles_complete = getEirRemoteProfiles(result->size_eir_data, result->eir_data, &remote_profiles);
+            INQ_DEBUG(("INQ: EIR Remote Profiles = %u%s\n", remote_profiles, profiles_complete ? " (complete)" : ""));
+            if (!peer_device && profiles_complete && !(remote_profiles & (profile_hsp | profile_hfp | profile_a2dp)))
+                return;
+            
+            /* Check if device is in PDL */
+            INQ_DEBUG(("RSSI_CHECK_PDL = %u\n",RSSI_CHECK_PDL(&result->bd_addr)));
+            if(RSSI_CHECK_PDL(&result->bd_addr))
             {
-                /* Check if device is in PDL */
-                INQ_DEBUG(("RSSI_CHECK_PDL = %u\n",RSSI_CHECK_PDL(&result->bd_addr)));
-                if(RSSI_CHECK_PDL(&result->bd_addr))
-                {
-                    uint8 old_index;
-                    uint8 new_index;
-                    inquiry_result_t res;
-                    res.bd_addr = result->bd_addr;
-                    res.rssi = result->rssi;
+                inquiry_result_t res;
+                res.bd_addr = result->bd_addr;
+                res.rssi = result->rssi;
 #ifdef ENABLE_PEER
-                    res.peer_device = peer_device;
-                    res.remote_profiles = getEirRemoteProfiles(result->size_eir_data, result->eir_data);
-                    INQ_DEBUG(("INQ: EIR Remote Profiles = %u\n",res.remote_profiles));
+                res.peer_device = peer_device;
+                res.remote_profiles = remote_profiles;
 #endif
-                    inquiryGetIndex(res.rssi, &new_index);
-                    INQ_DEBUG(("INQ: new_index = %u\n",new_index));
-                    
-                    /* Check if an entry exists for this device */
-                    if(inquiryCheckBdaddr(&res.bd_addr, &old_index))
-                    {
-                        /* Don't update if new entry further down the list */
-                        if(new_index > old_index)
-                            return;
-                        /* Reset the old entry (it should fall out the bottom) */
-                        inquiryResetEntry(old_index);
-                    }
-
-                    /* While new index is valid  */
-                    while(new_index < NUM_INQ_RESULTS)
-                    {
-                        inquiry_result_t prev;
-                        /* Remember the previous result for this index */
-                        prev = theSink.inquiry.results[new_index];
-                        /* Put this result in its place */
-                        theSink.inquiry.results[new_index] = res;
-                        res = prev;
-                        /* Get the new index of previous result */
-                        inquiryGetIndex(res.rssi, &new_index);
-                    }
-                }
+                inquiryRankAdd(theSink.inquiry.results, &res);
             }
         }
         else
@@ -68,6 +68,9 @@ typedef struct
 #endif
 }inquiry_result_t;
 
+/* Inquiry results ranked by RSSI, see sink_inquiry_rank.h */
+typedef struct inquiry_rank inquiry_rank_t;
+
 /* Inquiry run time data */
 typedef struct
 {
@@ -77,7 +80,7 @@ typedef struct
     unsigned           attempting:4;          /* Index of device being connected to   */
     supported_profiles remote_profiles:4;     /* Bitmask of profiles supported by a remote device */
     unsigned           profile_search_idx:3;  /* Index of current sdp service search */
-    inquiry_result_t*  results;               /* Array of inquiry results             */
+    inquiry_rank_t*    results;               /* Ranked inquiry results               */
 }inquiry_data_t;
 
 /* Inquiry Config */
@@ -0,0 +1,256 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_inquiry_rank.c
+
+DESCRIPTION
+    Ranked inquiry results. The slots in use are always the first count
+    slots of the table; the order array, held alongside them, lists those
+    slots best first. Placing a result is an insertion into the order array
+    so only slot numbers move. When the table is full the slot of the lowest
+    ranked result is reused.
+
+*/
+
+#include "sink_inquiry_rank.h"
+#include "sink_private.h"
+
+#include <panic.h>
+#include <stdlib.h>
+
+
+#ifdef DEBUG_INQ
+#define RANK_DEBUG(x) DEBUG(x)
+#else
+#define RANK_DEBUG(x)
+#endif
+
+/* A result and, for position i in the ranking, the slot holding it */
+typedef struct
+{
+    inquiry_result_t    result;
+    unsigned            order:5;        /* slot of the result ranked at this position */
+    unsigned            responses:3;    /* responses averaged into the result, saturates */
+    unsigned            unused:8;
+} inquiry_rank_entry;
+
+struct inquiry_rank
+{
+    int16               floor;          /* results must have an RSSI above this */
+    unsigned            capacity:5;
+    unsigned            count:5;
+    unsigned            mode:1;         /* inquiry_rank_mode */
+    unsigned            unused:5;
+    inquiry_rank_entry  entry[1];       /* capacity entries are allocated */
+};
+
+
+/****************************************************************************
+NAME
+  	inquiryRankFind
+
+DESCRIPTION
+  	Find the slot holding a device
+
+RETURNS
+  	the slot, the count of results held if the device is not held
+*/
+static uint8 inquiryRankFind( const inquiry_rank_t * rank, const bdaddr * bd_addr )
+{
+    uint8 slot;
+
+    for(slot = 0; slot < rank->count; slot++)
+    {
+        if(BdaddrIsSame(bd_addr, &rank->entry[slot].result.bd_addr))
+            break;
+    }
+    return slot;
+}
+
+/****************************************************************************
+NAME
+  	inquiryRankRemove
+
+DESCRIPTION
+  	Take a slot out of the first used positions of the ranking
+
+RETURNS
+  	void
+*/
+static void inquiryRankRemove( inquiry_rank_t * rank, uint8 slot, uint8 used )
+{
+    uint8 position;
+
+    for(position = 0; (position < used) && (rank->entry[position].order != slot); position++)
+        ;
+
+    for(; (position + 1) < used; position++)
+        rank->entry[position].order = rank->entry[position + 1].order;
+}
+
+/****************************************************************************
+NAME
+  	inquiryRankInsert
+
+DESCRIPTION
+  	Put a slot into its place among the first used positions of the
+    ranking, after any results with the same RSSI
+
+RETURNS
+  	void
+*/
+static void inquiryRankInsert( inquiry_rank_t * rank, uint8 slot, uint8 used )
+{
+    int16 rssi = rank->entry[slot].result.rssi;
+    uint8 position;
+
+    for(position = used; (position > 0) && (rssi > rank->entry[rank->entry[position - 1].order].result.rssi); position--)
+        rank->entry[position].order = rank->entry[position - 1].order;
+
+    rank->entry[position].order = slot;
+}
+
+
+/****************************************************************************
+NAME
+  	inquiryRankCreate
+*/
+inquiry_rank_t * inquiryRankCreate( uint8 capacity, int16 floor, inquiry_rank_mode mode )
+{
+    inquiry_rank_t * rank;
+
+    if(capacity > INQUIRY_RANK_MAX)
+        capacity = INQUIRY_RANK_MAX;
+    if(!capacity)
+        capacity = 1;
+
+    rank = (inquiry_rank_t *)PanicNull(mallocPanic(sizeof(inquiry_rank_t) + ((capacity - 1) * sizeof(inquiry_rank_entry))));
+
+    rank->capacity = capacity;
+    rank->mode     = mode;
+    inquiryRankReset(rank, floor);
+
+    return rank;
+}
+
+/****************************************************************************
+NAME
+  	inquiryRankReset
+*/
+void inquiryRankReset( inquiry_rank_t * rank, int16 floor )
+{
+    rank->floor = floor;
+    rank->count = 0;
+}
+
+/****************************************************************************
+NAME
+  	inquiryRankWouldStore
+*/
+bool inquiryRankWouldStore( const inquiry_rank_t * rank, const bdaddr * bd_addr, int16 rssi )
+{
+    if(inquiryRankFind(rank, bd_addr) < rank->count)
+        return TRUE;
+
+    if(rssi <= rank->floor)
+        return FALSE;
+
+    if(rank->count < rank->capacity)
+        return TRUE;
+
+    return (rssi > inquiryRankGetRssi(rank, rank->count - 1));
+}
+
+/****************************************************************************
+NAME
+  	inquiryRankAdd
+*/
+bool inquiryRankAdd( inquiry_rank_t * rank, const inquiry_result_t * result )
+{
+    inquiry_rank_entry * entry;
+    uint8 slot = inquiryRankFind(rank, &result->bd_addr);
+
+    if(slot < rank->count)
+    {
+        int16 rssi = result->rssi;
+
+        entry = &rank->entry[slot];
+
+        if(rank->mode == inquiry_rank_average)
+        {
+            rssi = ((entry->result.rssi * (int16)entry->responses) + rssi) / (int16)(entry->responses + 1);
+            if(entry->responses < (INQUIRY_RANK_AVERAGE_WINDOW - 1))
+                entry->responses++;
+        }
+        else if(rssi <= entry->result.rssi)
+        {
+            return TRUE;
+        }
+
+        entry->result      = *result;
+        entry->result.rssi = rssi;
+
+        inquiryRankRemove(rank, slot, rank->count);
+        inquiryRankInsert(rank, slot, rank->count - 1);
+
+        RANK_DEBUG(("RANK: update slot %d RSSI %d\n", slot, rssi));
+        return TRUE;
+    }
+
+    if(result->rssi <= rank->floor)
+        return FALSE;
+
+    if(rank->count == rank->capacity)
+    {
+        /* full, reuse the slot of the lowest ranked result if this is better */
+        if(result->rssi <= inquiryRankGetRssi(rank, rank->count - 1))
+            return FALSE;
+
+        slot = rank->entry[rank->count - 1].order;
+        rank->count--;
+    }
+
+    entry = &rank->entry[slot];
+    entry->result    = *result;
+    entry->responses = 1;
+
+    inquiryRankInsert(rank, slot, rank->count);
+    rank->count++;
+
+    RANK_DEBUG(("RANK: add slot %d RSSI %d, [%d] held\n", slot, result->rssi, rank->count));
+    return TRUE;
+}
+
+/****************************************************************************
+NAME
+  	inquiryRankGet
+*/
+inquiry_result_t * inquiryRankGet( inquiry_rank_t * rank, uint8 position )
+{
+    if(position >= rank->count)
+        return NULL;
+
+    return &rank->entry[rank->entry[position].order].result;
+}
+
+/****************************************************************************
+NAME
+  	inquiryRankGetRssi
+*/
+int16 inquiryRankGetRssi( const inquiry_rank_t * rank, uint8 position )
+{
+    if(position >= rank->count)
+        return rank->floor;
+
+    return rank->entry[rank->entry[position].order].result.rssi;
+}
+
+/****************************************************************************
+NAME
+  	inquiryRankCount
+*/
+uint8 inquiryRankCount( const inquiry_rank_t * rank )
+{
+    return rank->count;
+}
@@ -0,0 +1,132 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_inquiry_rank.h
+
+DESCRIPTION
+    Fixed size table of inquiry results ranked by RSSI, shared by RSSI
+    pairing/connecting and the subwoofer inquiry. Results stay in the slot
+    they were first stored in and only an array of slot numbers is kept in
+    order, so reordering never copies a result. Repeated responses from a
+    device either keep the highest RSSI seen or a running average of the
+    last few responses.
+
+*/
+#ifndef _SINK_INQUIRY_RANK_H_
+#define _SINK_INQUIRY_RANK_H_
+
+#include <csrtypes.h>
+#include <bdaddr.h>
+#include <connection.h>
+
+#include "sink_inquiry.h"
+
+
+/* most results a table can hold */
+#define INQUIRY_RANK_MAX            (16)
+
+/* number of responses from a device averaged over */
+#define INQUIRY_RANK_AVERAGE_WINDOW (4)
+
+/* floor to use when results are not limited by RSSI */
+#define INQUIRY_RANK_NO_FLOOR       ((int16)-0x7FFF)
+
+/* How repeated responses from a device are combined */
+typedef enum
+{
+    inquiry_rank_highest,       /* keep the highest RSSI */
+    inquiry_rank_average        /* running average of the recent responses */
+} inquiry_rank_mode;
+
+
+/****************************************************************************
+NAME
+    inquiryRankCreate
+
+DESCRIPTION
+    Allocate an empty table. Only results with an RSSI above floor are
+    stored, when the table is full a new result replaces the lowest ranked
+    one if it is better.
+
+RETURNS
+    the table, free with freePanic
+*/
+inquiry_rank_t * inquiryRankCreate( uint8 capacity, int16 floor, inquiry_rank_mode mode );
+
+/****************************************************************************
+NAME
+    inquiryRankReset
+
+DESCRIPTION
+    Empty a table and set a new floor
+
+RETURNS
+    void
+*/
+void inquiryRankReset( inquiry_rank_t * rank, int16 floor );
+
+/****************************************************************************
+NAME
+    inquiryRankWouldStore
+
+DESCRIPTION
+    Check whether a response would be stored without storing it, so checks
+    that cost more than the ranking can be skipped for devices that would
+    be dropped anyway
+
+RETURNS
+    TRUE if the device is already held or its RSSI would earn it a place
+*/
+bool inquiryRankWouldStore( const inquiry_rank_t * rank, const bdaddr * bd_addr, int16 rssi );
+
+/****************************************************************************
+NAME
+    inquiryRankAdd
+
+DESCRIPTION
+    Store a response, or combine it with the one already held for the
+    device, and move the device to its place in the ranking
+
+RETURNS
+    TRUE if the device is held in the table
+*/
+bool inquiryRankAdd( inquiry_rank_t * rank, const inquiry_result_t * result );
+
+/****************************************************************************
+NAME
+    inquiryRankGet
+
+DESCRIPTION
+    Get the result at a position in the ranking, 0 is the highest RSSI
+
+RETURNS
+    the result, NULL if there is no result at that position
+*/
+inquiry_result_t * inquiryRankGet( inquiry_rank_t * rank, uint8 position );
+
+/****************************************************************************
+NAME
+    inquiryRankGetRssi
+
+DESCRIPTION
+    Get the RSSI of the result at a position in the ranking
+
+RETURNS
+    the RSSI, the floor if there is no result at that position
+*/
+int16 inquiryRankGetRssi( const inquiry_rank_t * rank, uint8 position );
+
+/****************************************************************************
+NAME
+    inquiryRankCount
+
+DESCRIPTION
+    Get the number of results held
+
+RETURNS
+    the count
+*/
+uint8 inquiryRankCount( const inquiry_rank_t * rank );
+
+#endif /* _SINK_INQUIRY_RANK_H_ */
@@ -138,6 +138,58 @@ typedef struct PioTriColLedsTag
 }PioTriColLeds_t ;
 
 
+    /*the edges a compiled LED pattern is made of*/
+typedef enum LEDSeqEdgeTypeTag
+{
+    LED_SEQ_EDGE_ON_ODD ,       /*start of flash 1, 3, 5...*/
+    LED_SEQ_EDGE_ON_EVEN ,      /*start of flash 2, 4, 6...*/
+    LED_SEQ_EDGE_OFF ,          /*end of a flash*/
+    LED_SEQ_EDGE_OFF_LAST ,     /*end of the last flash, start of the repeat gap*/
+    LED_SEQ_NUM_EDGES
+}LEDSeqEdgeType_t ;
+
+    /*the PIO changes applied at a pattern edge*/
+typedef struct LEDSeqEdgeTag
+{
+    uint16              Mask ;  /*PIOs driven at this edge*/
+    uint16              Bits ;  /*level of the driven PIOs*/
+}LEDSeqEdge_t ;
+
+    /*a LED pattern and its active filters compiled into PIO mask changes.
+      The timeline of a pattern is the sequence ON_ODD, OFF, ON_EVEN, OFF ... OFF_LAST*/
+typedef struct LEDSequenceTag
+{
+    LEDSeqEdge_t        Edges[LED_SEQ_NUM_EDGES] ;
+    uint16              OnTime ;        /*filtered times in ms*/
+    uint16              OffTime ;
+    uint16              RepeatTime ;
+    uint16              Due ;           /*ms until the next edge*/
+    
+    unsigned            Active:1 ;
+    unsigned            Led:4 ;         /*the primary LED of the pattern*/
+    unsigned            Step:5 ;        /*next step in the timeline*/
+    unsigned            Dummy:6 ;
+}LEDSequence_t ;
+
+    /*the LED pads with PWM, LED_0, LED_1 and LED_2*/
+#define LED_DIM_NUM_PADS    (3)
+
+    /*fades in progress on the LED pads*/
+typedef struct LEDDimTag
+{
+    uint32              Start[LED_DIM_NUM_PADS] ;   /*VM clock at the start of each fade*/
+    uint16              Ticks ;                     /*dim timer messages handled*/
+    uint16              Steps ;                     /*brightness steps applied*/
+    unsigned            Fading:LED_DIM_NUM_PADS ;   /*mask of pads currently fading*/
+    unsigned            Dummy:13 ;
+}LEDDim_t ;
+
+    /*one sequence for a state and one for an event indication*/
+#define LED_SEQ_STATE   (0)
+#define LED_SEQ_EVENT   (1)
+#define LED_SEQ_NUM     (2)
+
+
    /*The LED task type*/
 typedef struct
 {
@@ -153,9 +205,7 @@ typedef struct
     unsigned                gLMNumFiltersUsed:5 ;
     unsigned                gLEDSStateTimeout:1 ; /*this is set to true if a state pattern has completed - reset if new event occurs*/
 
-    unsigned                gLED_0_STATE:1 ;
-    unsigned                gLED_1_STATE:1 ;
-    unsigned                gLED_2_STATE:1 ;
+    unsigned                gLEDPadState:3 ;      /*mask of LED pads currently on*/
     unsigned                gLEDSEnabled:1 ;      /*global LED overide  - event drivedn to enable / disable all LED Indications*/  
     unsigned                gLEDSSuspend:1;       /*LED indications suspended until this bit is cleared*/
     unsigned                gCurrentlyIndicatingEvent:1; /*if we are currently indicating an event*/
@@ -170,6 +220,10 @@ typedef struct
     LEDEventQueue_t         Queue ;
     PioTriColLeds_t         gTriColLeds ;
     
+    LEDSequence_t           gSequences[LED_SEQ_NUM] ; /*compiled patterns driven by the sequencer timer*/
+    uint32                  gSeqArmedAt ;             /*VM clock when the sequencer timer was last set*/
+    LEDDim_t                gDim ;
+    
 } LedTaskData;  
 
 #define LED_SCALE_ON_OFF_TIME(x) (uint16)((x * 10) << theSink.features.LedTimeMultiplier )
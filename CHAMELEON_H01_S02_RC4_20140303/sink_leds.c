@@ -20,7 +20,10 @@ DESCRIPTION
 #include <stddef.h>
 #include <led.h>
 #include <string.h>
+#include <vm.h>
 #include "ISA1200.h"
+#include "sink_fuel_gauge.h"
+#include "sink_energy.h"
 #ifdef DEBUG_LEDS
 #define LED_DEBUG(x) {printf x;}
 #else
@@ -33,6 +36,9 @@ DESCRIPTION
 
 #define LEDS_STATE_START_DELAY_MS 300
 
+    /*LEDs 10 to 15 are the vibrator, tricolour pairs and LED pads*/
+#define LED_SEQ_NUM_PLAIN_PIOS    (10)
+
  /*internal message handler for the LED callback messages*/
 static void LedsMessageHandler( Task task, MessageId id, Message message ) ;
 
@@ -74,14 +80,27 @@ static void ledsTurnOnAltLeds(uint8 On_LedA, uint8 Off_LedB);
 #endif
 
 #define DIM_NUM_STEPS (0xf)
-#define DIM_STEP_SIZE ((4096) / (DIM_NUM_STEPS + 1) ) 
 #define DIM_PERIOD    (0x0)
 
+    /*brightness of each dim step as a 12 bit LED duty cycle*/
+static const uint16 gDimRamp[DIM_NUM_STEPS + 1] =
+{
+    0x000 , 0x100 , 0x200 , 0x300 , 0x400 , 0x500 , 0x600 , 0x700 ,
+    0x800 , 0x900 , 0xa00 , 0xb00 , 0xc00 , 0xd00 , 0xe00 , 0xfff
+} ;
+
+    /*the LED numbers of the PWM capable pads and the LED driving each of them*/
+static const uint16 gDimPadPins[LED_DIM_NUM_PADS] = { 14 , 15 , 10 } ;
+static const led_id gDimPadLeds[LED_DIM_NUM_PADS] = { LED_0 , LED_1 , LED_2 } ;
+
     
 
 
 static void PioSetLed ( uint16 pPIO , bool pOnOrOff ) ;
 
+    /*LED numbers currently lit, for the energy accounting*/
+static uint32 gLitLeds = 0 ;
+
 /****************************************************************************
 NAME	
 	PioSetLedPin
@@ -106,12 +125,16 @@ void PioSetLedPin ( uint16 pPIO , bool pOnOrOff )
 			{
 				ISA1200_Enable();
 				ISA1200_Vibrator_On();
+				fuelGaugeSetAccessory(fuel_gauge_accessory_vibrator, TRUE);
+				energyConsumerSet(energy_consumer_vibrator, 1);
 
 			}
 			else
 			{
 				ISA1200_Vibrator_Off();
 				ISA1200_Disable();
+				fuelGaugeSetAccessory(fuel_gauge_accessory_vibrator, FALSE);
+				energyConsumerSet(energy_consumer_vibrator, 0);
 			}
 		}
 		break;
@@ -144,6 +167,164 @@ void PioSetLedPin ( uint16 pPIO , bool pOnOrOff )
 	}
 }	
 
+/****************************************************************************
+NAME	
+	LedsDimGetPad
+
+DESCRIPTION
+    Get the LED pad behind an LED number
+    
+RETURNS
+	the pad index or LED_DIM_NUM_PADS if the LED is not on a PWM capable pad
+*/
+static uint16 LedsDimGetPad ( uint16 pPIO )
+{
+    uint16 lPad ;
+    
+    for ( lPad = 0 ; lPad < LED_DIM_NUM_PADS ; lPad++ )
+    {
+        if ( gDimPadPins[lPad] == pPIO )
+            break ;
+    }
+    return lPad ;
+}
+
+/****************************************************************************
+NAME	
+	LedsDimSetDuty
+
+DESCRIPTION
+    Set the brightness of an LED pad from the ramp table
+    
+RETURNS
+	void
+*/
+static void LedsDimSetDuty ( uint16 pPad , uint16 pStep )
+{
+    LedConfigure(gDimPadLeds[pPad], LED_DUTY_CYCLE, gDimRamp[pStep]);
+    LedConfigure(gDimPadLeds[pPad], LED_PERIOD, DIM_PERIOD );
+    LedConfigure(gDimPadLeds[pPad], LED_ENABLE, TRUE);
+}
+
+/****************************************************************************
+NAME	
+	LedsDimSchedule
+
+DESCRIPTION
+    Set the dim timer for the next step due on any fading pad, one timer
+    serves all of the pads
+    
+RETURNS
+	void
+*/
+static void LedsDimSchedule ( void )
+{
+    LEDDim_t * lDim  = &theSink.theLEDTask->gDim ;
+    uint32     lNow  = VmGetClock() ;
+    uint16     lNext = 0xFFFF ;
+    uint16     lPad ;
+    
+    MessageCancelAll ( &theSink.theLEDTask->task, DIM_MSG_TICK ) ;
+    
+    for ( lPad = 0 ; lPad < LED_DIM_NUM_PADS ; lPad++ )
+    {
+        if ( lDim->Fading & (1 << lPad) )
+        {
+            uint16 lDimTime = theSink.theLEDTask->gActiveLEDS[gDimPadPins[lPad]].DimTime ;
+            uint16 lDue     = 0 ;
+            
+            if ( lDimTime )
+                lDue = lDimTime - (uint16)( (lNow - lDim->Start[lPad]) % lDimTime ) ;
+            
+            if ( lDue < lNext )
+                lNext = lDue ;
+        }
+    }
+    
+    if ( lDim->Fading )
+    {
+        MessageSendLater ( &theSink.theLEDTask->task, DIM_MSG_TICK , 0 , lNext ) ;
+    }
+    else
+    {
+        DIM_DEBUG(("DIM: Idle ticks[%d] steps[%d]\n" , lDim->Ticks , lDim->Steps )) ;
+    }
+}
+
+/****************************************************************************
+NAME	
+	LedsDimStart
+
+DESCRIPTION
+    Start fading a pad up or down from the opposite end of the ramp
+    
+RETURNS
+	void
+*/
+static void LedsDimStart ( uint16 pPad , bool pOnOrOff )
+{
+    LEDActivity_t * gActiveLED = &theSink.theLEDTask->gActiveLEDS[gDimPadPins[pPad]];
+    LEDDim_t *      lDim       = &theSink.theLEDTask->gDim ;
+    
+        /*set led to max or min depending on whether we think the led is on or off*/
+    gActiveLED->DimState = (DIM_NUM_STEPS * !pOnOrOff) ; 
+    gActiveLED->DimDir   = pOnOrOff ; /*1=go up , 0 = go down**/ 
+    
+    DIM_DEBUG(("DIM: Set LED [%d][%x][%d]\n" ,gDimPadPins[pPad] ,gActiveLED->DimState ,gActiveLED->DimDir  )) ;
+    LedsDimSetDuty ( pPad , gActiveLED->DimState ) ;
+    
+    lDim->Start[pPad] = VmGetClock() ;
+    lDim->Fading     |= (1 << pPad) ;
+    LedsDimSchedule () ;
+}
+
+/****************************************************************************
+NAME	
+	LedsDimStop
+
+DESCRIPTION
+    Stop any fade on a pad
+    
+RETURNS
+	void
+*/
+static void LedsDimStop ( uint16 pPad )
+{
+    LEDDim_t * lDim = &theSink.theLEDTask->gDim ;
+    
+    if ( lDim->Fading & (1 << pPad) )
+    {
+        lDim->Fading &= ~(1 << pPad) ;
+        LedsDimSchedule () ;
+    }
+}
+
+/****************************************************************************
+NAME	
+	LedsNoteLit
+
+DESCRIPTION
+    Note the LEDs in a mask changing to the state in bits, and pass the
+    number lit on to the energy accounting
+    
+RETURNS
+	void
+*/
+static void LedsNoteLit ( uint32 pMask , uint32 pBits )
+{
+    uint32 lLit = ( gLitLeds & ~pMask ) | ( pBits & pMask ) ;
+    uint16 lCount = 0 ;
+    
+    if ( lLit == gLitLeds )
+        return ;
+    
+    gLitLeds = lLit ;
+    for ( ; lLit ; lLit &= ( lLit - 1 ) )
+        lCount++ ;
+    
+    energyConsumerSet ( energy_consumer_leds , lCount ) ;
+}
+
 /****************************************************************************
 NAME	
 	PioSetLed
@@ -156,174 +337,623 @@ RETURNS
 */
 static void PioSetLed ( uint16 pPIO , bool pOnOrOff ) 
 {	
-    LEDActivity_t * gActiveLED = &theSink.theLEDTask->gActiveLEDS[pPIO];
+    uint16 lPad = LedsDimGetPad ( pPIO ) ;
+    
+    LedsNoteLit ( (uint32)1 << pPIO , pOnOrOff ? ((uint32)1 << pPIO) : 0 ) ;
     
    /* LED pins are special cases*/
-    if ( pPIO == 14)        
+    if ( lPad < LED_DIM_NUM_PADS )
     {
+        LEDActivity_t * gActiveLED = &theSink.theLEDTask->gActiveLEDS[pPIO];
+        bool            lPadState  = ( theSink.theLEDTask->gLEDPadState >> lPad ) & 1 ;
+        
         if ( gActiveLED->DimTime > 0 ) /*if this is a dimming led / pattern*/ 
         {
-            if (theSink.theLEDTask->gLED_0_STATE != pOnOrOff) /*if the request is to do the same as what we are doing then ignore*/
+            if (lPadState != pOnOrOff) /*if the request is to do the same as what we are doing then ignore*/
             {
-                    /*set led to max or min depending on whether we think the led is on or off*/
-                gActiveLED->DimState = (DIM_NUM_STEPS * !pOnOrOff) ; 
-                gActiveLED->DimDir   = pOnOrOff ; /*1=go up , 0 = go down**/ 
-                        
-                LedConfigure(LED_0, LED_DUTY_CYCLE, (gActiveLED->DimState * (DIM_STEP_SIZE)));
-                LedConfigure(LED_0, LED_PERIOD, DIM_PERIOD );
-                
-                DIM_DEBUG(("DIM: Set LED [%d][%x][%d]\n" ,pPIO ,gActiveLED->DimState ,gActiveLED->DimDir  )) ;
-                LedConfigure(LED_0, LED_ENABLE, TRUE);
-                /*send the first message*/
-                MessageCancelAll ( &theSink.theLEDTask->task, (DIM_MSG_BASE + pPIO) ) ;                
-                MessageSendLater ( &theSink.theLEDTask->task, (DIM_MSG_BASE + pPIO) ,0 ,gActiveLED->DimTime ) ;       
-              
-                theSink.theLEDTask->gLED_0_STATE = pOnOrOff ;
+                LedsDimStart ( lPad , pOnOrOff ) ;
             }
         }
         else
         {              
-            DIM_DEBUG(("DIM 0 N:[%d]\n" , pOnOrOff)) ;
-		    LedConfigure(LED_0, LED_ENABLE, pOnOrOff ) ;
-            LedConfigure(LED_0, LED_DUTY_CYCLE, (0xfff));
-            LedConfigure(LED_0, LED_PERIOD, DIM_PERIOD );
-            theSink.theLEDTask->gLED_0_STATE = pOnOrOff ;
+            DIM_DEBUG(("DIM %d N:[%d]\n" , lPad , pOnOrOff)) ;
+            LedsDimStop ( lPad ) ;
+		    LedConfigure(gDimPadLeds[lPad], LED_ENABLE, pOnOrOff ) ;
+            LedConfigure(gDimPadLeds[lPad], LED_DUTY_CYCLE, (0xfff));
+            LedConfigure(gDimPadLeds[lPad], LED_PERIOD, DIM_PERIOD );
         }
+        
+        if ( pOnOrOff )
+            theSink.theLEDTask->gLEDPadState |= (1 << lPad) ;
+        else
+            theSink.theLEDTask->gLEDPadState &= ~(1 << lPad) ;
     }
-    else if (pPIO == 15 )
+    else
     {
-        if ( gActiveLED->DimTime > 0 ) /*if this is a dimming led / pattern*/ 
+        PioSetPio (pPIO , pio_drive, pOnOrOff) ;
+    }
+}
+
+
+/****************************************************************************
+NAME	
+	PioSetDimState  
+	
+DESCRIPTION
+    Dim timer, moves every fading pad to the step its fade has reached and
+    sets the timer for the next step
+    
+RETURNS
+	void
+*/
+void PioSetDimState ( void )
+{
+    LEDDim_t * lDim = &theSink.theLEDTask->gDim ;
+    uint32     lNow = VmGetClock() ;
+    uint16     lPad ;
+    
+    lDim->Ticks++ ;
+    
+    for ( lPad = 0 ; lPad < LED_DIM_NUM_PADS ; lPad++ )
+    {
+        if ( lDim->Fading & (1 << lPad) )
         {
-            if (theSink.theLEDTask->gLED_1_STATE != pOnOrOff) /*if the request is to do the same as what we are doing then ignore*/
+            LEDActivity_t *gActiveLED = &theSink.theLEDTask->gActiveLEDS[gDimPadPins[lPad]];
+            uint16 lTarget = gActiveLED->DimDir ? DIM_NUM_STEPS : 0 ;
+            
+                /*the step the fade should be at by now*/
+            if ( gActiveLED->DimTime )
             {
-                   /*set led to max or min depending on whether we think the led is on or off*/
-                gActiveLED->DimState = (DIM_NUM_STEPS * !pOnOrOff) ; 
-                gActiveLED->DimDir   = pOnOrOff ; /*1=go up , 0 = go down**/ 
-                                    
-                LedConfigure(LED_1, LED_DUTY_CYCLE, (gActiveLED->DimState * (DIM_STEP_SIZE)));
-                LedConfigure(LED_1, LED_PERIOD, DIM_PERIOD );
-						
-                DIM_DEBUG(("DIM: Set LED [%d][%x][%d]\n" ,pPIO ,gActiveLED->DimState , gActiveLED->DimDir  )) ;
-                LedConfigure(LED_1, LED_ENABLE, TRUE);
-                   /*send the first message*/
-                MessageCancelAll ( &theSink.theLEDTask->task, (DIM_MSG_BASE + pPIO) ) ;                
-                MessageSendLater ( &theSink.theLEDTask->task, (DIM_MSG_BASE + pPIO) ,0 ,gActiveLED->DimTime ) ;
-
-                theSink.theLEDTask->gLED_1_STATE = pOnOrOff ;                                  
+                uint32 lSteps = ( lNow - lDim->Start[lPad] ) / gActiveLED->DimTime ;
+                
+                if ( lSteps < DIM_NUM_STEPS )
+                    lTarget = gActiveLED->DimDir ? (uint16)lSteps : (uint16)(DIM_NUM_STEPS - lSteps) ;
+            }
+            
+            while ( gActiveLED->DimState != lTarget )
+            {
+                if(gActiveLED->DimDir)
+                {
+                    gActiveLED->DimState++ ;
+	                ISA1200_SetDuty(theSink.isa_dimlev++ * 7);
+                }
+                else
+                {
+                    gActiveLED->DimState-- ;
+                }
+                lDim->Steps++ ;
             }
+            
+            DIM_DEBUG(("DIM:Pad [%x] Direction [%x], DimState:[%x], DimTime:[%x]\n", lPad, gActiveLED->DimDir, gActiveLED->DimState, gActiveLED->DimTime));
+            LedsDimSetDuty ( lPad , gActiveLED->DimState ) ;
+            
+                /*fade complete*/
+            if ( gActiveLED->DimState == (gActiveLED->DimDir ? DIM_NUM_STEPS : 0) )
+                lDim->Fading &= ~(1 << lPad) ;
         }
-        else
+    }
+    
+    LedsDimSchedule () ;
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqAddPin
+
+DESCRIPTION
+    Add a PIO to a mask, only plain PIOs can be driven by the sequencer
+    
+RETURNS
+	TRUE if the PIO can be driven by the sequencer
+*/
+static bool LedsSeqAddPin ( uint16 pPIO , uint16 * pMask )
+{
+    if ( pPIO >= LED_SEQ_NUM_PLAIN_PIOS )
+        return FALSE ;
+    
+    *pMask |= ( 1 << pPIO ) ;
+    return TRUE ;
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqAddPins
+
+DESCRIPTION
+    Add the PIOs behind an LED number to a mask, the vibrator and the LED pads
+    are driven through their own drivers so cannot be sequenced
+    
+RETURNS
+	TRUE if the LED can be driven by the sequencer
+*/
+static bool LedsSeqAddPins ( uint16 pLed , uint16 * pMask )
+{
+    PioTriColLeds_t * lTriCol = &theSink.theLEDTask->gTriColLeds ;
+    
+    switch (pLed)
+    {
+        case (11):
+            return ( LedsSeqAddPin ( lTriCol->TriCol_a , pMask ) && LedsSeqAddPin ( lTriCol->TriCol_b , pMask ) ) ;
+        case (12):
+            return ( LedsSeqAddPin ( lTriCol->TriCol_b , pMask ) && LedsSeqAddPin ( lTriCol->TriCol_c , pMask ) ) ;
+        case (13):
+            return ( LedsSeqAddPin ( lTriCol->TriCol_c , pMask ) && LedsSeqAddPin ( lTriCol->TriCol_a , pMask ) ) ;
+        default:
+            return LedsSeqAddPin ( pLed , pMask ) ;
+    }
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqDrive
+
+DESCRIPTION
+    Record a change of PIOs in an edge, later changes take precedence in the
+    same way as successive calls to PioSetLedPin
+    
+RETURNS
+	void
+*/
+static void LedsSeqDrive ( LEDSeqEdge_t * pEdge , uint16 pPins , bool pOnOrOff )
+{
+    pEdge->Mask |= pPins ;
+    
+    if ( pOnOrOff )
+        pEdge->Bits |= pPins ;
+    else
+        pEdge->Bits &= ~pPins ;
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqCompile
+
+DESCRIPTION
+    Compile a pattern and the currently active filters into the PIO changes
+    made at each edge of the pattern, mirroring LedsTurnOnLEDPair and 
+    LedsTurnOffLEDPair
+    
+RETURNS
+	FALSE if the pattern needs the per LED message handler, i.e. it uses the 
+    vibrator, the LED pads or an LED follower
+*/
+static bool LedsSeqCompile ( LEDSequence_t * pSeq , LEDPattern_t * pPattern , IndicationType_t pType )
+{
+    LEDColour_t lColour = LedsGetPatternColour ( pPattern ) ;
+    uint8  lLedA        = pPattern->LED_A ;
+    uint8  lLedB        = pPattern->LED_B ;
+    uint16 lPinsA       = 0 ;
+    uint16 lPinsB       = 0 ;
+    uint16 lOffA        = 0 ;
+    uint16 lOffB        = 0 ;
+    uint16 lEnable      = 0 ;
+    uint16 lOveride     = 0 ;
+    uint16 lFilterIndex = 0 ;
+    uint16 lEdge        = 0 ;
+    
+    if ( theSink.theLEDTask->gFollowing )
+        return FALSE ;
+    
+    if ( !LedsSeqAddPins ( lLedA , &lPinsA ) || !LedsSeqAddPins ( lLedB , &lPinsB ) )
+        return FALSE ;
+    
+    if ( ( theSink.conf1->PIOIO.pio_outputs.LedEnablePIO < 0xFF ) &&
+         !LedsSeqAddPins ( theSink.conf1->PIOIO.pio_outputs.LedEnablePIO , &lEnable ) )
+        return FALSE ;
+    
+    for (lFilterIndex = 0 ; lFilterIndex< LM_NUM_FILTER_EVENTS ; lFilterIndex++ )
+    {
+        if ( LedsIsFilterEnabled(lFilterIndex) )
         {
-            DIM_DEBUG(("DIM 1 N:[%d]\n" , pOnOrOff)) ;
-            LedConfigure(LED_1, LED_ENABLE, pOnOrOff ) ;
-            LedConfigure(LED_1, LED_DUTY_CYCLE, (0xfff));
-            LedConfigure(LED_1, LED_PERIOD, DIM_PERIOD );
-            theSink.theLEDTask->gLED_1_STATE = pOnOrOff ;
+            LEDFilter_t *lEventFilter = &(theSink.theLEDTask->gEventFilters[lFilterIndex]);
+            
+                /*a follower changes the pattern at every repeat*/
+            if ( lEventFilter->FollowerLEDActive && (pType == IT_StateIndication) )
+                return FALSE ;
+            
+            if ( lEventFilter->OverideLEDActive && !LedsSeqAddPins ( lEventFilter->OverideLED , &lOveride ) )
+                return FALSE ;
         }
     }
-    else if (pPIO == 10 )
+    
+        /*leds held on by an overide filter are never turned off*/
+    if ( !isOverideFilterActive ( lLedA ) )
+        lOffA = lPinsA ;
+    if ( !isOverideFilterActive ( lLedB ) )
+        lOffB = lPinsB ;
+    
+    memset ( pSeq->Edges , 0 , sizeof(pSeq->Edges) ) ;
+    
+        /*turning on, the odd and even flashes only differ for alternating patterns*/
+    for ( lEdge = LED_SEQ_EDGE_ON_ODD ; lEdge <= LED_SEQ_EDGE_ON_EVEN ; lEdge++ )
     {
-        if ( gActiveLED->DimTime > 0 ) /*if this is a dimming led / pattern*/ 
+        LEDSeqEdge_t * lOn = &pSeq->Edges[lEdge] ;
+        
+        LedsSeqDrive ( lOn , lEnable , LED_ON ) ;
+        
+        switch (lColour )
         {
-            if (theSink.theLEDTask->gLED_2_STATE != pOnOrOff) /*if the request is to do the same as what we are doing then ignore*/
+        case LED_COL_LED_A:
+            if (lLedA != lLedB)
+                LedsSeqDrive ( lOn , lOffB , LED_OFF ) ;
+            LedsSeqDrive ( lOn , lPinsA , LED_ON ) ;
+        break;
+        case LED_COL_LED_B:
+            if (lLedA != lLedB)
+                LedsSeqDrive ( lOn , lOffA , LED_OFF ) ;
+            LedsSeqDrive ( lOn , lPinsB , LED_ON ) ;
+        break;
+        case LED_COL_LED_ALT:
+                /*pins shared by a tricolour pair are left on*/
+            if ( lEdge == LED_SEQ_EDGE_ON_ODD )
             {
-                   /*set led to max or min depending on whether we think the led is on or off*/
-                gActiveLED->DimState = (DIM_NUM_STEPS * !pOnOrOff) ; 
-                gActiveLED->DimDir   = pOnOrOff ; /*1=go up , 0 = go down**/ 
-                                    
-                LedConfigure(LED_2, LED_DUTY_CYCLE, (gActiveLED->DimState * (DIM_STEP_SIZE)));
-                LedConfigure(LED_2, LED_PERIOD, DIM_PERIOD );
-                
-                DIM_DEBUG(("DIM: Set LED [%d][%x][%d]\n" ,pPIO ,gActiveLED->DimState , gActiveLED->DimDir  )) ;
-                LedConfigure(LED_2, LED_ENABLE, TRUE);
-                   /*send the first message*/
-
-		  
-                MessageCancelAll ( &theSink.theLEDTask->task, (DIM_MSG_BASE + pPIO) ) ;                
-                MessageSendLater ( &theSink.theLEDTask->task, (DIM_MSG_BASE + pPIO) ,0 ,gActiveLED->DimTime ) ;
-
-                theSink.theLEDTask->gLED_2_STATE = pOnOrOff ;
+                LedsSeqDrive ( lOn , (lPinsA & ~lPinsB) , LED_OFF ) ;
+                LedsSeqDrive ( lOn , lPinsB , LED_ON ) ;
+            }
+            else
+            {
+                LedsSeqDrive ( lOn , (lPinsB & ~lPinsA) , LED_OFF ) ;
+                LedsSeqDrive ( lOn , lPinsA , LED_ON ) ;
             }
+        break;
+        case LED_COL_LED_BOTH:
+            LedsSeqDrive ( lOn , lPinsA , LED_ON ) ;
+            LedsSeqDrive ( lOn , lPinsB , LED_ON ) ;
+        break;
+        default:
+        break;
         }
-        else
+        
+        if ( (lColour != LED_COL_LED_BOTH) && (lColour != LED_COL_LED_ALT) && !isOverideFilterActive ( lLedA ) )
+            LedsSeqDrive ( lOn , lOveride , LED_OFF ) ;
+    }
+    
+        /*turning off, an alternating pattern leaves its leds on between flashes*/
+    if ( lColour != LED_COL_LED_ALT )
+    {
+        for ( lEdge = LED_SEQ_EDGE_OFF ; lEdge <= LED_SEQ_EDGE_OFF_LAST ; lEdge++ )
         {
-            DIM_DEBUG(("DIM 2 N:[%d]\n" , pOnOrOff)) ;
-            LedConfigure(LED_2, LED_ENABLE, pOnOrOff ) ;
-            LedConfigure(LED_2, LED_DUTY_CYCLE, (0xfff));
-            LedConfigure(LED_2, LED_PERIOD, DIM_PERIOD );
-            theSink.theLEDTask->gLED_2_STATE = pOnOrOff ;
+            LEDSeqEdge_t * lOff = &pSeq->Edges[lEdge] ;
+            
+            LedsSeqDrive ( lOff , lOffA , LED_OFF ) ;
+            LedsSeqDrive ( lOff , lOffB , LED_OFF ) ;
+            
+                /*do not blip the overide led when switching off for 0 time*/
+            if ( (lEdge == LED_SEQ_EDGE_OFF_LAST) || LED_SCALE_ON_OFF_TIME(pPattern->OffTime) )
+                LedsSeqDrive ( lOff , lOveride , LED_ON ) ;
+            
+            LedsSeqDrive ( lOff , lEnable , LED_OFF ) ;
         }
     }
+    
+    pSeq->OnTime     = LedsApplyFilterToTime ( LED_SCALE_ON_OFF_TIME(pPattern->OnTime) ) ;
+    pSeq->OffTime    = LedsApplyFilterToTime ( LED_SCALE_ON_OFF_TIME(pPattern->OffTime) ) ;
+    pSeq->RepeatTime = LedsApplyFilterToTime ( LED_SCALE_REPEAT_TIME(pPattern->RepeatTime) ) ;
+    
+    LED_DEBUG(("LED: Seq Compile On[%x][%x] Off[%x][%x]\n" , pSeq->Edges[LED_SEQ_EDGE_ON_ODD].Mask , pSeq->Edges[LED_SEQ_EDGE_ON_ODD].Bits , 
+                                                             pSeq->Edges[LED_SEQ_EDGE_OFF].Mask , pSeq->Edges[LED_SEQ_EDGE_OFF].Bits )) ;
+    return TRUE ;
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqGetPattern
 
+DESCRIPTION
+    Get the pattern a sequence is playing
+    
+RETURNS
+	LEDPattern_t *
+*/
+static LEDPattern_t * LedsSeqGetPattern ( const LEDSequence_t * pSeq )
+{
+    LEDActivity_t * lLED = &theSink.theLEDTask->gActiveLEDS[pSeq->Led] ;
+    
+    if ( lLED->Type == IT_StateIndication )
+        return &theSink.theLEDTask->gStatePatterns[ lLED->Index ] ;
     else
+        return &theSink.theLEDTask->gEventPatterns[ lLED->Index ] ;
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqAge
+
+DESCRIPTION
+    Bring the time to the next edge of each sequence up to date with the time
+    elapsed since the sequencer timer was set
+    
+RETURNS
+	void
+*/
+static void LedsSeqAge ( void )
+{
+    uint32 lNow     = VmGetClock() ;
+    uint32 lElapsed = lNow - theSink.theLEDTask->gSeqArmedAt ;
+    uint16 lSeq ;
+    
+    for ( lSeq = 0 ; lSeq < LED_SEQ_NUM ; lSeq++ )
     {
-        PioSetPio (pPIO , pio_drive, pOnOrOff) ;
+        LEDSequence_t * lSequence = &theSink.theLEDTask->gSequences[lSeq] ;
+        
+        if ( lSequence->Active )
+            lSequence->Due = ( lSequence->Due > lElapsed ) ? ( lSequence->Due - (uint16)lElapsed ) : 0 ;
     }
+    
+    theSink.theLEDTask->gSeqArmedAt = lNow ;
 }
 
+/****************************************************************************
+NAME	
+	LedsSeqSchedule
+
+DESCRIPTION
+    Set the sequencer timer for the next edge due in any sequence
+    
+RETURNS
+	void
+*/
+static void LedsSeqSchedule ( void )
+{
+    uint16 lNext   = 0xFFFF ;
+    bool   lActive = FALSE ;
+    uint16 lSeq ;
+    
+    MessageCancelAll ( &theSink.theLEDTask->task, LED_SEQ_MSG ) ;
+    
+    for ( lSeq = 0 ; lSeq < LED_SEQ_NUM ; lSeq++ )
+    {
+        LEDSequence_t * lSequence = &theSink.theLEDTask->gSequences[lSeq] ;
+        
+        if ( lSequence->Active )
+        {
+            lActive = TRUE ;
+            if ( lSequence->Due < lNext )
+                lNext = lSequence->Due ;
+        }
+    }
+    
+    if ( lActive )
+    {
+        theSink.theLEDTask->gSeqArmedAt = VmGetClock() ;
+        MessageSendLater ( &theSink.theLEDTask->task, LED_SEQ_MSG , 0 , lNext ) ;
+    }
+}
 
 /****************************************************************************
 NAME	
-	PioSetDimState  
-	
+	LedsSeqStart
+
 DESCRIPTION
-    Update funtion for a led that is currently dimming
+    Compile a pattern and start playing it from the sequencer timer
+    
+RETURNS
+	FALSE if the pattern could not be compiled and has to be played by the
+    per LED message handler
+*/
+static bool LedsSeqStart ( LEDPattern_t * pPattern , IndicationType_t pType , uint16 pDelay )
+{
+    LEDSequence_t * lSequence = &theSink.theLEDTask->gSequences[ (pType == IT_StateIndication) ? LED_SEQ_STATE : LED_SEQ_EVENT ] ;
+    
+    LedsSeqAge () ;
+    lSequence->Active = FALSE ;
+    
+    if ( !LedsSeqCompile ( lSequence , pPattern , pType ) )
+    {
+        LED_DEBUG(("LED: Seq Not Compiled [%d]\n" , pPattern->LED_A)) ;
+        LedsSeqSchedule () ;
+        return FALSE ;
+    }
+    
+    lSequence->Led    = pPattern->LED_A ;
+    lSequence->Step   = 0 ;
+    lSequence->Due    = pDelay ;
+    lSequence->Active = TRUE ;
+    
+    LedsSeqSchedule () ;
+    return TRUE ;
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqStop
+
+DESCRIPTION
+    Stop any sequence playing a pattern whose primary LED is pLed
+    
+RETURNS
+	void
+*/
+static void LedsSeqStop ( uint16 pLed )
+{
+    uint16 lSeq ;
+    
+    for ( lSeq = 0 ; lSeq < LED_SEQ_NUM ; lSeq++ )
+    {
+        LEDSequence_t * lSequence = &theSink.theLEDTask->gSequences[lSeq] ;
+        
+        if ( lSequence->Active && (lSequence->Led == pLed) )
+        {
+            LedsSeqAge () ;
+            lSequence->Active = FALSE ;
+            LedsSeqSchedule () ;
+        }
+    }
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqRecompile
+
+DESCRIPTION
+    Recompile the running sequences after the active filters have changed. A
+    sequence that can no longer be compiled is handed back to the per LED 
+    message handler, which carries on from the current flash
     
 RETURNS
 	void
 */
-void PioSetDimState ( uint16 pPIO )
+static void LedsSeqRecompile ( void )
 {
-    uint16 lDim = 0x0000 ;
-    LEDActivity_t *gActiveLED = &theSink.theLEDTask->gActiveLEDS[pPIO];
+    uint16 lSeq ;
+    
+    for ( lSeq = 0 ; lSeq < LED_SEQ_NUM ; lSeq++ )
+    {
+        LEDSequence_t * lSequence = &theSink.theLEDTask->gSequences[lSeq] ;
+        
+        if ( lSequence->Active )
+        {
+            LEDActivity_t * lLED = &theSink.theLEDTask->gActiveLEDS[lSequence->Led] ;
+            
+            if ( !LedsSeqCompile ( lSequence , LedsSeqGetPattern ( lSequence ) , lLED->Type ) )
+            {
+                LED_DEBUG(("LED: Seq Handover [%d]\n" , lSequence->Led)) ;
+                LedsSeqAge () ;
+                lSequence->Active = FALSE ;
+                MessageSendLater ( &theSink.theLEDTask->task , lSequence->Led , 0 , lSequence->Due ) ;
+                LedsSeqSchedule () ;
+            }
+        }
+    }
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqStep
 
-    if (gActiveLED->DimDir && gActiveLED->DimState >= DIM_NUM_STEPS )
-    {      
-        lDim = 0xFFF;
-        DIM_DEBUG(("DIM:+[F] [ON]\n" ));
+DESCRIPTION
+    Apply the next edge of a sequence to the PIO changes being collected for
+    this tick and work out when the following edge is due
+    
+RETURNS
+	TRUE if the pattern has completed
+*/
+static bool LedsSeqStep ( LEDSequence_t * pSeq , uint16 * pMask , uint16 * pBits )
+{
+    LEDPattern_t *  lPattern  = LedsSeqGetPattern ( pSeq ) ;
+    LEDActivity_t * lLED      = &theSink.theLEDTask->gActiveLEDS[pSeq->Led] ;
+    uint16          lNumSteps ;
+    uint16          lEdge ;
+    bool            lPatternComplete = FALSE ;
+    
+        /*a pattern with no flashes counts as one, as the flash timer did*/
+    lNumSteps = ( lPattern->NumFlashes ? lPattern->NumFlashes : 1 ) * 2 ;
+    
+    if ( !(pSeq->Step & 1) )
+    {
+            /*turn on for the next flash*/
+        lLED->NumFlashesComplete++ ;
+        lLED->OnOrOff = TRUE ;
+        lEdge     = (lLED->NumFlashesComplete % 2) ? LED_SEQ_EDGE_ON_ODD : LED_SEQ_EDGE_ON_EVEN ;
+        pSeq->Due = pSeq->OnTime ;
     }
-    else if ( !gActiveLED->DimDir && gActiveLED->DimState == 0x0 )
+    else if ( pSeq->Step < (lNumSteps - 1) )
     {
-        lDim = 0 ;
-        DIM_DEBUG(("DIM:-[0] [OFF]\n" ));
+        lLED->OnOrOff = FALSE ;
+        lEdge     = LED_SEQ_EDGE_OFF ;
+        pSeq->Due = pSeq->OffTime ;
     }
     else
     {
-        if(gActiveLED->DimDir)
-            gActiveLED->DimState++ ;
-        else
-            gActiveLED->DimState-- ;
-        
-        DIM_DEBUG(("DIM:Direction [%x], DimState:[%x], DimTime:[%x]\n", gActiveLED->DimDir, gActiveLED->DimState, gActiveLED->DimTime));
+        lLED->OnOrOff = FALSE ;
+        lLED->NumFlashesComplete = 0 ;
+        lLED->NumRepeatsComplete ++ ;
+        lEdge     = LED_SEQ_EDGE_OFF_LAST ;
+        pSeq->Due = pSeq->RepeatTime ;
         
-        lDim = (gActiveLED->DimState * (DIM_STEP_SIZE) ) ;
-	if(gActiveLED->DimDir)
-	{
-	        ISA1200_SetDuty(theSink.isa_dimlev++ * 7);
-	}
-        MessageCancelAll ( &theSink.theLEDTask->task, (DIM_MSG_BASE + pPIO) ) ;                
-        MessageSendLater ( &theSink.theLEDTask->task, (DIM_MSG_BASE + pPIO) , 0 , gActiveLED->DimTime ) ;    
-    }    
+        if ( ( LED_SCALE_REPEAT_TIME(lPattern->RepeatTime) == 0 ) ||
+             ( ( lPattern->TimeOut !=0 )  && ( lLED->NumRepeatsComplete >= lPattern->TimeOut) ) )
+        {
+            lPatternComplete = TRUE ;
+        }
+    }
+    
+    *pMask |= pSeq->Edges[lEdge].Mask ;
+    *pBits  = ( *pBits & ~pSeq->Edges[lEdge].Mask ) | pSeq->Edges[lEdge].Bits ;
+    
+    pSeq->Step = ( pSeq->Step + 1 ) % lNumSteps ;
+    
+    return lPatternComplete ;
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqComplete
+
+DESCRIPTION
+    Stop a sequence that has played its pattern to the end and signal the
+    completion in the same way as the per LED message handler
+    
+RETURNS
+	void
+*/
+static void LedsSeqComplete ( LEDSequence_t * pSeq )
+{
+    LEDPattern_t *  lPattern  = LedsSeqGetPattern ( pSeq ) ;
+    LEDActivity_t * lLED      = &theSink.theLEDTask->gActiveLEDS[pSeq->Led] ;
     
-    if (pPIO == 14)
+    LED_DEBUG(("LED: Seq PatternComplete [%d]\n" , pSeq->Led)) ;
+    pSeq->Active = FALSE ;
+    
+        /*the leds of an alternating pattern are still on*/
+    if ( LedsGetPatternColour ( lPattern ) == LED_COL_LED_ALT )
+        LedsTurnOffLEDPair ( lPattern , TRUE) ;
+    
+    if ( lLED->Type == IT_EventIndication )
     {
-        LedConfigure(LED_0, LED_DUTY_CYCLE, lDim);
-        LedConfigure(LED_0, LED_PERIOD, DIM_PERIOD );  
-        LedConfigure(LED_0, LED_ENABLE, TRUE ) ;
+        LedsSendEventComplete ( lPattern->StateOrEvent + EVENTS_MESSAGE_BASE , TRUE ) ;
+        LedsEventComplete ( lLED , &theSink.theLEDTask->gActiveLEDS[lPattern->LED_B] ) ;
     }
-    else if (pPIO ==15)
-    {        
-        LedConfigure(LED_1, LED_DUTY_CYCLE, lDim);
-        LedConfigure(LED_1, LED_PERIOD, DIM_PERIOD );  
-        LedConfigure(LED_1, LED_ENABLE, TRUE ) ;
+    else if ( lLED->Type == IT_StateIndication )
+    {
+        theSink.theLEDTask->gLEDSStateTimeout = TRUE ;
     }
-    else if (pPIO ==10)
-    {        
-        LedConfigure(LED_2, LED_DUTY_CYCLE, lDim);
-        LedConfigure(LED_2, LED_PERIOD, DIM_PERIOD );  
-        LedConfigure(LED_2, LED_ENABLE, TRUE ) ;
+}
+
+/****************************************************************************
+NAME	
+	LedsSeqHandleTimer
+
+DESCRIPTION
+    Sequencer timer, applies every edge now due with a single PIO write and 
+    sets the timer for the next one
+    
+RETURNS
+	void
+*/
+static void LedsSeqHandleTimer ( void )
+{
+    uint16 lMask = 0 ;
+    uint16 lBits = 0 ;
+    bool   lComplete[LED_SEQ_NUM] ;
+    uint16 lSeq ;
+    
+    LedsSeqAge () ;
+    
+    for ( lSeq = 0 ; lSeq < LED_SEQ_NUM ; lSeq++ )
+    {
+        LEDSequence_t * lSequence = &theSink.theLEDTask->gSequences[lSeq] ;
+        
+        lComplete[lSeq] = FALSE ;
+        if ( lSequence->Active && (lSequence->Due == 0) )
+            lComplete[lSeq] = LedsSeqStep ( lSequence , &lMask , &lBits ) ;
     }
     
+    if ( lMask )
+    {
+        LED_DEBUG(("LED: Seq Set [%x][%x]\n" , lMask , lBits)) ;
+        PioSetPios ( lMask , lBits ) ;
+        LedsNoteLit ( lMask , lBits ) ;
+    }
+    
+        /*completion may start the next indication so only once the pins are set*/
+    for ( lSeq = 0 ; lSeq < LED_SEQ_NUM ; lSeq++ )
+    {
+        if ( lComplete[lSeq] )
+            LedsSeqComplete ( &theSink.theLEDTask->gSequences[lSeq] ) ;
+    }
+    
+    LedsSeqSchedule () ;
 }
 
 /****************************************************************************
@@ -348,6 +978,8 @@ void LedsInit ( void )
     theSink.theLEDTask->gTriColLeds.TriCol_c = 0 ;
     
     theSink.theLEDTask->gFollowing = FALSE ; 
+    
+    memset ( theSink.theLEDTask->gSequences , 0 , sizeof(theSink.theLEDTask->gSequences) ) ;
 }
 
      
@@ -493,6 +1125,8 @@ void ledsIndicateLedsPattern(LEDPattern_t *lPattern, uint8 lIndex, IndicationTyp
         /*if the PIO we want to use is currently indicating an event then do interrupt the event*/
         MessageCancelAll (&theSink.theLEDTask->task, lPrimaryLED ) ;
         MessageCancelAll (&theSink.theLEDTask->task, lSecondaryLED ) ;
+        LedsSeqStop ( lPrimaryLED ) ;
+        LedsSeqStop ( lSecondaryLED ) ;
     }
         
     /*cancel all led state indications*/
@@ -531,13 +1165,16 @@ void ledsIndicateLedsPattern(LEDPattern_t *lPattern, uint8 lIndex, IndicationTyp
     {
         if(Ind_type == IT_EventIndication)
         {
-            MessageSend (&theSink.theLEDTask->task, lPrimaryLED, 0) ;
+            /*play from the sequencer if possible, otherwise from the per LED messages*/
+            if (!LedsSeqStart ( lPattern , Ind_type , 0 ))
+                MessageSend (&theSink.theLEDTask->task, lPrimaryLED, 0) ;
             theSink.theLEDTask->gCurrentlyIndicatingEvent = TRUE ;
         }
         else
         {
             /*send the first message for this state LED indication*/ 
-            MessageSendLater (&theSink.theLEDTask->task , lPrimaryLED, 0 , LEDS_STATE_START_DELAY_MS ) ;
+            if (!LedsSeqStart ( lPattern , Ind_type , LEDS_STATE_START_DELAY_MS ))
+                MessageSendLater (&theSink.theLEDTask->task , lPrimaryLED, 0 , LEDS_STATE_START_DELAY_MS ) ;
         }
     }
 }
@@ -565,6 +1202,7 @@ void LedsIndicateNoState ( void  )
         if (lActiveLeds->Type == IT_StateIndication)
         {
             MessageCancelAll ( &theSink.theLEDTask->task, lLoop ) ; 
+            LedsSeqStop ( lLoop ) ;
             lActiveLeds->Type =  IT_Undefined ;
             
             LED_DEBUG(("LED: CancelStateInd[%x]\n" , lLoop)) ;
@@ -621,7 +1259,7 @@ static void LedsMessageHandler( Task task, MessageId id, Message message )
     LEDPattern_t *  lPattern = NULL ;
     bool lPatternComplete = FALSE ;
     
-    if (id < DIM_MSG_BASE )
+    if (id < DIM_MSG_TICK )
     {
         
         /*which pattern are we currently indicating for this LED pair*/
@@ -767,10 +1405,15 @@ static void LedsMessageHandler( Task task, MessageId id, Message message )
         } 
         
     }
-    else
+    else if (id == LED_SEQ_MSG )
+    {
+        /*compiled pattern edge*/
+        LedsSeqHandleTimer ( ) ;
+    }
+    else if (id == DIM_MSG_TICK )
     {
         /*DIMMING LED Update message */       
-        PioSetDimState ( (id - DIM_MSG_BASE) );
+        PioSetDimState ( );
     }
 }
 
@@ -1169,6 +1812,10 @@ static void LedsEnableFilter ( uint16 pFilter , bool pEnable)
         LED_DEBUG(("LED: DisF [%lx] [%lx] [%x]\n", lOldMask , LED_GETACTIVEFILTERS() , pFilter));
     }
     
+    /* the filters are compiled into the running sequences */
+    if (lOldMask != LED_GETACTIVEFILTERS())
+        LedsSeqRecompile ( ) ;
+    
     /* Check if we should indicate state */
     if ((theSink.theLEDTask->gEventFilters[pFilter].OverideDisable) && (lOldMask != LED_GETACTIVEFILTERS()))
         LEDManagerIndicateState ( stateManagerGetState () ) ;                          
@@ -1315,6 +1962,7 @@ void LedsResetAllLeds ( void )
         if (theSink.theLEDTask->gActiveLEDS[lLoop].Type == IT_EventIndication)
         {
             MessageCancelAll ( &theSink.theLEDTask->task, lLoop ) ; 
+            LedsSeqStop ( lLoop ) ;
             theSink.theLEDTask->gActiveLEDS[lLoop].Type =  IT_Undefined ;
             
             LED_DEBUG(("LED: CancelEventInd[%x]\n" , lLoop)) ;
@@ -15,7 +15,8 @@ DESCRIPTION
 #include "sink_leddata.h"
 #include "sink_states.h"
 
-#define DIM_MSG_BASE (0x1000)
+#define DIM_MSG_TICK (0x1000)
+#define LED_SEQ_MSG  (0x2000)
 
 /****************************************************************************
 NAME	
@@ -34,12 +35,12 @@ NAME
 	PioSetDimState  
 	
 DESCRIPTION
-    Update funtion for a led that is currently dimming
+    Update funtion for the leds that are currently dimming
     
 RETURNS
 	void
 */
-void PioSetDimState ( uint16 pPIO );
+void PioSetDimState ( void );
 
 
 
@@ -19,22 +19,17 @@ NOTES
 #include "sink_link_policy.h"
 #include "sink_statemanager.h"
 #include "sink_devicemanager.h"
+#include "sink_powermanager.h"
 
 #include <sink.h>
-
-#ifdef ENABLE_PBAP
 #include <bdaddr.h>
-#endif
-
-#ifdef ENABLE_PEER
-/* headers required for sending DM_HCI_QOS_SETUP_REQ */
 #include <vm.h>
 
+/* headers required for sending DM_HCI_QOS_SETUP_REQ */
 #include <app/bluestack/types.h>
 #include <app/bluestack/bluetooth.h>
 #include <app/bluestack/hci.h>
 #include <app/bluestack/dm_prim.h>
-#endif
 
 
 /* Lower power table for HFP SLC */
@@ -74,6 +69,13 @@ static const lp_power_table lp_powertable_a2dp_stream_source[]=
     {lp_active,    0,              0,              0,          0,          0}      /* Go into active mode and stay there */
 };
 
+/* Lower power table for A2DP streaming to a device in low latency mode. */
+static const lp_power_table lp_powertable_a2dp_stream_low_latency[]=
+{
+    /* mode,        min_interval,   max_interval,   attempt,    timeout,    duration */
+    {lp_active,    0,              0,              0,          0,          0}      /* Go into active mode and stay there */
+};
+
 #ifdef ENABLE_PBAP
 /* Lower power table for PBAP access. */
 static const lp_power_table lp_powertable_pbap_access[]=
@@ -93,6 +95,59 @@ static const lp_power_table lp_powertable_avrcp[]=
 };
 #endif
 
+/* Lower power table for idle links with recent AVRCP or GAIA traffic */
+static const lp_power_table lp_powertable_responsive[2]=
+{
+    /* mode,        min_interval,   max_interval,   attempt,    timeout,    duration */
+    {lp_passive,    0,              0,              0,          0,          2},     /* Passive mode 2 seconds */
+    {lp_sniff,      160,            160,            2,          1,          0}      /* Enter sniff mode (100mS)*/
+};
+
+/* Lower power table for idle links with no traffic for a long time or a low battery */
+static const lp_power_table lp_powertable_deep[1]=
+{
+    /* mode,        min_interval,   max_interval,   attempt,    timeout,    duration */
+    {lp_sniff,      2048,           2048,           2,          1,          0}      /* Enter sniff mode (1.28S)*/
+};
+
+/* poll interval of the relay link and of low latency a2dp links, the longer one is used when the battery is low */
+#define LP_QOS_LATENCY_FAST         (10000)
+#define LP_QOS_LATENCY_DEFAULT      (25000)
+#define LP_QOS_LATENCY_LOW_POWER    (40000)
+
+/* Message sent to the link policy task to re-evaluate the idle level */
+#define LP_EVALUATE                 (0)
+
+/* A link using the idle settings */
+typedef struct
+{
+    Sink        sink;
+    bdaddr      addr;
+} lp_idle_link;
+
+typedef struct
+{
+    lp_idle_link    link[LP_MAX_IDLE_LINKS];
+    lp_transition   log[LP_LOG_SIZE];
+    uint32          time_in_level[lp_num_levels];
+    uint32          last_traffic;       /* clock of the last AVRCP or GAIA traffic */
+    uint32          idle_since;         /* clock of the last traffic or new idle link */
+    uint32          last_account;       /* clock time_in_level was last updated */
+    uint16          transitions;
+    unsigned        level:2;            /* lp_level */
+    unsigned        pending:2;          /* lp_level waiting on the hysteresis */
+    unsigned        pending_count:3;
+    unsigned        links:3;            /* entries of link in use */
+    unsigned        log_next:3;
+    unsigned        traffic_seen:1;
+    unsigned        fast_poll:2;        /* a2dp links polled quickly for low latency */
+} lp_adaptive_t;
+
+static void linkPolicyHandler(Task task, MessageId id, Message message);
+
+static TaskData gLinkPolicyTask = { linkPolicyHandler };
+static lp_adaptive_t gLinkPolicy = { {{0}}, {{0}}, {0}, 0, 0, 0, 0, lp_level_normal };
+
 #ifdef DEBUG_LP
     #define LP_DEBUG(x) DEBUG(x)
 #else
@@ -143,33 +198,485 @@ static uint16 linkPolicyNumberPhysicalConnections (void)
 
 /****************************************************************************
 NAME    
-    linkPolicyUseDefaultSettings
+    linkPolicyBatteryLow
+
+DESCRIPTION
+    check the battery level reported by the power manager
+    
+RETURNS
+    TRUE if the battery is low or critical
+*/
+static bool linkPolicyBatteryLow(void)
+{
+    power_battery_level level = powerManagerGetLBIPM();
+    return ((level == POWER_BATT_CRITICAL) || (level == POWER_BATT_LOW));
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyTableDuty
+
+DESCRIPTION
+    estimate the radio duty cycle of a link settled in the last mode of a
+    power table, in sniff the radio is on for the receive and transmit slot
+    of each attempt in every interval
+    
+RETURNS
+    duty cycle in 1/1000
+*/
+static uint16 linkPolicyTableDuty(const lp_power_table * table, uint16 entries)
+{
+    const lp_power_table * last = &table[entries - 1];
+
+    if((last->state != lp_sniff) || !last->max_interval)
+        return 1000;
+
+    return (uint16)(((uint32)last->attempt * 2 * 1000) / last->max_interval);
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyLevelDuty
+
+DESCRIPTION
+    estimate the radio duty cycle of an idle link at a level
+    
+RETURNS
+    duty cycle in 1/1000
+*/
+static uint16 linkPolicyLevelDuty(lp_level level)
+{
+    switch(level)
+    {
+        case lp_level_responsive:
+            return linkPolicyTableDuty(lp_powertable_responsive, 2);
+        case lp_level_deep:
+            return linkPolicyTableDuty(lp_powertable_deep, 1);
+        default:
+            if((theSink.user_power_table)&&(theSink.user_power_table->normalEntries))
+                return linkPolicyTableDuty(&theSink.user_power_table->powertable[0], theSink.user_power_table->normalEntries);
+            return linkPolicyTableDuty(lp_powertable_default, 2);
+    }
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyAccount
 
 DESCRIPTION
-    set the link policy based on no a2dp streaming or sco 
+    add the time since the last update to the current level if there were
+    idle links
     
 RETURNS
     void
 */
-static void linkPolicyUseDefaultSettings(Sink sink)
+static void linkPolicyAccount(uint32 now)
+{
+    if(gLinkPolicy.links)
+        gLinkPolicy.time_in_level[gLinkPolicy.level] += now - gLinkPolicy.last_account;
+    gLinkPolicy.last_account = now;
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyApplyIdleSettings
+
+DESCRIPTION
+    set sniff subrating and the power table of an idle link for the current
+    level
+    
+RETURNS
+    void
+*/
+static void linkPolicyApplyIdleSettings(Sink sink)
 {
     /* Set up our sniff sub rate params for SLC */
     ssr_params* slc_params = &theSink.conf2->ssr_data.slc_params;
-    ConnectionSetSniffSubRatePolicy(sink, slc_params->max_remote_latency, slc_params->min_remote_timeout, slc_params->min_local_timeout);
+
+    switch(gLinkPolicy.level)
+    {
+        case lp_level_responsive:
+            /* no subrating, the remote should see the shortest latency */
+            LP_DEBUG(("LP: SetLinkP - responsive table \n" ));    
+            ConnectionSetSniffSubRatePolicy(sink, 0, 0, 0);
+            ConnectionSetLinkPolicy(sink, 2 ,lp_powertable_responsive);
+        break;
+
+        case lp_level_deep:
+            /* allow the remote to skip twice as many sniff anchors */
+            LP_DEBUG(("LP: SetLinkP - deep table \n" ));    
+            ConnectionSetSniffSubRatePolicy(sink, (slc_params->max_remote_latency > 0x7FFF) ? 0xFFFF : (slc_params->max_remote_latency * 2),
+                                            slc_params->min_remote_timeout, slc_params->min_local_timeout);
+            ConnectionSetLinkPolicy(sink, 1 ,lp_powertable_deep);
+        break;
+
+        default:
+            ConnectionSetSniffSubRatePolicy(sink, slc_params->max_remote_latency, slc_params->min_remote_timeout, slc_params->min_local_timeout);
     
-    /* audio not active, normal role, check for user defined power table */
-    if((theSink.user_power_table)&&(theSink.user_power_table->normalEntries))
-    {                  
-        LP_DEBUG(("LP: SetLinkP - norm user table \n" ));    
-        /* User supplied power table */
-        ConnectionSetLinkPolicy(sink, theSink.user_power_table->normalEntries ,&theSink.user_power_table->powertable[0]);               
+            /* audio not active, normal role, check for user defined power table */
+            if((theSink.user_power_table)&&(theSink.user_power_table->normalEntries))
+            {                  
+                LP_DEBUG(("LP: SetLinkP - norm user table \n" ));    
+                /* User supplied power table */
+                ConnectionSetLinkPolicy(sink, theSink.user_power_table->normalEntries ,&theSink.user_power_table->powertable[0]);               
+            }
+            /* no user defined power table so use default normal power table */       
+            else
+            {    
+                LP_DEBUG(("LP: SetLinkP - norm default table \n" ));    
+                ConnectionSetLinkPolicy(sink, 2 ,lp_powertable_default);
+            }              
+        break;
+    }
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyFindStream
+
+DESCRIPTION
+    find the a2dp link streaming to or from a device
+    
+RETURNS
+    TRUE if the device is streaming, with the a2dp link in index
+*/
+static bool linkPolicyFindStream(const bdaddr * addr, uint16 * index)
+{
+    uint8 i;
+
+    if(!theSink.a2dp_link_data)
+        return FALSE;
+
+    for_all_a2dp(i)
+    {
+        if(theSink.a2dp_link_data->connected[i] &&
+           BdaddrIsSame(&theSink.a2dp_link_data->bd_addr[i], addr) &&
+           (A2dpMediaGetState(theSink.a2dp_link_data->device_id[i], theSink.a2dp_link_data->stream_id[i]) == a2dp_stream_streaming))
+        {
+            *index = i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyFindIdleLink
+
+DESCRIPTION
+    find the idle link entry for a device
+    
+RETURNS
+    the entry index, the number of idle links if the device has no entry
+*/
+static uint16 linkPolicyFindIdleLink(const bdaddr * addr)
+{
+    uint16 i;
+
+    for(i = 0; i < gLinkPolicy.links; i++)
+    {
+        if(BdaddrIsSame(&gLinkPolicy.link[i].addr, addr))
+            break;
+    }
+    return i;
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyRemoveIdleLink
+
+DESCRIPTION
+    stop tracking an idle link entry
+    
+RETURNS
+    void
+*/
+static void linkPolicyRemoveIdleLink(uint16 i)
+{
+    linkPolicyAccount(VmGetClock());
+
+    gLinkPolicy.links--;
+    for(; i < gLinkPolicy.links; i++)
+        gLinkPolicy.link[i] = gLinkPolicy.link[i + 1];
+
+    if(!gLinkPolicy.links)
+        MessageCancelAll(&gLinkPolicyTask, LP_EVALUATE);
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyLeaveIdle
+
+DESCRIPTION
+    the link of a sink is being given audio or access settings, stop
+    adapting it
+    
+RETURNS
+    void
+*/
+static void linkPolicyLeaveIdle(Sink sink)
+{
+    typed_bdaddr taddr;
+    uint16 i;
+
+    if(SinkGetBdAddr(sink, &taddr))
+    {
+        i = linkPolicyFindIdleLink(&taddr.addr);
+        if(i < gLinkPolicy.links)
+            linkPolicyRemoveIdleLink(i);
+    }
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyDesiredLevel
+
+DESCRIPTION
+    work out the level idle links should be at
+    
+RETURNS
+    the level and the reason for it
+*/
+static lp_level linkPolicyDesiredLevel(uint32 now, lp_reason * reason)
+{
+    bool battery_low = linkPolicyBatteryLow();
+
+    if(gLinkPolicy.traffic_seen && ((now - gLinkPolicy.last_traffic) < LP_ACTIVITY_HOLD_MS))
+    {
+        if(battery_low)
+        {
+            *reason = lp_reason_battery;
+            return lp_level_normal;
+        }
+        /* short intervals on several links leave little room to schedule them */
+        if(linkPolicyNumberPhysicalConnections() > 1)
+        {
+            *reason = lp_reason_multipoint;
+            return lp_level_normal;
+        }
+        *reason = lp_reason_traffic;
+        return lp_level_responsive;
+    }
+
+    if(battery_low)
+    {
+        *reason = lp_reason_battery;
+        return lp_level_deep;
+    }
+
+    *reason = lp_reason_idle;
+    return ((now - gLinkPolicy.idle_since) >= LP_DEEP_IDLE_MS) ? lp_level_deep : lp_level_normal;
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyScheduleEvaluate
+
+DESCRIPTION
+    arrange the next evaluation for when the level wanted may next change:
+    the next hysteresis check of a pending drop, the end of the traffic
+    hold or the end of the deep idle time. Nothing is scheduled once no
+    such time is left, traffic and battery changes evaluate again.
+    
+RETURNS
+    void
+*/
+static void linkPolicyScheduleEvaluate(uint32 now)
+{
+    uint32 delay = 0;
+
+    if(gLinkPolicy.pending_count)
+        delay = LP_EVALUATE_MS;
+    else if(gLinkPolicy.traffic_seen && ((now - gLinkPolicy.last_traffic) < LP_ACTIVITY_HOLD_MS))
+        delay = LP_ACTIVITY_HOLD_MS - (now - gLinkPolicy.last_traffic);
+    else if((gLinkPolicy.level != lp_level_deep) && ((now - gLinkPolicy.idle_since) < LP_DEEP_IDLE_MS))
+        delay = LP_DEEP_IDLE_MS - (now - gLinkPolicy.idle_since);
+
+    MessageCancelAll(&gLinkPolicyTask, LP_EVALUATE);
+    if(delay)
+        MessageSendLater(&gLinkPolicyTask, LP_EVALUATE, 0, delay);
+
+    LP_DEBUG(("LP: next evaluation in %lums\n", delay));
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyEvaluate
+
+DESCRIPTION
+    move idle links to the level wanted, more responsive levels are taken
+    straight away and lower power levels once wanted for LP_HYSTERESIS_CHECKS
+    evaluations in a row
+    
+RETURNS
+    void
+*/
+static void linkPolicyEvaluate(void)
+{
+    uint32 now = VmGetClock();
+    lp_transition * entry;
+    lp_reason reason;
+    lp_level level;
+    uint16 stream;
+    uint16 i;
+
+    /* drop links that have gone or have started streaming */
+    for(i = gLinkPolicy.links; i > 0; i--)
+    {
+        if(!SinkIsValid(gLinkPolicy.link[i - 1].sink) || linkPolicyFindStream(&gLinkPolicy.link[i - 1].addr, &stream))
+            linkPolicyRemoveIdleLink(i - 1);
+    }
+
+    if(!gLinkPolicy.links)
+        return;
+
+    linkPolicyAccount(now);
+    level = linkPolicyDesiredLevel(now, &reason);
+
+    if(level == gLinkPolicy.level)
+    {
+        gLinkPolicy.pending_count = 0;
+    }
+    else if(level > gLinkPolicy.level)
+    {
+        if(gLinkPolicy.pending != level)
+        {
+            gLinkPolicy.pending = level;
+            gLinkPolicy.pending_count = 0;
+        }
+        if(++gLinkPolicy.pending_count < LP_HYSTERESIS_CHECKS)
+            level = gLinkPolicy.level;
+    }
+
+    if(level != gLinkPolicy.level)
+    {
+        entry = &gLinkPolicy.log[gLinkPolicy.log_next];
+        entry->time   = (uint16)(now / 1000);
+        entry->duty   = linkPolicyLevelDuty(level);
+        entry->from   = gLinkPolicy.level;
+        entry->to     = level;
+        entry->reason = reason;
+        entry->links  = gLinkPolicy.links;
+        gLinkPolicy.log_next = (gLinkPolicy.log_next + 1) % LP_LOG_SIZE;
+        gLinkPolicy.transitions++;
+
+        LP_DEBUG(("LP: level %d -> %d reason %d duty %d/1000 links %d\n", gLinkPolicy.level, level, reason, entry->duty, gLinkPolicy.links));
+
+        gLinkPolicy.level = level;
+        gLinkPolicy.pending_count = 0;
+
+        for(i = 0; i < gLinkPolicy.links; i++)
+            linkPolicyApplyIdleSettings(gLinkPolicy.link[i].sink);
+    }
+
+    linkPolicyScheduleEvaluate(now);
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyHandler
+
+DESCRIPTION
+    handle messages for the adaptive idle level
+    
+RETURNS
+    void
+*/
+static void linkPolicyHandler(Task task, MessageId id, Message message)
+{
+    if(id == LP_EVALUATE)
+        linkPolicyEvaluate();
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyUseDefaultSettings
+
+DESCRIPTION
+    set the link policy based on no a2dp streaming or sco, the settings
+    follow the idle level from then on. A link still streaming a2dp, as
+    when sco or phonebook access ends during a stream, is given the a2dp
+    settings instead.
+    
+RETURNS
+    void
+*/
+static void linkPolicyUseDefaultSettings(Sink sink)
+{
+    typed_bdaddr taddr;
+    uint16 i;
+
+    if(SinkGetBdAddr(sink, &taddr))
+    {
+        if(linkPolicyFindStream(&taddr.addr, &i))
+        {
+            LP_DEBUG(("LP: SetLinkP - streaming, a2dp settings \n" ));
+            linkPolicyLeaveIdle(sink);
+            linkPolicyUseA2dpSettings(theSink.a2dp_link_data->device_id[i], theSink.a2dp_link_data->stream_id[i],
+                                      A2dpMediaGetSink(theSink.a2dp_link_data->device_id[i], theSink.a2dp_link_data->stream_id[i]));
+            return;
+        }
+
+        /* track the link so its settings follow the idle level */
+        i = linkPolicyFindIdleLink(&taddr.addr);
+        if(i < gLinkPolicy.links)
+        {
+            gLinkPolicy.link[i].sink = sink;
+        }
+        else if(gLinkPolicy.links < LP_MAX_IDLE_LINKS)
+        {
+            linkPolicyAccount(VmGetClock());
+            gLinkPolicy.link[i].sink = sink;
+            gLinkPolicy.link[i].addr = taddr.addr;
+            gLinkPolicy.links++;
+            gLinkPolicy.idle_since = VmGetClock();
+        }
+
+        if(gLinkPolicy.links)
+        {
+            MessageCancelAll(&gLinkPolicyTask, LP_EVALUATE);
+            MessageSendLater(&gLinkPolicyTask, LP_EVALUATE, 0, LP_EVALUATE_MS);
+        }
+    }
+
+    linkPolicyApplyIdleSettings(sink);
+}
+
+
+/****************************************************************************
+NAME    
+    linkPolicySetQos
+
+DESCRIPTION
+    Request a poll interval for the ACL to an a2dp device, latency in us
+    
+RETURNS
+    void
+*/
+static void linkPolicySetQos(uint16 DeviceId, uint32 latency)
+{
+    typed_bdaddr tbdaddr;
+
+    if (A2dpDeviceGetBdaddr(DeviceId, &tbdaddr.addr))
+    {
+        MESSAGE_MAKE(prim, DM_HCI_QOS_SETUP_REQ_T);
+        prim->common.op_code = DM_HCI_QOS_SETUP_REQ;
+        prim->common.length = sizeof(DM_HCI_QOS_SETUP_REQ_T);
+        prim->bd_addr.lap = tbdaddr.addr.lap;
+        prim->bd_addr.uap = tbdaddr.addr.uap;
+        prim->bd_addr.nap = tbdaddr.addr.nap;
+
+        /* latency is the only thing used in the request and sets the poll interval */
+        prim->service_type = HCI_QOS_GUARANTEED;
+        prim->token_rate = 0xffffffff;
+        prim->peak_bandwidth = 0x0000aaaa;
+        prim->latency = latency;
+        prim->delay_variation = 0xffffffff;
+
+        DEBUG(("LP: SetLinkP - Set QoS %luus\n",prim->latency));
+        VmSendDmPrim(prim);
     }
-    /* no user defined power table so use default normal power table */       
-    else
-    {    
-        LP_DEBUG(("LP: SetLinkP - norm default table \n" ));    
-        ConnectionSetLinkPolicy(sink, 2 ,lp_powertable_default);
-    }              
 }
 
 
@@ -187,6 +694,11 @@ void linkPolicyUseA2dpSettings(uint16 DeviceId, uint16 StreamId, Sink sink )
 {
     Sink sinkAG1,sinkAG2 = NULL;
     bool faster_poll = FALSE;
+    bool low_latency = FALSE;
+    uint16 priority = MAX_A2DP_CONNECTIONS;
+    
+    if (getA2dpIndex(DeviceId, &priority))
+        low_latency = theSink.a2dp_link_data->low_latency[priority];
     
     /* obtain any sco sinks */
     HfpLinkGetAudioSink(hfp_primary_link, &sinkAG1);
@@ -196,8 +708,17 @@ void linkPolicyUseA2dpSettings(uint16 DeviceId, uint16 StreamId, Sink sink )
     if ((!sinkAG1 && !sinkAG2) && (A2dpMediaGetState(DeviceId, StreamId) == a2dp_stream_streaming))
                                 
     {
+        linkPolicyLeaveIdle(sink);
+
+        /* a device in low latency mode is kept active and polled quickly whatever the tables say */
+        if (low_latency)
+        {
+            LP_DEBUG(("LP: SetLinkP - A2dp low latency table \n" ));    
+            ConnectionSetLinkPolicy(sink, 1 ,lp_powertable_a2dp_stream_low_latency);
+            faster_poll = TRUE;
+        }
         /* is there a user power table available from ps ? */
-        if((theSink.user_power_table) && (theSink.user_power_table->A2DPStreamEntries))
+        else if((theSink.user_power_table) && (theSink.user_power_table->A2DPStreamEntries))
         {                
             LP_DEBUG(("LP: SetLinkP - A2dp user table \n"))
 
@@ -226,11 +747,10 @@ void linkPolicyUseA2dpSettings(uint16 DeviceId, uint16 StreamId, Sink sink )
     /* if not streaming a2dp check for the prescence of sco data and if none found go to normal settings */
     else if ((!sinkAG1 && !sinkAG2) && (A2dpMediaGetState(DeviceId, StreamId) != a2dp_stream_streaming))
     {
-        uint16 priority;
-        
         if (getA2dpIndex(DeviceId, &priority) && (theSink.a2dp_link_data->peer_device[priority] == remote_device_peer))
         {
             LP_DEBUG(("LP: SetLinkP - a2dp default table \n" ));    
+            linkPolicyLeaveIdle(sink);
             ConnectionSetLinkPolicy(sink, 2 ,lp_powertable_a2dp_default);
         }
         else
@@ -241,32 +761,23 @@ void linkPolicyUseA2dpSettings(uint16 DeviceId, uint16 StreamId, Sink sink )
     }
     
 #ifdef ENABLE_PEER
-    {   /* Set a reasonable poll interval for the relay link to help if we ever get into a */
-        /* scatternet situation due to an AV SRC refusing to be slave.                     */
-        typed_bdaddr tbdaddr;
-
-        if (A2dpDeviceGetBdaddr(DeviceId, &tbdaddr.addr))
-        {
-            MESSAGE_MAKE(prim, DM_HCI_QOS_SETUP_REQ_T);
-            prim->common.op_code = DM_HCI_QOS_SETUP_REQ;
-            prim->common.length = sizeof(DM_HCI_QOS_SETUP_REQ_T);
-            prim->bd_addr.lap = tbdaddr.addr.lap;
-            prim->bd_addr.uap = tbdaddr.addr.uap;
-            prim->bd_addr.nap = tbdaddr.addr.nap;
-
-            /* latency is the only thing used in the request and sets the poll interval */
-            prim->service_type = HCI_QOS_GUARANTEED;
-            prim->token_rate = 0xffffffff;
-            prim->peak_bandwidth = 0x0000aaaa;
-            prim->latency = faster_poll ? 10000 : 25000;
-            prim->delay_variation = 0xffffffff;
-
-            DEBUG(("LP: SetLinkP - Set QoS %lums\n",prim->latency));
-            VmSendDmPrim(prim);
-        }
+    /* Set a reasonable poll interval for the relay link to help if we ever get into a */
+    /* scatternet situation due to an AV SRC refusing to be slave.                     */
+    linkPolicySetQos(DeviceId, faster_poll ? LP_QOS_LATENCY_FAST : 
+                               (linkPolicyBatteryLow() ? LP_QOS_LATENCY_LOW_POWER : LP_QOS_LATENCY_DEFAULT));
 
-        /* Check connection role is suitable too */
-        linkPolicyGetRole(&sink);
+    /* Check connection role is suitable too */
+    linkPolicyGetRole(&sink);
+#else
+    /* otherwise only low latency links have the poll interval set, and are put back once not streaming */
+    if ((priority < MAX_A2DP_CONNECTIONS) && (faster_poll || (gLinkPolicy.fast_poll & (1 << priority))))
+    {
+        linkPolicySetQos(DeviceId, faster_poll ? LP_QOS_LATENCY_FAST : LP_QOS_LATENCY_DEFAULT);
+        
+        if (faster_poll)
+            gLinkPolicy.fast_poll |= (1 << priority);
+        else
+            gLinkPolicy.fast_poll &= ~(1 << priority);
     }
 #endif
 }
@@ -291,6 +802,8 @@ void linkPolicyUseHfpSettings(hfp_link_priority priority, Sink slcSink)
     {
         /* Set up our sniff sub rate params for SCO */
         ssr_params* sco_params = &theSink.conf2->ssr_data.sco_params;
+
+        linkPolicyLeaveIdle(slcSink);
         ConnectionSetSniffSubRatePolicy(slcSink, sco_params->max_remote_latency, sco_params->min_remote_timeout, sco_params->min_local_timeout);
        
         /* is there a user power table available from ps ? */
@@ -333,6 +846,7 @@ void linkPolicyUseAvrcpSettings( Sink slcSink )
 {
     if(slcSink)
     {
+        linkPolicyLeaveIdle(slcSink);
         ConnectionSetLinkPolicy(slcSink, 2 ,lp_powertable_avrcp); 
     }
 }
@@ -397,6 +911,7 @@ void linkPolicySetLinkinActiveMode(Sink sink)
 
     if(SinkIsValid(sink))
     {
+        linkPolicyLeaveIdle(sink);
         ConnectionSetLinkPolicy(sink, 1 , lp_powertable_pbap_access);
     } 
 }
@@ -634,3 +1149,77 @@ void linkPolicyCheckRoles(void)
 #endif        
 }
 
+
+/****************************************************************************
+NAME    
+    linkPolicyNoteActivity
+*/
+void linkPolicyNoteActivity(void)
+{
+    gLinkPolicy.last_traffic = VmGetClock();
+    gLinkPolicy.idle_since   = gLinkPolicy.last_traffic;
+    gLinkPolicy.traffic_seen = TRUE;
+
+    if(!gLinkPolicy.links)
+        return;
+
+    /* the level only has to change if it is not already responsive, otherwise
+       the traffic cancels any pending drop and extends the hold */
+    if(gLinkPolicy.level != lp_level_responsive)
+    {
+        linkPolicyEvaluate();
+    }
+    else
+    {
+        gLinkPolicy.pending_count = 0;
+        linkPolicyScheduleEvaluate(gLinkPolicy.last_traffic);
+    }
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyBatteryChanged
+*/
+void linkPolicyBatteryChanged(void)
+{
+    if(gLinkPolicy.links)
+        linkPolicyEvaluate();
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyGetTransition
+*/
+const lp_transition * linkPolicyGetTransition(uint16 age)
+{
+    if((age >= LP_LOG_SIZE) || (age >= gLinkPolicy.transitions))
+        return NULL;
+
+    return &gLinkPolicy.log[(gLinkPolicy.log_next + LP_LOG_SIZE - 1 - age) % LP_LOG_SIZE];
+}
+
+/****************************************************************************
+NAME    
+    linkPolicyGetAdaptiveStats
+*/
+void linkPolicyGetAdaptiveStats(lp_adaptive_stats * stats)
+{
+    uint32 weighted = 0;
+    uint32 total = 0;
+    uint16 level;
+
+    linkPolicyAccount(VmGetClock());
+
+    for(level = 0; level < lp_num_levels; level++)
+    {
+        uint32 seconds = gLinkPolicy.time_in_level[level] / 1000;
+
+        stats->time_in_level[level] = gLinkPolicy.time_in_level[level];
+        weighted += seconds * linkPolicyLevelDuty(level);
+        total    += seconds;
+    }
+
+    stats->transitions  = gLinkPolicy.transitions;
+    stats->duty         = linkPolicyLevelDuty(gLinkPolicy.level);
+    stats->average_duty = total ? (uint16)(weighted / total) : stats->duty;
+}
@@ -11,6 +11,67 @@ DESCRIPTION
 #ifndef _SINK_LINK_POLICY_H_
 #define _SINK_LINK_POLICY_H_
 
+
+/* Power levels for links with no audio, chosen from recent traffic, idle
+   time, battery level and the number of devices connected */
+typedef enum
+{
+    lp_level_responsive,        /* recent AVRCP or GAIA traffic, short sniff interval */
+    lp_level_normal,            /* default or user power table */
+    lp_level_deep,              /* long idle or low battery, long sniff interval */
+    lp_num_levels
+} lp_level;
+
+/* What caused a change of level */
+typedef enum
+{
+    lp_reason_traffic,
+    lp_reason_idle,
+    lp_reason_battery,
+    lp_reason_multipoint
+} lp_reason;
+
+/* time after AVRCP or GAIA traffic that links stay responsive */
+#define LP_ACTIVITY_HOLD_MS         (5000)
+
+/* time without traffic before links drop to the deep level */
+#define LP_DEEP_IDLE_MS             (60000)
+
+/* interval between the evaluations that confirm a drop to a lower power
+   level, otherwise the level is evaluated when a hold or idle time ends */
+#define LP_EVALUATE_MS              (2000)
+
+/* evaluations in a row that must agree before dropping to a lower power
+   level, moving to a more responsive level for traffic is immediate */
+#define LP_HYSTERESIS_CHECKS        (2)
+
+/* most links tracked at once, 2 AGs each with HFP and A2DP */
+#define LP_MAX_IDLE_LINKS           (4)
+
+/* number of level changes kept */
+#define LP_LOG_SIZE                 (8)
+
+/* A change of level */
+typedef struct
+{
+    uint16      time;           /* seconds since boot, wraps */
+    uint16      duty;           /* estimated radio duty cycle at the new level in 1/1000 */
+    unsigned    from:2;         /* lp_level */
+    unsigned    to:2;           /* lp_level */
+    unsigned    reason:2;       /* lp_reason */
+    unsigned    links:3;        /* idle links the level was applied to */
+    unsigned    unused:7;
+} lp_transition;
+
+/* Time spent at each level while there were idle links */
+typedef struct
+{
+    uint32      time_in_level[lp_num_levels];   /* in ms */
+    uint16      transitions;
+    uint16      duty;                           /* estimated radio duty cycle now in 1/1000 */
+    uint16      average_duty;                   /* time weighted over all levels in 1/1000 */
+} lp_adaptive_stats;
+
         
 /****************************************************************************
 NAME	
@@ -120,5 +181,51 @@ RETURNS
 */
 void linkPolicyCheckRoles(void);
 
+/****************************************************************************
+NAME    
+    linkPolicyNoteActivity
+    
+DESCRIPTION
+    Record AVRCP or GAIA traffic, idle links are made responsive for a
+    while unless the battery is low or more than one device is connected
+RETURNS
+    void
+*/
+void linkPolicyNoteActivity(void);
+
+/****************************************************************************
+NAME    
+    linkPolicyBatteryChanged
+    
+DESCRIPTION
+    The battery level used for power management has changed, evaluate the
+    level of idle links again
+RETURNS
+    void
+*/
+void linkPolicyBatteryChanged(void);
+
+/****************************************************************************
+NAME    
+    linkPolicyGetTransition
+    
+DESCRIPTION
+    get one of the level changes kept, 0 is the most recent
+RETURNS
+    the change, NULL if no change that old is kept
+*/
+const lp_transition * linkPolicyGetTransition(uint16 age);
+
+/****************************************************************************
+NAME    
+    linkPolicyGetAdaptiveStats
+    
+DESCRIPTION
+    get the time spent at each level and the estimated radio duty cycle
+RETURNS
+    void
+*/
+void linkPolicyGetAdaptiveStats(lp_adaptive_stats * stats);
+
 #endif /* _SINK_LINK_POLICY_H_ */
 
@@ -54,9 +54,66 @@ static void handleMapcMasConnectCfm(MAPC_MAS_CONNECT_CFM_T* pMsg);
 static void handleMapcMasDisconnectInd(MAPC_MAS_DISCONNECT_IND_T* pMsg);
 static void handleMapcMasSetNotificationCfm(MAPC_MAS_SET_NOTIFICATION_CFM_T* pMsg);
 static mapc_link_priority mapcAddDevice( const bdaddr *pAddr);
-static bool handleMapcEventReport(const char* pEventReport, const uint16 vReportLen);
+static void handleMapcEventReport(mapc_link_priority device_id, mapcEventParser *parser, const uint8 *buffer, uint16 buffer_size);
+static void mapcNotifyFlush(void);
 
-static const char mapcType[] = "NewMessage";
+/* where in the event object the parser is */
+typedef enum
+{
+    mapc_event_state_text,          /* between tags */
+    mapc_event_state_tag,           /* collecting the tag name */
+    mapc_event_state_attrs,         /* between the attributes of a tag */
+    mapc_event_state_attr_name,     /* collecting an attribute name */
+    mapc_event_state_attr_eq,       /* waiting for the quote opening a value */
+    mapc_event_state_value          /* inside a quoted value */
+} mapc_event_state;
+
+/* attributes of the event tag that are kept */
+typedef enum
+{
+    mapc_event_attr_other,
+    mapc_event_attr_type,
+    mapc_event_attr_handle,
+    mapc_event_attr_folder,
+    mapc_event_attr_msg_type
+} mapc_event_attr;
+
+typedef struct
+{
+    const char *    name;
+    uint8           value;
+} mapcEventToken;
+
+static const mapcEventToken mapcEventAttrs[] =
+{
+    {"type",                mapc_event_attr_type},
+    {"handle",              mapc_event_attr_handle},
+    {"folder",              mapc_event_attr_folder},
+    {"msg_type",            mapc_event_attr_msg_type}
+};
+
+static const mapcEventToken mapcEventTypes[] =
+{
+    {"NewMessage",          mapc_event_new_message},
+    {"DeliverySuccess",     mapc_event_delivery_success},
+    {"SendingSuccess",      mapc_event_sending_success},
+    {"DeliveryFailure",     mapc_event_delivery_failure},
+    {"SendingFailure",      mapc_event_sending_failure},
+    {"MemoryFull",          mapc_event_memory_full},
+    {"MemoryAvailable",     mapc_event_memory_available},
+    {"MessageDeleted",      mapc_event_message_deleted},
+    {"MessageShift",        mapc_event_message_shift}
+};
+
+static const mapcEventToken mapcMsgTypes[] =
+{
+    {"EMAIL",               mapc_msg_email},
+    {"SMS_GSM",             mapc_msg_sms_gsm},
+    {"SMS_CDMA",            mapc_msg_sms_cdma},
+    {"MMS",                 mapc_msg_mms}
+};
+
+static const char mapcEventTag[] = "event";
 
 
 /****************************************************************************
@@ -370,6 +427,13 @@ void handleMapcMessages(Task task, MessageId pId, Message pMessage)
                                       ((MAPC_APP_MAS_SET_NOTIFICATION_T*) pMessage)->action );
     break; 
     
+    case MAPC_APP_NOTIFY_HOLDOFF:
+        MAPC_DEBUG(("MAPC:MAPC_APP_NOTIFY_HOLDOFF\n"));
+        /* notify anything that arrived during the hold off */
+        theSink.rundata->mapc_data.notify_holdoff = FALSE;
+        mapcNotifyFlush();
+    break;
+    
     default:
         MAPC_DEBUG(("MAPC:Unknown Message - %x\n", pId));
         break; 
@@ -688,51 +752,405 @@ static void handleMapcMasSetNotificationCfm(MAPC_MAS_SET_NOTIFICATION_CFM_T* pMs
     }
 }
 
+/****************************************************************************
+NAME	
+	mapcEventMatch
+    
+DESCRIPTION
+    Look up the token just collected in a table
+    
+PARAMS
+    @parser
+    @table
+    @size       number of entries in the table
+    @none       value returned if the token is not in the table
+    
+RETURNS
+	uint8
+*/
+static uint8 mapcEventMatch(const mapcEventParser *parser, const mapcEventToken *table, uint16 size, uint8 none)
+{
+    uint16 i;
+    
+    for(i = 0; i < size; i++)
+    {
+        if((strlen(table[i].name) == parser->token_len) &&
+           (memcmp(table[i].name, parser->token, parser->token_len) == 0))
+        {
+            return table[i].value;
+        }
+    }
+    return none;
+}
+
+/****************************************************************************
+NAME	
+	mapcEventStoreToken
+    
+DESCRIPTION
+    Add a character to the token being collected, a token too long to be in
+    any of the tables is marked so it never matches
+    
+PARAMS
+    @parser
+    @c
+    
+RETURNS
+	void
+*/
+static void mapcEventStoreToken(mapcEventParser *parser, uint8 c)
+{
+    if(parser->token_len < MAPC_EVENT_MAX_TOKEN)
+        parser->token[parser->token_len++] = c;
+    else
+        parser->token_len = MAPC_EVENT_MAX_TOKEN + 1;
+}
+
+/****************************************************************************
+NAME	
+	mapcEventStoreValue
+    
+DESCRIPTION
+    Handle a character of an attribute value, the handle is converted from
+    hex as it arrives and the folder is copied, other values are collected
+    to be matched when the value ends
+    
+PARAMS
+    @parser
+    @c
+    
+RETURNS
+	void
+*/
+static void mapcEventStoreValue(mapcEventParser *parser, uint8 c)
+{
+    switch(parser->attr)
+    {
+        case mapc_event_attr_handle:
+            if((c >= '0') && (c <= '9'))
+                parser->handle = (parser->handle << 4) | (c - '0');
+            else if((c >= 'A') && (c <= 'F'))
+                parser->handle = (parser->handle << 4) | (c - 'A' + 10);
+            else if((c >= 'a') && (c <= 'f'))
+                parser->handle = (parser->handle << 4) | (c - 'a' + 10);
+        break;
+        
+        case mapc_event_attr_folder:
+            if(parser->folder_len < MAPC_EVENT_MAX_FOLDER)
+                parser->folder[parser->folder_len++] = c;
+        break;
+        
+        case mapc_event_attr_type:
+        case mapc_event_attr_msg_type:
+            mapcEventStoreToken(parser, c);
+        break;
+        
+        default:
+        break;
+    }
+}
+
+/****************************************************************************
+NAME	
+	mapcEventEndValue
+    
+DESCRIPTION
+    An attribute value has ended, match it if required
+    
+PARAMS
+    @parser
+    
+RETURNS
+	void
+*/
+static void mapcEventEndValue(mapcEventParser *parser)
+{
+    switch(parser->attr)
+    {
+        case mapc_event_attr_type:
+            parser->type = mapcEventMatch(parser, mapcEventTypes, sizeof(mapcEventTypes) / sizeof(mapcEventTypes[0]), mapc_event_unknown);
+        break;
+        
+        case mapc_event_attr_msg_type:
+            parser->msg_type = mapcEventMatch(parser, mapcMsgTypes, sizeof(mapcMsgTypes) / sizeof(mapcMsgTypes[0]), mapc_msg_unknown);
+        break;
+        
+        default:
+        break;
+    }
+    
+    parser->attr      = mapc_event_attr_other;
+    parser->token_len = 0;
+    parser->state     = mapc_event_state_attrs;
+}
+
+/****************************************************************************
+NAME	
+	mapcEventStartTag
+    
+DESCRIPTION
+    The name of a tag has been collected, start a new event if it is one
+    
+PARAMS
+    @parser
+    
+RETURNS
+	void
+*/
+static void mapcEventStartTag(mapcEventParser *parser)
+{
+    parser->in_event = ((parser->token_len == strlen(mapcEventTag)) &&
+                        (memcmp(mapcEventTag, parser->token, parser->token_len) == 0));
+    
+    if(parser->in_event)
+    {
+        parser->type       = mapc_event_none;
+        parser->msg_type   = mapc_msg_unknown;
+        parser->handle     = 0;
+        parser->folder_len = 0;
+    }
+    
+    parser->token_len = 0;
+    parser->state     = mapc_event_state_attrs;
+}
+
+/****************************************************************************
+NAME	
+	mapcEventComplete
+    
+DESCRIPTION
+    An event tag has been closed, queue a notification for new messages
+    
+PARAMS
+    @device_id
+    @parser
+    
+RETURNS
+	void
+*/
+static void mapcEventComplete(mapc_link_priority device_id, const mapcEventParser *parser)
+{
+    mapcData_t *data = &theSink.rundata->mapc_data;
+    uint16 i;
+    
+    MAPC_DEBUG(("MAPC:Event type [%d] msg_type [%d] handle [%lx] folder [%d]\n", parser->type, parser->msg_type, parser->handle, parser->folder_len));
+
+    /* only a new message is notified to the user */
+    if(parser->type != mapc_event_new_message)
+        return;
+    
+    /* the same message reported again is only notified once, whether it is
+       still queued or has already been notified */
+    for(i = 0; i < data->notify_count; i++)
+    {
+        if((data->notify[i].handle == parser->handle) && (data->notify[i].device_id == device_id))
+            return;
+    }
+    
+    for(i = 0; i < data->notified_count; i++)
+    {
+        if((data->notified[i].handle == parser->handle) && (data->notified[i].device_id == device_id))
+            return;
+    }
+    
+    if(data->notify_count < MAPC_NOTIFY_QUEUE_SIZE)
+    {
+        mapcNotification *notify = &data->notify[data->notify_count++];
+        
+        notify->handle     = parser->handle;
+        notify->device_id  = device_id;
+        notify->msg_type   = parser->msg_type;
+        notify->folder_len = parser->folder_len;
+        memmove(notify->folder, parser->folder, parser->folder_len);
+    }
+    else
+    {
+        data->notify_dropped++;
+    }
+    
+    /* a burst of reports is coalesced into one notification */
+    if(!data->notify_holdoff)
+        mapcNotifyFlush();
+}
+
+/****************************************************************************
+NAME	
+	mapcNotifyFlush
+    
+DESCRIPTION
+    Generate a single tone or voice prompt for the queued reports and hold
+    off further notifications for a while. The reports are moved to the
+    list of those notified most recently.
+    
+PARAMS
+    void
+    
+RETURNS
+	void
+*/
+static void mapcNotifyFlush(void)
+{
+    mapcData_t *data = &theSink.rundata->mapc_data;
+    uint16 i;
+    
+    if(data->notify_count)
+    {
+        MAPC_DEBUG(("MAPC:Notify [%d] new messages, [%d] not queued\n", data->notify_count, data->notify_dropped));
+        
+        /* If a new message has been received by the MSE device with type "NewMessage", */
+        /* generate a tone or vp for sms message */
+        MessageSend(&theSink.task, EventMapcMsgNotification, 0);
+        
+        /* newest first, the oldest drop off the end */
+        for(i = 0; i < data->notify_count; i++)
+        {
+            memmove(&data->notified[1], &data->notified[0], (MAPC_NOTIFY_QUEUE_SIZE - 1) * sizeof(mapcNotification));
+            data->notified[0] = data->notify[i];
+            if(data->notified_count < MAPC_NOTIFY_QUEUE_SIZE)
+                data->notified_count++;
+        }
+        
+        data->notify_count   = 0;
+        data->notify_dropped = 0;
+        data->notify_holdoff = TRUE;
+        MessageSendLater(&theSink.task, MAPC_APP_NOTIFY_HOLDOFF, 0, MAPC_NOTIFY_HOLDOFF_MS);
+    }
+}
+
 /****************************************************************************
 NAME	
 	handleMapcEventReport
     
 DESCRIPTION
-    handle data and get the metadata after receiving MAPC_MNS_SEND_EVENT_IND_T
+    Parse a packet of an event report object. The object is scanned once, tag
+    and attribute names are collected and matched as they end and the event
+    type, handle, folder and message type are taken from each event tag. The
+    parser state is kept so an object split over several packets is handled.
     
 PARAMS
+    @device_id
+    @parser
     @buffer  
     @buffer_size
     
 RETURNS
-	bool
+	void
 */
-static bool handleMapcEventReport(const char* buffer, const uint16 buffer_size )
+static void handleMapcEventReport(mapc_link_priority device_id, mapcEventParser *parser, const uint8 *buffer, uint16 buffer_size)
 {
-    uint16 count = strlen(mapcType);
-    char *p      = (char *)memchr(buffer, mapcType[0], buffer_size);
+    const uint8 *end = buffer + buffer_size;
     
-    while (p && p < buffer + buffer_size)
+    while(buffer < end)
     {
-        if(memcmp(p, mapcType, count) == 0)
+        uint8 c = *buffer++;
+        bool space = ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'));
+        
+        switch(parser->state)
         {
-            return TRUE;
+            case mapc_event_state_text:
+                if(c == '<')
+                {
+                    parser->token_len = 0;
+                    parser->state     = mapc_event_state_tag;
+                }
+            break;
+            
+            case mapc_event_state_tag:
+                if(space || (c == '/') || (c == '>'))
+                {
+                    /* a closing tag such as </MAP-event-report> collects an empty name */
+                    if(parser->token_len || (c != '/'))
+                        mapcEventStartTag(parser);
+                    
+                    if(c == '>')
+                    {
+                        parser->in_event = FALSE;
+                        parser->state    = mapc_event_state_text;
+                    }
+                }
+                else
+                {
+                    mapcEventStoreToken(parser, c);
+                }
+            break;
+            
+            case mapc_event_state_attrs:
+            case mapc_event_state_attr_name:
+                if(c == '>')
+                {
+                    if(parser->in_event)
+                        mapcEventComplete(device_id, parser);
+                    
+                    parser->in_event = FALSE;
+                    parser->state    = mapc_event_state_text;
+                }
+                else if(c == '=')
+                {
+                    parser->attr      = mapcEventMatch(parser, mapcEventAttrs, sizeof(mapcEventAttrs) / sizeof(mapcEventAttrs[0]), mapc_event_attr_other);
+                    parser->token_len = 0;
+                    parser->state     = mapc_event_state_attr_eq;
+                }
+                else if(!space && (c != '/'))
+                {
+                    if(parser->state == mapc_event_state_attrs)
+                    {
+                        parser->token_len = 0;
+                        parser->state     = mapc_event_state_attr_name;
+                    }
+                    mapcEventStoreToken(parser, c);
+                }
+            break;
+            
+            case mapc_event_state_attr_eq:
+                if((c == '"') || (c == '\''))
+                {
+                    parser->quote = (c == '\'');
+                    parser->state = mapc_event_state_value;
+                    
+                    if(parser->attr == mapc_event_attr_handle)
+                        parser->handle = 0;
+                    else if(parser->attr == mapc_event_attr_folder)
+                        parser->folder_len = 0;
+                }
+            break;
+            
+            case mapc_event_state_value:
+                if(c == (parser->quote ? '\'' : '"'))
+                    mapcEventEndValue(parser);
+                else
+                    mapcEventStoreValue(parser, c);
+            break;
+            
+            default:
+            break;
         }
-        p += 1;
-        p = (char *)memchr(p, mapcType[0], (uint16)(buffer+buffer_size - p));
     }
-    
-    return FALSE;
 }
 
 static void handleMapcMnsSendEventInd(MAPC_MNS_SEND_EVENT_IND_T* pMsg)
 {
     MapcResponse response= (pMsg->moreData)? mapc_pending: mapc_success;
+    mapc_link_priority device_id = mapcGetLinkFromMapsSession((MAPC_SESSION)(pMsg->mnsSession));
+    mapcEventParser *parser;
  
     MAPC_DEBUG(("MAPC:MAPC_MNS_SEND_EVENT_IND - Mas - %d Len = %d\n", 
                    pMsg->masInstanceId,
                    pMsg->sourceLen ));
     
+    /* the parser of a known link is kept until the end of the object, an
+       unknown session can only be parsed one packet at a time */
+    if(device_id != mapc_invalid_link)
+    {
+        parser = &theSink.rundata->mapc_data.state[device_id].event;
+    }
+    else
+    {
+        parser = (mapcEventParser *)mallocPanic(sizeof(mapcEventParser));
+        memset(parser, 0, sizeof(mapcEventParser));
+    }
+    
     if(pMsg->sourceLen)
     {
-        MAPC_DEBUG(("MAPC:***** Parsing the Event Object ******\n"));
-        MAPC_DEBUG(("MAPC:***** Or do other works        ******\n"));
-        
 #ifdef DEBUG_MAPC    
     {
         uint16 i;
@@ -747,12 +1165,17 @@ static void handleMapcMnsSendEventInd(MAPC_MNS_SEND_EVENT_IND_T* pMsg)
     }
 #endif        
         
-        if(handleMapcEventReport((const char*) SourceMap(pMsg->eventReport), (const uint16) pMsg->sourceLen))
-        {
-            /* If a new message has been received by the MSE device with type "NewMessage", */
-            /* generate a tone or vp for sms message */
-            MessageSend(&theSink.task, EventMapcMsgNotification, 0);
-        }
+        handleMapcEventReport(device_id, parser, SourceMap(pMsg->eventReport), pMsg->sourceLen);
+    }
+    
+    if(device_id == mapc_invalid_link)
+    {
+        freePanic(parser);
+    }
+    else if(!pMsg->moreData)
+    {
+        /* ready for the next event object */
+        memset(parser, 0, sizeof(mapcEventParser));
     }
 
     /* The application shall not access the source buffer received in the 
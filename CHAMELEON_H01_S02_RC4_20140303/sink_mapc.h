@@ -21,6 +21,15 @@ FILE
 
 #define MAX_MAPC_CONNECTIONS    2 
 
+/* event reports: longest attribute name or value matched, and folder kept */
+#define MAPC_EVENT_MAX_TOKEN        (16)
+#define MAPC_EVENT_MAX_FOLDER       (24)
+
+/* message notifications: reports held while a notification is being played
+   and the time further reports are held for before the next one */
+#define MAPC_NOTIFY_QUEUE_SIZE      (4)
+#define MAPC_NOTIFY_HOLDOFF_MS      (3000)
+
 /* Mapc link priority is used to identify different mapc links to
    AG devices using the order in which the devices were connected. 
 */
@@ -56,6 +65,61 @@ typedef enum
     
 } mapc_state;
 
+/* Type of a MAP event report */
+typedef enum
+{
+    mapc_event_none,
+    mapc_event_new_message,
+    mapc_event_delivery_success,
+    mapc_event_sending_success,
+    mapc_event_delivery_failure,
+    mapc_event_sending_failure,
+    mapc_event_memory_full,
+    mapc_event_memory_available,
+    mapc_event_message_deleted,
+    mapc_event_message_shift,
+    mapc_event_unknown
+} mapc_event_type;
+
+/* Type of the message an event report refers to */
+typedef enum
+{
+    mapc_msg_unknown,
+    mapc_msg_email,
+    mapc_msg_sms_gsm,
+    mapc_msg_sms_cdma,
+    mapc_msg_mms
+} mapc_msg_type;
+
+/* Event report parser, carried across MNS packets of the same event object */
+typedef struct
+{
+    uint32          handle;                         /* low 32 bits of the message handle */
+    uint8           token[MAPC_EVENT_MAX_TOKEN];    /* attribute name or value being matched */
+    uint8           folder[MAPC_EVENT_MAX_FOLDER];
+    unsigned        state:3;                        /* mapc_event_state */
+    unsigned        attr:3;                         /* mapc_event_attr the value belongs to */
+    unsigned        quote:1;                        /* value is enclosed in ' rather than " */
+    unsigned        in_event:1;                     /* attributes belong to an <event> tag */
+    unsigned        token_len:5;
+    unsigned        unused:3;
+    unsigned        type:4;                         /* mapc_event_type */
+    unsigned        msg_type:3;                     /* mapc_msg_type */
+    unsigned        folder_len:5;
+    unsigned        unused2:4;
+} mapcEventParser;
+
+/* A new message report awaiting notification */
+typedef struct
+{
+    uint32          handle;
+    uint8           folder[MAPC_EVENT_MAX_FOLDER];  /* folder the message is in, relative to telecom/msg */
+    unsigned        device_id:2;
+    unsigned        msg_type:3;
+    unsigned        folder_len:5;
+    unsigned        unused:6;
+} mapcNotification;
+
 typedef enum
 {
     /*! mapc no action. */
@@ -85,6 +149,8 @@ struct __mapcState
     uint8           masChannel;
     /* Device id for mapc connection */
     mapc_state      device_state;
+    /* Parser for the event report being received */
+    mapcEventParser event;
 };
 
 typedef struct __mapcState mapcState;
@@ -98,6 +164,22 @@ struct __mapcData
     
     /* The Mns rfcomm Channel for the MNS Service */
     unsigned        mnsChannel:8;
+    
+    /* new message reports received since the last notification */
+    unsigned        notify_count:3;
+    /* a notification has been played recently, hold further ones */
+    unsigned        notify_holdoff:1;
+    /* reports in the notified list */
+    unsigned        notified_count:3;
+    unsigned        unused:1;
+    
+    /* reports that did not fit in the queue */
+    uint16          notify_dropped;
+    
+    mapcNotification notify[MAPC_NOTIFY_QUEUE_SIZE];
+    
+    /* reports notified most recently, newest first, so a repeat is ignored */
+    mapcNotification notified[MAPC_NOTIFY_QUEUE_SIZE];
              
     mapc_state      mapcState;
 };
@@ -113,6 +195,7 @@ typedef enum
     MAPC_APP_MAS_CONNECT,
     MAPC_APP_MAS_DISCONNECT,
     MAPC_APP_MAS_SET_NOTIFICATION,
+    MAPC_APP_NOTIFY_HOLDOFF,
     
     MAPC_APP_MESSAGE_TOP 
 
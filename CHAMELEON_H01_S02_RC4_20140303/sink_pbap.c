@@ -43,6 +43,8 @@ FILE
 #include "sink_callmanager.h"
 #include "sink_link_policy.h"
 #include "sink_display.h"
+#include "sink_vcard.h"
+#include "sink_callerid.h"
 
 #ifdef DEBUG_PBAP
     #define PBAP_DEBUG(x) {printf x;}
@@ -50,18 +52,8 @@ FILE
     #define PBAP_DEBUG(x) 
 #endif
 
-static const char gpbapbegin[] = "BEGIN:VCARD"; 
-static const char gpbapname[]  = "\nN";
-static const char gpbaptel[]   = "TEL";
-static const char gpbapend[]   = "END:VCARD";
-
-typedef struct 
-{
-    uint8 telLen;
-    uint8 *pTel;
-    uint8 nameLen;
-    uint8 pName[1];    
-}pbapMetaData;
+/* vCard parser for the pull in progress, allocated when the first data arrives */
+static vcard_parser *gPbapVcard = NULL;
 
 /* Message Handler Prototypes */
 static void handlePbapInitCfm(PBAPC_INIT_CFM_T *pMsg);
@@ -80,10 +72,12 @@ static void handleAppPullVcardEntry( void );
 static void handleAppPullVcardList( void );
 static void handleAppPullPhoneBook( void );
 static void handleAppPhoneBookSize( void );
+static void handleAppCallerIdRefresh( void );
 
-static uint8 VcardGetFirstTel(const uint8* pVcard, const uint16 vcardLen, pbapMetaData **pMetaData);
-static bool handlePbapDialData(const uint8* pVcard, const uint16 vcardLen);
-static void handlePbapRetrievedData(const uint8 *pVcard, const uint16 vcardLen);
+static bool handlePbapVcardData(const uint8 *pVcard, uint16 vcardLen);
+static bool handlePbapDialData(const vcard_entry *pEntry);
+static void handlePbapRetrievedData(const vcard_entry *pEntry);
+static void pbapVcardRelease(void);
 static void handleVcardPhoneBookMessage(uint16 device_id, pbapc_lib_status status, const uint8 *lSource, const uint16 dataLen);
 static void pbapDial(uint8 phonebook);
 
@@ -102,6 +96,9 @@ void initPbap(void)
     theSink.pbapc_data.PbapBrowseEntryIndex = 1;
     theSink.pbapc_data.pbap_hfp_link        = 0;
     
+    /* load the caller ID store saved by the last phonebook pull */
+    callerIdInit();
+    
     /* Initialise the PBAP library */
 	PbapcInit(&theSink.task);
 }
@@ -286,6 +283,9 @@ void handlePbapMessages(Task task, MessageId pId, Message pMessage)
     case PBAPC_APP_PHONE_BOOK_SIZE:
         handleAppPhoneBookSize();
         break;
+    case PBAPC_APP_CALLER_ID_REFRESH:
+        handleAppCallerIdRefresh();
+        break;
         
     default:
         PBAP_DEBUG(("PBAPC Unhandled message : 0x%X\n",pId));
@@ -355,6 +355,10 @@ static void handlePbapConnectCfm(PBAPC_CONNECT_CFM_T *pMsg)
                 case pbapc_action_idle:
                     /* Set the link policy based on the HFP or A2DP state */
                     linkPolicyPhonebookAccessComplete(PbapcGetSink(theSink.pbapc_data.pbap_active_link));    
+                    
+                    /* refresh the caller ID store in the background */
+                    MessageCancelAll(&theSink.task, PBAPC_APP_CALLER_ID_REFRESH);
+                    MessageSendLater(&theSink.task, PBAPC_APP_CALLER_ID_REFRESH, 0, PBAPC_CALLER_ID_REFRESH_DELAY);
                 default:
                 break;
             }
@@ -400,7 +404,13 @@ static void handlePbapDisconnectInd(PBAPC_DISCONNECT_IND_T *pMsg)
     }
 
     theSink.pbapc_data.pbap_command = pbapc_action_idle;
-   
+    
+    /* any pull in progress has been abandoned */
+    pbapVcardRelease();
+    callerIdBuildEnd(FALSE);
+    
+    if(theSink.pbapc_data.pbap_active_link == pbapc_invalid_link)
+        MessageCancelAll(&theSink.task, PBAPC_APP_CALLER_ID_REFRESH);
 }
 
 static void handlePbapSetPhonebookCfm(PBAPC_SET_PHONEBOOK_CFM_T *pMsg)
@@ -490,6 +500,9 @@ static void handlePullVCardEntryCfm(PBAPC_PULL_VCARD_ENTRY_CFM_T *pMsg)
     if(pMsg->status != pbapc_pending && theSink.pbapc_data.pbap_command == pbapc_dialling)
     {
         MessageSend ( &theSink.task , EventPbapDialFail , 0 ) ; 
+        
+        /* Set the link policy based on the HFP or A2DP state */
+        linkPolicyPhonebookAccessComplete(PbapcGetSink(theSink.pbapc_data.pbap_active_link));     
     }
     
     if(pMsg->status != pbapc_pending)
@@ -553,10 +566,16 @@ static void handlePullPhonebookCfm(PBAPC_PULL_PHONEBOOK_CFM_T *pMsg)
     }
 #endif    
     
-    /* Set the link policy based on the HFP or A2DP state */
-    linkPolicyPhonebookAccessComplete(PbapcGetSink(theSink.pbapc_data.pbap_active_link));     
+    /* parse the data as it arrives and ask for more if there is any */
+    handleVcardPhoneBookMessage(pMsg->device_id, pMsg->status, SourceMap(pMsg->src), pMsg->dataLen);
+    
+    if(pMsg->status != pbapc_pending)
+    {
+        /* Set the link policy based on the HFP or A2DP state */
+        linkPolicyPhonebookAccessComplete(PbapcGetSink(theSink.pbapc_data.pbap_active_link));     
 
-    theSink.pbapc_data.pbap_command = pbapc_action_idle;
+        theSink.pbapc_data.pbap_command = pbapc_action_idle;
+    }
 }
 
 /****************************************************************************
@@ -639,6 +658,12 @@ static void handleAppPullPhoneBook(void)
             {
                 theSink.pbapc_data.pbap_active_pb = pbap_pb;
             }
+            
+            /* a full pull of the main phonebook rebuilds the caller ID store */
+            if(theSink.pbapc_data.pbap_active_pb == pbap_pb)
+            {
+                callerIdBuildStart();
+            }
                 
             PbapcPullPhonebookRequest(theSink.pbapc_data.pbap_active_link, theSink.pbapc_data.pbap_phone_repository, theSink.pbapc_data.pbap_active_pb, pParams);
                 
@@ -686,230 +711,152 @@ static void handleAppPhoneBookSize(void)
    
 }
 
+static void handleAppCallerIdRefresh(void)
+{
+    PBAP_DEBUG(("PBAPC_APP_CALLER_ID_REFRESH, "));
+    if(theSink.pbapc_data.pbap_active_link == pbapc_invalid_link)
+    {
+	    PBAP_DEBUG(("    Pbap not connected\n"));
+    }
+    else if(theSink.pbapc_data.pbap_command != pbapc_action_idle)
+    {
+        /* the user is using the phonebook, try again later */
+        PBAP_DEBUG(("    Pbap busy\n"));
+        MessageSendLater(&theSink.task, PBAPC_APP_CALLER_ID_REFRESH, 0, PBAPC_CALLER_ID_REFRESH_DELAY);
+    }
+    else
+    {
+        /* Set the link to active state */
+        linkPolicySetLinkinActiveMode(PbapcGetSink(theSink.pbapc_data.pbap_active_link));
+        
+        theSink.pbapc_data.pbap_command = pbapc_downloading;
+        handleAppPullPhoneBook();
+    }
+}
+
 /****************************************************************************
 NAME	
-	VcardGetFirstTel
+	pbapVcardRelease
 
 DESCRIPTION
-    Find the first telephone number from the supplied VCARD data
-    
-PARAMS
-    pVcard   pointer to supplied VCARD data
-    pTel     pointer to section of pVcard where the telephone number begins
+    Free the vCard parser once a pull has finished
     
 RETURNS
-	uint8    length of the found telephone number, 0 if not found
+	void
 */
-static uint8 *memstr( const uint8 *buffer, const uint16 buffer_size, const uint8 *str, const uint16 count )
+static void pbapVcardRelease(void)
 {
-
-    uint8 *p = (uint8 *)memchr(buffer, str[0], buffer_size);
-    PBAP_DEBUG(("PBAP memstr\n"));
-    
-    while (p && p < buffer + buffer_size)
+    if(gPbapVcard)
     {
-        if(memcmp((char *)p, (char *)str, count) == 0)
-        {
-            return p;
-        }
-        p += 1;
-        p = (uint8 *)memchr(p, str[0], (uint16)(buffer+buffer_size - p));
+        PBAP_DEBUG(("PBAP vCard parser released after [%d] entries\n", gPbapVcard->entries));
+        freePanic(gPbapVcard);
+        gPbapVcard = NULL;
     }
-    
-    return 0;
 }
 
-static uint16 VcardFindMetaData( const uint8 *start, const uint8 *end, uint8 **metaData, const char *str, const uint16 count)
-{
-    uint16 len;
-    uint8 *p         = (uint8 *)start;
-    uint8 *endstring = NULL;
-       
-    PBAP_DEBUG(("PBAP VcardFindMetaData\n"));
+/****************************************************************************
+NAME	
+	handlePbapVcardData
 
-    /* find the MetaData */
-    len         = (uint16)(end - p);
+DESCRIPTION
+    Pass a packet of phonebook data through the vCard parser, an entry split
+    across packets is completed when the next packet arrives
     
-    if((((*metaData) = (uint8 *)memstr(p, len, (uint8 *)str, strlen(str))) != NULL) &&
-       (((*metaData) = (uint8 *)memchr((uint8 *)(*metaData), ':',  end - (*metaData))) != NULL))
-    {
-        (*metaData) += 1;
-        endstring    = (uint8 *)memchr((uint8 *)(*metaData), '\n', end - (*metaData)) - 1;
-    }
-    else
-    {
-        /* There are some errors about the format of phonebook. */
-        return 0;
-    }
+PARAMS
+    pVcard   pointer to supplied VCARD data
+    vcardLen length of the data
     
-    return(endstring - (*metaData));
-}
-
-static uint8 VcardGetFirstTel(const uint8* pVcard, const uint16 vcardLen, pbapMetaData **pMetaData)
-{ 
-    uint16 len    = 0;
-    uint16 telLen, nameLen = 0;
-    uint8 *pTel   = NULL;
-    uint8 *pName  = NULL;
+RETURNS
+	TRUE if the pull is finished with, i.e. a number has been dialled
+*/
+static bool handlePbapVcardData(const uint8 *pVcard, uint16 vcardLen)
+{
+    if(!pVcard || !vcardLen)
+        return FALSE;
     
-    /* Find the start and end position of the first Vcard Entry */
-    uint8 *start  = memstr(pVcard, vcardLen, (uint8 *)gpbapbegin, strlen(gpbapbegin));
-    uint8 *end    = memstr(pVcard, vcardLen, (uint8 *)gpbapend,   strlen(gpbapend));
-    end           = (end == NULL) ? (uint8 *)(pVcard + vcardLen - 1) : end;
-
-#ifdef DEBUG_PBAP    
+    if(!gPbapVcard)
     {
-        uint16 i;
-        PBAP_DEBUG(("The pVcard is: "));
-
-        for(i = 0; i < vcardLen; i++)
-            PBAP_DEBUG(("%c", *(pVcard + i))); 
-        
-        PBAP_DEBUG(("\n"));    
+        gPbapVcard = (vcard_parser *)mallocPanic(sizeof(vcard_parser));
+        vcardParserInit(gPbapVcard);
     }
-#endif
     
-    PBAP_DEBUG(("First entry start:[%x], end:[%x]\n", (uint16)start, (uint16)end));
-    
-    while(start && start < end)
+    while(vcardLen)
     {
-        start = start + strlen(gpbapbegin);
-
-        /* find the Tel */
-        telLen = VcardFindMetaData(start, end, &pTel, gpbaptel, strlen(gpbaptel));
+        const vcard_entry *pEntry;
+        uint16 used = vcardParse(gPbapVcard, pVcard, vcardLen);
         
-        if( telLen )
+        pVcard   += used;
+        vcardLen -= used;
+        
+        if((pEntry = vcardEntryComplete(gPbapVcard)) != NULL)
         {
-            PBAP_DEBUG(("VcardGetFirstTel:telephone number found ok\n"));
-            
-            /* find the Name */
-            nameLen = VcardFindMetaData(start, end, &pName, gpbapname, strlen(gpbapname));
-            
-            /* allocate the memory for pMetaData structure */
-            *pMetaData = (pbapMetaData *)mallocPanic(sizeof(pbapMetaData) + nameLen);
-
-            if(pMetaData)
+            if(theSink.pbapc_data.pbap_command == pbapc_dialling)
             {
-                (*pMetaData)->pTel    = pTel;
-                (*pMetaData)->telLen  = telLen;       
-                (*pMetaData)->nameLen = nameLen;
-            
-                PBAP_DEBUG(("CallerID pos:[%x], len:[%d]\n", (uint16)pName, nameLen));
-           
-                if(nameLen)
-                {
-                    /* This memory should be freed after pbap dial command or TTS has completed */
-                    memmove(&((*pMetaData)->pName), pName, nameLen);
-                    (*pMetaData)->pName[nameLen] = '\0';
-                
-                    /* Remove the ';' between names */
-                    /* Based on PBAP spec., the name format is: 
-                      LastName;FirstName;MiddleName;Prefix;Suffix
-                    */
-                    len = nameLen;
-                    pName = (*pMetaData)->pName;
-                    while(pName < (*pMetaData)->pName + nameLen)
-                    {
-                        pName    = (uint8 *)memchr(pName, ';', len) ;
-                        /*if no ; is found exit */                            
-                        if(!pName)
-                            break;
-                        *pName++ = ' ';
-                        /* determine how many characters are left */
-                        len  = nameLen - (pName - (*pMetaData)->pName);
-                    }
-                
-                    PBAP_DEBUG(("VcardGetFirstTel:CallerID found ok\n"));
-                }
-
-                return(telLen);
+                /* dial the first entry that has a number */
+                if(handlePbapDialData(pEntry))
+                    return TRUE;
             }
             else
             {
-                PBAP_DEBUG(("VcardGetFirstTel:No memory slot to store MetaData\n"));
-                return 0;
+                callerIdBuildAdd(pEntry);
+                handlePbapRetrievedData(pEntry);
             }
         }
-        
-        /* If the first Vcard Entry the Tel is enmty, try next Entry. */
-        /* First find the next Vcard Entry start and end positions    */
-        end = end + strlen(gpbapend);
-        len = (uint16)(pVcard + vcardLen - end);
-        start = memstr(end, len , (uint8 *)gpbapbegin, strlen(gpbapbegin));
-        end   = memstr(end, len,  (uint8 *)gpbapend,   strlen(gpbapend));
-        end   = (end == NULL) ? (uint8 *)(pVcard + vcardLen - 1) : end;
-        
-        PBAP_DEBUG(("next start:[%x], end:[%x]\n", (uint16)start, (uint16)end));
     }
-     
-    PBAP_DEBUG(("VcardGetFirstTel:telephone number not found\n"));
-   
-    return 0;
+    
+    return FALSE;
 }
 
-static bool handlePbapDialData(const uint8 *pVcard, const uint16 vcardLen)
+static bool handlePbapDialData(const vcard_entry *pEntry)
 {
-    pbapMetaData *pMetaData = NULL;
-    bool success = FALSE;
-    
-    PBAP_DEBUG(("handlePbapDial:The length of data is [%d]\n", vcardLen));
-    
-  	/* Process Data to find telephone number*/
-    if(VcardGetFirstTel(pVcard, vcardLen, &pMetaData))
+    if(!pEntry->tel_len)
     {
-        PBAP_DEBUG(("handlePbapDial:dialling from PBAP Phonebook\n"));
+        /* If the Vcard Entry the Tel is empty, try next Entry. */
+        PBAP_DEBUG(("handlePbapDial:no number in entry\n"));
+        return FALSE;
+    }
+    
+    PBAP_DEBUG(("handlePbapDial:dialling from PBAP Phonebook\n"));
         
-        /* Display the name of tel of pbap dial entry.*/
-        /* TTS can be used to play the caller ID */
+    /* Display the name of tel of pbap dial entry.*/
+    /* TTS can be used to play the caller ID */
 #ifdef DEBUG_PBAP
-        {
-            uint8 i = 0;
-            PBAP_DEBUG(("The Name is: "));
-            for(i = 0; i < pMetaData->nameLen; i++)
-                PBAP_DEBUG(("%c ", *(pMetaData->pName + i)));
+    {
+        uint8 i = 0;
+        PBAP_DEBUG(("The Name is: "));
+        for(i = 0; i < pEntry->name_len; i++)
+            PBAP_DEBUG(("%c ", pEntry->name[i]));
   
-            PBAP_DEBUG(("\nThe Tel is: "));
-            for(i = 0; i < pMetaData->telLen; i++)
-                PBAP_DEBUG(("%c ", *(pMetaData->pTel + i)));
-            PBAP_DEBUG(("\n"));
-        }
+        PBAP_DEBUG(("\nThe Tel is: "));
+        for(i = 0; i < pEntry->tel_len; i++)
+            PBAP_DEBUG(("%c ", pEntry->tel[i]));
+        PBAP_DEBUG(("\n"));
+    }
 #endif
         
 #ifdef ENABLE_DISPLAY 
-        displayShowText((char*)pMetaData->pName,  pMetaData->nameLen, 1, DISPLAY_TEXT_SCROLL_SCROLL, 1000, 2000, FALSE, 0);
+    displayShowText((char*)pEntry->name,  pEntry->name_len, 1, DISPLAY_TEXT_SCROLL_SCROLL, 1000, 2000, FALSE, 0);
 #endif           
         
-        HfpDialNumberRequest(hfp_primary_link, pMetaData->telLen, (uint8 *)(pMetaData->pTel));
+    HfpDialNumberRequest(hfp_primary_link, pEntry->tel_len, (uint8 *)(pEntry->tel));
         
-        /* Task of Pbapc profile has completed and Hfp profile starts to work */
-        theSink.pbapc_data.pbap_command = pbapc_action_idle;
+    /* Task of Pbapc profile has completed and Hfp profile starts to work */
+    theSink.pbapc_data.pbap_command = pbapc_action_idle;
              
-        success = TRUE;
-        
-    }
-    else
-    {
-         /* error, number not found */   
-         PBAP_DEBUG(("handlePbapDial:no number found to dial.\n"));
-    }
-    
-    if(pMetaData)
-    {
-        freePanic(pMetaData);
-    }
-
-    return(success);
+    return TRUE;
 }
 
-static void handlePbapRetrievedData(const uint8 *pVcard, const uint16 vcardLen)
+static void handlePbapRetrievedData(const vcard_entry *pEntry)
 {
     /* Display the content of the retrieved data.*/
     #ifdef DEBUG_PBAP
     {
         uint8 i = 0;
-        for(i = 0; i < vcardLen; i++)
-            PBAP_DEBUG(("%c ", *(pVcard + i)));
-            
+        for(i = 0; i < pEntry->name_len; i++)
+            PBAP_DEBUG(("%c", pEntry->name[i]));
+        PBAP_DEBUG((" : "));
+        for(i = 0; i < pEntry->tel_len; i++)
+            PBAP_DEBUG(("%c", pEntry->tel[i]));
         PBAP_DEBUG(("\n"));
     }
     #endif
@@ -919,20 +866,19 @@ static void handleVcardPhoneBookMessage(uint16 device_id, pbapc_lib_status statu
 {
     PBAP_DEBUG(("PBAP vcardPhoneBookMessage\n"));
 
-    if(theSink.pbapc_data.pbap_command == pbapc_dialling)
-    {
-	    /* Process the data and dial the number */
-        if(handlePbapDialData(lSource, dataLen))
-        {
-            PbapcPullComplete(device_id);
-            return;
-        }
-    }
-    else
+    /* Process the data, dialling the number if that is what the pull was for. */
+    /* As no external memory avaible, other pbap features just display the data: Name, Tel */
+    if(handlePbapVcardData(lSource, dataLen))
     {
-        /* Other pbap features, for example, downloading or browsing phonebook object. */
-        /* As no external memory avaible, just display the data: Name, Tel */
-        handlePbapRetrievedData(lSource, dataLen);
+        PbapcPullComplete(device_id);
+        pbapVcardRelease();
+        
+        /* the rest of the phonebook is not read so any rebuild is partial */
+        callerIdBuildEnd(FALSE);
+        
+        /* the pull is abandoned once dialled, set the link policy based on the HFP or A2DP state */
+        linkPolicyPhonebookAccessComplete(PbapcGetSink(device_id));
+        return;
     }
     
     /* Read more data for pbap dial fail or other pbap features */
@@ -946,6 +892,8 @@ static void handleVcardPhoneBookMessage(uint16 device_id, pbapc_lib_status statu
         PBAP_DEBUG(("    Requesting complete.\n"));
 	    /* Send Complete to Server */
         PbapcPullComplete(device_id);
+        pbapVcardRelease();
+        callerIdBuildEnd(status == pbapc_success);
     }
 }
 
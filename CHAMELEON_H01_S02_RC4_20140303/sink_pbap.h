@@ -29,6 +29,10 @@ FILE
 #define PBAPC_MAX_LIST              (1000)
 #define PBAPC_LIST_START            (0)
 
+/* delay after connecting before the phonebook is pulled to refresh the
+   caller ID store, lets the connection settle first */
+#define PBAPC_CALLER_ID_REFRESH_DELAY   (10000)
+
 /*!
     @brief Pbap link priority is used to identify different pbapc links to
     AG devices using the order in which the devices were connected.
@@ -78,6 +82,7 @@ typedef enum
     PBAPC_APP_PULL_VCARD_LIST,
     PBAPC_APP_PULL_PHONE_BOOK,
     PBAPC_APP_PHONE_BOOK_SIZE,
+    PBAPC_APP_CALLER_ID_REFRESH,
     
     PBAPC_APP_MSG_TOP
 } PbapcAppMsgId;
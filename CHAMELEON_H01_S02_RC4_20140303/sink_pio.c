@@ -43,6 +43,25 @@ void PioSetPio(uint16 pio , pio_common_dir drive, bool dir)
 }
 
 
+/****************************************************************************
+NAME	
+	PioSetPios
+
+DESCRIPTION
+    Fn to drive a group of PIOs with a single write
+    Each PIO set in mask is driven to the level of the same bit in bits
+    
+RETURNS
+	void
+*/
+void PioSetPios(uint32 mask, uint32 bits)
+{
+    PIO_DEBUG(("PIO: Drive mask 0x%lX bits 0x%lX\n", mask, bits));
+    PioSetDir32(mask, mask);
+    PioSet32(mask, bits);
+}
+
+
 /****************************************************************************
 NAME	
 	PioGetPio
@@ -44,6 +44,19 @@ RETURNS
 void PioSetPio(uint16 pio , pio_common_dir drive, bool dir);
 
 
+/****************************************************************************
+NAME	
+	PioSetPios
+
+DESCRIPTION
+    Fn to drive a group of PIOs with a single write
+    Each PIO set in mask is driven to the level of the same bit in bits
+    
+RETURNS
+	void
+*/
+void PioSetPios(uint32 mask, uint32 bits);
+
 /****************************************************************************
 NAME	
 	PioGetPio
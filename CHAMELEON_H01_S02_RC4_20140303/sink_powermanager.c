@@ -20,6 +20,8 @@ DESCRIPTION
 #include "sink_leds.h"
 #include "sink_debug.h"
 #include "sink_display.h"
+#include "sink_fuel_gauge.h"
+#include "sink_link_policy.h"
 
 #include <pio.h>
 #include <psu.h>
@@ -116,6 +118,7 @@ void powerManagerChargerConnected( void )
     PowerChargerMonitor();
     /* notify the audio plugin of the new power state */
     AudioSetPower(POWER_BATT_LEVEL3);
+    linkPolicyBatteryChanged();
 }
 
 
@@ -139,6 +142,8 @@ void powerManagerChargerDisconnected( void )
     MessageSend(&theSink.task, EventCancelLedIndication, 0);
     /* Restore default bootmode */
     usbSetBootMode(BOOTMODE_DEFAULT);
+    /* the battery level applies to power management again */
+    linkPolicyBatteryChanged();
 }
 
 
@@ -292,6 +297,7 @@ static void powerManagerHandleVbatLow( void )
     }
     
     AudioSetPower(powerManagerGetLBIPM());
+    linkPolicyBatteryChanged();
 }
 
 
@@ -314,13 +320,14 @@ static void powerManagerHandleVbatNormal(uint8 level)
     
     /* reset any low battery warning that may be in place */
     theSink.battery_state = POWER_BATT_LEVEL0 + level;
-    csr2csrHandleAgBatteryRequestRes(level);
+    csr2csrHandleAgBatteryRequestRes(fuelGaugeGetPercent());
 
     /* when changing from low battery state to a normal state, refresh the led state pattern
        to replace the low battery pattern should it have been shown */
     if(low_batt) LEDManagerIndicateState(stateManagerGetState());
     
     AudioSetPower(powerManagerGetLBIPM());
+    linkPolicyBatteryChanged();
 }
 
 
@@ -339,6 +346,11 @@ static void powerManagerHandleVbat(voltage_reading vbat, battery_level_source so
 
     PM_DEBUG(("PM: Battery Voltage 0x%02X (%dmV)\n", vbat.level, vbat.voltage));
 
+    /* act on the filtered level rather than the raw reading */
+    vbat.level = fuelGaugeHandleReading(&vbat, (event == EventCriticalBattery));
+    setting = theSink.conf1->power.bat_events[vbat.level];
+    event = EVENTS_MESSAGE_BASE + setting.event;
+
     displayUpdateBatteryLevel(powerManagerIsChargerConnected());
     
     /* Send indication if not charging, not in limbo state and indication enabled for this source */
@@ -385,6 +397,13 @@ DESCRIPTION
 static void powerManagerHandleChargeState(power_charger_state state)
 {
     PM_DEBUG(("PM: Charger State 0x%02X\n", state));
+
+    /* the gauge counts charge in while the charger is actually charging */
+    fuelGaugeSetCharging((state == power_charger_trickle) || (state == power_charger_fast) ||
+                         (state == power_charger_boost_internal) || (state == power_charger_boost_external));
+    if(state == power_charger_complete)
+        fuelGaugeChargeComplete();
+
     if(!theSink.features.ChargerTerminationLEDOveride) 
     {
         /* Generate new message based on the reported charger state */
@@ -251,11 +251,6 @@ typedef struct  VolMappingTag
 #define NUM_FIXED_TONES            (94)    
 #define MAX_NUM_VARIABLE_TONES     (8)
 
-typedef struct VarTonesDataTag
-{
-    ringtone_note    *gVariableTones;    
-}ConfigTone_t;
-
 /*!
     @brief Block containing the PIOs assigned to fixed events the bit fields define if a PIO has been set
 */
@@ -524,7 +519,6 @@ typedef struct
 typedef struct
 {
     button_config_type     buttons_duration;
-    ConfigTone_t           gConfigTones;
     VolMapping_t           gVolMaps[VOL_NUM_VOL_SETTINGS];
     Timeouts_t             timeouts;
     pio_config_type        PIOIO;   
@@ -563,11 +557,11 @@ typedef struct
     char            at_commands[1];
 } config_block3_t;
 
+/* AT commands (config_block3_t), TTS phrases and user tones are held by the
+   config cache, see sink_config_cache.h */
 typedef struct
 {
     voice_prompts_index vp_init_params;
-    /* Always one termination prompt, additional space added in InitConfigMemory */
-    tts_config_type     gEventTTSPhrases[1];
 } config_block4_t;
 
 
@@ -583,7 +577,6 @@ typedef struct
     runtime_block1_t         *rundata;
     config_block1_t          *conf1;
     config_block2_t          *conf2;
-    config_block3_t          *conf3;
     config_block4_t          *conf4;
 
     power_table              *user_power_table;     /* pointer to user power table if available in ps */
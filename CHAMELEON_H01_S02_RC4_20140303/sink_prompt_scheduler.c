@@ -0,0 +1,362 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_prompt_scheduler.c
+
+DESCRIPTION
+    Prompt scheduler. A prompt is played straight away if audio is free,
+    otherwise it waits in the queue, highest class first and in order of
+    arrival within a class. A message sent conditionally on the audio busy
+    flag marks the end of the prompt playing and releases the next one.
+
+*/
+
+#include "sink_prompt_scheduler.h"
+#include "sink_private.h"
+#include "sink_tones.h"
+#include "sink_tts.h"
+
+#include <audio.h>
+#include <vm.h>
+
+
+#ifdef DEBUG_TONES
+#define PROMPT_DEBUG(x) DEBUG(x)
+#else
+#define PROMPT_DEBUG(x)
+#endif
+
+/* Message sent to the scheduler task once audio is no longer busy */
+#define PROMPT_DISPATCH     (0)
+
+/* What a prompt plays */
+typedef enum
+{
+    prompt_tone,
+    prompt_phrase
+} prompt_kind;
+
+typedef struct
+{
+    Task        plugin;             /* plugin for a phrase */
+    unsigned    id:8;               /* tone index or phrase */
+    unsigned    event:8;            /* event index */
+    unsigned    cls:3;              /* prompt_class */
+    unsigned    kind:1;             /* prompt_kind */
+    unsigned    flag:1;             /* tone at default level, or phrase overrides */
+    unsigned    unused:11;
+    uint16      scheduled;          /* low word of VmGetClock when the prompt was scheduled */
+} prompt_item;
+
+typedef struct
+{
+    prompt_item             queue[PROMPT_QUEUE_DEPTH];
+    prompt_scheduler_stats  stats;
+    unsigned                active:1;       /* a prompt has been handed to the plugin and not finished */
+    unsigned                active_class:3;
+    unsigned                unused:12;
+} prompt_scheduler_t;
+
+static void promptSchedulerHandler( Task task, MessageId id, Message message );
+
+static prompt_scheduler_t gPrompt;
+static TaskData gPromptTask = { promptSchedulerHandler };
+
+
+/****************************************************************************
+NAME
+  	promptPlay
+
+DESCRIPTION
+  	Hand a prompt to the audio plugin and wait for audio to be free again
+
+RETURNS
+  	void
+*/
+static void promptPlay( const prompt_item * item )
+{
+    PROMPT_DEBUG(("PROMPT: play class %d %s %x\n", item->cls, (item->kind == prompt_tone) ? "tone" : "phrase", item->id));
+
+    /* queueing is the only delay, a prompt waits well under a minute */
+    TonesCacheNoteLatency((uint16)VmGetClock() - item->scheduled);
+
+    if(item->kind == prompt_tone)
+        TonesPlayTone(item->id, TRUE, item->flag);
+    else
+        TTSPlay(item->plugin, item->id, NULL, 0, TRUE, item->flag);
+
+    gPrompt.active       = TRUE;
+    gPrompt.active_class = item->cls;
+    gPrompt.stats.played++;
+
+    MessageCancelAll(&gPromptTask, PROMPT_DISPATCH);
+    MessageSendConditionally(&gPromptTask, PROMPT_DISPATCH, 0, (const uint16 *)AudioBusyPtr());
+}
+
+/****************************************************************************
+NAME
+  	promptEnqueue
+
+DESCRIPTION
+  	Add a prompt to the queue, replacing a waiting prompt it supersedes,
+    any volume prompt for a volume prompt or else one for the same event. If
+    the queue is full the lowest class prompt is dropped, which is the new
+    one unless it outranks a waiting prompt.
+
+RETURNS
+  	void
+*/
+static void promptEnqueue( const prompt_item * item )
+{
+    prompt_item * queue = gPrompt.queue;
+    uint16 depth = gPrompt.stats.depth;
+    uint16 i;
+
+    for(i = 0; i < depth; i++)
+    {
+        if((queue[i].cls == item->cls) && ((item->cls == prompt_class_volume) || (queue[i].event == item->event)))
+        {
+            PROMPT_DEBUG(("PROMPT: class %d superseded\n", item->cls));
+            gPrompt.stats.coalesced++;
+
+            for(depth--; i < depth; i++)
+                queue[i] = queue[i + 1];
+            break;
+        }
+    }
+
+    if(depth == PROMPT_QUEUE_DEPTH)
+    {
+        gPrompt.stats.dropped++;
+
+        if(item->cls >= queue[depth - 1].cls)
+        {
+            PROMPT_DEBUG(("PROMPT: full, class %d dropped\n", item->cls));
+            return;
+        }
+        PROMPT_DEBUG(("PROMPT: full, class %d dropped\n", queue[depth - 1].cls));
+        depth--;
+    }
+
+    /* after any waiting prompts of the same or a higher class */
+    for(i = depth; (i > 0) && (queue[i - 1].cls > item->cls); i--)
+        queue[i] = queue[i - 1];
+
+    queue[i] = *item;
+    depth++;
+
+    gPrompt.stats.depth = depth;
+    if(depth > gPrompt.stats.peak_depth)
+        gPrompt.stats.peak_depth = depth;
+}
+
+/****************************************************************************
+NAME
+  	promptSubmit
+
+DESCRIPTION
+  	Play, preempt with, queue or drop a prompt
+
+RETURNS
+  	void
+*/
+static void promptSubmit( const prompt_item * item, bool can_queue )
+{
+    bool busy = gPrompt.active || IsAudioBusy();
+
+    /* a prompt that can't wait still plays if audio is free, waiting prompts
+       are released when the dispatch message is delivered */
+    if(!busy && (!gPrompt.stats.depth || !can_queue))
+    {
+        promptPlay(item);
+        return;
+    }
+
+    /* ring and call prompts don't wait for a lower class prompt to finish */
+    if(gPrompt.active && (item->cls <= prompt_class_call) && (item->cls < gPrompt.active_class))
+    {
+        PROMPT_DEBUG(("PROMPT: class %d preempts %d\n", item->cls, gPrompt.active_class));
+        gPrompt.stats.preempted++;
+
+        AudioStopTone();
+        TTSTerminate();
+        promptPlay(item);
+        return;
+    }
+
+    if(!can_queue)
+    {
+        PROMPT_DEBUG(("PROMPT: busy, class %d dropped\n", item->cls));
+        gPrompt.stats.dropped++;
+        return;
+    }
+
+    promptEnqueue(item);
+
+    /* audio may be busy with something other than a prompt */
+    if(!gPrompt.active)
+    {
+        MessageCancelAll(&gPromptTask, PROMPT_DISPATCH);
+        MessageSendConditionally(&gPromptTask, PROMPT_DISPATCH, 0, (const uint16 *)AudioBusyPtr());
+    }
+}
+
+/****************************************************************************
+NAME
+  	promptSchedulerHandler
+
+DESCRIPTION
+  	Message handler for the scheduler, audio is free so the prompt playing
+    has finished and the next can be played
+
+RETURNS
+  	void
+*/
+static void promptSchedulerHandler( Task task, MessageId id, Message message )
+{
+    uint16 i;
+
+    if(id == PROMPT_DISPATCH)
+    {
+        gPrompt.active = FALSE;
+
+        if(gPrompt.stats.depth)
+        {
+            prompt_item item = gPrompt.queue[0];
+
+            gPrompt.stats.depth--;
+            for(i = 0; i < gPrompt.stats.depth; i++)
+                gPrompt.queue[i] = gPrompt.queue[i + 1];
+
+            promptPlay(&item);
+        }
+    }
+}
+
+
+/****************************************************************************
+NAME
+  	promptClassFromEvent
+*/
+prompt_class promptClassFromEvent( sinkEvents_t pEvent )
+{
+    switch(pEvent)
+    {
+        case TONE_TYPE_RING_1:
+        case TONE_TYPE_RING_2:
+            return prompt_class_ring;
+
+        case EventAnswer:
+        case EventReject:
+        case EventCancelEnd:
+        case EventTransferToggle:
+        case EventEndOfCall:
+        case EventCallAnswered:
+        case EventMultipointCallWaiting:
+        case EventPlaceIncomingCallOnHold:
+        case EventAcceptHeldIncomingCall:
+        case EventRejectHeldIncomingCall:
+        case EventThreeWayReleaseAllHeld:
+        case EventThreeWayAcceptWaitingReleaseActive:
+        case EventThreeWayAcceptWaitingHoldActive:
+        case EventThreeWayAddHeldTo3Way:
+        case EventThreeWayConnect2Disconnect:
+        case EventToggleMute:
+        case EventMuteOn:
+        case EventMuteOff:
+        case EventMuteReminder:
+            return prompt_class_call;
+
+        case EventLowBattery:
+        case EventCriticalBattery:
+        case EventOkBattery:
+        case EventBatteryLevelRequest:
+        case EventGasGauge0:
+        case EventGasGauge1:
+        case EventGasGauge2:
+        case EventGasGauge3:
+        case EventChargerGasGauge0:
+        case EventChargerGasGauge1:
+        case EventChargerGasGauge2:
+        case EventChargerGasGauge3:
+        case EventChargerConnected:
+        case EventChargerDisconnected:
+        case EventChargeInProgress:
+        case EventChargeComplete:
+            return prompt_class_battery;
+
+        case EventVolumeUp:
+        case EventVolumeDown:
+        case EventVolumeMax:
+        case EventVolumeMin:
+        case EventToggleVolume:
+        case EventRCVolumeUp:
+        case EventRCVolumeDown:
+        case EventSubwooferVolumeUp:
+        case EventSubwooferVolumeDown:
+            return prompt_class_volume;
+
+        default:
+            return prompt_class_info;
+    }
+}
+
+/****************************************************************************
+NAME
+  	promptScheduleTone
+*/
+void promptScheduleTone( prompt_class cls, sinkEvents_t pEvent, uint16 tone, bool can_queue, bool default_level )
+{
+    prompt_item item;
+
+    item.plugin = NULL;
+    item.id     = tone;
+    item.event  = pEvent - EVENTS_MESSAGE_BASE;
+    item.cls    = cls;
+    item.kind   = prompt_tone;
+    item.flag   = default_level;
+    item.unused = 0;
+    item.scheduled = (uint16)VmGetClock();
+
+    promptSubmit(&item, can_queue);
+}
+
+/****************************************************************************
+NAME
+  	promptSchedulePhrase
+*/
+void promptSchedulePhrase( prompt_class cls, sinkEvents_t pEvent, Task plugin, uint16 tts_id, bool can_queue, bool override )
+{
+    prompt_item item;
+
+    item.plugin = plugin;
+    item.id     = tts_id;
+    item.event  = pEvent - EVENTS_MESSAGE_BASE;
+    item.cls    = cls;
+    item.kind   = prompt_phrase;
+    item.flag   = override;
+    item.unused = 0;
+    item.scheduled = (uint16)VmGetClock();
+
+    promptSubmit(&item, can_queue);
+}
+
+/****************************************************************************
+NAME
+  	promptSchedulerFlush
+*/
+void promptSchedulerFlush( void )
+{
+    gPrompt.stats.dropped += gPrompt.stats.depth;
+    gPrompt.stats.depth = 0;
+}
+
+/****************************************************************************
+NAME
+  	promptSchedulerGetStats
+*/
+void promptSchedulerGetStats( prompt_scheduler_stats * stats )
+{
+    *stats = gPrompt.stats;
+}
@@ -0,0 +1,114 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_prompt_scheduler.h
+
+DESCRIPTION
+    Schedules event tones and voice prompts by priority class. Only one
+    prompt is handed to the audio plugin at a time, the rest wait in a short
+    queue ordered by class. A waiting volume prompt is replaced by any later
+    one, so a burst of volume steps plays the first and the last tone only,
+    other waiting prompts are only replaced by a later one for the same
+    event. Ring and call prompts stop a lower class prompt that is
+    playing rather than waiting for it.
+
+*/
+#ifndef _SINK_PROMPT_SCHEDULER_H_
+#define _SINK_PROMPT_SCHEDULER_H_
+
+#include <csrtypes.h>
+#include <message.h>
+
+#include "sink_events.h"
+
+
+/* most prompts waiting to play */
+#define PROMPT_QUEUE_DEPTH      (4)
+
+/* Priority classes, highest first */
+typedef enum
+{
+    prompt_class_ring,
+    prompt_class_call,          /* call state and mute */
+    prompt_class_battery,
+    prompt_class_volume,        /* a later volume prompt supersedes any waiting one */
+    prompt_class_info           /* everything else */
+} prompt_class;
+
+/* Scheduler counters */
+typedef struct
+{
+    uint16  depth;              /* prompts waiting now */
+    uint16  peak_depth;
+    uint16  played;
+    uint16  coalesced;          /* waiting prompts replaced by a later one */
+    uint16  dropped;            /* prompts not played, the queue was full or they could not wait */
+    uint16  preempted;          /* prompts stopped for one of a higher class */
+} prompt_scheduler_stats;
+
+
+/****************************************************************************
+NAME
+    promptClassFromEvent
+
+DESCRIPTION
+    Get the priority class of the prompt for an event
+
+RETURNS
+    the class
+*/
+prompt_class promptClassFromEvent( sinkEvents_t pEvent );
+
+/****************************************************************************
+NAME
+    promptScheduleTone
+
+DESCRIPTION
+    Play a tone, or queue it if another prompt is playing and can_queue is
+    set. default_level plays the tone at the default volume.
+
+RETURNS
+    void
+*/
+void promptScheduleTone( prompt_class cls, sinkEvents_t pEvent, uint16 tone, bool can_queue, bool default_level );
+
+/****************************************************************************
+NAME
+    promptSchedulePhrase
+
+DESCRIPTION
+    Play a voice prompt phrase with the plugin given, or queue it if another
+    prompt is playing and can_queue is set. override is passed on to the
+    plugin to cancel what it has queued.
+
+RETURNS
+    void
+*/
+void promptSchedulePhrase( prompt_class cls, sinkEvents_t pEvent, Task plugin, uint16 tts_id, bool can_queue, bool override );
+
+/****************************************************************************
+NAME
+    promptSchedulerFlush
+
+DESCRIPTION
+    Drop all waiting prompts, the prompt playing is left to the caller
+
+RETURNS
+    void
+*/
+void promptSchedulerFlush( void );
+
+/****************************************************************************
+NAME
+    promptSchedulerGetStats
+
+DESCRIPTION
+    Copy the scheduler counters
+
+RETURNS
+    void
+*/
+void promptSchedulerGetStats( prompt_scheduler_stats * stats );
+
+#endif /* _SINK_PROMPT_SCHEDULER_H_ */
@@ -0,0 +1,358 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_rc_params.c
+
+DESCRIPTION
+    Connection parameter manager for the BLE remote control. As master the
+    headset must attend every connection event, so the interval sets both
+    the power it spends on the link and how long a key press waits to be
+    sent, slave latency only saves the remote's battery. The interval is
+    asked for as a single value so it is known, and is rounded to keep the
+    connection events in step with BR/EDR audio rather than drifting
+    through it.
+
+*/
+#ifdef ENABLE_REMOTE
+#include "sink_rc_params.h"
+#include "sink_energy.h"
+#include "sink_private.h"
+
+#include <connection.h>
+#include <vm.h>
+
+
+#ifdef DEBUG_RC_PARAMS
+#define RC_PARAMS_DEBUG(x) DEBUG(x)
+#else
+#define RC_PARAMS_DEBUG(x)
+#endif
+
+#define RC_PARAMS_IDLE_MSG          (0)
+#define RC_PARAMS_SLEEP_MSG         (1)
+#define RC_PARAMS_SLOW_SCAN_MSG     (2)
+
+/* time without a key press before the link is slowed, then slowed again */
+#define RC_PARAMS_IDLE_MS           (D_SEC(5))
+#define RC_PARAMS_SLEEP_MS          (D_SEC(60))
+
+/* fast scanning when looking for the remote, then back to the slow scan
+   the rest of the scan time, intervals and windows in 625us */
+#define RC_PARAMS_FAST_SCAN_MS      (D_SEC(10))
+#define RC_PARAMS_FAST_SCAN         (96)
+#define RC_PARAMS_FAST_WINDOW       (48)
+#define RC_PARAMS_SLOW_SCAN         (800)
+#define RC_PARAMS_SLOW_WINDOW       (400)
+
+/* The HV3/EV3 reserved slot pattern repeats every 6 slots, 3 connection
+   interval units, and the A2DP poll is 10ms, 8 units */
+#define RC_PARAMS_SCO_STEP          (3)
+#define RC_PARAMS_A2DP_STEP         (8)
+#define RC_PARAMS_A2DP_MIN          (16)
+
+/* Parameter sets */
+typedef enum
+{
+    rc_params_setup,                /* discovery and set up */
+    rc_params_active,               /* keys being pressed */
+    rc_params_idle,
+    rc_params_sleep,
+    rc_params_num_modes
+} rc_params_mode;
+
+typedef struct
+{
+    uint16      interval;           /* 1.25ms */
+    uint16      latency;            /* connection events */
+    uint16      timeout;            /* supervision timeout in 10ms */
+} rc_params_set;
+
+static const rc_params_set gRcParamsSets[rc_params_num_modes] =
+{
+    /* interval,    latency,    timeout */
+    {   8,          0,          400 },      /* setup 10ms */
+    {   12,         0,          400 },      /* active 15ms */
+    {   80,         12,         400 },      /* idle 100ms */
+    {   400,        4,          600 }       /* sleep 500ms */
+};
+
+typedef struct
+{
+    uint32      latency_sum;        /* estimated key press latency over all presses in ms */
+    uint32      scan_start;         /* clock the remote was looked for */
+    uint16      presses;
+    uint16      worst_latency;      /* ms */
+    uint16      interval;           /* asked for, 1.25ms, not confirmed */
+    uint16      reconnect;          /* 100ms */
+    uint16      worst_reconnect;    /* 100ms */
+    unsigned    mode:2;             /* rc_params_mode */
+    unsigned    traffic:2;          /* rc_traffic */
+    unsigned    connected:1;
+    unsigned    scanning:1;
+    unsigned    unused:10;
+} rc_params_t;
+
+static void rcParamsHandler(Task task, MessageId id, Message message);
+
+static TaskData gRcParamsTask = { rcParamsHandler };
+static rc_params_t gRcParams;
+
+
+/****************************************************************************
+NAME
+  	rcParamsAlign
+
+DESCRIPTION
+  	Round an interval to keep the connection events in step with the
+    BR/EDR audio
+
+RETURNS
+  	the interval to ask for in 1.25ms
+*/
+static uint16 rcParamsAlign( uint16 interval )
+{
+    uint16 step = 1;
+
+    if(gRcParams.traffic == rc_traffic_sco)
+    {
+        step = RC_PARAMS_SCO_STEP;
+    }
+    else if(gRcParams.traffic == rc_traffic_a2dp)
+    {
+        step = RC_PARAMS_A2DP_STEP;
+        if(interval < RC_PARAMS_A2DP_MIN)
+            interval = RC_PARAMS_A2DP_MIN;
+    }
+
+    return ((interval + step - 1) / step) * step;
+}
+
+/****************************************************************************
+NAME
+  	rcParamsEventsPerSecond
+
+DESCRIPTION
+  	Get the connection events attended each second at the interval asked
+    for, assuming the controller set it
+
+RETURNS
+  	events per second, rounded up
+*/
+static uint16 rcParamsEventsPerSecond( void )
+{
+    if(!gRcParams.connected || !gRcParams.interval)
+        return 0;
+
+    return (800 + gRcParams.interval - 1) / gRcParams.interval;
+}
+
+/****************************************************************************
+NAME
+  	rcParamsApply
+
+DESCRIPTION
+  	Ask for the parameters of a mode, adjusted for the BR/EDR audio. No
+    confirmation of the interval set comes back, so the one asked for is
+    kept and the estimates are made from it.
+
+RETURNS
+  	void
+*/
+static void rcParamsApply( rc_params_mode mode )
+{
+    const rc_params_set * set = &gRcParamsSets[mode];
+    ble_connection_params params;
+    uint16 interval = rcParamsAlign(set->interval);
+
+    if((mode == gRcParams.mode) && (interval == gRcParams.interval))
+        return;
+
+    gRcParams.mode = mode;
+    gRcParams.interval = interval;
+
+    RC_PARAMS_DEBUG(("RCP: mode %d interval %d latency %d traffic %d\n", mode, interval, set->latency, gRcParams.traffic));
+
+    params.scan_interval = 16;
+    params.scan_window = 16;
+    params.conn_interval_min = interval;
+    params.conn_interval_max = interval;
+    params.conn_latency = set->latency;
+    params.supervision_timeout = set->timeout;
+    params.conn_attempt_timeout = 8192;
+    params.adv_interval_min = 32;
+    params.adv_interval_max = 16384;
+    params.conn_latency_max = 12;
+    params.supervision_timeout_min = 10;
+    params.supervision_timeout_max = 3200;
+    params.own_address_type = TYPED_BDADDR_PUBLIC;
+
+    ConnectionDmBleSetConnectionParametersReq(&params);
+
+    energyConsumerSet(energy_consumer_remote, rcParamsEventsPerSecond());
+}
+
+/****************************************************************************
+NAME
+  	rcParamsHandler
+
+DESCRIPTION
+  	Slow the link when keys stop being pressed and the scan once the
+    remote has had time to be found
+
+RETURNS
+  	void
+*/
+static void rcParamsHandler(Task task, MessageId id, Message message)
+{
+    switch(id)
+    {
+        case RC_PARAMS_IDLE_MSG:
+            if(gRcParams.connected)
+            {
+                rcParamsApply(rc_params_idle);
+                MessageSendLater(&gRcParamsTask, RC_PARAMS_SLEEP_MSG, 0, RC_PARAMS_SLEEP_MS);
+            }
+        break;
+
+        case RC_PARAMS_SLEEP_MSG:
+            if(gRcParams.connected)
+                rcParamsApply(rc_params_sleep);
+        break;
+
+        case RC_PARAMS_SLOW_SCAN_MSG:
+            ConnectionDmBleSetScanParametersReq(FALSE, FALSE, FALSE, RC_PARAMS_SLOW_SCAN, RC_PARAMS_SLOW_WINDOW);
+        break;
+
+        default:
+        break;
+    }
+}
+
+
+/****************************************************************************
+NAME
+  	rcParamsScanStart
+*/
+void rcParamsScanStart( void )
+{
+    gRcParams.scanning = TRUE;
+    gRcParams.scan_start = VmGetClock();
+
+    MessageCancelAll(&gRcParamsTask, RC_PARAMS_SLOW_SCAN_MSG);
+    ConnectionDmBleSetScanParametersReq(FALSE, FALSE, FALSE, RC_PARAMS_FAST_SCAN, RC_PARAMS_FAST_WINDOW);
+    MessageSendLater(&gRcParamsTask, RC_PARAMS_SLOW_SCAN_MSG, 0, RC_PARAMS_FAST_SCAN_MS);
+
+    rcParamsApply(rc_params_setup);
+}
+
+/****************************************************************************
+NAME
+  	rcParamsConnected
+*/
+void rcParamsConnected( void )
+{
+    uint32 elapsed;
+
+    gRcParams.connected = TRUE;
+
+    if(gRcParams.scanning)
+    {
+        gRcParams.scanning = FALSE;
+        elapsed = (VmGetClock() - gRcParams.scan_start) / 100;
+        gRcParams.reconnect = (elapsed < 0xFFFF) ? (uint16)elapsed : 0xFFFF;
+        if(gRcParams.reconnect > gRcParams.worst_reconnect)
+            gRcParams.worst_reconnect = gRcParams.reconnect;
+
+        RC_PARAMS_DEBUG(("RCP: reconnected in %d00ms\n", gRcParams.reconnect));
+    }
+
+    /* the slow scan is left for when the remote is next looked for */
+    MessageCancelAll(&gRcParamsTask, RC_PARAMS_SLOW_SCAN_MSG);
+    ConnectionDmBleSetScanParametersReq(FALSE, FALSE, FALSE, RC_PARAMS_SLOW_SCAN, RC_PARAMS_SLOW_WINDOW);
+
+    rcParamsApply(rc_params_idle);
+    MessageSendLater(&gRcParamsTask, RC_PARAMS_SLEEP_MSG, 0, RC_PARAMS_SLEEP_MS);
+}
+
+/****************************************************************************
+NAME
+  	rcParamsDisconnected
+*/
+void rcParamsDisconnected( void )
+{
+    gRcParams.connected = FALSE;
+
+    MessageCancelAll(&gRcParamsTask, RC_PARAMS_IDLE_MSG);
+    MessageCancelAll(&gRcParamsTask, RC_PARAMS_SLEEP_MSG);
+
+    energyConsumerSet(energy_consumer_remote, 0);
+}
+
+/****************************************************************************
+NAME
+  	rcParamsInput
+*/
+void rcParamsInput( bool key_down )
+{
+    uint16 latency;
+
+    if(!gRcParams.connected)
+        return;
+
+    if(key_down)
+    {
+        /* the press waits for the next connection event, half an interval
+           on average and a whole one at worst, whatever the slave latency */
+        latency = (gRcParams.interval * 5) / 4;
+        gRcParams.latency_sum += latency / 2;
+        if(gRcParams.presses < 0xFFFF)
+            gRcParams.presses++;
+        if(latency > gRcParams.worst_latency)
+            gRcParams.worst_latency = latency;
+    }
+
+    MessageCancelAll(&gRcParamsTask, RC_PARAMS_IDLE_MSG);
+    MessageCancelAll(&gRcParamsTask, RC_PARAMS_SLEEP_MSG);
+
+    if(gRcParams.mode != rc_params_setup)
+    {
+        rcParamsApply(rc_params_active);
+        MessageSendLater(&gRcParamsTask, RC_PARAMS_IDLE_MSG, 0, RC_PARAMS_IDLE_MS);
+    }
+}
+
+/****************************************************************************
+NAME
+  	rcParamsSetTraffic
+*/
+void rcParamsSetTraffic( rc_traffic traffic )
+{
+    if(traffic == gRcParams.traffic)
+        return;
+
+    gRcParams.traffic = traffic;
+
+    /* ask again for the same mode aligned to the new traffic */
+    if(gRcParams.connected || gRcParams.scanning)
+        rcParamsApply(gRcParams.mode);
+}
+
+/****************************************************************************
+NAME
+  	rcParamsGetStats
+*/
+void rcParamsGetStats( rc_params_stats * stats )
+{
+    stats->presses = gRcParams.presses;
+    stats->average_latency = gRcParams.presses ? (uint16)(gRcParams.latency_sum / gRcParams.presses) : 0;
+    stats->worst_latency = gRcParams.worst_latency;
+    stats->requested_interval = gRcParams.connected ? gRcParams.interval : 0;
+    stats->current = rcParamsEventsPerSecond() * energyGetCurrent(energy_consumer_remote);
+    stats->reconnect = gRcParams.reconnect;
+    stats->worst_reconnect = gRcParams.worst_reconnect;
+}
+
+#else
+static const int dummy;  /* ISO C forbids an empty source file */
+#endif  /* def ENABLE_REMOTE */
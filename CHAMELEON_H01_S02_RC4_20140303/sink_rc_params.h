@@ -0,0 +1,122 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_rc_params.h
+
+DESCRIPTION
+    Connection parameter manager for the BLE remote control. The connection
+    interval is chosen from the input seen from the remote, short while keys
+    are being pressed and longer the longer it is left alone, and is kept in
+    step with any SCO or A2DP traffic on BR/EDR. Scanning is fast for a
+    while each time the remote is looked for so it is found again quickly
+    after sleep or link loss.
+
+*/
+#ifndef _SINK_RC_PARAMS_H_
+#define _SINK_RC_PARAMS_H_
+
+#include <csrtypes.h>
+
+
+/* BR/EDR audio the remote control link shares the radio with */
+typedef enum
+{
+    rc_traffic_none,
+    rc_traffic_sco,
+    rc_traffic_a2dp
+} rc_traffic;
+
+/* Key press latency and power of the remote control link. The interval
+   is the one asked for, the controller does not report the one it set, so
+   the latency and current are worked out from the request and must be
+   checked against an air trace on target. */
+typedef struct
+{
+    uint16      presses;            /* key presses seen */
+    uint16      average_latency;    /* estimated over all presses in ms */
+    uint16      worst_latency;      /* estimated in ms */
+    uint16      requested_interval; /* connection interval asked for in 1.25ms */
+    uint16      current;            /* estimated current now in 10uA */
+    uint16      reconnect;          /* time the last reconnection took in 100ms */
+    uint16      worst_reconnect;    /* in 100ms */
+} rc_params_stats;
+
+
+/****************************************************************************
+NAME
+    rcParamsScanStart
+
+DESCRIPTION
+    Note the remote control is being looked for, scanning starts fast and
+    the connection will be made with the setup parameters
+
+RETURNS
+    void
+*/
+void rcParamsScanStart( void );
+
+/****************************************************************************
+NAME
+    rcParamsConnected
+
+DESCRIPTION
+    Note the remote control connection is set up, the link is taken to the
+    idle parameters
+
+RETURNS
+    void
+*/
+void rcParamsConnected( void );
+
+/****************************************************************************
+NAME
+    rcParamsDisconnected
+
+DESCRIPTION
+    Note the remote control has disconnected
+
+RETURNS
+    void
+*/
+void rcParamsDisconnected( void );
+
+/****************************************************************************
+NAME
+    rcParamsInput
+
+DESCRIPTION
+    Note an input report from the remote control, key_down set if a key is
+    pressed in it
+
+RETURNS
+    void
+*/
+void rcParamsInput( bool key_down );
+
+/****************************************************************************
+NAME
+    rcParamsSetTraffic
+
+DESCRIPTION
+    Note the BR/EDR audio now routed
+
+RETURNS
+    void
+*/
+void rcParamsSetTraffic( rc_traffic traffic );
+
+/****************************************************************************
+NAME
+    rcParamsGetStats
+
+DESCRIPTION
+    Get the key press latency and power of the remote control link, as
+    estimated from the connection interval asked for
+
+RETURNS
+    void
+*/
+void rcParamsGetStats( rc_params_stats * stats );
+
+#endif /* _SINK_RC_PARAMS_H_ */
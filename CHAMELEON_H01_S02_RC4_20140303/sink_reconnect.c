@@ -0,0 +1,288 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_reconnect.c
+
+DESCRIPTION
+    Reconnection ordering. The devices available to connect to are scored
+    when reconnection starts and attempted best first. The success rate of a
+    device is estimated from the attempts recorded in its attributes, with
+    one success and one failure assumed so a device with no history starts
+    in the middle, and it is penalised for each place it is down the PDL and
+    for each recent link loss. Devices with equal scores keep their PDL order.
+
+*/
+
+#include "sink_reconnect.h"
+#include "sink_private.h"
+#include "sink_devicemanager.h"
+#include "sink_slc.h"
+
+#include <connection.h>
+#include <string.h>
+
+
+#ifdef DEBUG_SLC
+#define RECONNECT_DEBUG(x) DEBUG(x)
+#else
+#define RECONNECT_DEBUG(x)
+#endif
+
+/* number of outcomes held in the page history */
+#define RECONNECT_HISTORY_SIZE      (8)
+#define RECONNECT_LINK_LOSS_MAX     (15)
+
+typedef struct
+{
+    bdaddr      device[RECONNECT_MAX_CANDIDATES];   /* devices in the order they are to be attempted */
+    bdaddr      pending;                            /* device being paged */
+    unsigned    count:4;                            /* number of devices in the plan */
+    unsigned    next:4;                             /* position in the plan of the next device */
+    unsigned    round:4;                            /* rounds of attempts started, saturates */
+    unsigned    pending_valid:1;
+    unsigned    short_page:1;                       /* page timeout has been shortened */
+    unsigned    unused:2;
+} reconnect_plan_t;
+
+static reconnect_plan_t gReconnect;
+
+
+/****************************************************************************
+NAME
+  	reconnectScore
+
+DESCRIPTION
+  	Score a device by how likely a connection attempt is to succeed
+
+RETURNS
+  	the score, higher is better
+*/
+static uint16 reconnectScore( uint8 list_id, const reconnect_attributes * stats )
+{
+    uint16 successes = 0;
+    uint16 attempts = stats->page_attempts;
+    uint16 penalty;
+    uint16 score;
+    uint16 i;
+
+    for(i = 0; i < attempts; i++)
+    {
+        if(stats->page_history & (1 << i))
+            successes++;
+    }
+
+    score   = ((successes + 1) * RECONNECT_SCORE_SCALE) / (attempts + 2);
+    penalty = (list_id * RECONNECT_RECENCY_PENALTY) + (stats->link_loss * RECONNECT_LINK_LOSS_PENALTY);
+
+    return (score > penalty) ? (score - penalty) : 0;
+}
+
+/****************************************************************************
+NAME
+  	reconnectFindListId
+
+DESCRIPTION
+  	Find the current PDL index of a device
+
+RETURNS
+  	TRUE if the device is still in the PDL
+*/
+static bool reconnectFindListId( const bdaddr * bd_addr, uint8 * list_id )
+{
+    sink_attributes attributes;
+    typed_bdaddr addr;
+    uint8 pdl_size = ConnectionTrustedDeviceListSize();
+    uint8 i;
+
+    for(i = 0; i < pdl_size; i++)
+    {
+        if(deviceManagerGetIndexedAttributes(i, &attributes, &addr) && BdaddrIsSame(&addr.addr, bd_addr))
+        {
+            *list_id = i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/****************************************************************************
+NAME
+  	reconnectSetShortPage
+
+DESCRIPTION
+  	Shorten or restore the page timeout
+
+RETURNS
+  	void
+*/
+static void reconnectSetShortPage( bool short_page )
+{
+    if(gReconnect.short_page != short_page)
+    {
+        /* a timeout of 0 restores the default */
+        ConnectionSetPageTimeout(short_page ? RECONNECT_SHORT_PAGE_TIMEOUT : 0);
+        gReconnect.short_page = short_page;
+    }
+}
+
+
+/****************************************************************************
+NAME
+  	reconnectPlanStart
+*/
+void reconnectPlanStart( uint8 max_candidates )
+{
+    uint16 score[RECONNECT_MAX_CANDIDATES];
+    sink_attributes attributes;
+    typed_bdaddr addr;
+    uint16 new_score;
+    uint8 pdl_size = ConnectionTrustedDeviceListSize();
+    uint8 i;
+    uint8 j;
+
+    gReconnect.count = 0;
+    gReconnect.next  = 0;
+    gReconnect.round = 1;
+    gReconnect.pending_valid = FALSE;
+
+    if(max_candidates > RECONNECT_MAX_CANDIDATES)
+        max_candidates = RECONNECT_MAX_CANDIDATES;
+    if(max_candidates > pdl_size)
+        max_candidates = pdl_size;
+
+    for(i = 0; i < max_candidates; i++)
+    {
+        deviceManagerGetDefaultAttributes(&attributes, FALSE);
+
+        if(!slcIsListIdAvailable(i) || !deviceManagerGetIndexedAttributes(i, &attributes, &addr))
+            continue;
+
+        new_score = reconnectScore(i, &attributes.reconnect);
+
+        /* insert after any devices with the same score so ties stay in PDL order */
+        for(j = gReconnect.count; (j > 0) && (score[j - 1] < new_score); j--)
+        {
+            score[j] = score[j - 1];
+            gReconnect.device[j] = gReconnect.device[j - 1];
+        }
+        score[j] = new_score;
+        gReconnect.device[j] = addr.addr;
+        gReconnect.count++;
+
+        RECONNECT_DEBUG(("RECON: ListID %d score %d history %x/%d link loss %d\n", i, new_score,
+                         attributes.reconnect.page_history, attributes.reconnect.page_attempts, attributes.reconnect.link_loss));
+    }
+
+    /* short windows are only worth using if there is another device to move on to */
+    reconnectSetShortPage(gReconnect.count > 1);
+}
+
+/****************************************************************************
+NAME
+  	reconnectPlanNext
+*/
+bool reconnectPlanNext( uint8 * list_id )
+{
+    while(gReconnect.next < gReconnect.count)
+    {
+        const bdaddr * bd_addr = &gReconnect.device[gReconnect.next++];
+
+        if(reconnectFindListId(bd_addr, list_id) && slcIsListIdAvailable(*list_id))
+        {
+            RECONNECT_DEBUG(("RECON: round %d next ListID %d\n", gReconnect.round, *list_id));
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/****************************************************************************
+NAME
+  	reconnectPlanRestart
+*/
+bool reconnectPlanRestart( void )
+{
+    if(!gReconnect.count)
+        return FALSE;
+
+    gReconnect.next = 0;
+    if(gReconnect.round < 15)
+        gReconnect.round++;
+
+    /* every device has had a short window, give them the full timeout */
+    reconnectSetShortPage(FALSE);
+
+    return TRUE;
+}
+
+/****************************************************************************
+NAME
+  	reconnectPlanEnd
+*/
+void reconnectPlanEnd( void )
+{
+    gReconnect.count = 0;
+    gReconnect.next  = 0;
+    reconnectSetShortPage(FALSE);
+}
+
+/****************************************************************************
+NAME
+  	reconnectPageStarted
+*/
+void reconnectPageStarted( const bdaddr * bd_addr )
+{
+    gReconnect.pending = *bd_addr;
+    gReconnect.pending_valid = TRUE;
+}
+
+/****************************************************************************
+NAME
+  	reconnectPageResult
+*/
+void reconnectPageResult( const bdaddr * bd_addr, bool connected )
+{
+    sink_attributes attributes;
+
+    if(!gReconnect.pending_valid || !BdaddrIsSame(&gReconnect.pending, bd_addr))
+        return;
+
+    gReconnect.pending_valid = FALSE;
+
+    deviceManagerGetDefaultAttributes(&attributes, FALSE);
+    if(!deviceManagerGetAttributes(&attributes, bd_addr))
+        return;
+
+    attributes.reconnect.page_history = (attributes.reconnect.page_history << 1) | (connected ? 1 : 0);
+    if(attributes.reconnect.page_attempts < RECONNECT_HISTORY_SIZE)
+        attributes.reconnect.page_attempts++;
+    if(connected)
+        attributes.reconnect.link_loss >>= 1;
+
+    RECONNECT_DEBUG(("RECON: page %s history %x/%d\n", connected ? "ok" : "failed",
+                     attributes.reconnect.page_history, attributes.reconnect.page_attempts));
+
+    deviceManagerStoreAttributes(&attributes, bd_addr);
+}
+
+/****************************************************************************
+NAME
+  	reconnectLinkLoss
+*/
+void reconnectLinkLoss( const bdaddr * bd_addr )
+{
+    sink_attributes attributes;
+
+    deviceManagerGetDefaultAttributes(&attributes, FALSE);
+    if(!deviceManagerGetAttributes(&attributes, bd_addr))
+        return;
+
+    if(attributes.reconnect.link_loss < RECONNECT_LINK_LOSS_MAX)
+    {
+        attributes.reconnect.link_loss++;
+        deviceManagerStoreAttributes(&attributes, bd_addr);
+    }
+
+    RECONNECT_DEBUG(("RECON: link loss %d\n", attributes.reconnect.link_loss));
+}
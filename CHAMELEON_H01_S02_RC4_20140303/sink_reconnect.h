@@ -0,0 +1,125 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_reconnect.h
+
+DESCRIPTION
+    Orders the devices in the PDL for reconnection by how likely they are to
+    connect. The outcome of recent connection attempts and the number of
+    recent link losses are kept in the device attributes and combined with
+    the position of the device in the PDL to give a score. The first round of
+    attempts uses a short page timeout so a device that is out of range does
+    not hold up the devices after it, later rounds use the default timeout.
+
+*/
+#ifndef _SINK_RECONNECT_H_
+#define _SINK_RECONNECT_H_
+
+#include <csrtypes.h>
+#include <bdaddr.h>
+
+
+/* most devices considered, the size of the PDL */
+#define RECONNECT_MAX_CANDIDATES        (8)
+
+/* page timeout used for the first round of attempts, in slots (2.56 seconds) */
+#define RECONNECT_SHORT_PAGE_TIMEOUT    (0x1000)
+
+/* score of a device is its estimated success rate out of this less the penalties below */
+#define RECONNECT_SCORE_SCALE           (256)
+#define RECONNECT_RECENCY_PENALTY       (16)    /* per place in the PDL */
+#define RECONNECT_LINK_LOSS_PENALTY     (8)     /* per recent link loss */
+
+
+/****************************************************************************
+NAME
+    reconnectPlanStart
+
+DESCRIPTION
+    Build the order in which to attempt connections from the first
+    max_candidates devices in the PDL that are available to connect to
+
+RETURNS
+    void
+*/
+void reconnectPlanStart( uint8 max_candidates );
+
+/****************************************************************************
+NAME
+    reconnectPlanNext
+
+DESCRIPTION
+    Get the next device of the current round that is still available to
+    connect to. Devices are held by address so the list ID returned is
+    correct even if the PDL has been reordered by a connection.
+
+RETURNS
+    TRUE and the PDL index of the device in list_id, FALSE at the end of
+    the round
+*/
+bool reconnectPlanNext( uint8 * list_id );
+
+/****************************************************************************
+NAME
+    reconnectPlanRestart
+
+DESCRIPTION
+    Start another round of attempts, these use the default page timeout
+
+RETURNS
+    FALSE if there are no devices to connect to
+*/
+bool reconnectPlanRestart( void );
+
+/****************************************************************************
+NAME
+    reconnectPlanEnd
+
+DESCRIPTION
+    Reconnection has finished, restore the default page timeout
+
+RETURNS
+    void
+*/
+void reconnectPlanEnd( void );
+
+/****************************************************************************
+NAME
+    reconnectPageStarted
+
+DESCRIPTION
+    Note the device a connection attempt is being made to so the result can
+    be recorded against it
+
+RETURNS
+    void
+*/
+void reconnectPageStarted( const bdaddr * bd_addr );
+
+/****************************************************************************
+NAME
+    reconnectPageResult
+
+DESCRIPTION
+    Record the outcome of a connection attempt, ignored unless it is the
+    result of the attempt noted by reconnectPageStarted
+
+RETURNS
+    void
+*/
+void reconnectPageResult( const bdaddr * bd_addr, bool connected );
+
+/****************************************************************************
+NAME
+    reconnectLinkLoss
+
+DESCRIPTION
+    Record a link loss against a device
+
+RETURNS
+    void
+*/
+void reconnectLinkLoss( const bdaddr * bd_addr );
+
+#endif /* _SINK_RECONNECT_H_ */
@@ -13,6 +13,7 @@ NOTES
 */
 #ifdef ENABLE_REMOTE
 #include "sink_remote_control.h"
+#include "sink_rc_params.h"
 #include "sink_statemanager.h"
 
 #ifdef ENABLE_SOUNDBAR
@@ -22,46 +23,6 @@ NOTES
 
 
 
-/*************************************************************************
-NAME
-    set_speed_parameters
-    
-DESCRIPTION
-    Request connection parameters to enable quick setup or to save energy
-*/
-static void set_speed_parameters(bool quick)
-{
-    ble_connection_params params;
-            
-    RC_DEBUG(("RC: set_speed_parameters %u\n", quick));
-          
-    params.scan_interval = 16;
-    params.scan_window = 16;
-    params.conn_interval_min = 6;
-    params.supervision_timeout = 400;
-    params.conn_attempt_timeout = 8192;
-    params.adv_interval_min = 32;
-    params.adv_interval_max = 16384;
-    params.conn_latency_max = 12;
-    params.supervision_timeout_min = 10;
-    params.supervision_timeout_max = 3200;
-    params.own_address_type = TYPED_BDADDR_PUBLIC;
-    
-    if (quick)
-    {
-        params.conn_interval_max = 40;
-        params.conn_latency = 0;
-    }
-    
-    else
-    {
-        params.conn_interval_max = 3200;
-        params.conn_latency = 12;
-    }
-    
-    ConnectionDmBleSetConnectionParametersReq(&params);
-}
-
 #ifndef ENABLE_SOUNDBAR
 /*************************************************************************
 NAME
@@ -120,8 +81,6 @@ static void gatt_message_handler(Task task, MessageId id, Message message)
                     if (m->status == gatt_status_success)
                         theSink.rundata->remoteControl.state = hgs_idle;
 
-                    set_speed_parameters(TRUE);
-
                     /*  Set scan interval to 800 * 625s = 500ms, scan window half that */
                     ConnectionDmBleSetScanParametersReq(FALSE, FALSE, FALSE, 800, 400);
 #ifdef ENABLE_SOUNDBAR
@@ -203,6 +162,7 @@ static void gatt_message_handler(Task task, MessageId id, Message message)
                     {
                         theSink.rundata->remoteControl.state = hgs_idle;
                         theSink.rundata->remoteControl.cid = 0;
+                        rcParamsDisconnected();
 
                         if (m->status == gatt_status_link_loss)
                         {
@@ -294,7 +254,7 @@ static void gatt_message_handler(Task task, MessageId id, Message message)
                         }
 
                     if (!m->more_to_come)
-                        set_speed_parameters(FALSE);
+                        rcParamsConnected();
 
                 }
                 break;
@@ -314,6 +274,8 @@ static void gatt_message_handler(Task task, MessageId id, Message message)
                     if (m->size_value == ATTR_LEN_HID_INPUT_REPORT)
 #endif
                     {
+                    rcParamsInput(m->value[GATT_NOTIFICATION_INDEX] != 0);
+
                     for(i =0 ; i<m->size_value; i++)
                     {
                         RC_DEBUG((" %02X", m->value[i]));
@@ -612,6 +574,7 @@ void rcConnect(void)
         MessageSendLater(&theSink.rundata->remoteControl.task, RC_SCAN_STOP, NULL, RC_SCAN_TIMEOUT);
 #endif
         RC_DEBUG(("RC: Enable Scan\n"));
+        rcParamsScanStart();
         ConnectionDmBleSetScanEnable(TRUE);
     }
 }
@@ -744,6 +707,7 @@ void rcSetScan()
     if(theSink.rundata->remoteControl.cid == 0)
     {
         RC_DEBUG(("RC: Enable Scanning....\n"));
+        rcParamsScanStart();
         ConnectionDmBleSetScanEnable(TRUE);
         theSink.rundata->remoteControl.state = hgs_scan;
     }
@@ -27,6 +27,7 @@ NOTES
 #include "sink_volume.h"
 #include "sink_led_manager.h"
 #include "sink_a2dp.h"
+#include "sink_reconnect.h"
 
 #ifdef ENABLE_PBAP
 #include "sink_pbap.h"
@@ -147,7 +148,11 @@ RETURNS
 */
 void sinkHandleSlcDisconnectInd( const HFP_SLC_DISCONNECT_IND_T *ind )
 {	    
-    conn_mask mask = deviceManagerProfilesConnected(&ind->bd_addr);
+    conn_mask mask;
+    
+    /* the HFP library has already released the link */
+    deviceManagerUpdateConnections();
+    mask = deviceManagerProfilesConnected(&ind->bd_addr);
 
     SLC_DEBUG(("SLC: slc DiscInd for index %d, status = %d\n",ind->priority, ind->status)) ;     
         
@@ -212,6 +217,9 @@ void sinkHandleSlcDisconnectInd( const HFP_SLC_DISCONNECT_IND_T *ind )
                 theSink.profile_data[PROFILE_INDEX(hfp_secondary_link)].status.list_id = INVALID_LIST_ID;
             }
         }
+        /* link priorities may have changed */
+        deviceManagerUpdateConnections();
+        
         /* send event slc disconnected only if the status of the indication is success or link loss indication */
         MessageSend(&theSink.task , ((ind->status == hfp_disconnect_link_loss) ? EventReconnectFailed : EventSLCDisconnected) , 0) ;
     }
@@ -310,6 +318,7 @@ static void slcConnectionComplete(hfp_link_priority priority, Sink sink, bdaddr*
     	
     /* mark as connected */
     theSink.profile_data[PROFILE_INDEX(priority)].status.connected = TRUE;
+    deviceManagerUpdateConnections();
 
     /* Another connection made, update number of current connections */
     theSink.no_of_profiles_connected = deviceManagerNumConnectedDevs();
@@ -358,6 +367,9 @@ bool sinkHandleSlcConnectCfm( const HFP_SLC_CONNECT_CFM_T *cfm )
     sink_attributes attributes;
     bool lResult = FALSE;
 
+    /* record the outcome of a reconnection attempt before reading the attributes it updates */
+    reconnectPageResult(&cfm->bd_addr, (cfm->status == hfp_connect_success));
+
     deviceManagerGetDefaultAttributes(&attributes, FALSE);
     (void)deviceManagerGetAttributes(&attributes, &cfm->bd_addr);
 
@@ -490,6 +502,10 @@ void slcHandleLinkLossInd( const HFP_SLC_LINK_LOSS_IND_T *ind )
     {
         /* Send an event to notify the user */
         MessageSend(&theSink.task , EventLinkLoss , 0);
+        
+        /* note the link loss against the device for reconnection ordering */
+        if(HfpLinkGetSlcSink(ind->priority, &sink) && SinkGetBdAddr(sink, &ag_addr))
+            reconnectLinkLoss(&ag_addr.addr);
         /* Go connectable if feature enabled */
         if(theSink.features.GoConnectableDuringLinkLoss)
             sinkEnableConnectable(); 
@@ -574,6 +590,7 @@ RETURNS
 void slcEstablishSLCRequest ( void )
 {
     bool listId_available = FALSE;
+    uint8 lListID = 0;
     
     /* only attempt a connection is the device is able to do so, 1 connection without multipoint only */
     if(deviceManagerCanConnect())
@@ -615,16 +632,16 @@ void slcEstablishSLCRequest ( void )
             /* get the number of devices in the PDL */
             gSlcData.gPdlSize = ConnectionTrustedDeviceListSize();
 
-            listId_available = slcIsListIdAvailable(gSlcData.gListID);
-            
-            /* ensure device is available to connect to and not already connected */
-            if(!listId_available)
-            {
-               /* move to next ID as that must be free */
-               gSlcData.gListID++;  
-               /* check whether next id is available for connection */               
-               listId_available = slcIsListIdAvailable(gSlcData.gListID);
-            }
+            /* order the devices by how likely they are to connect, LAST only considers the
+               last device connected or the last two when multipoint is enabled */
+            if(reconnect_action == AR_List)
+                reconnectPlanStart(gSlcData.gPdlSize);
+            else
+                reconnectPlanStart(theSink.MultipointEnable ? MAX_MULTIPOINT_CONNECTIONS : 1);
+
+            listId_available = reconnectPlanNext(&lListID);
+            if(listId_available)
+                gSlcData.gListID = lListID;
             
             /* ensure device is available */
             if(listId_available)
@@ -638,6 +655,7 @@ void slcEstablishSLCRequest ( void )
                 SLC_DEBUG(("SLC: EstablishSLC - no devices found\n")) ;
                 /* nothing to connect to, reset flag */
                 theSink.rundata->connection_in_progress = FALSE;
+                reconnectPlanEnd();
             }
         }
     }
@@ -714,6 +732,10 @@ void slcContinueEstablishSLCRequest( void )
 
     /* reset connection via remote ag instead of device flag */
     gSlcData.gSlcConnectRemote = FALSE;
+    
+    /* restore the page timeout once all connection attempts are complete */
+    if(!theSink.rundata->connection_in_progress)
+        reconnectPlanEnd();
 
     SLC_DEBUG(("SLC: StopReq\n")) ;
 }       
@@ -775,7 +797,8 @@ void slcAttemptConnection(void)
            try to find another device */
         if(attributes.profiles & (sink_hfp | sink_a2dp | sink_avrcp))
         {
-            /* attempt to connect to device */
+            /* attempt to connect to device, noting it so the outcome is recorded */
+            reconnectPageStarted(&ag_addr.addr);
             slcConnectDevice(&ag_addr.addr, attributes.profiles);
         }
         /* device does not support required profiles, try to find another device that does */
@@ -861,9 +884,9 @@ NAME
     slcGetNextListID
     
 DESCRIPTION
-    selects the next available ListID for connection based on list id passed in and
-    the type of profile requested, this could be 'not fussed', 'hfp' or 'a2dp', the 
-    funtion will also check for the end of the pdl and wrap to the beggining if that 
+    selects the next available ListID for connection, devices are taken in the order
+    given by the reconnection scheduler (sink_reconnect.c) rather than PDL order, the 
+    funtion will also check for the end of the order and wrap to the beggining if that 
     feature is enabled
 
 RETURNS
@@ -871,109 +894,55 @@ RETURNS
 */   
 bool slcGetNextListID(void)
 {
+    uint8 lListID;
+    bool wrap;
+    
     /* determine reconnection action, last or list */
     if(slcDetermineConnectAction() == AR_List)
     {
    		SLC_DEBUG(("SLC: slcGetNextListID - LIST - rem att = %d\n",theSink.NoOfReconnectionAttempts)) ;
 
-        /* move to next item in list */
-        gSlcData.gListID++;
-
         /* if there are a maximum number of reconnection attempts configured then check to see if
            any attempts remain, if no reconnection attempts are configured then traverse the list
            once only */
-        if((!theSink.conf1->timeouts.ReconnectionAttempts)||
-           (theSink.conf1->timeouts.ReconnectionAttempts && theSink.NoOfReconnectionAttempts))
-        {
-           /* check whether the ID is available, if not and at end of PDL, consider wrapping */
-           if((!slcIsListIdAvailable(gSlcData.gListID))&&(gSlcData.gListID == gSlcData.gPdlSize)&&(gSlcData.gPdlSize))
-           {
-                /* At end of PDL, is PDL wrapping available ? */           
-               	if(theSink.conf1->timeouts.ReconnectionAttempts)
-                {
-                	SLC_DEBUG(("SLC: slcGetNextListID = %x - End of PDL - Wrap to 0\n",gSlcData.gListID)) ;
-                    /* wrapping available, go to start of PDL */
-                    gSlcData.gListID = 0;
-                    /* check ListID 0 is available */
-                    if(!slcIsListIdAvailable(gSlcData.gListID))
-                    {
-                        gSlcData.gListID = 1;
-                        SLC_DEBUG(("SLC: slcGetNextListID = ID 0 not available use ID %x\n",gSlcData.gListID)) ;
-                    }
-                    /* success */
-                    return TRUE;
-                }
-                /* PDL wrapping not allowed so stop here */
-                else
-              	{
-              		SLC_DEBUG(("SLC: slcGetNextListID = %x - End of PDL - No Wrapping\n",gSlcData.gListID)) ;
-                    return FALSE;
-                }
-           }
-           /* also check if ID not allowed due to being already connected, in which case try the next one */
-           else if(!slcIsListIdAvailable(gSlcData.gListID))
-           {
-               /* move to next ID and check that */
-               gSlcData.gListID++;
-               /* this should be available, if not it is end of PDL in which case stop as only
-                  allow two connections to be made */
-               if(slcIsListIdAvailable(gSlcData.gListID))
-              	{
-                   SLC_DEBUG(("SLC: slcGetNextListID = %x - Already Connected - try next\n",gSlcData.gListID)) ;
-                   return TRUE;
-               }
-               /* not available, there is only one device in PDL so return failed status */
-               else
-               {
-              		SLC_DEBUG(("SLC: slcGetNextListID = %x - Already Connected - no next so stop\n",gSlcData.gListID)) ;
-                   return FALSE;
-               }
-           }
-           /* new ListId is available for trying a connection */
-           else
-           {
-          		SLC_DEBUG(("SLC: slcGetNextListID = %x - OK\n",gSlcData.gListID)) ;
-               return TRUE;
-           }
-        }
-        /* no further attempts remaining so stop */
-        else
+        if(theSink.conf1->timeouts.ReconnectionAttempts && !theSink.NoOfReconnectionAttempts)
       	{
        		SLC_DEBUG(("SLC: slcGetNextListID = %x - No attempts remaining\n",gSlcData.gListID)) ;
             return FALSE;
         }
+        
+        /* PDL wrapping is only available when attempts are limited */
+        wrap = (theSink.conf1->timeouts.ReconnectionAttempts != 0);
     }
-    /* LAST reconnection type, device will connect to first two devices in PDL */
+    /* LAST reconnection type, device will connect to the last device, or the last two
+       devices with multipoint, repeating while attempts remain */
     else
     {
-       if(!theSink.MultipointEnable)
-       {
-            if(theSink.NoOfReconnectionAttempts && !theSink.no_of_profiles_connected)
-                return TRUE;
-            else
-                return FALSE;
-       }
-       else
-       {
-            /* If no attempts remaining give up */
-            if(!theSink.NoOfReconnectionAttempts)
-                return FALSE;
-            
-            /* move to next id */
-            gSlcData.gListID++;
-                      
-            /* ensure device is available, if a swat device is in the PDL then this will need
-               to be skipped */
-            if(!(slcIsListIdAvailable(gSlcData.gListID)))
-            {
-               gSlcData.gListID++;
-            }
-            
-            SLC_DEBUG(("SLC: slcGetNextListID - LAST\n")) ;
-            /* ensure device is available and return TRUE or FALSE status */
-            return slcIsListIdAvailable(gSlcData.gListID);
+        if(!theSink.NoOfReconnectionAttempts)
+            return FALSE;
+        
+        if(!theSink.MultipointEnable && theSink.no_of_profiles_connected)
+            return FALSE;
+        
+        SLC_DEBUG(("SLC: slcGetNextListID - LAST\n")) ;
+        wrap = TRUE;
+    }
+    
+    /* move to the next device in the reconnection order, those already connected are skipped */
+    if(!reconnectPlanNext(&lListID))
+    {
+        /* end of the order, is wrapping available ? */
+        if(!wrap || !reconnectPlanRestart() || !reconnectPlanNext(&lListID))
+        {
+            SLC_DEBUG(("SLC: slcGetNextListID - End of PDL - No Wrapping\n")) ;
+            return FALSE;
         }
+        SLC_DEBUG(("SLC: slcGetNextListID - End of PDL - Wrap\n")) ;
     }
+    
+    gSlcData.gListID = lListID;
+    SLC_DEBUG(("SLC: slcGetNextListID = %x - OK\n",gSlcData.gListID)) ;
+    return TRUE;
 }
 
 /****************************************************************************
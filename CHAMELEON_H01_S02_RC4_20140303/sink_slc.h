@@ -209,9 +209,9 @@ NAME
     slcGetNextListID
     
 DESCRIPTION
-    selects the next available ListID for connection based on list id passed in and
-    the type of profile requested, this could be 'not fussed', 'hfp' or 'a2dp', the 
-    funtion will also check for the end of the pdl and wrap to the beggining if that 
+    selects the next available ListID for connection, devices are taken in the order
+    given by the reconnection scheduler (sink_reconnect.c) rather than PDL order, the 
+    funtion will also check for the end of the order and wrap to the beggining if that 
     feature is enabled
 
 RETURNS
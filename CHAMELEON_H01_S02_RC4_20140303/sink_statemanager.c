@@ -764,6 +764,8 @@ void stateManagerUpdateLimboState ( void )
     if(power_off_request)    
     {
       SM_DEBUG(("SM : Power Off\n--goodbye--\n")) ;
+      /* Write back any cached device attributes */
+      deviceManagerFlushAttributes();
       /* Store DSP data */
       configManagerWriteDspData();
       /* Check defrag */
@@ -16,6 +16,7 @@ DESCRIPTION
 #include "sink_debug.h"
 #include "sink_private.h"
 #include "sink_inquiry.h"
+#include "sink_inquiry_rank.h"
 #include "sink_scan.h"
 #include "sink_states.h"
 #include "sink_statemanager.h"
@@ -104,17 +105,6 @@ DESCRIPTION
 static bool getSubwooferBdAddrFromPs(void);
 
 
-/****************************************************************************
-NAME    
-    sortSubwooferInquiryResults
-    
-DESCRIPTION
-    Helper function to sort the inquiry results once inquiry search has
-    completed.
-*/
-static void sortSubwooferInquiryResults(void);
-
-
 /****************************************************************************
 NAME    
     subwooferStartInqConnection
@@ -382,9 +372,10 @@ void handleEventSubwooferStartInquiry(void)
     theSink.inquiry.action = rssi_subwoofer;
     theSink.inquiry.state = inquiry_searching;
         
-    /* Allocate memory to store the inquiry results */
-    theSink.inquiry.results = (inquiry_result_t *)PanicNull(malloc(SW_MAX_INQUIRY_DEVS * sizeof(inquiry_result_t)));
-    memset(theSink.inquiry.results, 0, (SW_MAX_INQUIRY_DEVS * sizeof(inquiry_result_t)));
+    /* Allocate memory to store the inquiry results, limited by RSSI if configured */
+    theSink.inquiry.results = inquiryRankCreate(SW_MAX_INQUIRY_DEVS,
+                                                theSink.features.LimitRssiSuboowferPairing ? (int16)RSSI_CONF.threshold : INQUIRY_RANK_NO_FLOOR,
+                                                inquiry_rank_highest);
         
     /* Inquire for devices with device class matching SW_CLASS_OF_DEVICE */
     ConnectionWriteInquiryMode(&theSink.task, inquiry_mode_eir);
@@ -397,8 +388,6 @@ void handleEventSubwooferStartInquiry(void)
 /*************************************************************************/
 void handleSubwooferInquiryResult( CL_DM_INQUIRE_RESULT_T* result )
 {
-    uint8 counter;
-    
     SWAT_DEBUG(("SW : SW inquiry result status = %x\n",result->status));
 
 
@@ -409,48 +398,25 @@ void handleSubwooferInquiryResult( CL_DM_INQUIRE_RESULT_T* result )
         if(theSink.rundata->subwoofer.inquiry_attempts) 
             theSink.rundata->subwoofer.inquiry_attempts--;
 
-        /* Sort the list */
-        sortSubwooferInquiryResults();
-        
-        /* Make connection attempts to the inquiry results */
+        /* Make connection attempts to the inquiry results, these are already sorted by RSSI */
         subwooferStartInqConnection();
     }
     else
     {
-        /* Expect SW_MAX_INQUIRY_DEV number of unique inquiry results; process each one */
-        for (counter=0; counter<SW_MAX_INQUIRY_DEVS; counter++)
+        inquiry_result_t res;
+        
+        memset(&res, 0, sizeof(inquiry_result_t));
+        res.bd_addr = result->bd_addr;
+        res.rssi    = result->rssi;
+        
+        /* Devices below the RSSI threshold (if configured), or weaker than all those already found once the list is full, are not stored */
+        if (inquiryRankAdd(theSink.inquiry.results, &res))
         {
-            /* If the discovered device already exists in the list, ignore it */
-            if (BdaddrIsSame(&result->bd_addr, (const bdaddr *)&theSink.inquiry.results[counter]))
-            {
-                return;
-            }
-            /* If the current entry is empty, validate and add the device */
-            if (BdaddrIsZero((const bdaddr *)&theSink.inquiry.results[counter]))
-            {
-                /* Check the RSSI value meets minimum required (if configured) */
-                if (theSink.features.LimitRssiSuboowferPairing)
-                {
-                    if (result->rssi > (int)RSSI_CONF.threshold)
-                    {
-                        /* Add the device (RSSI meets threshold requirements */
-                        SWAT_DEBUG(("SW : INQ Found SW device\n"));
-                        theSink.inquiry.results[counter].bd_addr = result->bd_addr;
-                        theSink.inquiry.results[counter].rssi    = result->rssi;
-                    }
-                    else
-                    {
-                        SWAT_DEBUG(("SW : INQ - Device signal too low [%d]\n", result->rssi));
-                    }
-                }
-                else
-                {
-                    /* Add the device (RSSI restriction is disabled) */
-                    SWAT_DEBUG(("SW : INQ Found SW device\n"));
-                    theSink.inquiry.results[counter].bd_addr = result->bd_addr;
-                    theSink.inquiry.results[counter].rssi    = result->rssi;
-                }
-            }
+            SWAT_DEBUG(("SW : INQ Found SW device\n"));
+        }
+        else
+        {
+            SWAT_DEBUG(("SW : INQ - Device not stored RSSI[%d]\n", result->rssi));
         }
     }
 }
@@ -816,7 +782,7 @@ static void handleSwatSignallingConnectCfm(SWAT_SIGNALLING_CONNECT_CFM_T * cfm)
         if (theSink.inquiry.action == rssi_subwoofer)
         {
             theSink.inquiry.action = rssi_none;
-            free(theSink.inquiry.results);
+            freePanic(theSink.inquiry.results);
             theSink.inquiry.results = NULL;
 
             /* inquiry complete, make soundbar connectable again */
@@ -1045,64 +1011,15 @@ static void handleSwatSetVolumeCfm(SWAT_SET_VOLUME_CFM_T * cfm)
 }
 
 
-/****************************************************************************/
-static void sortSubwooferInquiryResults(void)
-{
-    uint8 counter, sub_counter;
-    inquiry_result_t temp;
-    
-    /* Sort the list based on RSSI */
-    for (counter=0; counter<SW_MAX_INQUIRY_DEVS; counter++)
-    {
-        /* Check there's actually an item in the list to compare */
-        if (!BdaddrIsZero(&theSink.inquiry.results[counter].bd_addr))
-        {
-            /* Compare current result against other results and change position if necessary */
-            for (sub_counter=0; sub_counter<SW_MAX_INQUIRY_DEVS; sub_counter++)
-            {
-                /* Only compare against real items in the list */
-                if (BdaddrIsZero(&theSink.inquiry.results[sub_counter].bd_addr) == FALSE)
-                {
-                    /* Don't compare result against itself */
-                    if ((theSink.inquiry.results[counter].rssi > theSink.inquiry.results[sub_counter].rssi) && (sub_counter != counter))
-                    {
-                        /* Current result has a lesser RSSI with compared result so swap their positions in list */
-                        temp = theSink.inquiry.results[counter];
-                        theSink.inquiry.results[counter] = theSink.inquiry.results[sub_counter];
-                        theSink.inquiry.results[sub_counter] = temp;
-                    }
-                }
-                else
-                {
-                    /* No other results to compare against */
-                    break;
-                }
-            }
-        }
-        else
-        {
-            /* No more results to sort */
-            break;
-        }
-    }
-#ifdef DEBUG_SWAT
-    for (counter=0; counter<SW_MAX_INQUIRY_DEVS; counter++)
-    {
-        SWAT_DEBUG(("SW : theSink.inquiry.results[%d] = ADDR[%04x %02x %06lx] RSSI[%d]\n", counter, theSink.inquiry.results[counter].bd_addr.nap, theSink.inquiry.results[counter].bd_addr.uap, theSink.inquiry.results[counter].bd_addr.lap, theSink.inquiry.results[counter].rssi));
-    }
-#endif
-}
-
-
 /****************************************************************************/
 static void subwooferStartInqConnection(void)
 {
     /* Check a subwoofer device was found by the inquiry search */
-    if (BdaddrIsZero((const bdaddr *)&theSink.inquiry.results[0].bd_addr))
+    if (!inquiryRankCount(theSink.inquiry.results))
     {
         SWAT_DEBUG(("No subwoofer device found by inquiry\n"));
         theSink.inquiry.action = rssi_none;
-        free(theSink.inquiry.results);
+        freePanic(theSink.inquiry.results);
         theSink.inquiry.results = NULL;
         MessageCancelFirst(&theSink.task, EventSubwooferStartInquiry);
         /* are there any more scan attempts available? */            
@@ -1125,7 +1042,7 @@ static void subwooferStartInqConnection(void)
     {
         /* Attempt to connect to the first result */
         theSink.inquiry.attempting = 0;
-        SwatSignallingConnectRequest(&theSink.inquiry.results[0].bd_addr);
+        SwatSignallingConnectRequest(&inquiryRankGet(theSink.inquiry.results, 0)->bd_addr);
     }
 }
 
@@ -1136,12 +1053,11 @@ static void subwooferInqNextConnection(void)
     theSink.inquiry.attempting++;
     
     /* Check there is another result to make a connection request to */
-    if ((theSink.inquiry.attempting >= SW_MAX_INQUIRY_DEVS)||
-        (BdaddrIsZero((const bdaddr *)&theSink.inquiry.results[theSink.inquiry.attempting].bd_addr)))
+    if (theSink.inquiry.attempting >= inquiryRankCount(theSink.inquiry.results))
     {
         SWAT_DEBUG(("No more subwoofer devices found by inquiry\n"));
         theSink.inquiry.action = rssi_none;
-        free(theSink.inquiry.results);
+        freePanic(theSink.inquiry.results);
         theSink.inquiry.results = NULL;
         /* are there any more scan attempts available? */            
         if(theSink.rundata->subwoofer.inquiry_attempts) 
@@ -1161,7 +1077,7 @@ static void subwooferInqNextConnection(void)
     else
     {
         /* Attempt to connect to the result */
-        SwatSignallingConnectRequest(&theSink.inquiry.results[theSink.inquiry.attempting].bd_addr);
+        SwatSignallingConnectRequest(&inquiryRankGet(theSink.inquiry.results, theSink.inquiry.attempting)->bd_addr);
     }
 }
 
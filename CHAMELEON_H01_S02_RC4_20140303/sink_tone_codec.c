@@ -0,0 +1,591 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_tone_codec.c
+
+DESCRIPTION
+    Packed user tones. A packed key is the magic word, the decoded size and
+    then one record per tone. A record is a header word holding the tone
+    index in the top 4 bits and the number of data words below, followed by
+    4 bit codes packed most significant first:
+
+        1ddd            note at the previous length, pitch moved by ddd - 4
+        0000 nnnn       the previous note repeated nnnn + 1 times
+        0001 pp         note at the previous length with pitch pp
+        0010 ll         note at the previous pitch with length ll
+        0011 pp ll      note with pitch pp and length ll
+        0100 wwww       ringtone word as it is, control words and any note
+                        that does not fit the codes above
+        0101            end of the tone
+
+    The previous note starts as pitch 0 length 0 for every record.
+
+*/
+
+#include "sink_tone_codec.h"
+#include "sink_private.h"
+#include "sink_config.h"
+#include "sink_configmanager.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#ifdef DEBUG_TONES
+#define CODEC_DEBUG(x) DEBUG(x)
+#else
+#define CODEC_DEBUG(x)
+#endif
+
+#define TONE_CODEC_INDEX_POS            (12)
+#define TONE_CODEC_LENGTH_MASK          (0x0FFF)
+
+#define TONE_CODEC_DELTA                (0x8)
+#define TONE_CODEC_REPEAT               (0x0)
+#define TONE_CODEC_PITCH                (0x1)
+#define TONE_CODEC_LENGTH               (0x2)
+#define TONE_CODEC_NOTE                 (0x3)
+#define TONE_CODEC_WORD                 (0x4)
+#define TONE_CODEC_END                  (0x5)
+
+/* longest run a single repeat code covers */
+#define TONE_CODEC_MAX_RUN              (16)
+
+/* a run of 4 bit codes within a record */
+typedef struct
+{
+    uint16 *    data;
+    uint16      pos;        /* next code */
+    uint16      size;       /* codes that fit */
+    unsigned    overrun:1;
+    unsigned    unused:15;
+} tone_codec_stream;
+
+/* the note a code is relative to */
+typedef struct
+{
+    uint8       pitch;
+    uint8       length;
+} tone_codec_note;
+
+
+/****************************************************************************
+NAME
+  	toneCodecIsPacked
+
+DESCRIPTION
+  	Check whether a block holds packed records
+
+RETURNS
+  	TRUE if packed
+*/
+static bool toneCodecIsPacked( const uint16 * key, uint16 key_len )
+{
+    return ((key_len >= TONE_CODEC_HEADER_SIZE) && (key[0] == TONE_CODEC_MAGIC));
+}
+
+/****************************************************************************
+NAME
+  	toneCodecPut
+
+DESCRIPTION
+  	Write the low codes of value, most significant first
+
+RETURNS
+  	void, overrun is set if the stream is full
+*/
+static void toneCodecPut( tone_codec_stream * stream, uint16 value, uint16 codes )
+{
+    while(codes--)
+    {
+        uint16 shift = (3 - (stream->pos & 3)) * 4;
+
+        if(stream->pos >= stream->size)
+        {
+            stream->overrun = TRUE;
+            return;
+        }
+
+        if(!(stream->pos & 3))
+            stream->data[stream->pos >> 2] = 0;
+
+        stream->data[stream->pos >> 2] |= ((value >> (codes * 4)) & 0xF) << shift;
+        stream->pos++;
+    }
+}
+
+/****************************************************************************
+NAME
+  	toneCodecGet
+
+DESCRIPTION
+  	Read a value made up of codes, most significant first
+
+RETURNS
+  	the value, overrun is set if the stream ended
+*/
+static uint16 toneCodecGet( tone_codec_stream * stream, uint16 codes )
+{
+    uint16 value = 0;
+
+    while(codes--)
+    {
+        if(stream->pos >= stream->size)
+        {
+            stream->overrun = TRUE;
+            return 0;
+        }
+
+        value = (value << 4) | ((stream->data[stream->pos >> 2] >> ((3 - (stream->pos & 3)) * 4)) & 0xF);
+        stream->pos++;
+    }
+    return value;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecSplitNote
+
+DESCRIPTION
+  	Get the pitch and length of a ringtone word if it is a note the codes
+    can describe
+
+RETURNS
+  	TRUE if it is such a note
+*/
+static bool toneCodecSplitNote( ringtone_note word, tone_codec_note * note )
+{
+    uint16 pitch  = (word & RINGTONE_SEQ_NOTE_PITCH_MASK) >> RINGTONE_SEQ_NOTE_PITCH_POS;
+    uint16 length = (word & RINGTONE_SEQ_NOTE_LENGTH_MASK) >> RINGTONE_SEQ_NOTE_LENGTH_POS;
+
+    if((word & RINGTONE_SEQ_CONTROL_MASK) || (pitch > 0xFF) || (length > 0xFF))
+        return FALSE;
+
+    /* bits outside the pitch and length would be lost */
+    if((uint16)word != ((pitch << RINGTONE_SEQ_NOTE_PITCH_POS) | (length << RINGTONE_SEQ_NOTE_LENGTH_POS)))
+        return FALSE;
+
+    note->pitch  = pitch;
+    note->length = length;
+    return TRUE;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecJoinNote
+
+DESCRIPTION
+  	Make a ringtone word from a pitch and length
+
+RETURNS
+  	the note
+*/
+static ringtone_note toneCodecJoinNote( const tone_codec_note * note )
+{
+    return (ringtone_note)((note->pitch << RINGTONE_SEQ_NOTE_PITCH_POS) | (note->length << RINGTONE_SEQ_NOTE_LENGTH_POS));
+}
+
+/****************************************************************************
+NAME
+  	toneCodecDecodeRecord
+
+DESCRIPTION
+  	Decode the codes of a record into tone, which has room for size words.
+    With no tone the words are only counted.
+
+RETURNS
+  	the number of words including RINGTONE_END, 0 if the record is invalid
+*/
+static uint16 toneCodecDecodeRecord( const uint16 * record, ringtone_note * tone, uint16 size )
+{
+    tone_codec_stream stream;
+    tone_codec_note previous = {0, 0};
+    uint16 count = 0;
+    uint16 repeat;
+    uint16 code;
+
+    stream.data    = (uint16 *)&record[1];
+    stream.pos     = 0;
+    stream.size    = (record[0] & TONE_CODEC_LENGTH_MASK) * 4;
+    stream.overrun = FALSE;
+
+    for(;;)
+    {
+        code   = toneCodecGet(&stream, 1);
+        repeat = 1;
+
+        if(code & TONE_CODEC_DELTA)
+        {
+            previous.pitch += (code & 0x7) - 4;
+        }
+        else
+        {
+            switch(code)
+            {
+                case TONE_CODEC_REPEAT:
+                    repeat = toneCodecGet(&stream, 1) + 1;
+                break;
+                case TONE_CODEC_PITCH:
+                    previous.pitch = toneCodecGet(&stream, 2);
+                break;
+                case TONE_CODEC_LENGTH:
+                    previous.length = toneCodecGet(&stream, 2);
+                break;
+                case TONE_CODEC_NOTE:
+                    previous.pitch  = toneCodecGet(&stream, 2);
+                    previous.length = toneCodecGet(&stream, 2);
+                break;
+                case TONE_CODEC_WORD:
+                    code = toneCodecGet(&stream, 4);
+                    if(stream.overrun || (count >= size))
+                        return 0;
+                    if(tone)
+                        tone[count] = (ringtone_note)code;
+                    count++;
+                    continue;
+                case TONE_CODEC_END:
+                    if(count >= size)
+                        return 0;
+                    if(tone)
+                        tone[count] = (ringtone_note)RINGTONE_END;
+                    return count + 1;
+                default:
+                    return 0;
+            }
+        }
+
+        if(stream.overrun || ((count + repeat) > size))
+            return 0;
+
+        while(repeat--)
+        {
+            if(tone)
+                tone[count] = toneCodecJoinNote(&previous);
+            count++;
+        }
+    }
+}
+
+/****************************************************************************
+NAME
+  	toneCodecEncodeRecord
+
+DESCRIPTION
+  	Encode a RINGTONE_END terminated tone into the codes of a stream
+
+RETURNS
+  	the number of words the tone decodes to including RINGTONE_END
+*/
+static uint16 toneCodecEncodeRecord( tone_codec_stream * stream, const ringtone_note * tone )
+{
+    tone_codec_note previous = {0, 0};
+    tone_codec_note note;
+    const ringtone_note * start = tone;
+    uint16 run;
+
+    while((*tone != (ringtone_note)RINGTONE_END) && !stream->overrun)
+    {
+        if(!toneCodecSplitNote(*tone, &note))
+        {
+            toneCodecPut(stream, TONE_CODEC_WORD, 1);
+            toneCodecPut(stream, (uint16)*tone, 4);
+            tone++;
+            continue;
+        }
+
+        if((note.pitch == previous.pitch) && (note.length == previous.length))
+        {
+            /* a pair costs the same either way, longer runs are cheaper as a repeat */
+            for(run = 1; (run < TONE_CODEC_MAX_RUN) && (tone[run] == tone[0]); run++)
+                ;
+
+            if(run > 1)
+            {
+                toneCodecPut(stream, TONE_CODEC_REPEAT, 1);
+                toneCodecPut(stream, run - 1, 1);
+                tone += run;
+                continue;
+            }
+        }
+
+        if(note.length == previous.length)
+        {
+            int16 delta = (int16)note.pitch - (int16)previous.pitch;
+
+            if((delta >= -4) && (delta <= 3))
+            {
+                toneCodecPut(stream, TONE_CODEC_DELTA | (delta + 4), 1);
+            }
+            else
+            {
+                toneCodecPut(stream, TONE_CODEC_PITCH, 1);
+                toneCodecPut(stream, note.pitch, 2);
+            }
+        }
+        else if(note.pitch == previous.pitch)
+        {
+            toneCodecPut(stream, TONE_CODEC_LENGTH, 1);
+            toneCodecPut(stream, note.length, 2);
+        }
+        else
+        {
+            toneCodecPut(stream, TONE_CODEC_NOTE, 1);
+            toneCodecPut(stream, note.pitch, 2);
+            toneCodecPut(stream, note.length, 2);
+        }
+
+        previous = note;
+        tone++;
+    }
+
+    toneCodecPut(stream, TONE_CODEC_END, 1);
+
+    return (tone - start) + 1;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecIsTerminated
+
+DESCRIPTION
+  	Check a tone of an unpacked block ends with RINGTONE_END within the
+    words left in the block
+
+RETURNS
+  	TRUE if it does
+*/
+static bool toneCodecIsTerminated( const uint16 * tone, uint16 words )
+{
+    while(words--)
+    {
+        if(*tone++ == (uint16)RINGTONE_END)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecRead
+
+DESCRIPTION
+  	Read PSKEY_CONFIG_TONES into a new buffer
+
+RETURNS
+  	the buffer, to be freed by the caller, NULL if the key could not be read
+*/
+static uint16 * toneCodecRead( uint16 key_len )
+{
+    uint16 * key;
+
+    if(!key_len)
+        return NULL;
+
+    key = malloc(key_len);
+
+    if(key && !ConfigRetrieve(theSink.config_id, PSKEY_CONFIG_TONES, key, key_len))
+    {
+        free(key);
+        key = NULL;
+    }
+    return key;
+}
+
+
+/****************************************************************************
+NAME
+  	toneCodecPack
+*/
+uint16 toneCodecPack( uint16 * key, uint16 key_len, uint16 max_len )
+{
+    uint16 * legacy;
+    uint16 len = TONE_CODEC_HEADER_SIZE;
+    uint8 index;
+
+    if(toneCodecIsPacked(key, key_len))
+        return key_len;
+
+    if(max_len < TONE_CODEC_HEADER_SIZE)
+        return 0;
+
+    legacy = NULL;
+    if(key_len)
+    {
+        legacy = malloc(key_len);
+        if(!legacy)
+            return 0;
+        memmove(legacy, key, key_len);
+    }
+
+    key[0] = TONE_CODEC_MAGIC;
+    key[1] = MAX_NUM_VARIABLE_TONES;
+
+    for(index = 0; legacy && (index < MAX_NUM_VARIABLE_TONES) && len; index++)
+    {
+        if(!legacy[index] || (legacy[index] >= key_len))
+            continue;
+
+        /* a tone running off the end of the block is not a valid key */
+        if(toneCodecIsTerminated(&legacy[legacy[index]], key_len - legacy[index]))
+            len = toneCodecAppend(key, len, max_len, index, (const ringtone_note *)&legacy[legacy[index]]);
+        else
+            len = 0;
+    }
+
+    CODEC_DEBUG(("CODEC: pack %d words to %d\n", key_len, len));
+
+    if(legacy)
+        free(legacy);
+
+    return len;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecRemove
+*/
+uint16 toneCodecRemove( uint16 * key, uint16 key_len, uint8 index )
+{
+    uint16 pos = TONE_CODEC_HEADER_SIZE;
+    uint16 record_len;
+
+    if(!toneCodecIsPacked(key, key_len))
+        return key_len;
+
+    while(pos < key_len)
+    {
+        record_len = (key[pos] & TONE_CODEC_LENGTH_MASK) + 1;
+
+        if(record_len > (key_len - pos))
+            break;
+
+        if((key[pos] >> TONE_CODEC_INDEX_POS) == index)
+        {
+            key[1] -= toneCodecDecodeRecord(&key[pos], NULL, TONE_CODEC_MAX_DECODED_SIZE);
+            memmove(&key[pos], &key[pos + record_len], key_len - pos - record_len);
+            return key_len - record_len;
+        }
+        pos += record_len;
+    }
+    return key_len;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecAppend
+*/
+uint16 toneCodecAppend( uint16 * key, uint16 key_len, uint16 max_len, uint8 index, const ringtone_note * tone )
+{
+    tone_codec_stream stream;
+    uint16 decoded;
+    uint16 words;
+
+    if(!toneCodecIsPacked(key, key_len) || (index >= MAX_NUM_VARIABLE_TONES) || (max_len <= key_len))
+        return 0;
+
+    stream.data    = &key[key_len + 1];
+    stream.pos     = 0;
+    stream.size    = (max_len - key_len - 1) * 4;
+    stream.overrun = FALSE;
+
+    decoded = toneCodecEncodeRecord(&stream, tone);
+    words   = (stream.pos + 3) / 4;
+
+    if(stream.overrun || (words > TONE_CODEC_LENGTH_MASK) || ((key[1] + decoded) > TONE_CODEC_MAX_DECODED_SIZE))
+        return 0;
+
+    key[key_len] = ((uint16)index << TONE_CODEC_INDEX_POS) | words;
+    key[1] += decoded;
+
+    CODEC_DEBUG(("CODEC: tone %d %d notes in %d words\n", index, decoded, words + 1));
+
+    return key_len + words + 1;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecDecodedSize
+*/
+uint16 toneCodecDecodedSize( const uint16 * key, uint16 key_len )
+{
+    return toneCodecIsPacked(key, key_len) ? key[1] : key_len;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecDecode
+*/
+bool toneCodecDecode( const uint16 * key, uint16 key_len, ringtone_note * tones, uint16 size )
+{
+    uint16 pos = TONE_CODEC_HEADER_SIZE;
+    uint16 out = MAX_NUM_VARIABLE_TONES;
+    uint16 count;
+    uint8 index;
+
+    if(!toneCodecIsPacked(key, key_len))
+    {
+        memmove(tones, key, (key_len < size) ? key_len : size);
+        return TRUE;
+    }
+
+    if(size < MAX_NUM_VARIABLE_TONES)
+        return FALSE;
+
+    memset(tones, 0, MAX_NUM_VARIABLE_TONES);
+
+    while(pos < key_len)
+    {
+        index = key[pos] >> TONE_CODEC_INDEX_POS;
+        count = 0;
+
+        /* a record running off the end of the block is not decoded */
+        if((key[pos] & TONE_CODEC_LENGTH_MASK) < (key_len - pos))
+            count = toneCodecDecodeRecord(&key[pos], &tones[out], size - out);
+
+        if(!count || (index >= MAX_NUM_VARIABLE_TONES))
+        {
+            CODEC_DEBUG(("CODEC: bad record at %d\n", pos));
+            return FALSE;
+        }
+
+        tones[index] = (ringtone_note)out;
+        out += count;
+        pos += (key[pos] & TONE_CODEC_LENGTH_MASK) + 1;
+    }
+    return TRUE;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecUserTonesSize
+*/
+uint16 toneCodecUserTonesSize( uint16 key_len )
+{
+    uint16 * key = toneCodecRead(key_len);
+    uint16 size = 0;
+
+    if(key)
+    {
+        size = toneCodecDecodedSize(key, key_len);
+        free(key);
+    }
+    return size;
+}
+
+/****************************************************************************
+NAME
+  	toneCodecUserTonesLoad
+*/
+bool toneCodecUserTonesLoad( uint16 key_len, ringtone_note * tones, uint16 size )
+{
+    uint16 * key = toneCodecRead(key_len);
+    bool valid = FALSE;
+
+    if(key)
+    {
+        valid = toneCodecDecode(key, key_len, tones, size);
+        free(key);
+    }
+    return valid;
+}
@@ -0,0 +1,128 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_tone_codec.h
+
+DESCRIPTION
+    Compact storage for the user defined tones in PSKEY_CONFIG_TONES. Each
+    tone is held as its own record of 4 bit codes, most notes taking a
+    single code for a small pitch step at the previous length, and runs of
+    a repeated note taking two. Records are independent so a tone can be
+    replaced without touching the others. Blocks are decoded into the form
+    written by the configuration tool, 8 offsets followed by RINGTONE_END
+    terminated ringtone_note data, so they can be handed straight to
+    AudioPlayTone. A key still in that form is read as it is.
+
+*/
+#ifndef _SINK_TONE_CODEC_H_
+#define _SINK_TONE_CODEC_H_
+
+#include <csrtypes.h>
+#include <audio.h>
+
+
+/* first word of a key holding packed records, never a valid tone offset */
+#define TONE_CODEC_MAGIC                (0xFC01)
+
+/* magic and decoded size words ahead of the records */
+#define TONE_CODEC_HEADER_SIZE          (2)
+
+/* largest decoded block allowed, it has to fit in the config cache */
+#define TONE_CODEC_MAX_DECODED_SIZE     (256)
+
+
+/****************************************************************************
+NAME
+    toneCodecPack
+
+DESCRIPTION
+    Bring a PSKEY_CONFIG_TONES block of key_len words into the packed form
+    in place. An empty block gets a header and an unpacked block has each of
+    its tones encoded, the block may hold up to max_len words.
+
+RETURNS
+    the packed length, 0 if the tones do not fit, a tone is not terminated
+    within the block or memory was short
+*/
+uint16 toneCodecPack( uint16 * key, uint16 key_len, uint16 max_len );
+
+/****************************************************************************
+NAME
+    toneCodecRemove
+
+DESCRIPTION
+    Remove the record of a tone from a packed block, the records after it
+    move down
+
+RETURNS
+    the new length, unchanged if the tone was not held
+*/
+uint16 toneCodecRemove( uint16 * key, uint16 key_len, uint8 index );
+
+/****************************************************************************
+NAME
+    toneCodecAppend
+
+DESCRIPTION
+    Encode a RINGTONE_END terminated tone as a record at the end of a packed
+    block that may hold up to max_len words. Any record already held for the
+    tone must have been removed first.
+
+RETURNS
+    the new length, 0 if the tone does not fit
+*/
+uint16 toneCodecAppend( uint16 * key, uint16 key_len, uint16 max_len, uint8 index, const ringtone_note * tone );
+
+/****************************************************************************
+NAME
+    toneCodecDecodedSize
+
+DESCRIPTION
+    Get the words needed to decode a block
+
+RETURNS
+    the size in words
+*/
+uint16 toneCodecDecodedSize( const uint16 * key, uint16 key_len );
+
+/****************************************************************************
+NAME
+    toneCodecDecode
+
+DESCRIPTION
+    Decode a block into offsets followed by ringtone_note data, tones must
+    be toneCodecDecodedSize words long and must not overlap the key
+
+RETURNS
+    TRUE if the block was valid
+*/
+bool toneCodecDecode( const uint16 * key, uint16 key_len, ringtone_note * tones, uint16 size );
+
+/****************************************************************************
+NAME
+    toneCodecUserTonesSize
+
+DESCRIPTION
+    Read PSKEY_CONFIG_TONES, key_len words long, and get the words needed to
+    decode it
+
+RETURNS
+    the size in words, 0 if the key could not be read
+*/
+uint16 toneCodecUserTonesSize( uint16 key_len );
+
+/****************************************************************************
+NAME
+    toneCodecUserTonesLoad
+
+DESCRIPTION
+    Read PSKEY_CONFIG_TONES, key_len words long, and decode it into tones
+    which is size words long
+
+RETURNS
+    TRUE if the key held valid data
+*/
+bool toneCodecUserTonesLoad( uint16 key_len, ringtone_note * tones, uint16 size );
+
+#endif /* _SINK_TONE_CODEC_H_ */
@@ -18,10 +18,13 @@ DESCRIPTION
 #include "sink_states.h"
 #include "sink_statemanager.h"
 #include "sink_pio.h"
+#include "sink_config_cache.h"
+#include "sink_prompt_scheduler.h"
 
 #include <stddef.h>
 #include <csrtypes.h>
 #include <audio.h>
+#include <string.h>
 
 
 #ifdef DEBUG_TONES
@@ -1487,6 +1490,213 @@ static const ringtone_note * const gFixedTones [ NUM_FIXED_TONES ] =
                  
      } ;
 
+/* An event and the tone configured for it */
+typedef struct
+{
+    unsigned    event:8;            /* event index */
+    unsigned    tone:8;             /* TONE_NOT_DEFINED if the event has no tone */
+    unsigned    uses:8;             /* times indicated, all are halved when one saturates */
+    unsigned    valid:1;
+    unsigned    tts_checked:1;      /* tts holds whether the event has a phrase */
+    unsigned    tts:1;
+    unsigned    unused:5;
+} tone_cache_entry;
+
+typedef struct
+{
+    tone_cache_entry    entry[TONE_CACHE_SIZE];
+    tone_cache_stats    stats;
+} tone_cache_t;
+
+static tone_cache_t gToneCache;
+
+/* events preloaded into the cache, user actions that expect immediate feedback */
+static const sinkEvents_t gHotToneEvents[] =
+{
+    EventVolumeUp,
+    EventVolumeDown,
+    EventToggleMute,
+    EventMuteReminder,
+    EventAvrcpPlayPause
+};
+
+
+/****************************************************************************
+NAME 
+    toneCacheFind
+
+DESCRIPTION
+    Find the cache entry of an event
+
+RETURNS
+    the entry, NULL if the event is not cached
+*/
+static tone_cache_entry * toneCacheFind ( uint16 lEvent )
+{
+    uint16 i;
+
+    for(i = 0; i < TONE_CACHE_SIZE; i++)
+    {
+        if(gToneCache.entry[i].valid && (gToneCache.entry[i].event == lEvent))
+            return &gToneCache.entry[i];
+    }
+    return NULL;
+}
+
+/****************************************************************************
+NAME 
+    toneCacheAdd
+
+DESCRIPTION
+    Look an event up in the event tones and cache the result, replacing the
+    least used entry. Events with more than one tone are not cached.
+
+RETURNS
+    the entry, NULL if the event was not cached
+*/
+static tone_cache_entry * toneCacheAdd ( uint16 lEvent )
+{
+    tone_cache_entry * entry = &gToneCache.entry[0];
+    uint16 tone = TONE_NOT_DEFINED;
+    uint16 i;
+
+    for(i = 0; theSink.conf2->gEventTones[i].tone != TONE_NOT_DEFINED; i++)
+    {
+        if(theSink.conf2->gEventTones[i].event == lEvent)
+        {
+            if(tone != TONE_NOT_DEFINED)
+                return NULL;
+            tone = theSink.conf2->gEventTones[i].tone;
+        }
+    }
+
+    for(i = 0; i < TONE_CACHE_SIZE; i++)
+    {
+        if(!gToneCache.entry[i].valid)
+        {
+            entry = &gToneCache.entry[i];
+            break;
+        }
+        if(gToneCache.entry[i].uses < entry->uses)
+            entry = &gToneCache.entry[i];
+    }
+
+    entry->event       = lEvent;
+    entry->tone        = tone;
+    entry->uses        = 0;
+    entry->valid       = TRUE;
+    entry->tts_checked = FALSE;
+
+    TONE_DEBUG(("TONE cache event [%x] tone [%x]\n", lEvent, tone));
+    return entry;
+}
+
+/****************************************************************************
+NAME 
+    toneCacheUse
+
+DESCRIPTION
+    Count a use of an entry, halving all counts when it saturates so the
+    cache follows changes in which events are frequent
+
+RETURNS
+    void
+*/
+static void toneCacheUse ( tone_cache_entry * entry )
+{
+    uint16 i;
+
+    if(entry->uses == 0xFF)
+    {
+        for(i = 0; i < TONE_CACHE_SIZE; i++)
+            gToneCache.entry[i].uses >>= 1;
+    }
+    entry->uses++;
+}
+
+/****************************************************************************
+NAME 
+    tonesPlayEventTone
+
+DESCRIPTION
+    Play the tone configured for an event
+
+RETURNS
+    void
+*/
+static void tonesPlayEventTone ( sinkEvents_t pEvent , uint16 pTone )
+{
+    /* turn on audio amp */
+    PioSetPio ( theSink.conf1->PIOIO.pio_outputs.DeviceAudioActivePIO , pio_drive, TRUE) ;
+    /* start check to turn amp off again if required */ 
+    MessageSendLater(&theSink.task , EventCheckAudioAmpDrive, 0, 1000);    
+
+    /* check event as tone queueing not allowed on mute and ring tones */					   
+    switch(pEvent)
+    {
+        case EventMuteReminder:
+        case TONE_TYPE_RING_1:
+        case TONE_TYPE_RING_2:
+        
+            /* check whether to play mute reminder tone at default volume level, never queue mute reminders to 
+               protect against the case that the tone is longer than the mute reminder timer */
+            promptScheduleTone (promptClassFromEvent(pEvent), pEvent, pTone ,FALSE, (theSink.features.MuteToneFixedVolume)) ;			
+            break;
+           
+        /* for all other events use the QueueEventTones feature bit setting */
+        default:
+            
+            /* play tone */
+            promptScheduleTone (promptClassFromEvent(pEvent), pEvent, pTone ,theSink.features.QueueEventTones, FALSE ) ;			
+            break;    
+    }
+}
+
+
+/****************************************************************************
+NAME 
+    TonesCacheInit
+*/
+void TonesCacheInit ( void )
+{
+    bool user_tone = FALSE;
+    uint16 i;
+
+    memset(&gToneCache, 0, sizeof(tone_cache_t));
+
+    for(i = 0; i < (sizeof(gHotToneEvents) / sizeof(gHotToneEvents[0])); i++)
+    {
+        tone_cache_entry * entry = toneCacheAdd(gHotToneEvents[i] - EVENTS_MESSAGE_BASE);
+
+        if(entry && (entry->tone > NUM_FIXED_TONES))
+            user_tone = TRUE;
+    }
+
+    /* have the user tones resident before they are first needed */
+    if(user_tone)
+        (void)configCacheGet(config_cache_user_tones);
+}
+
+/****************************************************************************
+NAME 
+    TonesCacheNoteLatency
+*/
+void TonesCacheNoteLatency ( uint16 latency )
+{
+    gToneCache.stats.latency_last = latency;
+    if(latency > gToneCache.stats.latency_max)
+        gToneCache.stats.latency_max = latency;
+}
+
+/****************************************************************************
+NAME 
+    TonesCacheGetStats
+*/
+void TonesCacheGetStats ( tone_cache_stats * stats )
+{
+    *stats = gToneCache.stats;
+}
+
 /****************************************************************************
 NAME 
  TonesPlayEvent
@@ -1502,9 +1712,44 @@ RETURNS
 void TonesPlayEvent ( sinkEvents_t pEvent )
 {    
     uint16 lEvent = pEvent - EVENTS_MESSAGE_BASE ;
+    tone_cache_entry * entry = toneCacheFind(lEvent);
 	int i = 0 ;
-	
-    /* If tts is disabled go straight to tones. Otherwise if tts is assigned to this event tone playback would be skipped.*/
+
+    if(entry)
+    {
+        gToneCache.stats.hits++;
+    }
+    else
+    {
+        gToneCache.stats.misses++;
+        entry = toneCacheAdd(lEvent);
+    }
+
+    if(entry)
+    {
+        toneCacheUse(entry);
+
+        /* If tts is disabled go straight to tones. Otherwise if tts is assigned to this event tone playback would be skipped.*/
+        if(theSink.tts_enabled)
+        {
+            /* only search the phrases for events that have one */
+            if(!entry->tts_checked)
+            {
+                entry->tts = TTSEventHasPhrase(pEvent);
+                entry->tts_checked = TRUE;
+            }
+
+            /* If there's a valid TTS event to play don't play any tones */
+            if(entry->tts && TTSPlayEvent(pEvent))
+                return;
+        }
+
+        if(entry->tone != TONE_NOT_DEFINED)
+            tonesPlayEventTone(pEvent, entry->tone);
+        return;
+    }
+
+    /* event has more than one tone, play them all */
     if(theSink.tts_enabled)
     { 
         /* If there's a valid TTS event to play don't play any tones */
@@ -1517,32 +1762,7 @@ void TonesPlayEvent ( sinkEvents_t pEvent )
 	{
         /* if an event matche is found then play tone */
 		if (theSink.conf2->gEventTones [i].event == lEvent )
-		{
-            /* turn on audio amp */
-            PioSetPio ( theSink.conf1->PIOIO.pio_outputs.DeviceAudioActivePIO , pio_drive, TRUE) ;
-            /* start check to turn amp off again if required */ 
-            MessageSendLater(&theSink.task , EventCheckAudioAmpDrive, 0, 1000);    
-
-			/* check event as tone queueing not allowed on mute and ring tones */					   
-			switch(pEvent)
-            {
-                case EventMuteReminder:
-                case TONE_TYPE_RING_1:
-                case TONE_TYPE_RING_2:
-                
-     				/* check whether to play mute reminder tone at default volume level, never queue mute reminders to 
-		         	   protect against the case that the tone is longer than the mute reminder timer */
-       	            TonesPlayTone (theSink.conf2->gEventTones [ i ].tone ,FALSE, (theSink.features.MuteToneFixedVolume)) ;			
-                    break;
-                   
-                /* for all other events use the QueueEventTones feature bit setting */
-                default:
-                    
-    				/* play tone */
-            	    TonesPlayTone (theSink.conf2->gEventTones [ i ].tone ,theSink.features.QueueEventTones, FALSE ) ;			
-                    break;    
-            }
-        }
+            tonesPlayEventTone(pEvent, theSink.conf2->gEventTones [ i ].tone);
 		i++ ;
 	}
 } 
@@ -1622,19 +1842,22 @@ void TonesPlayTone ( uint16 pTone , bool pCanQueue , bool PlayToneAtDefaultLevel
        fixed tones list */
     else
     {
+        /* user tones are loaded on demand, the cache keeps them resident whilst audio is busy */
+        const ringtone_note * variable_tones = configCacheGet(config_cache_user_tones);
+
         TONE_DEBUG(("TONE Play sinth which is larger than 5e is [%x] - [%d]\n", pTone, pTone-1-NUM_FIXED_TONES));
             
          /* check to see if there are any configured user defined tones and then check to see
             if there is a tone available at the index (0 to 7) requested */
-        if(&theSink.conf1->gConfigTones.gVariableTones[0] && 
-           theSink.conf1->gConfigTones.gVariableTones[pTone-1-NUM_FIXED_TONES])
+        if(variable_tones && 
+           variable_tones[pTone-1-NUM_FIXED_TONES])
         {
 
             /* audio tone is located at 'start of data + an offset' into the array of data,
-               the first 8 words of data in gVariableTones are offsets into the data array
+               the first 8 words of data in the user tones are offsets into the data array
                for user tones 0 to 7 */
-            AudioPlayTone ( (const ringtone_note *)(&theSink.conf1->gConfigTones.gVariableTones[0] + 
-                                                 (uint16)theSink.conf1->gConfigTones.gVariableTones[pTone-1-NUM_FIXED_TONES]),
+            AudioPlayTone ( (const ringtone_note *)(variable_tones + 
+                                                 (uint16)variable_tones[pTone-1-NUM_FIXED_TONES]),
                             pCanQueue,
                             theSink.codec_task,
                             lToneVolume,
@@ -1656,6 +1879,7 @@ RETURNS
 */
 void ToneTerminate ( void )
 {
+    promptSchedulerFlush();
     AudioStopTone();
     TTSTerminate();
 }  
@@ -18,6 +18,56 @@ DESCRIPTION
 #define TONE_TYPE_RING_1 (0x60FF)
 #define TONE_TYPE_RING_2 (0x60FE)
 
+/* number of events whose tone and prompt lookups are kept */
+#define TONE_CACHE_SIZE  (8)
+
+/* Event tone cache counters */
+typedef struct
+{
+    uint16  hits;               /* events found in the cache */
+    uint16  misses;             /* events that needed the tone and prompt tables searched */
+    uint16  latency_last;       /* ms from a tone or prompt being scheduled to reaching the audio plugin */
+    uint16  latency_max;
+} tone_cache_stats;
+
+/****************************************************************************
+NAME 
+    TonesCacheInit
+
+DESCRIPTION
+    Empty the event tone cache and preload it with the tones of the events
+    indicated most often, called once the event tones have been read
+
+RETURNS
+    void
+*/
+void TonesCacheInit ( void ) ;
+
+/****************************************************************************
+NAME 
+    TonesCacheNoteLatency
+
+DESCRIPTION
+    Record the time a tone or prompt waited between being scheduled for an
+    event and being handed to the audio plugin
+
+RETURNS
+    void
+*/
+void TonesCacheNoteLatency ( uint16 latency ) ;
+
+/****************************************************************************
+NAME 
+    TonesCacheGetStats
+
+DESCRIPTION
+    Copy the event tone cache counters
+
+RETURNS
+    void
+*/
+void TonesCacheGetStats ( tone_cache_stats * stats ) ;
+
 /****************************************************************************
 NAME 
  TonesPlayEvent
@@ -16,6 +16,8 @@ DESCRIPTION
 #include "sink_tones.h"
 #include "sink_statemanager.h"
 #include "sink_pio.h"
+#include "sink_config_cache.h"
+#include "sink_prompt_scheduler.h"
 #include "vm.h"
 
 
@@ -118,15 +120,12 @@ bool TTSPlayEvent ( sinkEvents_t pEvent )
 #ifdef TEXT_TO_SPEECH_PHRASES
     uint16 lEventIndex = pEvent - EVENTS_MESSAGE_BASE ;
 	uint16 state_mask  = 1 << stateManagerGetState();
-    tts_config_type* ptr  = NULL;
+    const tts_config_type* ptr  = NULL;
 	TaskData * task    = NULL;
     bool event_match   = FALSE;
     
-    if(theSink.conf4)
-    {
-        ptr = theSink.conf4->gEventTTSPhrases;
-    }
-    else
+    ptr = configCacheGet(config_cache_tts_phrases);
+    if(!ptr)
     {
         /* no config */
         return FALSE;
@@ -157,10 +156,10 @@ bool TTSPlayEvent ( sinkEvents_t pEvent )
                 
                     /* never queue mute reminders to protect against the case that the prompt is longer 
                     than the mute reminder timer */
-       	            TTSPlay(task, (uint16) ptr->tts_id, NULL, 0, FALSE, ptr->cancel_queue_play_immediate);
+       	            promptSchedulePhrase(promptClassFromEvent(pEvent), pEvent, task, (uint16) ptr->tts_id, FALSE, ptr->cancel_queue_play_immediate);
                 break;
                 default:
-                   TTSPlay(task, (uint16) ptr->tts_id,  NULL, 0, TRUE, ptr->cancel_queue_play_immediate);
+                   promptSchedulePhrase(promptClassFromEvent(pEvent), pEvent, task, (uint16) ptr->tts_id, TRUE, ptr->cancel_queue_play_immediate);
                  break;
             }   
         }
@@ -172,6 +171,28 @@ bool TTSPlayEvent ( sinkEvents_t pEvent )
 #endif /* TEXT_TO_SPEECH_PHRASES */
 } 
 
+/****************************************************************************
+NAME 
+    TTSEventHasPhrase
+*/
+bool TTSEventHasPhrase( sinkEvents_t pEvent )
+{
+#ifdef TEXT_TO_SPEECH_PHRASES
+    uint16 lEventIndex = pEvent - EVENTS_MESSAGE_BASE ;
+    const tts_config_type* ptr = configCacheGet(config_cache_tts_phrases);
+
+    if(ptr)
+    {
+        for(; ptr->tts_id != TTS_NOT_DEFINED; ptr++)
+        {
+            if(ptr->event == lEventIndex)
+                return TRUE;
+        }
+    }
+#endif /* TEXT_TO_SPEECH_PHRASES */
+    return FALSE;
+}
+
 /****************************************************************************
 NAME 
     TTSPlayNumString
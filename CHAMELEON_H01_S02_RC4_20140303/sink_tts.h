@@ -40,6 +40,16 @@ void TTSPlay(Task plugin, uint16 id, uint8 *data, uint16 size_data, bool can_que
 */
 bool TTSPlayEvent( sinkEvents_t pEvent );
 
+/****************************************************************************
+NAME 
+    TTSEventHasPhrase
+DESCRIPTION
+    Check whether a phrase is configured for an event, whatever the state
+RETURNS    
+    TRUE if TTSPlayEvent could play a phrase for the event
+*/
+bool TTSEventHasPhrase( sinkEvents_t pEvent );
+
 /****************************************************************************
 NAME 
     TTSPlayNumString
@@ -0,0 +1,329 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_vcard.c
+
+DESCRIPTION
+    Streaming vCard 2.1 parser. Each byte is looked at once: the property
+    name of a line is collected up to the first ';' or ':', parameters are
+    skipped and the value is copied straight into the entry arena if the
+    property is one of the fields kept, otherwise it is skipped to the end
+    of the line. A line is only finished once the first character of the
+    next is seen, as white space there folds the next line onto it.
+
+*/
+
+#include "sink_vcard.h"
+#include "sink_debug.h"
+
+#include <string.h>
+
+
+#ifdef DEBUG_PBAP
+#define VCARD_DEBUG(x) DEBUG(x)
+#else
+#define VCARD_DEBUG(x)
+#endif
+
+/* where in a line the parser is */
+typedef enum
+{
+    vcard_state_key,                /* collecting the property name */
+    vcard_state_params,             /* skipping parameters up to the ':' */
+    vcard_state_value,              /* copying or skipping the value */
+    vcard_state_skip                /* ignoring the rest of the line */
+} vcard_state;
+
+/* fields the value of a line may be copied to */
+typedef enum
+{
+    vcard_field_none,
+    vcard_field_tel,
+    vcard_field_n,
+    vcard_field_fn,
+    vcard_field_datetime,
+    vcard_field_begin,
+    vcard_field_end
+} vcard_field;
+
+typedef struct
+{
+    const char *    key;
+    vcard_field     field;
+} vcard_key_map;
+
+static const vcard_key_map gVcardKeys[] =
+{
+    {"TEL",                     vcard_field_tel},
+    {"N",                       vcard_field_n},
+    {"FN",                      vcard_field_fn},
+    {"X-IRMC-CALL-DATETIME",    vcard_field_datetime},
+    {"BEGIN",                   vcard_field_begin},
+    {"END",                     vcard_field_end}
+};
+
+
+/****************************************************************************
+NAME
+  	vcardLookupKey
+
+DESCRIPTION
+  	Find the field for the property name just collected
+
+RETURNS
+  	the field, vcard_field_none if the property is not of interest
+*/
+static vcard_field vcardLookupKey( const vcard_parser * parser )
+{
+    uint16 i;
+
+    for(i = 0; i < sizeof(gVcardKeys) / sizeof(gVcardKeys[0]); i++)
+    {
+        if((strlen(gVcardKeys[i].key) == parser->key_len) &&
+           (memcmp(gVcardKeys[i].key, parser->key, parser->key_len) == 0))
+        {
+            return gVcardKeys[i].field;
+        }
+    }
+    return vcard_field_none;
+}
+
+/****************************************************************************
+NAME
+  	vcardStartValue
+
+DESCRIPTION
+  	Work out where the value of the current line is to go
+
+RETURNS
+  	void
+*/
+static void vcardStartValue( vcard_parser * parser )
+{
+    vcard_entry * entry = &parser->entry;
+    vcard_field field = vcardLookupKey(parser);
+
+    parser->state = vcard_state_value;
+
+    switch(field)
+    {
+        case vcard_field_begin:
+            /* new entry, forget the previous one */
+            memset(entry, 0, sizeof(vcard_entry));
+            parser->in_card  = TRUE;
+            parser->have_n   = FALSE;
+            parser->complete = FALSE;
+        break;
+
+        case vcard_field_tel:
+            /* only the first number of an entry is kept */
+            if(!parser->in_card || entry->tel_len)
+                field = vcard_field_none;
+        break;
+
+        case vcard_field_n:
+            if(parser->in_card)
+            {
+                entry->name_len = 0;
+                parser->have_n  = TRUE;
+            }
+            else
+                field = vcard_field_none;
+        break;
+
+        case vcard_field_fn:
+            /* formatted name is only used if there is no structured name */
+            if(!parser->in_card || parser->have_n)
+                field = vcard_field_none;
+            else
+                entry->name_len = 0;
+        break;
+
+        case vcard_field_datetime:
+            if(!parser->in_card)
+                field = vcard_field_none;
+            else
+                entry->datetime_len = 0;
+        break;
+
+        default:
+        break;
+    }
+
+    parser->field = field;
+}
+
+/****************************************************************************
+NAME
+  	vcardStoreValue
+
+DESCRIPTION
+  	Copy a character of a value into the entry arena
+
+RETURNS
+  	void
+*/
+static void vcardStoreValue( vcard_parser * parser, uint8 c )
+{
+    vcard_entry * entry = &parser->entry;
+
+    switch(parser->field)
+    {
+        case vcard_field_tel:
+            if(entry->tel_len < VCARD_MAX_TEL)
+                entry->tel[entry->tel_len++] = c;
+        break;
+
+        case vcard_field_n:
+            /* Based on PBAP spec., the name format is:
+               LastName;FirstName;MiddleName;Prefix;Suffix */
+            if(c == ';')
+                c = ' ';
+            /* fall through */
+        case vcard_field_fn:
+            if(entry->name_len < VCARD_MAX_NAME)
+                entry->name[entry->name_len++] = c;
+        break;
+
+        case vcard_field_datetime:
+            if(entry->datetime_len < VCARD_MAX_DATETIME)
+                entry->datetime[entry->datetime_len++] = c;
+        break;
+
+        default:
+        break;
+    }
+}
+
+/****************************************************************************
+NAME
+  	vcardEndLine
+
+DESCRIPTION
+  	Finish the current line
+
+RETURNS
+  	TRUE if the line ended a vCard
+*/
+static bool vcardEndLine( vcard_parser * parser )
+{
+    bool end_of_card = ((parser->state == vcard_state_value) &&
+                        (parser->field == vcard_field_end) && parser->in_card);
+
+    parser->state   = vcard_state_key;
+    parser->field   = vcard_field_none;
+    parser->key_len = 0;
+
+    if(end_of_card)
+    {
+        parser->in_card  = FALSE;
+        parser->complete = TRUE;
+        parser->entries++;
+
+        VCARD_DEBUG(("VCARD: entry %d tel %d name %d\n", parser->entries, parser->entry.tel_len, parser->entry.name_len));
+    }
+
+    return end_of_card;
+}
+
+
+/****************************************************************************
+NAME
+  	vcardParserInit
+*/
+void vcardParserInit( vcard_parser * parser )
+{
+    memset(parser, 0, sizeof(vcard_parser));
+    parser->state = vcard_state_key;
+}
+
+/****************************************************************************
+NAME
+  	vcardParse
+*/
+uint16 vcardParse( vcard_parser * parser, const uint8 * data, uint16 len )
+{
+    uint16 used = 0;
+
+    /* the previous entry has been dealt with by now */
+    parser->complete = FALSE;
+
+    while(used < len)
+    {
+        uint8 c = data[used++];
+
+        /* lines end in CRLF, the CR carries no information */
+        if(c == '\r')
+            continue;
+
+        if(parser->line_break)
+        {
+            parser->line_break = FALSE;
+            
+            /* white space carries the line on as in vCard 2.1, where it
+               is kept in the value, anything else starts a new line */
+            if((c != ' ') && (c != '\t'))
+                vcardEndLine(parser);
+        }
+
+        if(c == '\n')
+        {
+            /* END:VCARD is never folded, so the entry is complete without
+               waiting for the next line which may be in the next packet */
+            if((parser->state == vcard_state_value) && (parser->field == vcard_field_end))
+            {
+                if(vcardEndLine(parser))
+                    break;
+            }
+            else
+                parser->line_break = TRUE;
+            continue;
+        }
+
+        switch(parser->state)
+        {
+            case vcard_state_key:
+                if(c == ':')
+                    vcardStartValue(parser);
+                else if(c == ';')
+                    parser->state = vcard_state_params;
+                else if(parser->key_len < VCARD_MAX_KEY)
+                {
+                    /* property names are case insensitive */
+                    if((c >= 'a') && (c <= 'z'))
+                        c -= 'a' - 'A';
+                    parser->key[parser->key_len++] = c;
+                }
+                else
+                {
+                    /* not a name we could match, ignore the line */
+                    parser->state = vcard_state_skip;
+                }
+            break;
+
+            case vcard_state_params:
+                if(c == ':')
+                    vcardStartValue(parser);
+            break;
+
+            case vcard_state_value:
+                vcardStoreValue(parser, c);
+            break;
+
+            default:
+            break;
+        }
+    }
+
+    return used;
+}
+
+/****************************************************************************
+NAME
+  	vcardEntryComplete
+*/
+const vcard_entry * vcardEntryComplete( const vcard_parser * parser )
+{
+    return parser->complete ? &parser->entry : NULL;
+}
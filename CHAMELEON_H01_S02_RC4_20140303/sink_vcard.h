@@ -0,0 +1,97 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    sink_vcard.h
+
+DESCRIPTION
+    Streaming vCard 2.1 parser for phonebook objects pulled over PBAP. Data is
+    consumed in a single pass as it arrives from the PBAP client, the parser
+    carries its state across packet boundaries and holds the fields of the
+    current entry in a fixed size arena so no allocation is needed per entry.
+    A long line folded onto following lines that start with white space is
+    read as the one line.
+
+*/
+#ifndef SINK_VCARD_H
+#define SINK_VCARD_H
+
+#include <csrtypes.h>
+
+
+/* maximum lengths of the fields kept for an entry, longer values are truncated */
+#define VCARD_MAX_TEL           (24)
+#define VCARD_MAX_NAME          (32)
+#define VCARD_MAX_DATETIME      (16)
+
+/* longest property name recognised, X-IRMC-CALL-DATETIME */
+#define VCARD_MAX_KEY           (20)
+
+/* Fields of the entry most recently parsed */
+typedef struct
+{
+    uint8   tel_len;                        /* first TEL of the entry */
+    uint8   name_len;                       /* N with the ';' separators replaced by spaces, else FN */
+    uint8   datetime_len;                   /* X-IRMC-CALL-DATETIME of call history entries */
+    uint8   tel[VCARD_MAX_TEL];
+    uint8   name[VCARD_MAX_NAME];
+    uint8   datetime[VCARD_MAX_DATETIME];
+} vcard_entry;
+
+/* Parser state, carried from one packet to the next */
+typedef struct
+{
+    vcard_entry entry;                      /* arena for the entry being parsed */
+    uint8       key[VCARD_MAX_KEY];         /* property name of the current line */
+    uint16      entries;                    /* entries completed since vcardParserInit */
+    unsigned    key_len:5;
+    unsigned    state:2;                    /* vcard_state */
+    unsigned    field:3;                    /* vcard_field the value is copied into */
+    unsigned    in_card:1;                  /* between BEGIN:VCARD and END:VCARD */
+    unsigned    have_n:1;                   /* name came from N so FN is ignored */
+    unsigned    complete:1;                 /* entry holds a complete vCard */
+    unsigned    line_break:1;               /* line ended, unless the next one is folded onto it */
+    unsigned    unused:2;
+} vcard_parser;
+
+
+/****************************************************************************
+NAME
+  	vcardParserInit
+
+DESCRIPTION
+  	Reset the parser ready for a new phonebook object
+
+RETURNS
+  	void
+*/
+void vcardParserInit( vcard_parser * parser );
+
+/****************************************************************************
+NAME
+  	vcardParse
+
+DESCRIPTION
+  	Consume phonebook data. Parsing stops straight after the end of each
+    vCard so the caller can use the entry, vcardEntryComplete indicates
+    this has happened. Data not consumed must be passed in again, a partial
+    line at the end of a packet is continued by the next packet.
+
+RETURNS
+  	the number of bytes consumed
+*/
+uint16 vcardParse( vcard_parser * parser, const uint8 * data, uint16 len );
+
+/****************************************************************************
+NAME
+  	vcardEntryComplete
+
+DESCRIPTION
+  	Check whether the last call to vcardParse finished a vCard
+
+RETURNS
+  	pointer to the completed entry, NULL if the entry is still in progress
+*/
+const vcard_entry * vcardEntryComplete( const vcard_parser * parser );
+
+#endif /* SINK_VCARD_H */
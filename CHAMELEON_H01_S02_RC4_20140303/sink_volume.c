@@ -11,11 +11,13 @@ DESCRIPTION
 #include "sink_statemanager.h"
 #include "sink_volume.h"
 #include "sink_tones.h"
+#include "sink_prompt_scheduler.h"
 #include "sink_pio.h"
 #include "sink_slc.h"
 #include "sink_audio.h"
 #include "sink_wired.h"
 #include "sink_display.h"
+#include "sink_devicemanager.h"
 
 #ifdef ENABLE_AVRCP
 #include "sink_avrcp.h"    
@@ -39,6 +41,36 @@ DESCRIPTION
 #define VOL_DEBUG(x) 
 #endif
 
+#define VOLUME_ENGINE_FRAME     (0)
+
+/* gain passed for a level that does not change the plugin gain */
+#define VOLUME_ENGINE_NO_GAIN   (-1)
+
+/* Volume engine, the level waiting to settle and the gain ramp */
+typedef struct
+{
+    Sink        sink;           /* audio the gain was last set for */
+    int16       gain;           /* gain last sent to the plugin */
+    int16       target;         /* gain being ramped to */
+    uint16      level;          /* latest level, applied once settled */
+    unsigned    index:2;        /* a2dp index or hfp priority of the level */
+    unsigned    a2dp:1;
+    unsigned    settle:1;       /* level not yet settled */
+    unsigned    tone:1;         /* a tone is wanted once settled */
+    unsigned    changed:1;      /* level or gain changed this frame */
+    unsigned    running:1;      /* frame timer set */
+    unsigned    unused:9;
+} volume_engine_t;
+
+/* Gain step taken for each distance from the target */
+static const int16 gVolumeRampStep[] = { 0, 1, 1, 2, 2, 3, 3, 4 };
+
+static void volumeEngineHandler(Task task, MessageId id, Message message);
+
+static TaskData gVolumeEngineTask = { volumeEngineHandler };
+static volume_engine_t gVolumeEngine;
+
+
 /* Helper to decide if sync request from AG affects our gain settings */
 static bool volumeSyncAffectsGain(hfp_link_priority priority)
 {
@@ -52,6 +84,182 @@ static bool volumeSyncAffectsGain(hfp_link_priority priority)
 }
 
 
+/****************************************************************************
+NAME 
+    volumeEngineRampStep
+
+DESCRIPTION
+    Get the gain step to take towards a target the given distance away,
+    steps shrink as the target is neared so the ramp eases in
+    
+RETURNS
+    the step, never more than the distance
+*/
+static int16 volumeEngineRampStep(int16 distance)
+{
+    if(distance >= (int16)(sizeof(gVolumeRampStep) / sizeof(gVolumeRampStep[0])))
+        return gVolumeRampStep[(sizeof(gVolumeRampStep) / sizeof(gVolumeRampStep[0])) - 1];
+    
+    return gVolumeRampStep[distance];
+}
+
+
+/****************************************************************************
+NAME 
+    volumeEngineSettle
+
+DESCRIPTION
+    Make the updates held back until the volume stopped changing, the
+    display, subwoofer, volume tone and stored attributes
+    
+RETURNS
+    void
+*/
+static void volumeEngineSettle(void)
+{
+    uint16 level = gVolumeEngine.level;
+    bdaddr addr;
+    
+    VOL_DEBUG(("VOL: settled [%d] tone [%d]\n", level, gVolumeEngine.tone));
+    
+    gVolumeEngine.settle = FALSE;
+    
+    displayUpdateVolume(level);
+
+    if(gVolumeEngine.a2dp)
+    {
+#ifdef ENABLE_SUBWOOFER
+        updateSwatVolume(level);
+#endif
+        if(theSink.a2dp_link_data->connected[gVolumeEngine.index])
+            deviceManagerUpdateAttributes(&theSink.a2dp_link_data->bd_addr[gVolumeEngine.index], sink_a2dp, 0, gVolumeEngine.index);
+    }
+    else if(HfpLinkGetBdaddr(gVolumeEngine.index, &addr))
+    {
+        deviceManagerUpdateAttributes(&addr, sink_hfp, gVolumeEngine.index, 0);
+    }
+    
+    /* play tone if applicable */
+    if(gVolumeEngine.tone && theSink.conf1->gVolMaps[level].Tone)
+        promptScheduleTone(prompt_class_volume, EventInvalid, theSink.conf1->gVolMaps[level].Tone, theSink.features.QueueVolumeTones, FALSE);
+    
+    gVolumeEngine.tone = FALSE;
+}
+
+
+/****************************************************************************
+NAME 
+    volumeEngineFrame
+
+DESCRIPTION
+    Take one step of the gain ramp, or settle once a whole frame has passed
+    with the ramp complete and no new volume
+    
+RETURNS
+    void
+*/
+static void volumeEngineFrame(void)
+{
+    int16 distance = gVolumeEngine.target - gVolumeEngine.gain;
+    
+    /* the gain belongs to the audio it was set for, once that is no longer 
+       routed the routing sets the gain itself */
+    if(gVolumeEngine.sink != theSink.routed_audio)
+        gVolumeEngine.gain = gVolumeEngine.target;
+    
+    else if(distance > 0)
+        gVolumeEngine.gain += volumeEngineRampStep(distance);
+    
+    else if(distance < 0)
+        gVolumeEngine.gain -= volumeEngineRampStep(-distance);
+    
+    if(distance && (gVolumeEngine.sink == theSink.routed_audio))
+    {
+        VOL_DEBUG(("VOL: ramp [%d] to [%d]\n", gVolumeEngine.gain, gVolumeEngine.target));
+        AudioSetVolume(gVolumeEngine.gain, TonesGetToneVolume(FALSE), theSink.codec_task);
+        gVolumeEngine.changed = TRUE;
+    }
+    
+    if(gVolumeEngine.changed)
+    {
+        /* wait a frame for the next step or further changes */
+        gVolumeEngine.changed = FALSE;
+        MessageSendLater(&gVolumeEngineTask, VOLUME_ENGINE_FRAME, 0, VOLUME_ENGINE_FRAME_MS);
+    }
+    else
+    {
+        gVolumeEngine.running = FALSE;
+        if(gVolumeEngine.settle)
+            volumeEngineSettle();
+    }
+}
+
+
+/****************************************************************************
+NAME 
+    volumeEngineHandler
+
+DESCRIPTION
+    Handle the volume engine frame timer
+    
+RETURNS
+    void
+*/
+static void volumeEngineHandler(Task task, MessageId id, Message message)
+{
+    if(id == VOLUME_ENGINE_FRAME)
+        volumeEngineFrame();
+}
+
+
+/****************************************************************************
+NAME 
+    volumeEngineUpdate
+
+DESCRIPTION
+    Take a new volume level for a link. Changes arriving within a frame of 
+    each other are coalesced, the gain is ramped to the latest one at most
+    one plugin call per frame and the display, subwoofer, tone and stored
+    attributes follow once the level has settled. gain is the plugin gain
+    for the level, or VOLUME_ENGINE_NO_GAIN if the link is not routed.
+    
+RETURNS
+    void
+*/
+static void volumeEngineUpdate(bool a2dp, uint16 index, uint16 level, int16 gain, bool tone)
+{
+    /* a level for another link replaces one waiting to settle */
+    if(gVolumeEngine.settle && ((gVolumeEngine.a2dp != a2dp) || (gVolumeEngine.index != index)))
+        volumeEngineSettle();
+    
+    gVolumeEngine.a2dp   = a2dp;
+    gVolumeEngine.index  = index;
+    gVolumeEngine.level  = level;
+    gVolumeEngine.settle = TRUE;
+    gVolumeEngine.tone  |= tone;
+    
+    if(gain != VOLUME_ENGINE_NO_GAIN)
+    {
+        /* start from the gain last set unless it was for other audio */
+        if(gVolumeEngine.sink != theSink.routed_audio)
+        {
+            gVolumeEngine.sink = theSink.routed_audio;
+            gVolumeEngine.gain = gain;
+            AudioSetVolume(gain, TonesGetToneVolume(FALSE), theSink.codec_task);
+        }
+        gVolumeEngine.target = gain;
+    }
+    gVolumeEngine.changed = TRUE;
+    
+    /* a change with the engine idle takes effect straight away */
+    if(!gVolumeEngine.running)
+    {
+        gVolumeEngine.running = TRUE;
+        volumeEngineFrame();
+    }
+}
+
+
 /****************************************************************************
 DESCRIPTION
     sets the current A2dp volume
@@ -59,7 +267,9 @@ DESCRIPTION
 */
 void VolumeSetA2dp(uint16 index, uint16 oldVolume, bool pPlayTone)
 {               
-    if(theSink.conf1->gVolMaps[ theSink.a2dp_link_data->gAvVolumeLevel[index] ].A2dpGain == VOLUME_A2DP_MUTE_GAIN)
+    uint16 level = theSink.a2dp_link_data->gAvVolumeLevel[index];
+    
+    if(theSink.conf1->gVolMaps[ level ].A2dpGain == VOLUME_A2DP_MUTE_GAIN)
     {                   
         /* if actual mute enabled, activate it now */
         if(theSink.conf1->gVolMaps[ oldVolume ].A2dpGain != VOLUME_A2DP_MUTE_GAIN)
@@ -67,30 +277,27 @@ void VolumeSetA2dp(uint16 index, uint16 oldVolume, bool pPlayTone)
             VOL_DEBUG(("VOL: A2dp mute\n"));
             AudioSetMode(AUDIO_MODE_MUTE_SPEAKER, &theSink.a2dp_link_data->a2dp_audio_mode_params);
         }
+        /* nothing to ramp while muted */
+        gVolumeEngine.target = gVolumeEngine.gain;
+        volumeEngineUpdate(TRUE, index, level, VOLUME_ENGINE_NO_GAIN, pPlayTone);
     }                
     else
     {
-        VOL_DEBUG(("VOL: A2dp set vol [%d][%d]\n", theSink.a2dp_link_data->gAvVolumeLevel[index], theSink.conf1->gVolMaps[ theSink.a2dp_link_data->gAvVolumeLevel[index] ].A2dpGain - 1));
-        AudioSetVolume ( theSink.conf1->gVolMaps[ theSink.a2dp_link_data->gAvVolumeLevel[index] ].A2dpGain - 1 , TonesGetToneVolume(FALSE), theSink.codec_task ) ;
-    }
-    /* set volume level in audio plugin */
-    if ((theSink.conf1->gVolMaps[ theSink.a2dp_link_data->gAvVolumeLevel[index] ].A2dpGain != VOLUME_A2DP_MUTE_GAIN) && (theSink.conf1->gVolMaps[ oldVolume ].A2dpGain == VOLUME_A2DP_MUTE_GAIN))
-    {
-        /* the audio was muted but now should be un-muted as above minimum volume */   
-        VOL_DEBUG(("VOL: A2dp unmute\n"));
-        AudioSetMode(AUDIO_MODE_CONNECTED, &theSink.a2dp_link_data->a2dp_audio_mode_params);
+        VOL_DEBUG(("VOL: A2dp set vol [%d][%d]\n", level, theSink.conf1->gVolMaps[ level ].A2dpGain - 1));
+        
+        if(theSink.conf1->gVolMaps[ oldVolume ].A2dpGain == VOLUME_A2DP_MUTE_GAIN)
+        {
+            /* the audio was muted but now should be un-muted as above minimum volume,
+               bring it back at the lowest gain and ramp up from there */   
+            VOL_DEBUG(("VOL: A2dp unmute\n"));
+            gVolumeEngine.sink = theSink.routed_audio;
+            gVolumeEngine.gain = 0;
+            gVolumeEngine.target = 0;
+            AudioSetVolume(0, TonesGetToneVolume(FALSE), theSink.codec_task);
+            AudioSetMode(AUDIO_MODE_CONNECTED, &theSink.a2dp_link_data->a2dp_audio_mode_params);
+        }
+        volumeEngineUpdate(TRUE, index, level, theSink.conf1->gVolMaps[ level ].A2dpGain - 1, pPlayTone);
     }
-    
-    /* update the display to show A2DP volume */
-    displayUpdateVolume(theSink.a2dp_link_data->gAvVolumeLevel[index]);
-
-#ifdef ENABLE_SUBWOOFER
-    updateSwatVolume(theSink.a2dp_link_data->gAvVolumeLevel[index]);
-#endif
-
-    /* play tone if applicable */
-    if((pPlayTone)&&(theSink.conf1->gVolMaps[theSink.a2dp_link_data->gAvVolumeLevel[index]].Tone))
-        TonesPlayTone(theSink.conf1->gVolMaps[theSink.a2dp_link_data->gAvVolumeLevel[index]].Tone ,theSink.features.QueueVolumeTones, FALSE);
 }
 
 
@@ -215,7 +422,6 @@ DESCRIPTION
 */
 void VolumeSetHeadsetVolume( uint16 pNewVolume , bool pPlayTone, hfp_link_priority priority) 
 {      
-    bool lPlayTone = FALSE ;
     bool lVolumeChangeCausesUnMute = theSink.features.VolumeChangeCausesUnMute ;
     bool lAdjustVolumeWhilstMuted = theSink.features.AdjustVolumeWhilstMuted ;
     bool set_gain = volumeSyncAffectsGain(priority);
@@ -233,27 +439,13 @@ void VolumeSetHeadsetVolume( uint16 pNewVolume , bool pPlayTone, hfp_link_priori
             VolumeSetMicrophoneGainCheckMute(priority, VOLUME_MUTE_OFF);
         }
         
-        /* the tone needs to be played so set flag */
-        lPlayTone = TRUE ;     
-        
         /* set new volume */
         theSink.profile_data[PROFILE_INDEX(priority)].audio.gSMVolumeLevel = pNewVolume ; 
         
-        /* update the display */
-        displayUpdateVolume(pNewVolume);     
-        
-        /* determine whether this volume change affects the audio currently being routed to the speaker #
-           and update volume level via audio plugin if this is the case */
-        if(set_gain)
-            AudioSetVolume ( theSink.conf1->gVolMaps[ pNewVolume ].VolGain , TonesGetToneVolume(FALSE), theSink.codec_task ) ;
+        /* determine whether this volume change affects the audio currently being routed to the speaker,
+           the engine ramps the gain there and updates the display and plays any tone once settled */
+        volumeEngineUpdate(FALSE, priority, pNewVolume, (set_gain ? theSink.conf1->gVolMaps[ pNewVolume ].VolGain : VOLUME_ENGINE_NO_GAIN), pPlayTone);
     }
-    
-    /* ensure there is a valid tone (non zero) to be played */
-    if( pPlayTone && lPlayTone && theSink.conf1->gVolMaps[pNewVolume].Tone )
-    {   /*only attempt to play the tone if it has not yet been played*/
-        VOL_DEBUG(("VOL: VolTone[%x]\n" , (int)theSink.conf1->gVolMaps[pNewVolume].Tone)) ;
-        TonesPlayTone(theSink.conf1->gVolMaps[pNewVolume].Tone ,theSink.features.QueueVolumeTones, FALSE);
-    }    
 }
 
 
@@ -41,6 +41,10 @@ typedef enum
 #define VOLUME_FM_MAX_LEVEL 15
 #define VOLUME_FM_MIN_LEVEL 0
 
+/* volume changes closer together than this are coalesced, and the gain is
+   ramped by at most one step of the ramp table per frame */
+#define VOLUME_ENGINE_FRAME_MS  (40)
+
 
 /****************************************************************************
 NAME 
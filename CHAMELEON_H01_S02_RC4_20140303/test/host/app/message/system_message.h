@@ -0,0 +1,5 @@
+/* Host stand-in for the firmware system_message.h */
+#ifndef SYSTEM_MESSAGE_H_
+#define SYSTEM_MESSAGE_H_
+
+#endif /* SYSTEM_MESSAGE_H_ */
@@ -0,0 +1,19 @@
+/* Host stand-in for the firmware audio.h, only the ringtone words used by
+   the tone codec. A note is a pitch and a length, a word with the control
+   bit set is a command. */
+#ifndef AUDIO_H_
+#define AUDIO_H_
+
+#include <csrtypes.h>
+
+typedef uint16 ringtone_note;
+
+#define RINGTONE_SEQ_CONTROL_MASK       (0x8000)
+#define RINGTONE_SEQ_NOTE_PITCH_MASK    (0x7E00)
+#define RINGTONE_SEQ_NOTE_PITCH_POS     (9)
+#define RINGTONE_SEQ_NOTE_LENGTH_MASK   (0x01FF)
+#define RINGTONE_SEQ_NOTE_LENGTH_POS    (0)
+
+#define RINGTONE_END                    (0x8000)
+
+#endif /* AUDIO_H_ */
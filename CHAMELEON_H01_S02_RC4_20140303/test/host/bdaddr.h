@@ -0,0 +1,9 @@
+/* Host stand-in for the firmware bdaddr.h */
+#ifndef BDADDR_H_
+#define BDADDR_H_
+
+#include <connection.h>
+
+bool BdaddrIsSame(const bdaddr *first, const bdaddr *second);
+
+#endif /* BDADDR_H_ */
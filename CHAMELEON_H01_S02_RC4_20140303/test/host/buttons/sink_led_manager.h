@@ -0,0 +1,7 @@
+/* Host stand-in for sink_led_manager.h */
+#ifndef SINK_LED_MANAGER_H
+#define SINK_LED_MANAGER_H
+
+void LEDManagerCheckTimeoutState( void ) ;
+
+#endif /* SINK_LED_MANAGER_H */
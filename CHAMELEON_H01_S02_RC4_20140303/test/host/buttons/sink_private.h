@@ -0,0 +1,39 @@
+/* Host stand-in for sink_private.h holding what the button manager uses.
+   Blocks are sized with sizeof, so malloc and memset count host bytes. */
+#ifndef _SINK_PRIVATE_H_
+#define _SINK_PRIVATE_H_
+
+#include <csrtypes.h>
+#include <message.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sink_buttonmanager.h"
+
+#define DEBUG(x)
+
+#define mallocPanic(x) malloc(x)
+#define freePanic(x) free(x)
+
+typedef struct
+{
+    unsigned    gLEDSStateTimeout:1;
+} LedTaskData;
+
+typedef struct
+{
+    unsigned    IgnoreButtonPressAfterLedEnable:1;
+} feature_config_type;
+
+typedef struct
+{
+    TaskData                task;
+    ButtonsTaskData         *theButtonsTask;
+    LedTaskData             *theLEDTask;
+    feature_config_type     features;
+    unsigned                buttons_locked:1;
+} hsTaskData;
+
+extern hsTaskData theSink;
+
+#endif /* _SINK_PRIVATE_H_ */
@@ -0,0 +1,5 @@
+/* Host stand-in for sink_scan.h, nothing is used */
+#ifndef _SINK_SCAN_H_
+#define _SINK_SCAN_H_
+
+#endif /* _SINK_SCAN_H_ */
@@ -0,0 +1,10 @@
+/* Host stand-in for sink_statemanager.h */
+#ifndef _SINK_STATE_MANAGER_H
+#define _SINK_STATE_MANAGER_H
+
+#include "sink_private.h"
+#include "sink_states.h"
+
+sinkState stateManagerGetState ( void ) ;
+
+#endif /* _SINK_STATE_MANAGER_H */
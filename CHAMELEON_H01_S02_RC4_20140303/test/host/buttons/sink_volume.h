@@ -0,0 +1,5 @@
+/* Host stand-in for sink_volume.h, nothing is used */
+#ifndef SINK_VOLUME_H
+#define SINK_VOLUME_H
+
+#endif /* SINK_VOLUME_H */
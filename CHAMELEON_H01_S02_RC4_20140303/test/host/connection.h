@@ -0,0 +1,72 @@
+/* Host stand-in for the firmware connection.h */
+#ifndef CONNECTION_H_
+#define CONNECTION_H_
+
+#include <csrtypes.h>
+#include <message.h>
+#include <sink.h>
+
+typedef struct
+{
+    uint32  lap;
+    uint8   uap;
+    uint16  nap;
+} bdaddr;
+
+typedef struct
+{
+    uint8   type;
+    bdaddr  addr;
+} typed_bdaddr;
+
+typedef enum
+{
+    sdp_response_success,
+    sdp_error_response_pdu,
+    sdp_no_response_data
+} sdp_search_status;
+
+typedef enum
+{
+    protocol_l2cap,
+    protocol_rfcomm
+} dm_protocol_id;
+
+typedef enum
+{
+    sec4_in_level_0,
+    sec4_in_level_1,
+    sec4_in_level_2,
+    sec4_in_level_3
+} dm_ssp_security_level_in;
+
+typedef enum
+{
+    sec4_out_level_0,
+    sec4_out_level_1,
+    sec4_out_level_2,
+    sec4_out_level_3
+} dm_ssp_security_level_out;
+
+typedef struct
+{
+    sdp_search_status   status;
+    uint16              error_code;
+    bdaddr              bd_addr;
+    bool                more_to_come;
+    uint16              size_attributes;
+    uint8               attributes[1];
+} CL_SDP_SERVICE_SEARCH_ATTRIBUTE_CFM_T;
+
+uint16 ConnectionTrustedDeviceListSize(void);
+void ConnectionSetPageTimeout(uint16 timeout);
+bool ConnectionSmGetAttributeNow(uint16 ps_base, const bdaddr *bd_addr, uint16 size_psdata, uint8 *psdata);
+bool ConnectionSmGetIndexedAttributeNowReq(uint16 ps_base, uint16 index, uint16 size_psdata, uint8 *psdata, typed_bdaddr *taddr);
+void ConnectionSmPutAttribute(uint16 ps_base, const bdaddr *bd_addr, uint16 size_psdata, const uint8 *psdata);
+
+void ConnectionSmSetSdpSecurityIn(bool enable);
+void ConnectionSmSetSdpSecurityOut(bool enable, const bdaddr *bd_addr);
+void ConnectionSmRegisterIncomingService(dm_protocol_id protocol_id, uint32 channel, dm_ssp_security_level_in security_level);
+void ConnectionSmRegisterOutgoingService(Task task, const bdaddr *bd_addr, dm_protocol_id protocol_id, uint32 channel, dm_ssp_security_level_out security_level);
+
+#endif /* CONNECTION_H_ */
@@ -0,0 +1,15 @@
+/* Host stand-in for the firmware csrtypes.h */
+#ifndef CSRTYPES_H__
+#define CSRTYPES_H__
+
+typedef unsigned char   uint8;
+typedef unsigned short  uint16;
+typedef unsigned long   uint32;
+typedef signed short    int16;
+typedef signed long     int32;
+typedef int             bool;
+
+#define TRUE    (1)
+#define FALSE   (0)
+
+#endif /* CSRTYPES_H__ */
@@ -0,0 +1,10 @@
+/* Host stand-in for sink_private.h holding what energy accounting uses */
+#ifndef _SINK_PRIVATE_H_
+#define _SINK_PRIVATE_H_
+
+#include <csrtypes.h>
+#include <message.h>
+
+#define DEBUG(x)
+
+#endif /* _SINK_PRIVATE_H_ */
@@ -0,0 +1,12 @@
+/* Host stand-in for the firmware hfp.h */
+#ifndef HFP_H_
+#define HFP_H_
+
+typedef enum
+{
+    hfp_invalid_link,
+    hfp_primary_link,
+    hfp_secondary_link
+} hfp_link_priority;
+
+#endif /* HFP_H_ */
@@ -0,0 +1,115 @@
+/* Host stand-in for the firmware MAP client library mapc.h, holding the
+   messages and calls the sink application uses */
+#ifndef MAPC_H_
+#define MAPC_H_
+
+#include <csrtypes.h>
+#include <message.h>
+#include <connection.h>
+#include <source.h>
+
+#define MAPC_MESSAGE_BASE   (0x6F00)
+
+typedef struct __Mas * Mas;
+typedef struct __Mns * Mns;
+
+typedef enum
+{
+    mapc_success,
+    mapc_failure,
+    mapc_pending
+} MapcResponse;
+
+typedef enum
+{
+    MAPC_MNS_START_CFM = MAPC_MESSAGE_BASE,
+    MAPC_MNS_SHUTDOWN_CFM,
+    MAPC_MNS_CONNECT_IND,
+    MAPC_MNS_CONNECT_CFM,
+    MAPC_MNS_DISCONNECT_IND,
+    MAPC_MNS_SEND_EVENT_IND,
+    MAPC_MAS_CONNECT_CFM,
+    MAPC_MAS_DISCONNECT_IND,
+    MAPC_MAS_SET_NOTIFICATION_CFM,
+    MAPC_MAS_SET_FOLDER_CFM,
+    MAPC_MAS_GET_FOLDER_LISTING_CFM,
+    MAPC_MAS_GET_MESSAGES_LISTING_CFM,
+    MAPC_MAS_GET_MESSAGE_CFM,
+    MAPC_MAS_PUT_MESSAGE_CFM,
+    MAPC_MAS_UPDATE_INBOX_CFM,
+    MAPC_MAS_SET_MESSAGE_STATUS_CFM,
+    MAPC_API_MESSAGE_END
+} MapcMessageId;
+
+typedef struct
+{
+    MapcResponse    status;
+    uint8           mnsChannel;
+    uint32          sdpHandle;
+} MAPC_MNS_START_CFM_T;
+
+typedef struct
+{
+    MapcResponse    status;
+} MAPC_MNS_SHUTDOWN_CFM_T;
+
+typedef struct
+{
+    bdaddr          addr;
+    uint8           mnsChannel;
+    uint16          connectID;
+} MAPC_MNS_CONNECT_IND_T;
+
+typedef struct
+{
+    MapcResponse    status;
+    Mns             mnsSession;
+    bdaddr          addr;
+    uint8           mnsChannel;
+} MAPC_MNS_CONNECT_CFM_T;
+
+typedef struct
+{
+    Mns             mnsSession;
+} MAPC_MNS_DISCONNECT_IND_T;
+
+typedef struct
+{
+    Mns             mnsSession;
+    uint8           masInstanceId;
+    bool            moreData;
+    uint16          sourceLen;
+    Source          eventReport;
+} MAPC_MNS_SEND_EVENT_IND_T;
+
+typedef struct
+{
+    MapcResponse    status;
+    Mas             masSession;
+    bdaddr          addr;
+    uint8           masChannel;
+} MAPC_MAS_CONNECT_CFM_T;
+
+typedef struct
+{
+    Mas             masSession;
+} MAPC_MAS_DISCONNECT_IND_T;
+
+typedef struct
+{
+    MapcResponse    status;
+    Mas             masSession;
+} MAPC_MAS_SET_NOTIFICATION_CFM_T;
+
+void MapcMnsStart(Task theAppTask, bool sdpRegister, uint8 mnsChannel);
+void MapcMnsShutdown(uint32 sdpHandle, uint8 mnsChannel);
+void MapcMnsConnectResponse(Task theAppTask, const bdaddr *addr, uint8 mnsChannel, bool accept, uint16 connectID);
+void MapcMnsDisconnectResponse(Mns mnsSession);
+void MapcMnsSendEventResponse(Mns mnsSession, MapcResponse response);
+void MapcMasSdpAttrSearchRequest(Task theAppTask, const bdaddr *addr);
+void MapcMasConnectRequest(Task theAppTask, const bdaddr *addr, uint8 masChannel);
+void MapcMasDisconnectRequest(Mas masSession);
+void MapcMasDisconnectResponse(Mas masSession);
+void MapcMasSetNotificationRequest(Mas masSession, bool regStatus);
+
+#endif /* MAPC_H_ */
@@ -0,0 +1,32 @@
+/* Host stand-in for sink_private.h holding what the MAP client uses.
+   Blocks are sized with sizeof, so malloc and memset count host bytes. */
+#ifndef _SINK_PRIVATE_H_
+#define _SINK_PRIVATE_H_
+
+#include <csrtypes.h>
+#include <message.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sink_events.h"
+#include "sink_mapc.h"
+
+#define DEBUG(x)
+
+#define mallocPanic(x) malloc(x)
+#define freePanic(x) free(x)
+
+typedef struct
+{
+    mapcData_t              mapc_data;
+} runtime_block1_t;
+
+typedef struct
+{
+    TaskData                task;
+    runtime_block1_t        *rundata;
+} hsTaskData;
+
+extern hsTaskData theSink;
+
+#endif /* _SINK_PRIVATE_H_ */
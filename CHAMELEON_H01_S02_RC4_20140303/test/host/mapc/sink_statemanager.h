@@ -0,0 +1,5 @@
+/* Host stand-in for sink_statemanager.h, nothing of it is used */
+#ifndef _SINK_STATE_MANAGER_H
+#define _SINK_STATE_MANAGER_H
+
+#endif /* _SINK_STATE_MANAGER_H */
@@ -0,0 +1,24 @@
+/* Host stand-in for the firmware message.h. Messages are not delivered,
+   each test provides the functions and records what it needs. */
+#ifndef MESSAGE_H_
+#define MESSAGE_H_
+
+#include <csrtypes.h>
+
+typedef uint16 MessageId;
+typedef const void * Message;
+
+typedef struct TaskData * Task;
+typedef void (*TaskHandler)(Task task, MessageId id, Message message);
+
+typedef struct TaskData
+{
+    TaskHandler handler;
+} TaskData;
+
+void MessageSend(Task task, MessageId id, void * message);
+void MessageSendLater(Task task, MessageId id, void * message, uint32 delay);
+uint16 MessageCancelAll(Task task, MessageId id);
+uint16 MessageCancelFirst(Task task, MessageId id);
+
+#endif /* MESSAGE_H_ */
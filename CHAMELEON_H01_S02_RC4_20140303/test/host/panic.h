@@ -0,0 +1,11 @@
+/* Host stand-in for the firmware panic.h */
+#ifndef PANIC_H_
+#define PANIC_H_
+
+#include <stdlib.h>
+
+#define Panic()             abort()
+#define PanicNull(x)        ((x) ? (x) : (abort(), (x)))
+#define PanicFalse(x)       ((x) ? (x) : (abort(), (x)))
+
+#endif /* PANIC_H_ */
@@ -0,0 +1,13 @@
+/* Host stand-in for the firmware power.h */
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <csrtypes.h>
+
+typedef struct
+{
+    uint16  voltage;    /* mV */
+    uint16  level;      /* battery region */
+} voltage_reading;
+
+#endif /* POWER_H_ */
@@ -0,0 +1,7 @@
+/* Host stand-in for the firmware print.h */
+#ifndef PRINT_H_
+#define PRINT_H_
+
+#include <stdio.h>
+
+#endif /* PRINT_H_ */
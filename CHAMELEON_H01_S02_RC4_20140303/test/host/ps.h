@@ -0,0 +1,11 @@
+/* Host stand-in for the firmware ps.h, sizes are in words on the target
+   and in host bytes here */
+#ifndef PS_H_
+#define PS_H_
+
+#include <csrtypes.h>
+
+uint16 PsRetrieve(uint16 key, void *buff, uint16 words);
+uint16 PsStore(uint16 key, const void *buff, uint16 words);
+
+#endif /* PS_H_ */
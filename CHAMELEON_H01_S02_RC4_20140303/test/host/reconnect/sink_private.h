@@ -0,0 +1,19 @@
+/* Host stand-in for sink_private.h holding what reconnection uses */
+#ifndef _SINK_PRIVATE_H_
+#define _SINK_PRIVATE_H_
+
+#include <csrtypes.h>
+#include <connection.h>
+#include <hfp.h>
+
+#define DEBUG(x)
+
+/* from sink_a2dp.h, for the prototypes of sink_devicemanager.h */
+typedef enum
+{
+    a2dp_primary,
+    a2dp_secondary,
+    a2dp_invalid
+} a2dp_link_priority;
+
+#endif /* _SINK_PRIVATE_H_ */
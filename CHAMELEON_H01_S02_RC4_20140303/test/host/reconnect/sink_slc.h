@@ -0,0 +1,9 @@
+/* Host stand-in for sink_slc.h holding what reconnection uses */
+#ifndef _SINK_SLC_H_
+#define _SINK_SLC_H_
+
+#include "sink_devicemanager.h"
+
+bool slcIsListIdAvailable(uint8 ListID);
+
+#endif /* _SINK_SLC_H_ */
@@ -0,0 +1,9 @@
+/* Host stand-in for the firmware sdp_parse.h */
+#ifndef SDP_PARSE_H_
+#define SDP_PARSE_H_
+
+#include <csrtypes.h>
+
+bool SdpParseGetMultipleRfcommServerChannels(uint8 size_attribute_list, uint8 *attribute_list, uint8 size_chans, uint8 **chans, uint8 *found);
+
+#endif /* SDP_PARSE_H_ */
@@ -0,0 +1,7 @@
+/* Host stand-in for the firmware sink.h */
+#ifndef SINK_H_
+#define SINK_H_
+
+typedef struct SinkData * Sink;
+
+#endif /* SINK_H_ */
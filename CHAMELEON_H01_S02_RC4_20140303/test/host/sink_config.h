@@ -0,0 +1,9 @@
+/* Host stand-in for sink_config.h */
+#ifndef _SINK_CONFIG_H_
+#define _SINK_CONFIG_H_
+
+#include <csrtypes.h>
+
+uint16 ConfigRetrieve(uint16 config_id, uint16 key, void* data, uint16 len);
+
+#endif /* _SINK_CONFIG_H_ */
@@ -0,0 +1,7 @@
+/* Host stand-in for sink_configmanager.h */
+#ifndef SINK_CONFIG_MANAGER_H
+#define SINK_CONFIG_MANAGER_H
+
+#define PSKEY_CONFIG_TONES      (19)
+
+#endif /* SINK_CONFIG_MANAGER_H */
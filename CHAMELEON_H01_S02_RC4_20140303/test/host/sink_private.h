@@ -0,0 +1,25 @@
+/* Host stand-in for sink_private.h. The firmware is word addressed, so
+   malloc, memmove and memset count 16 bit words, as they do here. */
+#ifndef _SINK_PRIVATE_H_
+#define _SINK_PRIVATE_H_
+
+#include <csrtypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define malloc(words)           malloc((words) * sizeof(uint16))
+#define memmove(d, s, words)    memmove((d), (s), (words) * sizeof(uint16))
+#define memset(d, c, words)     memset((d), (c), (words) * sizeof(uint16))
+
+#define DEBUG(x)
+
+#define MAX_NUM_VARIABLE_TONES  (8)
+
+typedef struct
+{
+    uint16  config_id;
+} hsTaskData;
+
+extern hsTaskData theSink;
+
+#endif /* _SINK_PRIVATE_H_ */
@@ -0,0 +1,12 @@
+/* Host stand-in for the firmware source.h. A source is the data a test
+   passes in, mapped as it is. */
+#ifndef SOURCE_H_
+#define SOURCE_H_
+
+#include <csrtypes.h>
+
+typedef const struct SourceData * Source;
+
+const uint8 *SourceMap(Source source);
+
+#endif /* SOURCE_H_ */
@@ -0,0 +1,8 @@
+/* Host stand-in for the firmware stream.h */
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <source.h>
+#include <sink.h>
+
+#endif /* STREAM_H_ */
@@ -0,0 +1,9 @@
+/* Host stand-in for the firmware vm.h, each test provides the clock */
+#ifndef VM_H_
+#define VM_H_
+
+#include <csrtypes.h>
+
+uint32 VmGetClock(void);
+
+#endif /* VM_H_ */
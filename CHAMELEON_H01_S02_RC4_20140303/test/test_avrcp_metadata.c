@@ -0,0 +1,269 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    test_avrcp_metadata.c
+
+DESCRIPTION
+    Host test of the Now Playing metadata cache. Get Element Attributes
+    responses are parsed whole and split into fragments at every point, so
+    headers and values are split across them, and every attribute must be
+    cached the same way. A title far longer than its part of the pool must
+    be truncated without losing the attributes after it.
+
+*/
+
+#include "sink_avrcp_metadata.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define TEST_RESPONSE_SIZE  (512)
+
+#define CHECK(x) \
+    do { if(!(x)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #x); failures++; } } while(0)
+
+static int failures;
+
+static uint8 response[TEST_RESPONSE_SIZE];
+static uint16 response_len;
+
+static char long_title[121];
+
+/* attributes of the response, by ID */
+static const char * values[AVRCP_METADATA_NUM_ATTRIBUTES + 1];
+
+static const uint8 value_max[AVRCP_METADATA_NUM_ATTRIBUTES + 1] =
+{
+    0,
+    AVRCP_METADATA_MAX_TITLE,
+    AVRCP_METADATA_MAX_ARTIST,
+    AVRCP_METADATA_MAX_ALBUM,
+    AVRCP_METADATA_MAX_NUMBER,
+    AVRCP_METADATA_MAX_TOTAL,
+    AVRCP_METADATA_MAX_GENRE,
+    AVRCP_METADATA_MAX_TIME
+};
+
+
+/****************************************************************************
+NAME
+    appendAttribute
+
+DESCRIPTION
+    Add an attribute ID, UTF-8 character set, length and value to the
+    response
+
+RETURNS
+    void
+*/
+static void appendAttribute( uint32 attribute_id, const char * value )
+{
+    uint16 len = strlen(value);
+    uint8 * p = &response[response_len];
+
+    p[0] = attribute_id >> 24;
+    p[1] = (attribute_id >> 16) & 0xFF;
+    p[2] = (attribute_id >> 8) & 0xFF;
+    p[3] = attribute_id & 0xFF;
+    p[4] = 0x00;
+    p[5] = 0x6A;
+    p[6] = len >> 8;
+    p[7] = len & 0xFF;
+    memcpy(&p[AVRCP_METADATA_HEADER_SIZE], value, len);
+
+    response_len += AVRCP_METADATA_HEADER_SIZE + len;
+}
+
+/****************************************************************************
+NAME
+    buildResponse
+
+DESCRIPTION
+    Build a response with every attribute cached, a long title first and an
+    attribute that is not cached in the middle
+
+RETURNS
+    void
+*/
+static void buildResponse( void )
+{
+    uint16 i;
+
+    for(i = 0; i < sizeof(long_title) - 1; i++)
+        long_title[i] = 'a' + (i % 26);
+
+    values[1] = long_title;
+    values[2] = "The Artist";
+    values[3] = "An Album Name That Is Long Enough";
+    values[4] = "7";
+    values[5] = "12";
+    values[6] = "Progressive Rock";
+    values[7] = "254000";
+
+    response_len = 0;
+    appendAttribute(1, values[1]);
+    appendAttribute(2, values[2]);
+    appendAttribute(0x100, "not cached");
+    for(i = 3; i <= AVRCP_METADATA_NUM_ATTRIBUTES; i++)
+        appendAttribute(i, values[i]);
+}
+
+/****************************************************************************
+NAME
+    expectedTruncated
+
+DESCRIPTION
+    Get the bytes of the response values too long for the cache
+
+RETURNS
+    the bytes
+*/
+static uint16 expectedTruncated( void )
+{
+    uint16 truncated = 0;
+    uint16 i;
+
+    for(i = 1; i <= AVRCP_METADATA_NUM_ATTRIBUTES; i++)
+    {
+        if(strlen(values[i]) > value_max[i])
+            truncated += strlen(values[i]) - value_max[i];
+    }
+    return truncated;
+}
+
+/****************************************************************************
+NAME
+    checkCache
+
+DESCRIPTION
+    Check every attribute holds its value, truncated to its maximum
+
+RETURNS
+    void
+*/
+static void checkCache( const sinkAvrcpMetadata * metadata )
+{
+    uint16 i;
+
+    for(i = 1; i <= AVRCP_METADATA_NUM_ATTRIBUTES; i++)
+    {
+        uint16 expected = strlen(values[i]);
+        const uint8 * value;
+        uint16 length = 0;
+
+        if(expected > value_max[i])
+            expected = value_max[i];
+
+        value = avrcpMetadataGetValue(metadata, i, &length);
+        CHECK(value != NULL);
+        CHECK(length == expected);
+        if(value && (length == expected))
+            CHECK(memcmp(value, values[i], length) == 0);
+    }
+
+    CHECK(metadata->truncated == expectedTruncated());
+    CHECK(avrcpMetadataGetValue(metadata, 0, NULL) == NULL);
+    CHECK(avrcpMetadataGetValue(metadata, AVRCP_METADATA_NUM_ATTRIBUTES + 1, NULL) == NULL);
+}
+
+
+static void testWhole( void )
+{
+    sinkAvrcpMetadata metadata;
+
+    memset(&metadata, 0, sizeof metadata);
+    avrcpMetadataReset(&metadata);
+    avrcpMetadataParse(&metadata, response, response_len);
+
+    checkCache(&metadata);
+    CHECK(metadata.value_remaining == 0);
+    CHECK(metadata.header_len == 0);
+}
+
+static void testFragments( void )
+{
+    sinkAvrcpMetadata metadata;
+    uint16 split;
+    uint16 size;
+    uint16 offset;
+
+    /* split in two at every point */
+    for(split = 1; split < response_len; split++)
+    {
+        memset(&metadata, 0xA5, sizeof metadata);
+        avrcpMetadataReset(&metadata);
+        avrcpMetadataParse(&metadata, response, split);
+        avrcpMetadataParse(&metadata, &response[split], response_len - split);
+        checkCache(&metadata);
+    }
+
+    /* and in fragments of every size up to the headers and beyond */
+    for(size = 1; size <= 2 * AVRCP_METADATA_HEADER_SIZE + 1; size++)
+    {
+        memset(&metadata, 0xA5, sizeof metadata);
+        avrcpMetadataReset(&metadata);
+        for(offset = 0; offset < response_len; offset += size)
+            avrcpMetadataParse(&metadata, &response[offset], ((response_len - offset) < size) ? (response_len - offset) : size);
+        checkCache(&metadata);
+    }
+}
+
+static void testRepeat( void )
+{
+    sinkAvrcpMetadata metadata;
+    uint16 length;
+    const uint8 * value;
+
+    /* a title sent again replaces the first, and the pool is reused */
+    memset(&metadata, 0, sizeof metadata);
+    avrcpMetadataReset(&metadata);
+    avrcpMetadataParse(&metadata, response, response_len);
+
+    response_len = 0;
+    appendAttribute(1, "Short");
+    avrcpMetadataParse(&metadata, response, response_len);
+
+    value = avrcpMetadataGetValue(&metadata, 1, &length);
+    CHECK(value && (length == 5) && (memcmp(value, "Short", 5) == 0));
+
+    value = avrcpMetadataGetValue(&metadata, 2, &length);
+    CHECK(value && (length == strlen(values[2])));
+
+    /* a reset empties the cache */
+    avrcpMetadataReset(&metadata);
+    CHECK(avrcpMetadataGetValue(&metadata, 1, &length) == NULL);
+    CHECK(metadata.truncated == 0);
+}
+
+static void testEmptyValue( void )
+{
+    sinkAvrcpMetadata metadata;
+    uint16 length;
+
+    response_len = 0;
+    appendAttribute(4, "");
+    appendAttribute(6, "Jazz");
+
+    memset(&metadata, 0, sizeof metadata);
+    avrcpMetadataReset(&metadata);
+    avrcpMetadataParse(&metadata, response, response_len);
+
+    CHECK(avrcpMetadataGetValue(&metadata, 4, &length) == NULL);
+    CHECK(avrcpMetadataGetValue(&metadata, 6, &length) != NULL);
+    CHECK(length == 4);
+}
+
+
+int main( void )
+{
+    buildResponse();
+    testWhole();
+    testFragments();
+    testRepeat();
+    testEmptyValue();
+
+    printf("test_avrcp_metadata: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
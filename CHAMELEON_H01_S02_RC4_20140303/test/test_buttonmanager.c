@@ -0,0 +1,259 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    test_buttonmanager.c
+
+DESCRIPTION
+    Host test of the button event index. The event blocks of each default
+    configuration are mapped as configManagerButtons does, and every press
+    in every state must send the same events in the same order as a linear
+    scan of both blocks, the way BMCheckForButtonMatch used to find them.
+
+*/
+
+#include "sink_private.h"
+#include "sink_buttonmanager.h"
+#include "sink_buttons.h"
+#include "sink_statemanager.h"
+
+#include <stdio.h>
+
+/* events_a, events_b and events_c of each sink_config_csr_*.c, renamed */
+#include "default_events.h"
+
+
+#define TEST_MAX_SENT       (BM_EVENTS_PER_CONF_BLOCK * 2)
+#define TEST_NUM_STATES     (deviceLowBattery + 1)
+#define TEST_NUM_DURATIONS  (B_TRIPLE + 1)
+
+#define CHECK(x) \
+    do { if(!(x)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #x); failures++; } } while(0)
+
+hsTaskData theSink;
+static LedTaskData led_task;
+static int failures;
+
+static sinkState state;
+static MessageId sent[TEST_MAX_SENT];
+static uint16 sent_count;
+
+
+sinkState stateManagerGetState( void )
+{
+    return state;
+}
+
+void MessageSend(Task task, MessageId id, void * message)
+{
+    (void)task; (void)message;
+    if(sent_count < TEST_MAX_SENT)
+        sent[sent_count] = id;
+    sent_count++;
+}
+
+void LEDManagerCheckTimeoutState( void )
+{
+}
+
+void ButtonsInit( ButtonsTaskData *pButtonsTask )
+{
+    (void)pButtonsTask;
+}
+
+void ButtonsCheckForChangeAfterInit( void )
+{
+}
+
+uint32 ButtonsTranslateInput(uint16 block, uint16 index, bool include_cap_sense)
+{
+    (void)block; (void)index; (void)include_cap_sense;
+    return 0;
+}
+
+/****************************************************************************
+NAME
+    decodeEvent
+
+DESCRIPTION
+    Get an event of a block as held in PS, 3 words each after the length,
+    with the event in the high octet of the first word and the type in the
+    low octet
+
+RETURNS
+    void
+*/
+static void decodeEvent( const uint16 * block, uint16 n, event_config_type * event )
+{
+    const uint16 * words = &block[1 + 3 * n];
+
+    event->event = words[0] >> 8;
+    event->type = words[0] & 0xFF;
+    event->pio_mask = words[1];
+    event->state_mask = words[2];
+}
+
+/****************************************************************************
+NAME
+    mapBlocks
+
+DESCRIPTION
+    Map the events of three blocks in the order configManagerButtons does
+
+RETURNS
+    void
+*/
+static void mapBlocks( const uint16 * a, const uint16 * b, const uint16 * c )
+{
+    const uint16 * blocks[3];
+    event_config_type event;
+    uint16 n;
+    uint16 i;
+    uint8 index = 0;
+
+    blocks[0] = a;
+    blocks[1] = b;
+    blocks[2] = c;
+
+    for(n = 0; n < BM_EVENTS_PER_PS_BLOCK; n++)
+    {
+        for(i = 0; i < 3; i++)
+        {
+            decodeEvent(blocks[i], n, &event);
+            if(event.pio_mask || (event.state_mask & 0xC000))
+                buttonManagerAddMapping(&event, index++);
+        }
+    }
+}
+
+/****************************************************************************
+NAME
+    linearScan
+
+DESCRIPTION
+    Find the events for a press by scanning every entry of both blocks
+
+RETURNS
+    the number of events found
+*/
+static uint16 linearScan( uint32 mask, ButtonsTime_t duration, MessageId * events )
+{
+    uint16 count = 0;
+    uint16 block;
+    uint16 n;
+
+    for(block = 0; block < 2; block++)
+    {
+        for(n = 0; n < BM_EVENTS_PER_CONF_BLOCK; n++)
+        {
+            ButtonEvents_t * event = &theSink.theButtonsTask->gButtonEvents[block][n];
+            uint32 event_mask = (uint32)(event->ButtonMaskLS | (uint32)(event->ButtonMaskVC) << VREG_PIN);
+
+            if((event_mask == mask) && (event->Duration == duration) && (event->StateMask & (1 << state)))
+                events[count++] = event->Event + EVENTS_MESSAGE_BASE;
+        }
+    }
+    return count;
+}
+
+/****************************************************************************
+NAME
+    checkAllPresses
+
+DESCRIPTION
+    Press every input mask that has an event with every duration in every
+    state and compare the events sent with those of the linear scan
+
+RETURNS
+    the number of presses that sent an event
+*/
+static uint16 checkAllPresses( void )
+{
+    MessageId expected[TEST_MAX_SENT];
+    uint16 expected_count;
+    uint16 matched = 0;
+    uint16 block;
+    uint16 n;
+    uint16 duration;
+
+    for(block = 0; block < 2; block++)
+    {
+        for(n = 0; n < BM_EVENTS_PER_CONF_BLOCK; n++)
+        {
+            ButtonEvents_t * event = &theSink.theButtonsTask->gButtonEvents[block][n];
+            uint32 mask = (uint32)(event->ButtonMaskLS | (uint32)(event->ButtonMaskVC) << VREG_PIN);
+
+            if(!mask)
+                continue;
+
+            for(duration = 0; duration < TEST_NUM_DURATIONS; duration++)
+            {
+                for(state = 0; state < TEST_NUM_STATES; state++)
+                {
+                    /* patterns are not configured so only matches are sent */
+                    sent_count = 0;
+                    BMButtonDetected(mask, (ButtonsTime_t)duration);
+                    expected_count = linearScan(mask, (ButtonsTime_t)duration, expected);
+
+                    CHECK(sent_count == expected_count);
+                    if(sent_count == expected_count)
+                        CHECK(memcmp(sent, expected, sent_count * sizeof(MessageId)) == 0);
+                    if(expected_count)
+                        matched++;
+                }
+            }
+        }
+    }
+    return matched;
+}
+
+/****************************************************************************
+NAME
+    checkConfig
+
+DESCRIPTION
+    Build the index from a default configuration, check it against the
+    linear scan, then reconfigure some entries and check it again
+
+RETURNS
+    void
+*/
+static void checkConfig( const char * name, const uint16 * a, const uint16 * b, const uint16 * c )
+{
+    event_config_type event;
+    int before = failures;
+
+    buttonManagerInit();
+    theSink.theButtonsTask->client = &theSink.task;
+    mapBlocks(a, b, c);
+
+    CHECK(checkAllPresses() != 0);
+
+    /* move the first entry to another input and clear the second, as
+       GAIA or a later configuration may */
+    decodeEvent(b, 0, &event);
+    buttonManagerAddMapping(&event, 0);
+    memset(&event, 0, sizeof event);
+    buttonManagerAddMapping(&event, 1);
+
+    CHECK(checkAllPresses() != 0);
+
+    printf("  %s: %s\n", name, (failures == before) ? "ok" : "FAILED");
+
+    free(theSink.theButtonsTask->gButtonEvents[0]);
+    free(theSink.theButtonsTask->gButtonEvents[1]);
+    free(theSink.theButtonsTask);
+}
+
+
+int main( void )
+{
+    theSink.theLEDTask = &led_task;
+
+    checkConfig("stereo", stereo_events_a, stereo_events_b, stereo_events_c);
+    checkConfig("mono", mono_events_a, mono_events_b, mono_events_c);
+    checkConfig("car", car_events_a, car_events_b, car_events_c);
+
+    printf("test_buttonmanager: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
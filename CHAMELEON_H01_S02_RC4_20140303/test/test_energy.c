@@ -0,0 +1,382 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    test_energy.c
+
+DESCRIPTION
+    Host replay of consumer changes through the energy accounting. A log in
+    the form DEBUG_ENERGY prints, the clock, consumer and units of each
+    change, is replayed with the clock stubbed and the hour message
+    delivered when it falls due. The charge of every consumer is integrated
+    alongside in ms, and the total of each hour held must be the whole 10uAh
+    reached by the end of the hour less those reached by its start, so
+    charge short of a unit is carried over and not lost. A consumer
+    switched far faster than it draws a unit must still be counted. The
+    hour totals must roll over with the hours held.
+
+    A log captured from the target can be given as an argument and is
+    replayed in place of the scripted one.
+
+*/
+
+#include "sink_energy.h"
+#include "sink_private.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define TEST_LOG_SIZE       (0x40000)
+#define TEST_LOG_HOURS      (11)
+#define TEST_HOUR_MS        (3600000UL)
+
+/* 10uA for a millisecond in 10uAh */
+#define TEST_MS_PER_UNIT    (3600000UL)
+
+#define CHECK(x) \
+    do { if(!(x)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #x); failures++; } } while(0)
+
+static int failures;
+
+static uint32 now;
+
+/* the hour message and when it is due */
+static Task hour_task;
+static MessageId hour_id;
+static uint32 hour_due;
+static bool hour_pending;
+static uint32 hour_start;
+
+/* the charge each consumer has drawn in 10uA ms, its units on and the whole
+   units counted when the hour in progress started */
+static unsigned long drawn[energy_num_consumers];
+static uint16 units[energy_num_consumers];
+static unsigned long hour_base[energy_num_consumers];
+
+/* totals expected for each hour, newest first, and the hours held */
+static uint16 expected[ENERGY_HOURS][energy_num_consumers];
+static uint16 hours_held;
+
+static char log_text[TEST_LOG_SIZE];
+
+static unsigned long seed;
+
+
+uint32 VmGetClock(void)
+{
+    return now;
+}
+
+uint16 PsRetrieve(uint16 key, void *buff, uint16 words)
+{
+    (void)key; (void)buff; (void)words;
+    return 0;
+}
+
+uint16 PsStore(uint16 key, const void *buff, uint16 words)
+{
+    (void)key; (void)buff;
+    return words;
+}
+
+void MessageSendLater(Task task, MessageId id, void * message, uint32 delay)
+{
+    (void)message;
+    hour_task    = task;
+    hour_id      = id;
+    hour_due     = now + delay;
+    hour_pending = TRUE;
+}
+
+
+/****************************************************************************
+NAME
+    integrate
+
+DESCRIPTION
+    Add the charge drawn by each consumer up to a time
+
+RETURNS
+    void
+*/
+static void integrate( uint32 to )
+{
+    uint16 i;
+
+    for(i = 0; i < energy_num_consumers; i++)
+        drawn[i] += (unsigned long)energyGetCurrent(i) * units[i] * (to - now);
+    now = to;
+}
+
+/****************************************************************************
+NAME
+    closeHour
+
+DESCRIPTION
+    The hour in progress has ended, the totals expected of it are the whole
+    units reached since it started and it is now an hour ago
+
+RETURNS
+    void
+*/
+static void closeHour( void )
+{
+    uint16 i;
+
+    memmove(expected[1], expected[0], sizeof(expected[0]) * (ENERGY_HOURS - 1));
+    for(i = 0; i < energy_num_consumers; i++)
+    {
+        expected[1][i] = (uint16)(drawn[i] / TEST_MS_PER_UNIT - hour_base[i]);
+        hour_base[i]   = drawn[i] / TEST_MS_PER_UNIT;
+    }
+
+    if(hours_held < ENERGY_HOURS)
+        hours_held++;
+    hour_start = now;
+}
+
+/****************************************************************************
+NAME
+    advance
+
+DESCRIPTION
+    Move the clock on, delivering the hour message each time it falls due
+
+RETURNS
+    void
+*/
+static void advance( uint32 to )
+{
+    while(hour_pending && (hour_due <= to))
+    {
+        integrate(hour_due);
+        hour_pending = FALSE;
+        closeHour();
+
+        hour_task->handler(hour_task, hour_id, NULL);
+    }
+    integrate(to);
+}
+
+/****************************************************************************
+NAME
+    set
+
+DESCRIPTION
+    Change a consumer at a time, as the log records it
+
+RETURNS
+    void
+*/
+static void set( uint32 at, energy_consumer consumer, uint16 on )
+{
+    if(!hours_held)
+    {
+        /* the first change starts the accounting */
+        now = at;
+        hour_start = at;
+        hours_held = 1;
+    }
+
+    advance(at);
+    energyConsumerSet(consumer, on);
+    units[consumer] = on;
+}
+
+/****************************************************************************
+NAME
+    checkHours
+
+DESCRIPTION
+    Check the totals of every hour held, the one in progress being what
+    has been reached so far, and the hours not held
+
+RETURNS
+    void
+*/
+static void checkHours( void )
+{
+    uint16 totals[energy_num_consumers];
+    uint16 hour;
+    uint16 i;
+
+    for(i = 0; i < energy_num_consumers; i++)
+        expected[0][i] = (uint16)(drawn[i] / TEST_MS_PER_UNIT - hour_base[i]);
+
+    for(hour = 0; hour < hours_held; hour++)
+    {
+        uint16 minutes = energyGetHourTotals(hour, totals);
+
+        CHECK(minutes == (hour ? 60 : (uint16)((now - hour_start) / 60000) + 1));
+        CHECK(memcmp(totals, expected[hour], sizeof(totals)) == 0);
+    }
+
+    CHECK(energyGetHourTotals(hours_held, totals) == 0);
+}
+
+/****************************************************************************
+NAME
+    nextRandom
+
+DESCRIPTION
+    Next value of a linear congruential generator, so every run replays the
+    same log
+
+RETURNS
+    a value from 0 to 32767
+*/
+static uint16 nextRandom( void )
+{
+    seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+    return (uint16)((seed >> 16) & 0x7FFF);
+}
+
+/****************************************************************************
+NAME
+    buildLog
+
+DESCRIPTION
+    Write a log of changes over several hours. Most changes are a second or
+    two apart, some minutes and a few hours, so some stretches cross the
+    hour boundary. The remote consumer is left to checkCarry.
+
+RETURNS
+    void
+*/
+static void buildLog( void )
+{
+    uint32 at = 1000;
+    unsigned long n = 0;
+    uint16 r;
+
+    seed = 7;
+    while(at < TEST_LOG_HOURS * TEST_HOUR_MS)
+    {
+        energy_consumer consumer = (energy_consumer)(nextRandom() % energy_consumer_remote);
+        uint16 on = nextRandom() % ((consumer == energy_consumer_leds) ? 4 : 2);
+
+        n += sprintf(log_text + n, "ENERGY: %lu %d %d\n", at, consumer, on);
+
+        r = nextRandom() % 100;
+        if(r < 70)
+            at += 1 + nextRandom() % 2000;
+        else if(r < 98)
+            at += 2000 + (uint32)nextRandom() * 4;
+        else
+            at += (uint32)nextRandom() * 128;
+    }
+}
+
+/****************************************************************************
+NAME
+    replay
+
+DESCRIPTION
+    Replay the changes of a log, ignoring any line that is not one
+
+RETURNS
+    the number of changes replayed
+*/
+static uint16 replay( const char * text )
+{
+    unsigned long at;
+    int consumer;
+    int on;
+    uint16 changes = 0;
+
+    while(text && *text)
+    {
+        const char * line = strstr(text, "ENERGY: ");
+
+        if(!line)
+            break;
+        text = strchr(line, '\n');
+
+        if((sscanf(line, "ENERGY: %lu %d %d", &at, &consumer, &on) == 3) &&
+           (consumer >= 0) && (consumer < energy_num_consumers) && (at >= now))
+        {
+            set(at, consumer, on);
+            changes++;
+        }
+    }
+    return changes;
+}
+
+/****************************************************************************
+NAME
+    checkCarry
+
+DESCRIPTION
+    Switch the remote consumer for half a second at a time for half an hour,
+    each time drawing a fraction of a unit
+
+RETURNS
+    void
+*/
+static void checkCarry( void )
+{
+    uint16 totals[energy_num_consumers];
+    uint32 start;
+    uint32 at;
+    int before = failures;
+
+    /* start on an hour so the half hour is in one */
+    advance(hour_due);
+    start = now;
+
+    for(at = start; at < start + TEST_HOUR_MS / 2; at += 1000)
+    {
+        set(at, energy_consumer_remote, 10);
+        set(at + 500, energy_consumer_remote, 0);
+    }
+
+    /* 900s at 100uA is 2.5 of 10uAh, 5 of 10uA ms each time */
+    energyGetHourTotals(0, totals);
+    CHECK(totals[energy_consumer_remote] == 2);
+
+    checkHours();
+
+    printf("  carry: %s\n", (failures == before) ? "ok" : "FAILED");
+}
+
+
+int main( int argc, char ** argv )
+{
+    uint16 changes;
+    int before;
+
+    if(argc > 1)
+    {
+        FILE * file = fopen(argv[1], "r");
+        size_t len;
+
+        if(!file)
+        {
+            printf("test_energy: can't open %s\n", argv[1]);
+            return 1;
+        }
+        len = fread(log_text, 1, sizeof(log_text) - 1, file);
+        log_text[len] = '\0';
+        fclose(file);
+    }
+    else
+    {
+        buildLog();
+    }
+
+    before = failures;
+    changes = replay(log_text);
+    CHECK(changes > 0);
+    checkHours();
+    printf("  replay %u changes over %u hours: %s\n", changes, hours_held, (failures == before) ? "ok" : "FAILED");
+
+    if(argc == 1)
+    {
+        CHECK(hours_held == ENERGY_HOURS);
+        checkCarry();
+    }
+
+    printf("test_energy: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
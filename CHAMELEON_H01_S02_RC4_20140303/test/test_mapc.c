@@ -0,0 +1,338 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    test_mapc.c
+
+DESCRIPTION
+    Host replay of MAP event report objects through the MNS event handler.
+    The objects are written as in the MAP 1.0 and 1.1 specifications with
+    the spacing and quoting differences phones use, and each is delivered
+    whole and split over packets of several sizes with moreData set on all
+    but the last. Every split must give the same notifications, with the
+    handle, folder and message type of each new message, and repeats and
+    bursts must be held back as they are when delivered whole.
+
+*/
+
+#include "sink_private.h"
+#include "sink_mapc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define TEST_MAX_NEW        (3)
+
+#define CHECK(x) \
+    do { if(!(x)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #x); failures++; } } while(0)
+
+/* a new message an object should be notified for */
+typedef struct
+{
+    uint32          handle;
+    const char *    folder;
+    mapc_msg_type   msg_type;
+} test_new;
+
+typedef struct
+{
+    const char *    name;
+    const char *    object;
+    uint16          new_count;
+    test_new        new_messages[TEST_MAX_NEW];
+} test_object;
+
+hsTaskData theSink;
+static runtime_block1_t rundata;
+static int failures;
+
+/* the MNS sessions are only compared, so any address will do */
+static uint16 mns_session[2];
+#define TEST_MNS_SESSION    ((Mns)&mns_session[0])
+#define TEST_MNS_UNKNOWN    ((Mns)&mns_session[1])
+
+static uint16 tones;
+static uint16 holdoffs;
+
+static const test_object objects[] =
+{
+    {
+        "map 1.0",
+        "<MAP-event-report version = \"1.0\">\n"
+        "<event type = \"NewMessage\" handle = \"12345678\" folder = \"TELECOM/MSG/INBOX\" msg_type = \"SMS_CDMA\" />\n"
+        "</MAP-event-report>\n",
+        1,
+        { { 0x12345678, "TELECOM/MSG/INBOX", mapc_msg_sms_cdma } }
+    },
+    {
+        "map 1.1",
+        "<MAP-event-report version=\"1.1\"><event type=\"NewMessage\" handle=\"20000100001\" "
+        "folder=\"telecom/msg/inbox\" msg_type=\"SMS_GSM\" datetime=\"20140303T101500\" "
+        "subject=\"Running late &gt; 10 min\" sender_name=\"Mary\" priority=\"no\"/></MAP-event-report>",
+        1,
+        { { 0x00100001, "telecom/msg/inbox", mapc_msg_sms_gsm } }
+    },
+    {
+        "single quotes",
+        "<?xml version='1.0' encoding='UTF-8'?>\r\n"
+        "<MAP-event-report version='1.0'>\r\n"
+        "  <event\r\n    type='NewMessage'\r\n    handle='0A1b2C3d'\r\n    folder='inbox'\r\n    msg_type='EMAIL'/>\r\n"
+        "</MAP-event-report>\r\n",
+        1,
+        { { 0x0A1B2C3D, "inbox", mapc_msg_email } }
+    },
+    {
+        "other events",
+        "<MAP-event-report version=\"1.0\">"
+        "<event type=\"SendingSuccess\" handle=\"00000011\" folder=\"TELECOM/MSG/SENT\" msg_type=\"SMS_GSM\"/>"
+        "<event type=\"MessageDeleted\" handle=\"00000012\" folder=\"TELECOM/MSG/DELETED\" msg_type=\"MMS\"/>"
+        "<event type=\"MemoryFull\"/>"
+        "</MAP-event-report>",
+        0,
+        { { 0, NULL, mapc_msg_unknown } }
+    },
+    {
+        "burst",
+        "<MAP-event-report version=\"1.0\">"
+        "<event type=\"NewMessage\" handle=\"00000021\" folder=\"TELECOM/MSG/INBOX\" msg_type=\"SMS_GSM\"/>"
+        "<event type=\"DeliverySuccess\" handle=\"00000020\" msg_type=\"SMS_GSM\"/>"
+        "<event type=\"NewMessage\" handle=\"00000022\" folder=\"TELECOM/MSG/INBOX\" msg_type=\"MMS\"/>"
+        "<event type=\"NewMessage\" handle=\"00000021\" folder=\"TELECOM/MSG/INBOX\" msg_type=\"SMS_GSM\"/>"
+        "<event type=\"NewMessage\" handle=\"00000023\" folder=\"a/folder/name/longer/than/kept\" msg_type=\"EMAIL\"/>"
+        "</MAP-event-report>",
+        3,
+        {
+            { 0x00000021, "TELECOM/MSG/INBOX", mapc_msg_sms_gsm },
+            { 0x00000022, "TELECOM/MSG/INBOX", mapc_msg_mms },
+            { 0x00000023, "a/folder/name/longer/tha", mapc_msg_email }
+        }
+    }
+};
+
+/* packet sizes, 0 for the whole object in one */
+static const uint16 packet_sizes[] = { 0, 1, 2, 5, 17, 64 };
+
+
+const uint8 *SourceMap(Source source)
+{
+    return (const uint8 *)source;
+}
+
+void MessageSend(Task task, MessageId id, void * message)
+{
+    (void)task; (void)message;
+    if(id == EventMapcMsgNotification)
+        tones++;
+}
+
+void MessageSendLater(Task task, MessageId id, void * message, uint32 delay)
+{
+    (void)task; (void)message; (void)delay;
+    if(id == MAPC_APP_NOTIFY_HOLDOFF)
+        holdoffs++;
+}
+
+bool BdaddrIsSame(const bdaddr *first, const bdaddr *second)
+{
+    return (first->lap == second->lap) && (first->uap == second->uap) && (first->nap == second->nap);
+}
+
+void MapcMnsSendEventResponse(Mns mnsSession, MapcResponse response)
+{
+    (void)mnsSession; (void)response;
+}
+
+/* the connection calls are not made by the event handling */
+void MapcMnsStart(Task theAppTask, bool sdpRegister, uint8 mnsChannel) { abort(); }
+void MapcMnsShutdown(uint32 sdpHandle, uint8 mnsChannel) { abort(); }
+void MapcMnsConnectResponse(Task theAppTask, const bdaddr *addr, uint8 mnsChannel, bool accept, uint16 connectID) { abort(); }
+void MapcMnsDisconnectResponse(Mns mnsSession) { abort(); }
+void MapcMasSdpAttrSearchRequest(Task theAppTask, const bdaddr *addr) { abort(); }
+void MapcMasConnectRequest(Task theAppTask, const bdaddr *addr, uint8 masChannel) { abort(); }
+void MapcMasDisconnectRequest(Mas masSession) { abort(); }
+void MapcMasDisconnectResponse(Mas masSession) { abort(); }
+void MapcMasSetNotificationRequest(Mas masSession, bool regStatus) { abort(); }
+void ConnectionSmSetSdpSecurityIn(bool enable) { abort(); }
+void ConnectionSmSetSdpSecurityOut(bool enable, const bdaddr *bd_addr) { abort(); }
+void ConnectionSmRegisterIncomingService(dm_protocol_id protocol_id, uint32 channel, dm_ssp_security_level_in security_level) { abort(); }
+void ConnectionSmRegisterOutgoingService(Task task, const bdaddr *bd_addr, dm_protocol_id protocol_id, uint32 channel, dm_ssp_security_level_out security_level) { abort(); }
+bool SdpParseGetMultipleRfcommServerChannels(uint8 size_attribute_list, uint8 *attribute_list, uint8 size_chans, uint8 **chans, uint8 *found) { abort(); }
+
+/****************************************************************************
+NAME
+    reset
+
+DESCRIPTION
+    Clear the notifications as at connection, with the first link
+    registered for notifications
+
+RETURNS
+    void
+*/
+static void reset( void )
+{
+    memset(&rundata, 0, sizeof rundata);
+    rundata.mapc_data.state[0].mnsHandle    = TEST_MNS_SESSION;
+    rundata.mapc_data.state[0].device_state = mapc_mns_registered;
+
+    tones = 0;
+    holdoffs = 0;
+}
+
+/****************************************************************************
+NAME
+    replay
+
+DESCRIPTION
+    Deliver an object over a session in packets of a size, 0 for the
+    whole object in one
+
+RETURNS
+    void
+*/
+static void replay( Mns session, const char * object, uint16 packet )
+{
+    MAPC_MNS_SEND_EVENT_IND_T ind;
+    uint16 len = strlen(object);
+    uint16 offset = 0;
+
+    if(!packet)
+        packet = len;
+
+    do
+    {
+        ind.mnsSession    = session;
+        ind.masInstanceId = 0;
+        ind.sourceLen     = ((len - offset) < packet) ? (len - offset) : packet;
+        ind.eventReport   = (Source)(object + offset);
+        offset += ind.sourceLen;
+        ind.moreData      = (offset < len);
+
+        handleMapcMessages(&theSink.task, MAPC_MNS_SEND_EVENT_IND, &ind);
+    }
+    while(offset < len);
+}
+
+/****************************************************************************
+NAME
+    notificationIs
+
+DESCRIPTION
+    Check a notification against the new message expected
+
+RETURNS
+    TRUE if they match
+*/
+static bool notificationIs( const mapcNotification * notify, const test_new * expected )
+{
+    /* uint32 may be wider on the host than on the target */
+    return ((notify->handle & 0xFFFFFFFFUL) == expected->handle) &&
+           (notify->msg_type == expected->msg_type) &&
+           (notify->device_id == mapc_primary_link) &&
+           (notify->folder_len == strlen(expected->folder)) &&
+           (memcmp(notify->folder, expected->folder, notify->folder_len) == 0);
+}
+
+/****************************************************************************
+NAME
+    checkObject
+
+DESCRIPTION
+    Replay an object split each way. The first new message is notified
+    straight away and the rest are held until the hold off ends, when one
+    more notification covers them all.
+
+RETURNS
+    void
+*/
+static void checkObject( const test_object * test )
+{
+    mapcData_t *data = &rundata.mapc_data;
+    int before = failures;
+    uint16 i;
+    uint16 n;
+
+    for(i = 0; i < sizeof(packet_sizes) / sizeof(packet_sizes[0]); i++)
+    {
+        reset();
+        replay(TEST_MNS_SESSION, test->object, packet_sizes[i]);
+
+        CHECK(tones == (test->new_count ? 1 : 0));
+        CHECK(holdoffs == tones);
+
+        /* the parser is ready for the next object */
+        CHECK(data->state[0].event.state == 0);
+        CHECK(data->state[0].event.token_len == 0);
+
+        if(!test->new_count)
+        {
+            CHECK(data->notified_count == 0);
+            CHECK(data->notify_count == 0);
+            continue;
+        }
+
+        CHECK(data->notified_count == 1);
+        CHECK(notificationIs(&data->notified[0], &test->new_messages[0]));
+
+        CHECK(data->notify_count == test->new_count - 1);
+        for(n = 1; (n < test->new_count) && (n <= data->notify_count); n++)
+            CHECK(notificationIs(&data->notify[n - 1], &test->new_messages[n]));
+
+        /* the hold off ends */
+        handleMapcMessages(&theSink.task, MAPC_APP_NOTIFY_HOLDOFF, NULL);
+        CHECK(tones == ((test->new_count > 1) ? 2 : 1));
+        CHECK(data->notify_count == 0);
+
+        /* the same object again is all repeats */
+        data->notify_holdoff = FALSE;
+        replay(TEST_MNS_SESSION, test->object, packet_sizes[i]);
+        CHECK(tones == ((test->new_count > 1) ? 2 : 1));
+    }
+
+    printf("  %s: %s\n", test->name, (failures == before) ? "ok" : "FAILED");
+}
+
+/****************************************************************************
+NAME
+    checkUnknownSession
+
+DESCRIPTION
+    An object from a session that is not known is parsed a packet at a time,
+    so a new message is only notified when its event arrives in one packet
+
+RETURNS
+    void
+*/
+static void checkUnknownSession( void )
+{
+    const char * object = objects[0].object;
+    int before = failures;
+
+    reset();
+    replay(TEST_MNS_UNKNOWN, object, 0);
+    CHECK(tones == 1);
+    CHECK(rundata.mapc_data.notified[0].device_id == mapc_invalid_link);
+
+    reset();
+    replay(TEST_MNS_UNKNOWN, object, 16);
+    CHECK(tones == 0);
+
+    printf("  unknown session: %s\n", (failures == before) ? "ok" : "FAILED");
+}
+
+
+int main( void )
+{
+    uint16 i;
+
+    theSink.rundata = &rundata;
+
+    for(i = 0; i < sizeof(objects) / sizeof(objects[0]); i++)
+        checkObject(&objects[i]);
+
+    checkUnknownSession();
+
+    printf("test_mapc: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
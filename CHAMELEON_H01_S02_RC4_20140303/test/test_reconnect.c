@@ -0,0 +1,581 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    test_reconnect.c
+
+DESCRIPTION
+    Host test of the reconnection order. The device attributes are held in
+    a stand-in for the PS attribute store, so the page history and link
+    losses recorded by the plan are read back as they are on the target.
+    The ordering, the page timeouts and the handling of page results are
+    checked, then reconnection is replayed over scripted sessions in which
+    each device is in range or not and takes a scripted time to answer a
+    page. The attempts and the time taken to connect are printed for the
+    plan and for the order used before it, the PDL order with the default
+    page timeout.
+
+*/
+
+#include "sink_reconnect.h"
+#include "sink_private.h"
+#include "sink_devicemanager.h"
+#include "sink_slc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define TEST_MAX_DEVICES    (RECONNECT_MAX_CANDIDATES)
+#define TEST_SESSIONS       (2000)
+#define TEST_ROUNDS         (3)
+
+/* page timeouts in ms, a slot is 0.625ms */
+#define TEST_DEFAULT_PAGE_MS    (5120)
+#define TEST_SHORT_PAGE_MS      ((RECONNECT_SHORT_PAGE_TIMEOUT * 5) / 8)
+
+#define CHECK(x) \
+    do { if(!(x)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #x); failures++; } } while(0)
+
+/* a device of the PDL and its attributes as held in PS */
+typedef struct
+{
+    bdaddr          addr;
+    sink_attributes attributes;
+} test_device;
+
+/* how a device behaves over the scripted sessions */
+typedef struct
+{
+    const char *    name;
+    uint16          present;        /* chance it is in range, out of 100 */
+    uint16          answer_ms;      /* quickest it answers a page */
+    uint16          spread_ms;      /* and how much later it may answer */
+} test_profile;
+
+/* totals of a run over the sessions */
+typedef struct
+{
+    unsigned long   attempts;
+    unsigned long   ms;
+    unsigned        connected;
+} test_totals;
+
+static int failures;
+
+static test_device pdl[TEST_MAX_DEVICES];
+static uint16 pdl_size;
+
+/* page timeout set, in slots, 0 for the default */
+static uint16 page_timeout;
+static uint16 page_timeout_sets;
+
+static unsigned long seed;
+
+static const test_profile profiles[] =
+{
+    { "phone",       85,  600, 1200 },
+    { "work phone",  45,  800, 1200 },
+    { "tablet",      30, 1500, 2500 },
+    { "laptop",      15, 1000, 1000 },
+    { "old phone",    5,  700,  600 }
+};
+
+#define TEST_PROFILES   (sizeof(profiles) / sizeof(profiles[0]))
+
+
+/* the PS attribute store and the connection library */
+
+uint16 ConnectionTrustedDeviceListSize(void)
+{
+    return pdl_size;
+}
+
+void ConnectionSetPageTimeout(uint16 timeout)
+{
+    page_timeout = timeout;
+    page_timeout_sets++;
+}
+
+bool BdaddrIsSame(const bdaddr *first, const bdaddr *second)
+{
+    return (first->lap == second->lap) && (first->uap == second->uap) && (first->nap == second->nap);
+}
+
+static test_device * findDevice( const bdaddr * bd_addr )
+{
+    uint16 i;
+
+    for(i = 0; i < pdl_size; i++)
+    {
+        if(BdaddrIsSame(&pdl[i].addr, bd_addr))
+            return &pdl[i];
+    }
+    return NULL;
+}
+
+bool ConnectionSmGetAttributeNow(uint16 ps_base, const bdaddr *bd_addr, uint16 size_psdata, uint8 *psdata)
+{
+    test_device * device = findDevice(bd_addr);
+
+    if(!device)
+        return FALSE;
+    memcpy(psdata, &device->attributes, size_psdata);
+    return TRUE;
+}
+
+bool ConnectionSmGetIndexedAttributeNowReq(uint16 ps_base, uint16 index, uint16 size_psdata, uint8 *psdata, typed_bdaddr *taddr)
+{
+    if(index >= pdl_size)
+        return FALSE;
+    memcpy(psdata, &pdl[index].attributes, size_psdata);
+    taddr->type = 0;
+    taddr->addr = pdl[index].addr;
+    return TRUE;
+}
+
+void ConnectionSmPutAttribute(uint16 ps_base, const bdaddr *bd_addr, uint16 size_psdata, const uint8 *psdata)
+{
+    test_device * device = findDevice(bd_addr);
+
+    if(device)
+        memcpy(&device->attributes, psdata, size_psdata);
+}
+
+
+/* the device manager as it is with nothing in the attribute cache */
+
+void deviceManagerGetDefaultAttributes(sink_attributes* attributes, bool is_subwoofer)
+{
+    memset(attributes, 0, sizeof(sink_attributes));
+}
+
+bool deviceManagerGetAttributes(sink_attributes* attributes, const bdaddr* dev_addr)
+{
+    uint8 size = (attributes ? sizeof(sink_attributes) : 0);
+    return ConnectionSmGetAttributeNow(PSKEY_ATTRIBUTE_BASE, dev_addr, size, (uint8*)attributes);
+}
+
+bool deviceManagerGetIndexedAttributes(uint8 index, sink_attributes* attributes, typed_bdaddr* dev_addr)
+{
+    return ConnectionSmGetIndexedAttributeNowReq(PSKEY_ATTRIBUTE_BASE, index, sizeof(sink_attributes), (uint8*)attributes, dev_addr);
+}
+
+void deviceManagerStoreAttributes(sink_attributes* attributes, const bdaddr* dev_addr)
+{
+    ConnectionSmPutAttribute(PSKEY_ATTRIBUTE_BASE, dev_addr, sizeof(sink_attributes), (uint8*)attributes);
+}
+
+bool slcIsListIdAvailable(uint8 ListID)
+{
+    return (ListID < pdl_size);
+}
+
+
+/****************************************************************************
+NAME
+    reset
+
+DESCRIPTION
+    Fill the PDL with a number of devices that have no history, device i
+    at index i
+
+RETURNS
+    void
+*/
+static void reset( uint16 devices )
+{
+    uint16 i;
+
+    memset(pdl, 0, sizeof pdl);
+    for(i = 0; i < devices; i++)
+    {
+        pdl[i].addr.nap = 0x0002;
+        pdl[i].addr.uap = 0x5B;
+        pdl[i].addr.lap = 0x100 + i;
+    }
+    pdl_size = devices;
+
+    reconnectPlanEnd();
+    page_timeout = 0;
+    page_timeout_sets = 0;
+}
+
+/****************************************************************************
+NAME
+    deviceOf
+
+DESCRIPTION
+    Get the device number, as given by reset, of a PDL index
+
+RETURNS
+    the device
+*/
+static uint16 deviceOf( uint8 list_id )
+{
+    return (uint16)(pdl[list_id].addr.lap - 0x100);
+}
+
+/****************************************************************************
+NAME
+    moveToTop
+
+DESCRIPTION
+    Move a device to the top of the PDL as deviceManagerSetPriority does
+    when it connects
+
+RETURNS
+    void
+*/
+static void moveToTop( uint8 list_id )
+{
+    test_device device = pdl[list_id];
+
+    memmove(&pdl[1], &pdl[0], list_id * sizeof(test_device));
+    pdl[0] = device;
+}
+
+/****************************************************************************
+NAME
+    page
+
+DESCRIPTION
+    Page a device through the plan as sink_slc.c does and record the result
+
+RETURNS
+    void
+*/
+static void page( uint8 list_id, bool connected )
+{
+    bdaddr addr = pdl[list_id].addr;
+
+    reconnectPageStarted(&addr);
+    reconnectPageResult(&addr, connected);
+}
+
+/****************************************************************************
+NAME
+    orderIs
+
+DESCRIPTION
+    Check a whole round of the plan gives the devices in an order
+
+RETURNS
+    TRUE if it does
+*/
+static bool orderIs( const uint16 * order, uint16 count )
+{
+    uint8 list_id;
+    uint16 i;
+
+    for(i = 0; i < count; i++)
+    {
+        if(!reconnectPlanNext(&list_id) || (deviceOf(list_id) != order[i]))
+            return FALSE;
+    }
+    return !reconnectPlanNext(&list_id);
+}
+
+
+static void testNoHistory( void )
+{
+    static const uint16 order[] = { 0, 1, 2 };
+    int before = failures;
+
+    /* with nothing recorded the PDL order is kept */
+    reset(3);
+    reconnectPlanStart(3);
+    CHECK(orderIs(order, 3));
+    CHECK(page_timeout == RECONNECT_SHORT_PAGE_TIMEOUT);
+
+    /* later rounds have the default timeout, as does what follows */
+    CHECK(reconnectPlanRestart());
+    CHECK(page_timeout == 0);
+    CHECK(orderIs(order, 3));
+    reconnectPlanEnd();
+    CHECK(page_timeout == 0);
+    CHECK(page_timeout_sets == 2);
+
+    /* a plan of one device keeps the default timeout */
+    reconnectPlanStart(1);
+    CHECK(orderIs(order, 1));
+    CHECK(page_timeout_sets == 2);
+    reconnectPlanEnd();
+
+    /* and an empty PDL gives nothing to restart */
+    reset(0);
+    reconnectPlanStart(3);
+    CHECK(orderIs(order, 0));
+    CHECK(!reconnectPlanRestart());
+    CHECK(page_timeout_sets == 0);
+
+    printf("  no history: %s\n", (failures == before) ? "ok" : "FAILED");
+}
+
+static void testHistory( void )
+{
+    static const uint16 order[] = { 1, 2, 0 };
+    int before = failures;
+
+    /* device 0 failed and 1 connected, 85 less 0, 170 less 16, 128 less 32 */
+    reset(3);
+    page(0, FALSE);
+    page(1, TRUE);
+    CHECK(pdl[0].attributes.reconnect.page_attempts == 1);
+    CHECK(pdl[0].attributes.reconnect.page_history == 0);
+    CHECK(pdl[1].attributes.reconnect.page_history == 1);
+
+    reconnectPlanStart(3);
+    CHECK(orderIs(order, 3));
+    reconnectPlanEnd();
+
+    /* the history is kept to its size */
+    reset(1);
+    {
+        uint16 i;
+        for(i = 0; i < 20; i++)
+            page(0, (i & 1) != 0);
+    }
+    CHECK(pdl[0].attributes.reconnect.page_attempts == 8);
+    CHECK(pdl[0].attributes.reconnect.page_history == 0x55);
+
+    printf("  history: %s\n", (failures == before) ? "ok" : "FAILED");
+}
+
+static void testLinkLoss( void )
+{
+    static const uint16 order[] = { 1, 0 };
+    bdaddr addr;
+    uint16 i;
+    int before = failures;
+
+    /* eight link losses cost device 0 64, more than its place costs 1 */
+    reset(2);
+    addr = pdl[0].addr;
+    for(i = 0; i < 8; i++)
+        reconnectLinkLoss(&addr);
+    CHECK(pdl[0].attributes.reconnect.link_loss == 8);
+
+    reconnectPlanStart(2);
+    CHECK(orderIs(order, 2));
+    reconnectPlanEnd();
+
+    /* and connecting halves them */
+    page(0, TRUE);
+    CHECK(pdl[0].attributes.reconnect.link_loss == 4);
+
+    /* they saturate */
+    for(i = 0; i < 20; i++)
+        reconnectLinkLoss(&addr);
+    CHECK(pdl[0].attributes.reconnect.link_loss == 15);
+
+    printf("  link loss: %s\n", (failures == before) ? "ok" : "FAILED");
+}
+
+static void testPageResult( void )
+{
+    bdaddr first;
+    bdaddr second;
+    int before = failures;
+
+    reset(2);
+    first = pdl[0].addr;
+    second = pdl[1].addr;
+
+    /* nothing paged */
+    reconnectPageResult(&first, TRUE);
+    CHECK(pdl[0].attributes.reconnect.page_attempts == 0);
+
+    /* the result of a device not being paged, as an incoming connection */
+    reconnectPageStarted(&first);
+    reconnectPageResult(&second, TRUE);
+    CHECK(pdl[1].attributes.reconnect.page_attempts == 0);
+
+    /* the result of the page, then another that is ignored */
+    reconnectPageResult(&first, FALSE);
+    reconnectPageResult(&first, TRUE);
+    CHECK(pdl[0].attributes.reconnect.page_attempts == 1);
+    CHECK(pdl[0].attributes.reconnect.page_history == 0);
+
+    printf("  page result: %s\n", (failures == before) ? "ok" : "FAILED");
+}
+
+static void testReordered( void )
+{
+    uint8 list_id;
+    int before = failures;
+
+    /* devices are followed through a change of the PDL order */
+    reset(3);
+    page(2, TRUE);
+    reconnectPlanStart(3);
+    moveToTop(2);
+
+    CHECK(reconnectPlanNext(&list_id) && (list_id == 0) && (deviceOf(list_id) == 2));
+    CHECK(reconnectPlanNext(&list_id) && (deviceOf(list_id) == 0));
+    CHECK(reconnectPlanNext(&list_id) && (deviceOf(list_id) == 1));
+    reconnectPlanEnd();
+
+    printf("  reordered: %s\n", (failures == before) ? "ok" : "FAILED");
+}
+
+
+/****************************************************************************
+NAME
+    nextRandom
+
+DESCRIPTION
+    Next value of a linear congruential generator, so every run replays the
+    same sessions
+
+RETURNS
+    a value from 0 to 32767
+*/
+static uint16 nextRandom( void )
+{
+    seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+    return (uint16)((seed >> 16) & 0x7FFF);
+}
+
+/****************************************************************************
+NAME
+    session
+
+DESCRIPTION
+    Reconnect to the devices of one session, in range or not and taking the
+    time given to answer, for up to TEST_ROUNDS rounds. Reconnection stops
+    at the first connection, as it does without multipoint, and the device
+    is moved to the top of the PDL. With use_plan clear the devices are paged
+    in PDL order with the default timeout, as they were before.
+
+RETURNS
+    void
+*/
+static void session( const bool * present, const uint16 * answer_ms, bool use_plan, test_totals * totals )
+{
+    uint16 round = 1;
+    uint16 next = 0;
+    uint8 list_id;
+
+    if(use_plan)
+        reconnectPlanStart(pdl_size);
+
+    for(;;)
+    {
+        uint16 timeout_ms;
+        uint16 device;
+
+        if(use_plan)
+        {
+            if(!reconnectPlanNext(&list_id))
+            {
+                if((round == TEST_ROUNDS) || !reconnectPlanRestart() || !reconnectPlanNext(&list_id))
+                    break;
+                round++;
+            }
+            timeout_ms = (page_timeout == RECONNECT_SHORT_PAGE_TIMEOUT) ? TEST_SHORT_PAGE_MS : TEST_DEFAULT_PAGE_MS;
+        }
+        else
+        {
+            if(next == pdl_size)
+            {
+                if(round == TEST_ROUNDS)
+                    break;
+                round++;
+                next = 0;
+            }
+            list_id = next++;
+            timeout_ms = TEST_DEFAULT_PAGE_MS;
+        }
+
+        device = deviceOf(list_id);
+        totals->attempts++;
+
+        if(present[device] && (answer_ms[device] <= timeout_ms))
+        {
+            totals->ms += answer_ms[device];
+            totals->connected++;
+            if(use_plan)
+                page(list_id, TRUE);
+            moveToTop(list_id);
+            break;
+        }
+
+        totals->ms += timeout_ms;
+        if(use_plan)
+            page(list_id, FALSE);
+    }
+
+    if(use_plan)
+        reconnectPlanEnd();
+}
+
+/****************************************************************************
+NAME
+    replay
+
+DESCRIPTION
+    Run the scripted sessions with or without the plan, each run drawing the
+    same sessions
+
+RETURNS
+    void
+*/
+static void replay( bool use_plan, test_totals * totals )
+{
+    bool present[TEST_PROFILES];
+    uint16 answer_ms[TEST_PROFILES];
+    uint16 s;
+    uint16 i;
+
+    memset(totals, 0, sizeof(test_totals));
+    reset(TEST_PROFILES);
+    seed = 1;
+
+    for(s = 0; s < TEST_SESSIONS; s++)
+    {
+        for(i = 0; i < TEST_PROFILES; i++)
+        {
+            present[i]   = ((nextRandom() % 100) < profiles[i].present);
+            answer_ms[i] = profiles[i].answer_ms + (nextRandom() % (profiles[i].spread_ms + 1));
+        }
+        session(present, answer_ms, use_plan, totals);
+    }
+}
+
+static void testReplay( void )
+{
+    test_totals plan;
+    test_totals pdl_order;
+    int before = failures;
+
+    replay(FALSE, &pdl_order);
+    replay(TRUE, &plan);
+
+    printf("    PDL order: %u of %u connected, %.2f attempts, %.0fms a session\n",
+           pdl_order.connected, TEST_SESSIONS,
+           (double)pdl_order.attempts / TEST_SESSIONS, (double)pdl_order.ms / TEST_SESSIONS);
+    printf("    plan:      %u of %u connected, %.2f attempts, %.0fms a session\n",
+           plan.connected, TEST_SESSIONS,
+           (double)plan.attempts / TEST_SESSIONS, (double)plan.ms / TEST_SESSIONS);
+
+    /* a device in range is found by both, the plan by its later rounds */
+    CHECK(plan.connected == pdl_order.connected);
+    CHECK(plan.ms < pdl_order.ms);
+
+    printf("  replay: %s\n", (failures == before) ? "ok" : "FAILED");
+}
+
+
+int main( void )
+{
+    testNoHistory();
+    testHistory();
+    testLinkLoss();
+    testPageResult();
+    testReordered();
+    testReplay();
+
+    printf("test_reconnect: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,253 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    test_tone_codec.c
+
+DESCRIPTION
+    Host test of the packed user tones. Blocks in the form written by the
+    configuration tool are packed, edited and decoded again, and the tones
+    must come back word for word.
+
+*/
+
+#include "sink_tone_codec.h"
+#include "sink_private.h"
+
+#include <stdio.h>
+
+
+#define TEST_BLOCK_SIZE     (128)
+
+#define NOTE(pitch, length) ((ringtone_note)(((pitch) << RINGTONE_SEQ_NOTE_PITCH_POS) | ((length) << RINGTONE_SEQ_NOTE_LENGTH_POS)))
+#define CONTROL(value)      ((ringtone_note)(RINGTONE_SEQ_CONTROL_MASK | 0x1000 | (value)))
+
+#define CHECK(x) \
+    do { if(!(x)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #x); failures++; } } while(0)
+
+hsTaskData theSink;
+static int failures;
+
+/* control word, delta, run longer than one repeat code, pitch only,
+   length too long for the codes, pitch and length */
+static const ringtone_note tone_a[] =
+{
+    CONTROL(0x40),
+    NOTE(10, 8), NOTE(12, 8), NOTE(9, 8),
+    NOTE(12, 8), NOTE(12, 8), NOTE(12, 8), NOTE(12, 8), NOTE(12, 8),
+    NOTE(12, 8), NOTE(12, 8), NOTE(12, 8), NOTE(12, 8), NOTE(12, 8),
+    NOTE(12, 8), NOTE(12, 8), NOTE(12, 8), NOTE(12, 8), NOTE(12, 8),
+    NOTE(12, 8), NOTE(12, 8), NOTE(12, 8), NOTE(12, 8), NOTE(12, 8),
+    NOTE(60, 8), NOTE(60, 300), NOTE(5, 16), NOTE(5, 32),
+    RINGTONE_END
+};
+
+static const ringtone_note tone_b[] =
+{
+    NOTE(30, 4), NOTE(31, 4), NOTE(30, 4),
+    RINGTONE_END
+};
+
+static const ringtone_note tone_c[] =
+{
+    CONTROL(0x7), NOTE(0, 0), NOTE(63, 255),
+    RINGTONE_END
+};
+
+
+uint16 ConfigRetrieve(uint16 config_id, uint16 key, void* data, uint16 len)
+{
+    (void)config_id; (void)key; (void)data; (void)len;
+    return 0;
+}
+
+/****************************************************************************
+NAME
+    toneLength
+
+DESCRIPTION
+    Get the words in a tone including RINGTONE_END
+
+RETURNS
+    the length
+*/
+static uint16 toneLength( const ringtone_note * tone )
+{
+    uint16 len = 1;
+
+    while(*tone++ != (ringtone_note)RINGTONE_END)
+        len++;
+    return len;
+}
+
+/****************************************************************************
+NAME
+    buildLegacy
+
+DESCRIPTION
+    Build a block as written by the configuration tool, 8 offsets followed
+    by the tones, with tone_a as tone 0 and tone_b as tone 5
+
+RETURNS
+    the block length
+*/
+static uint16 buildLegacy( uint16 * block )
+{
+    uint16 len = MAX_NUM_VARIABLE_TONES;
+
+    memset(block, 0, TEST_BLOCK_SIZE);
+
+    block[0] = len;
+    memmove(&block[len], tone_a, toneLength(tone_a));
+    len += toneLength(tone_a);
+
+    block[5] = len;
+    memmove(&block[len], tone_b, toneLength(tone_b));
+    len += toneLength(tone_b);
+
+    return len;
+}
+
+/****************************************************************************
+NAME
+    checkTone
+
+DESCRIPTION
+    Check a tone of a decoded block matches the one expected, or is absent
+
+RETURNS
+    void
+*/
+static void checkTone( const ringtone_note * tones, uint8 index, const ringtone_note * expected )
+{
+    uint16 len;
+
+    if(!expected)
+    {
+        CHECK(tones[index] == 0);
+        return;
+    }
+
+    CHECK(tones[index] != 0);
+    if(tones[index])
+    {
+        len = toneLength(expected);
+        CHECK(memcmp(&tones[tones[index]], expected, len * sizeof(ringtone_note)) == 0);
+    }
+}
+
+/****************************************************************************
+NAME
+    decode
+
+DESCRIPTION
+    Decode a packed block into tones
+
+RETURNS
+    the decoded size, 0 if the block did not decode
+*/
+static uint16 decode( const uint16 * key, uint16 key_len, ringtone_note * tones )
+{
+    uint16 size = toneCodecDecodedSize(key, key_len);
+
+    if((size > TONE_CODEC_MAX_DECODED_SIZE) || !toneCodecDecode(key, key_len, tones, size))
+        return 0;
+    return size;
+}
+
+
+static void testPackRoundTrip( void )
+{
+    uint16 key[TEST_BLOCK_SIZE];
+    ringtone_note tones[TONE_CODEC_MAX_DECODED_SIZE];
+    uint16 legacy_len = buildLegacy(key);
+    uint16 len = toneCodecPack(key, legacy_len, TEST_BLOCK_SIZE);
+    uint8 index;
+
+    CHECK(len != 0);
+    CHECK(len < legacy_len);
+    CHECK(key[0] == TONE_CODEC_MAGIC);
+    CHECK(decode(key, len, tones) == legacy_len);
+
+    for(index = 0; index < MAX_NUM_VARIABLE_TONES; index++)
+        checkTone(tones, index, (index == 0) ? tone_a : (index == 5) ? tone_b : NULL);
+
+    /* packing again leaves the block as it is */
+    CHECK(toneCodecPack(key, len, TEST_BLOCK_SIZE) == len);
+}
+
+static void testReplace( void )
+{
+    uint16 key[TEST_BLOCK_SIZE];
+    ringtone_note tones[TONE_CODEC_MAX_DECODED_SIZE];
+    uint16 len = toneCodecPack(key, buildLegacy(key), TEST_BLOCK_SIZE);
+
+    len = toneCodecRemove(key, len, 0);
+    CHECK(len != 0);
+    len = toneCodecAppend(key, len, TEST_BLOCK_SIZE, 0, tone_c);
+    CHECK(len != 0);
+    len = toneCodecAppend(key, len, TEST_BLOCK_SIZE, 7, tone_a);
+    CHECK(len != 0);
+
+    CHECK(decode(key, len, tones) == MAX_NUM_VARIABLE_TONES + toneLength(tone_a) + toneLength(tone_b) + toneLength(tone_c));
+    checkTone(tones, 0, tone_c);
+    checkTone(tones, 5, tone_b);
+    checkTone(tones, 7, tone_a);
+
+    /* removing a tone not held changes nothing */
+    CHECK(toneCodecRemove(key, len, 3) == len);
+}
+
+static void testEmpty( void )
+{
+    uint16 key[TEST_BLOCK_SIZE];
+    ringtone_note tones[TONE_CODEC_MAX_DECODED_SIZE];
+    uint16 len = toneCodecPack(key, 0, TEST_BLOCK_SIZE);
+
+    CHECK(len == TONE_CODEC_HEADER_SIZE);
+    CHECK(decode(key, len, tones) == MAX_NUM_VARIABLE_TONES);
+    checkTone(tones, 0, NULL);
+
+    CHECK(toneCodecPack(key, 0, TONE_CODEC_HEADER_SIZE - 1) == 0);
+}
+
+static void testUnterminated( void )
+{
+    uint16 key[TEST_BLOCK_SIZE];
+    uint16 len = buildLegacy(key);
+
+    /* drop the RINGTONE_END of the last tone in the block */
+    CHECK(toneCodecPack(key, len - 1, TEST_BLOCK_SIZE) == 0);
+}
+
+static void testNoRoom( void )
+{
+    uint16 key[TEST_BLOCK_SIZE];
+    uint16 len = buildLegacy(key);
+
+    CHECK(toneCodecPack(key, len, TONE_CODEC_HEADER_SIZE + 4) == 0);
+}
+
+static void testBadRecord( void )
+{
+    uint16 key[TEST_BLOCK_SIZE];
+    ringtone_note tones[TONE_CODEC_MAX_DECODED_SIZE];
+    uint16 len = toneCodecPack(key, buildLegacy(key), TEST_BLOCK_SIZE);
+
+    /* cut the block short in the middle of the last record */
+    CHECK(decode(key, len - 1, tones) == 0);
+}
+
+
+int main( void )
+{
+    testPackRoundTrip();
+    testReplace();
+    testEmpty();
+    testUnterminated();
+    testNoRoom();
+    testBadRecord();
+
+    printf("test_tone_codec: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
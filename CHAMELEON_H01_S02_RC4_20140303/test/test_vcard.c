@@ -0,0 +1,319 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    test_vcard.c
+
+DESCRIPTION
+    Host test and benchmark of the streaming vCard parser. A phonebook of
+    1000 entries, some with folded lines, is fed in packets of several sizes
+    so lines are split across them. Every entry must come out of the
+    streaming parser whole. The parser sink_pbap.c used before is run on
+    the same packets and the entries each finds and the time each takes
+    are printed.
+
+*/
+
+#include "sink_vcard.h"
+#include "vcard_legacy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define TEST_ENTRIES        (1000)
+#define TEST_ENTRY_SIZE     (160)
+#define TEST_RUNS           (20)
+
+#define CHECK(x) \
+    do { if(!(x)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #x); failures++; } } while(0)
+
+/* what each entry should be read as */
+typedef struct
+{
+    char    tel[VCARD_MAX_TEL + 1];
+    char    name[VCARD_MAX_NAME + 1];
+} test_entry;
+
+static int failures;
+
+static test_entry expected[TEST_ENTRIES];
+static uint8 * phonebook;
+static uint32 phonebook_len;
+
+/* packet sizes, the largest as the PBAP client may deliver */
+static const uint16 packet_sizes[] = { 1, 7, 64, 255, 1000 };
+
+/* a packet for the old parser with nothing of the phonebook after it */
+static uint8 legacy_packet[0x20000];
+
+static uint16 stream_next;
+static uint16 stream_wrong;
+static uint16 legacy_found;
+static uint16 legacy_right;
+
+
+/****************************************************************************
+NAME
+    appendEntry
+
+DESCRIPTION
+    Write entry i of the phonebook at p and fill in what it should be read
+    as. Every tenth entry has its N folded and a folded NOTE, every seventh
+    has only an FN and every fiftieth has no number.
+
+RETURNS
+    the characters written
+*/
+static int appendEntry( char * p, unsigned i )
+{
+    test_entry * e = &expected[i];
+    int n = 0;
+
+    n += sprintf(p + n, "BEGIN:VCARD\r\nVERSION:2.1\r\n");
+
+    if(i % 10 == 0)
+    {
+        n += sprintf(p + n, "N:Smith%04u;Mary\r\n Ann;;;\r\n", i);
+        sprintf(e->name, "Smith%04u Mary Ann   ", i);
+    }
+    else if(i % 7 == 0)
+    {
+        n += sprintf(p + n, "FN:Solo %04u\r\n", i);
+        sprintf(e->name, "Solo %04u", i);
+    }
+    else
+    {
+        n += sprintf(p + n, "N:Last%04u;First;;;\r\nFN:First Last%04u\r\n", i, i);
+        sprintf(e->name, "Last%04u First   ", i);
+    }
+
+    if(i % 50 != 0)
+    {
+        n += sprintf(p + n, "TEL;TYPE=CELL:+4477009%05u\r\nTEL;TYPE=HOME:+441223%06u\r\n", i, i);
+        sprintf(e->tel, "+4477009%05u", i);
+    }
+
+    if(i % 10 == 0)
+        n += sprintf(p + n, "NOTE:Prefers a call\r\n after six\r\n");
+
+    n += sprintf(p + n, "END:VCARD\r\n");
+    return n;
+}
+
+/****************************************************************************
+NAME
+    buildPhonebook
+
+DESCRIPTION
+    Build the phonebook object
+
+RETURNS
+    void
+*/
+static void buildPhonebook( void )
+{
+    char * p = malloc(TEST_ENTRIES * TEST_ENTRY_SIZE);
+    uint16 i;
+
+    phonebook = (uint8 *)p;
+    phonebook_len = 0;
+
+    for(i = 0; i < TEST_ENTRIES; i++)
+        phonebook_len += appendEntry(p + phonebook_len, i);
+}
+
+/****************************************************************************
+NAME
+    fieldIs
+
+DESCRIPTION
+    Check a field of a parsed entry
+
+RETURNS
+    TRUE if it holds the string expected
+*/
+static bool fieldIs( const uint8 * field, uint16 len, const char * value )
+{
+    return (len == strlen(value)) && (memcmp(field, value, len) == 0);
+}
+
+/****************************************************************************
+NAME
+    runStream
+
+DESCRIPTION
+    Feed the phonebook to the streaming parser in packets, as sink_pbap.c
+    does, checking each entry against the one expected when check is set
+
+RETURNS
+    void
+*/
+static void runStream( uint16 packet, bool check )
+{
+    vcard_parser parser;
+    uint32 offset;
+
+    vcardParserInit(&parser);
+    stream_next = 0;
+    stream_wrong = 0;
+
+    for(offset = 0; offset < phonebook_len; offset += packet)
+    {
+        const uint8 * data = phonebook + offset;
+        uint16 len = (phonebook_len - offset < packet) ? (uint16)(phonebook_len - offset) : packet;
+
+        while(len)
+        {
+            const vcard_entry * entry;
+            uint16 used = vcardParse(&parser, data, len);
+
+            data += used;
+            len  -= used;
+
+            if(((entry = vcardEntryComplete(&parser)) != NULL) && check)
+            {
+                const test_entry * e = &expected[stream_next];
+
+                if((stream_next >= TEST_ENTRIES) ||
+                   !fieldIs(entry->tel, entry->tel_len, e->tel) ||
+                   !fieldIs(entry->name, entry->name_len, e->name))
+                {
+                    stream_wrong++;
+                }
+                stream_next++;
+            }
+        }
+    }
+}
+
+/****************************************************************************
+NAME
+    legacyFound
+
+DESCRIPTION
+    Check an entry found by the old parser against the entry its number
+    belongs to
+
+RETURNS
+    void
+*/
+static void legacyFound( const uint8 * tel, uint8 tel_len, const uint8 * name, uint8 name_len )
+{
+    char number[VCARD_MAX_TEL + 1];
+    unsigned i;
+
+    legacy_found++;
+
+    if((tel_len < sizeof(number)) && (tel_len > 8))
+    {
+        memcpy(number, tel, tel_len);
+        number[tel_len] = '\0';
+        i = (unsigned)atoi(number + 8);
+
+        if((i < TEST_ENTRIES) && fieldIs(tel, tel_len, expected[i].tel) &&
+           fieldIs(name, name_len, expected[i].name))
+        {
+            legacy_right++;
+        }
+    }
+}
+
+/****************************************************************************
+NAME
+    runLegacy
+
+DESCRIPTION
+    Feed the phonebook to the old parser, which searched each packet on
+    its own
+
+RETURNS
+    void
+*/
+static void runLegacy( uint16 packet )
+{
+    uint32 offset;
+
+    legacy_found = 0;
+    legacy_right = 0;
+
+    for(offset = 0; offset < phonebook_len; offset += packet)
+    {
+        uint16 len = (phonebook_len - offset < packet) ? (uint16)(phonebook_len - offset) : packet;
+
+        /* the old parser reads past the end of a packet, up to 64K with a
+           length gone negative, so it is given the packet alone */
+        memcpy(legacy_packet, phonebook + offset, len);
+        vcardLegacyParse(legacy_packet, len, legacyFound);
+        memset(legacy_packet, 0, len);
+    }
+}
+
+/****************************************************************************
+NAME
+    msPerRun
+
+DESCRIPTION
+    Time a parser over the whole phonebook
+
+RETURNS
+    the milliseconds taken for one pass
+*/
+static double msPerRun( void (*run)(uint16 packet, bool check), uint16 packet )
+{
+    clock_t start = clock();
+    uint16 i;
+
+    for(i = 0; i < TEST_RUNS; i++)
+        run(packet, FALSE);
+
+    return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / TEST_RUNS;
+}
+
+static void runLegacyTimed( uint16 packet, bool check )
+{
+    (void)check;
+    runLegacy(packet);
+}
+
+
+int main( void )
+{
+    uint16 i;
+
+    buildPhonebook();
+    printf("  %u entries, %lu bytes\n", TEST_ENTRIES, phonebook_len);
+
+    for(i = 0; i < sizeof(packet_sizes) / sizeof(packet_sizes[0]); i++)
+    {
+        uint16 packet = packet_sizes[i];
+
+        unsigned stream_right;
+        unsigned legacy;
+        unsigned legacy_ok;
+        double stream_ms;
+        double legacy_ms;
+
+        runStream(packet, TRUE);
+        CHECK(stream_next == TEST_ENTRIES);
+        CHECK(stream_wrong == 0);
+        stream_right = stream_next - stream_wrong;
+
+        runLegacy(packet);
+        legacy = legacy_found;
+        legacy_ok = legacy_right;
+
+        stream_ms = msPerRun(runStream, packet);
+        legacy_ms = msPerRun(runLegacyTimed, packet);
+
+        printf("  packet %4u: streaming %u right %.2fms, legacy %u found %u right %.2fms\n",
+               (unsigned)packet, stream_right, stream_ms, legacy, legacy_ok, legacy_ms);
+    }
+
+    free(phonebook);
+
+    printf("test_vcard: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
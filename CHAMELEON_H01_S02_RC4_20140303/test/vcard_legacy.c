@@ -0,0 +1,231 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    vcard_legacy.c
+
+DESCRIPTION
+    The phonebook parsing sink_pbap.c did before sink_vcard.c, kept to
+    compare the two. Each packet was searched on its own with memstr and
+    memchr for the first entry holding a TEL. The code is as it was apart
+    from a guard against a value with no line end in the packet.
+
+*/
+
+#include "vcard_legacy.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define PBAP_DEBUG(x)
+#define mallocPanic(x) malloc(x)
+#define freePanic(x) free(x)
+
+static const char gpbapbegin[] = "BEGIN:VCARD"; 
+static const char gpbapname[]  = "\nN";
+static const char gpbaptel[]   = "TEL";
+static const char gpbapend[]   = "END:VCARD";
+
+typedef struct 
+{
+    uint8 telLen;
+    uint8 *pTel;
+    uint8 nameLen;
+    uint8 pName[1];    
+}pbapMetaData;
+
+
+static uint8 *memstr( const uint8 *buffer, const uint16 buffer_size, const uint8 *str, const uint16 count )
+{
+
+    uint8 *p = (uint8 *)memchr(buffer, str[0], buffer_size);
+    PBAP_DEBUG(("PBAP memstr\n"));
+    
+    while (p && p < buffer + buffer_size)
+    {
+        if(memcmp((char *)p, (char *)str, count) == 0)
+        {
+            return p;
+        }
+        p += 1;
+        p = (uint8 *)memchr(p, str[0], (uint16)(buffer+buffer_size - p));
+    }
+    
+    return 0;
+}
+
+static uint16 VcardFindMetaData( const uint8 *start, const uint8 *end, uint8 **metaData, const char *str, const uint16 count)
+{
+    uint16 len;
+    uint8 *p         = (uint8 *)start;
+    uint8 *endstring = NULL;
+       
+    PBAP_DEBUG(("PBAP VcardFindMetaData\n"));
+
+    /* find the MetaData */
+    len         = (uint16)(end - p);
+    
+    if((((*metaData) = (uint8 *)memstr(p, len, (uint8 *)str, strlen(str))) != NULL) &&
+       (((*metaData) = (uint8 *)memchr((uint8 *)(*metaData), ':',  end - (*metaData))) != NULL))
+    {
+        (*metaData) += 1;
+        endstring    = (uint8 *)memchr((uint8 *)(*metaData), '\n', end - (*metaData));
+        
+        /* added for the host: the value running to the end of the packet
+           gave a length from a NULL pointer */
+        if(!endstring)
+            return 0;
+        endstring -= 1;
+    }
+    else
+    {
+        /* There are some errors about the format of phonebook. */
+        return 0;
+    }
+    
+    return(endstring - (*metaData));
+}
+
+static uint8 VcardGetFirstTel(const uint8* pVcard, const uint16 vcardLen, pbapMetaData **pMetaData)
+{ 
+    uint16 len    = 0;
+    uint16 telLen, nameLen = 0;
+    uint8 *pTel   = NULL;
+    uint8 *pName  = NULL;
+    
+    /* Find the start and end position of the first Vcard Entry */
+    uint8 *start  = memstr(pVcard, vcardLen, (uint8 *)gpbapbegin, strlen(gpbapbegin));
+    uint8 *end    = memstr(pVcard, vcardLen, (uint8 *)gpbapend,   strlen(gpbapend));
+    end           = (end == NULL) ? (uint8 *)(pVcard + vcardLen - 1) : end;
+
+#ifdef DEBUG_PBAP    
+    {
+        uint16 i;
+        PBAP_DEBUG(("The pVcard is: "));
+
+        for(i = 0; i < vcardLen; i++)
+            PBAP_DEBUG(("%c", *(pVcard + i))); 
+        
+        PBAP_DEBUG(("\n"));    
+    }
+#endif
+    
+    PBAP_DEBUG(("First entry start:[%x], end:[%x]\n", (uint16)start, (uint16)end));
+    
+    while(start && start < end)
+    {
+        start = start + strlen(gpbapbegin);
+
+        /* find the Tel */
+        telLen = VcardFindMetaData(start, end, &pTel, gpbaptel, strlen(gpbaptel));
+        
+        if( telLen )
+        {
+            PBAP_DEBUG(("VcardGetFirstTel:telephone number found ok\n"));
+            
+            /* find the Name */
+            nameLen = VcardFindMetaData(start, end, &pName, gpbapname, strlen(gpbapname));
+            
+            /* allocate the memory for pMetaData structure */
+            *pMetaData = (pbapMetaData *)mallocPanic(sizeof(pbapMetaData) + nameLen);
+
+            if(pMetaData)
+            {
+                (*pMetaData)->pTel    = pTel;
+                (*pMetaData)->telLen  = telLen;       
+                (*pMetaData)->nameLen = nameLen;
+            
+                PBAP_DEBUG(("CallerID pos:[%x], len:[%d]\n", (uint16)pName, nameLen));
+           
+                if(nameLen)
+                {
+                    /* This memory should be freed after pbap dial command or TTS has completed */
+                    memmove(&((*pMetaData)->pName), pName, nameLen);
+                    (*pMetaData)->pName[nameLen] = '\0';
+                
+                    /* Remove the ';' between names */
+                    /* Based on PBAP spec., the name format is: 
+                      LastName;FirstName;MiddleName;Prefix;Suffix
+                    */
+                    len = nameLen;
+                    pName = (*pMetaData)->pName;
+                    while(pName < (*pMetaData)->pName + nameLen)
+                    {
+                        pName    = (uint8 *)memchr(pName, ';', len) ;
+                        /*if no ; is found exit */                            
+                        if(!pName)
+                            break;
+                        *pName++ = ' ';
+                        /* determine how many characters are left */
+                        len  = nameLen - (pName - (*pMetaData)->pName);
+                    }
+                
+                    PBAP_DEBUG(("VcardGetFirstTel:CallerID found ok\n"));
+                }
+
+                return(telLen);
+            }
+            else
+            {
+                PBAP_DEBUG(("VcardGetFirstTel:No memory slot to store MetaData\n"));
+                return 0;
+            }
+        }
+        
+        /* If the first Vcard Entry the Tel is enmty, try next Entry. */
+        /* First find the next Vcard Entry start and end positions    */
+        end = end + strlen(gpbapend);
+        len = (uint16)(pVcard + vcardLen - end);
+        start = memstr(end, len , (uint8 *)gpbapbegin, strlen(gpbapbegin));
+        end   = memstr(end, len,  (uint8 *)gpbapend,   strlen(gpbapend));
+        end   = (end == NULL) ? (uint8 *)(pVcard + vcardLen - 1) : end;
+        
+        PBAP_DEBUG(("next start:[%x], end:[%x]\n", (uint16)start, (uint16)end));
+    }
+     
+    PBAP_DEBUG(("VcardGetFirstTel:telephone number not found\n"));
+   
+    return 0;
+}
+
+
+/****************************************************************************
+NAME
+    vcardLegacyParse
+*/
+uint16 vcardLegacyParse( const uint8 * data, uint16 len, vcard_legacy_found found )
+{
+    pbapMetaData *pMetaData = NULL;
+    uint16 entries = 0;
+    
+    /* as the dial did for each entry without a number, the search starts
+       again after the entry found, or after the end of the first entry if
+       there was none, as the packet may start part way through an entry */
+    while(len)
+    {
+        const uint8 *next;
+        
+        if(VcardGetFirstTel(data, len, &pMetaData))
+        {
+            found(pMetaData->pTel, pMetaData->telLen, pMetaData->pName, pMetaData->nameLen);
+            entries++;
+            next = memstr(pMetaData->pTel, (uint16)(data + len - pMetaData->pTel), (uint8 *)gpbapend, strlen(gpbapend));
+            freePanic(pMetaData);
+        }
+        else
+        {
+            next = memstr(data, len, (uint8 *)gpbapend, strlen(gpbapend));
+        }
+        
+        /* memstr may match an END:VCARD running off the end of the packet */
+        if(!next || (next + strlen(gpbapend) > data + len))
+            break;
+        
+        next += strlen(gpbapend);
+        len  -= (uint16)(next - data);
+        data  = next;
+    }
+    
+    return entries;
+}
@@ -0,0 +1,33 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2004-2013
+
+FILE NAME
+    vcard_legacy.h
+
+DESCRIPTION
+    The phonebook parsing sink_pbap.c did before sink_vcard.c
+
+*/
+#ifndef VCARD_LEGACY_H
+#define VCARD_LEGACY_H
+
+#include <csrtypes.h>
+
+
+/* called with each entry found, name is 0 long if the entry had no N */
+typedef void (*vcard_legacy_found)( const uint8 * tel, uint8 tel_len, const uint8 * name, uint8 name_len );
+
+/****************************************************************************
+NAME
+    vcardLegacyParse
+
+DESCRIPTION
+    Find every entry holding a TEL in one packet of phonebook data, as the
+    old parser searched a packet
+
+RETURNS
+    the number of entries found
+*/
+uint16 vcardLegacyParse( const uint8 * data, uint16 len, vcard_legacy_found found );
+
+#endif /* VCARD_LEGACY_H */